@@ -8,6 +8,12 @@
      Fills all values stored in heap with 0s before they are free'd.
      Recommended for more strict performance scenarios, but not security-wise.
 
+   FLUFF_VM_PROFILE:
+     Makes the VM count every instruction it executes (see 'FluffVM::executed').
+     Meant to measure how IR changes affect the work done at runtime.
+     Also lets 'fluff --profile <file>' list the opcode sequences a script runs the most,
+     which is how the superinstructions were picked (see 'VMProfile').
+
    
 
 */
@@ -0,0 +1,35 @@
+#pragma once
+#ifndef FLUFF_CORE_AOT_H
+#define FLUFF_CORE_AOT_H
+
+/* -=============
+     Includes
+   =============- */
+
+#include <base.h>
+#include <core/ir.h>
+
+/* -========
+     AOT
+   ========- */
+
+/*
+    Binaries are compiled ahead of time into a C file ('fluff compile --emit-c'), which the system compiler
+    builds into a native program linked against libfluff.
+
+    Each chunk becomes a C function set as the callback of its method, so calls go through the VM like calls
+    to native functions. The stack size before each instruction is known like on the JIT, entries are addressed
+    from the frame base: ints, floats and bools are handled inline, anything else goes through the fluff_vm_*
+    functions running single instructions. Callback frames don't hold the callee, so every local is one entry
+    lower than on IR frames.
+
+    Nothing of the binary is kept but its code: literals are written inline and methods are created when the
+    program starts. The file has a 'main' running the main chunk and printing its result, unless it's compiled
+    with FLUFF_AOT_NO_MAIN.
+*/
+
+typedef struct FluffInstance FluffInstance;
+
+FLUFF_PRIVATE_API FluffResult _aot_emit_c(FluffInstance * instance, const IRBinary * binary, const char * path, FILE * out);
+
+#endif
\ No newline at end of file
@@ -94,8 +94,33 @@ typedef struct FluffConfig {
     FluffMutexTryLockFn mutex_try_lock_fn;
     FluffMutexFreeFn    free_mutex_fn;
 
+    // NOTE: rejects code whose types can't be proven at compile time, so it runs without runtime type checks
     bool strict_mode;
     bool manual_mem;
+
+    // NOTE: reports what the peephole optimizer did to every compiled binary, 'dump_ir' prints its code
+    bool opt_stats;
+    bool dump_ir;
+
+    // NOTE: reads stop once the source is parsed into a syntax tree, nothing is compiled or run
+    bool check;
+
+    // NOTE: translates compiled chunks into register IR and runs them on the register interpreter
+    bool register_vm;
+
+    // NOTE: compiles hot chunks to native code, platforms without a JIT keep interpreting them
+    bool jit;
+
+    // NOTE: records hot loops of the stack VM into traces compiled to native code, 'trace_stats' reports them after a run
+    bool trace_jit;
+    bool trace_stats;
+
+    // NOTE: runs write what they found out into the profile at 'pgo_out', compilations read it back from 'pgo_in'
+    const char * pgo_in;
+    const char * pgo_out;
+
+    // NOTE: 'alloc_fn' and 'free_fn' must be thread-safe to lex with more than 1 thread, 0 keeps the default
+    size_t lexer_threads;
 } FluffConfig;
 
 /*! Initializes fluff. If 'cfg' is NULL then the default configuration will be used instead. */
@@ -9,31 +9,74 @@
 #include <base.h>
 #include <core/string.h>
 
-// TODO: make a constant table inside the IR so we use less memory
 // TODO: better IR structure
 
 /* -===========
      Macros
    ===========- */
 
+/*
+    Operands follow their opcode:
+        uint   = unsigned LEB128 varint
+        const  = uint index into the constant pool of the binary
+        jump8  = signed byte, relative to the end of the instruction
+        jump32 = signed 32-bit integer, relative to the end of the instruction
+        nibble = unsigned value packed into the low 4 bits of the opcode itself
+
+    LT_JZ and the 0x5x opcodes are superinstructions, the optimizer fuses the sequences
+    they stand for (see '_ir_optimize_chunk') and they behave exactly like them:
+        STORE_LOCAL x   = SET_LOCAL x; POP
+        INC_LOCAL x, c  = GET_LOCAL x; PUSH_INT c; ADD; SET_LOCAL x; POP
+        ADD_LOCALS x, y = GET_LOCAL x; GET_LOCAL y; ADD
+        ADD_INT c       = PUSH_INT c; ADD
+        SUB_INT c       = PUSH_INT c; SUB
+        LT_JZ           = LT; JZ
+
+    ILT_JNZ is ILT_JZ with the jump inverted, it's only left by the profile guided layout
+    (see '_ir_layout_chunk') when the jump was mostly taken.
+
+    TAIL_CALL n is a CALL n the optimizer found right before a RET. The VM runs the function
+    in the frame of the caller, which it returns from directly (native code returns first and
+    leaves the call to the VM): the RET after it stays for the tiers that run it as a plain CALL.
+
+    The VM quickens generic arithmetic and comparisons the first time they run, turning
+    them into a form specialized for the classes of their operands (ADD into ADD_INT_INT,
+    LT_JZ into LT_JZ_INT...). A quickened instruction checks those classes and goes back
+    to its generic form when they don't match.
+
+    The typed opcodes (IADD, FLT, ILT_JZ...) are emitted by the code generator when it has
+    proven the classes of both operands, they skip every check. CHECK is the runtime check
+    left at the boundaries it couldn't prove, it fails unless the top of the stack is of the
+    class it is given.
+*/
 #define IR_OP_NOP         0x00 // void
-#define IR_OP_JMP         0x01 // int32
-#define IR_OP_JZ          0x02 // int32
-#define IR_OP_JNZ         0x03 // int32
+#define IR_OP_JMP         0x01 // jump32
+#define IR_OP_JZ          0x02 // jump32
+#define IR_OP_JNZ         0x03 // jump32
+#define IR_OP_JMP_S       0x04 // jump8
+#define IR_OP_JZ_S        0x05 // jump8
+#define IR_OP_JNZ_S       0x06 // jump8
+#define IR_OP_LT_JZ       0x07 // jump32
+#define IR_OP_LT_JZ_S     0x08 // jump8
+#define IR_OP_ILT_JZ      0x0b // jump32
+#define IR_OP_ILT_JZ_S    0x0c // jump8
+#define IR_OP_ILT_JNZ     0x0d // jump32
+#define IR_OP_ILT_JNZ_S   0x0e // jump8
 #define IR_OP_PUSH_VOID   0x10 // void
 #define IR_OP_PUSH_TRUE   0x11 // void
 #define IR_OP_PUSH_FALSE  0x12 // void
-#define IR_OP_PUSH_INT    0x13 // int
-#define IR_OP_PUSH_FLOAT  0x14 // float
-#define IR_OP_PUSH_STRING 0x15 // string
-#define IR_OP_PUSH_OBJECT 0x16 // string
-#define IR_OP_PUSH_ARRAY  0x17 // int
+#define IR_OP_PUSH_INT    0x13 // const
+#define IR_OP_PUSH_FLOAT  0x14 // const
+#define IR_OP_PUSH_STRING 0x15 // const
+#define IR_OP_PUSH_OBJECT 0x16 // const
+#define IR_OP_PUSH_ARRAY  0x17 // uint
 #define IR_OP_POP         0x18 // void
-#define IR_OP_POPN        0x19 // int
-#define IR_OP_SET_LOCAL   0x20 // int
-#define IR_OP_GET_LOCAL   0x21
-#define IR_OP_GET_MEMBER  0x22
-#define IR_OP_SET_MEMBER  0x23
+#define IR_OP_POPN        0x19 // uint
+#define IR_OP_PUSH_FUNC   0x1a // uint
+#define IR_OP_SET_LOCAL   0x20 // uint
+#define IR_OP_GET_LOCAL   0x21 // uint
+#define IR_OP_GET_MEMBER  0x22 // const
+#define IR_OP_SET_MEMBER  0x23 // const
 #define IR_OP_GET_ITEM    0x24
 #define IR_OP_SET_ITEM    0x25
 #define IR_OP_ADD         0x31
@@ -59,9 +102,80 @@
 #define IR_OP_AND         0x46
 #define IR_OP_OR          0x47
 #define IR_OP_NOT         0x48
-#define IR_OP_IS          0x49
-#define IR_OP_AS          0x4a
-#define IR_OP_CALL        0x70
+#define IR_OP_IS          0x49 // const
+#define IR_OP_AS          0x4a // const
+#define IR_OP_CHECK       0x4b // const
+#define IR_OP_STORE_LOCAL 0x50 // uint
+#define IR_OP_INC_LOCAL   0x51 // uint, const
+#define IR_OP_ADD_LOCALS  0x52 // uint, uint
+#define IR_OP_ADD_INT     0x53 // const
+#define IR_OP_SUB_INT     0x54 // const
+#define IR_OP_CALL        0x70 // uint
+#define IR_OP_RET         0x71 // void
+#define IR_OP_TAIL_CALL   0x72 // uint
+#define IR_OP_SET_LOCAL_N 0x80 // nibble
+#define IR_OP_GET_LOCAL_N 0x90 // nibble
+#define IR_OP_CALL_N      0xa0 // nibble
+#define IR_OP_IADD        0xb0
+#define IR_OP_ISUB        0xb1
+#define IR_OP_IMUL        0xb2
+#define IR_OP_IEQ         0xb3
+#define IR_OP_INE         0xb4
+#define IR_OP_IGT         0xb5
+#define IR_OP_IGE         0xb6
+#define IR_OP_ILT         0xb7
+#define IR_OP_ILE         0xb8
+#define IR_OP_FADD        0xb9
+#define IR_OP_FSUB        0xba
+#define IR_OP_FMUL        0xbb
+#define IR_OP_FEQ         0xbc
+#define IR_OP_FNE         0xbd
+#define IR_OP_FGT         0xbe
+#define IR_OP_FGE         0xbf
+#define IR_OP_FLT         0xc0
+#define IR_OP_FLE         0xc1
+
+// NOTE: quickened opcodes are never emitted, the VM rewrites generic ones into them at runtime
+#define IR_OP_LT_JZ_INT       0x09 // jump32
+#define IR_OP_LT_JZ_INT_S     0x0a // jump8
+#define IR_OP_ADD_INT_INT     0x58
+#define IR_OP_ADD_FLOAT_FLOAT 0x59
+#define IR_OP_SUB_INT_INT     0x5a
+#define IR_OP_SUB_FLOAT_FLOAT 0x5b
+#define IR_OP_MUL_INT_INT     0x5c
+#define IR_OP_MUL_FLOAT_FLOAT 0x5d
+#define IR_OP_EQ_INT_INT      0x5e
+#define IR_OP_EQ_FLOAT_FLOAT  0x5f
+#define IR_OP_NE_INT_INT      0x60
+#define IR_OP_NE_FLOAT_FLOAT  0x61
+#define IR_OP_GT_INT_INT      0x62
+#define IR_OP_GT_FLOAT_FLOAT  0x63
+#define IR_OP_GE_INT_INT      0x64
+#define IR_OP_GE_FLOAT_FLOAT  0x65
+#define IR_OP_LT_INT_INT      0x66
+#define IR_OP_LT_FLOAT_FLOAT  0x67
+#define IR_OP_LE_INT_INT      0x68
+#define IR_OP_LE_FLOAT_FLOAT  0x69
+
+#define IR_OP_NIBBLE_MASK 0x0f
+#define IR_OP_NIBBLE_MAX  0x0f
+
+// NOTE: the longest varint is 10 bytes, enough for any 64-bit value
+#define IR_VARINT_MAX_SIZE 10
+
+#define _ir_opcode_is_nibble(__op)  ((__op) >= IR_OP_SET_LOCAL_N && (__op) <= (IR_OP_CALL_N | IR_OP_NIBBLE_MASK))
+#define _ir_opcode_is_jump(__op)    ((__op) >= IR_OP_JMP && (__op) <= IR_OP_ILT_JNZ_S)
+#define _ir_opcode_is_typed(__op)   ((__op) >= IR_OP_IADD && (__op) <= IR_OP_FLE)
+#define _ir_opcode_is_binary(__op)  (((__op) >= IR_OP_ADD && (__op) <= IR_OP_BIT_SHR) || ((__op) >= IR_OP_EQ && (__op) <= IR_OP_OR) || _ir_opcode_is_typed(__op))
+#define _ir_opcode_is_unary(__op)   ((__op) == IR_OP_BIT_NOT || (__op) == IR_OP_NEGATE || (__op) == IR_OP_NOT)
+#define _ir_opcode_short_jump(__op) ((__op) >= IR_OP_LT_JZ ? (__op) + 1 : (__op) + (IR_OP_JMP_S - IR_OP_JMP))
+
+#define IR_CONSTANT_INT    0x0
+#define IR_CONSTANT_FLOAT  0x1
+#define IR_CONSTANT_STRING 0x2
+#define IR_CONSTANT_KLASS  0x3
+
+#define IR_CONSTANT_NONE UINT32_MAX
 
 #define _make_ir_opcode(__type) (IROpcode){ .data = { .op = __type } }
 
@@ -70,13 +184,10 @@
    =============- */
 
 // This struct represents an opcode inside the IR.
+// NOTE: nibble opcodes keep their operand in the low 4 bits, see '_ir_opcode_is_nibble'
 typedef union IROpcode {
     struct {
         uint8_t op : 8;
-
-        // TODO: use this
-        // uint8_t arg1 : 4;
-        // uint8_t arg2 : 4;
     } data;
     uint8_t word;
 } IROpcode;
@@ -85,35 +196,155 @@ typedef union IROpcode {
      IRChunk
    ============- */
 
+typedef struct IRRegChunk IRRegChunk;
+typedef struct JitCode JitCode;
+typedef struct TraceLoop TraceLoop;
+typedef struct IRFeedback IRFeedback;
+
+// This struct represents an instruction of a chunk that came from a function inlined into it (see core/optimizer.h).
+// NOTE: 'origin' is its address in the code of 'method', an instruction inlined through several functions has a site
+//       for each of them, the outermost one first
+typedef struct IRInlineSite {
+    size_t   start, end;
+    uint64_t method;
+    size_t   origin;
+} IRInlineSite;
+
 // This struct represents a chunk inside the IR.
 typedef struct IRChunk {
     uint8_t * data;
-    size_t    size;
+    size_t    size, capacity;
+
+    // NOTE: the register form of 'data', only there when the chunk was translated into it
+    IRRegChunk * registers;
+
+    // NOTE: set when every call inside the chunk was proven to pass arguments of the right classes
+    bool typed;
+
+    // NOTE: counts the calls and loop iterations of the chunk, 'native' is set once it gets hot
+    size_t    hotness;
+    JitCode * native;
+
+    // NOTE: the loops the stack VM found running the chunk, along with their traces (see core/trace.h)
+    TraceLoop * loops;
+    size_t      loop_count, loop_capacity;
+
+    // NOTE: only there while feedback is recorded or once a profile moved its blocks (see core/pgo.h)
+    IRFeedback * feedback;
+
+    // NOTE: sorted by address, errors raised inside inlined code still name the functions it came from
+    IRInlineSite * inlined;
+    size_t         inlined_count;
 } IRChunk;
 
 FLUFF_PRIVATE_API void _new_ir_chunk(IRChunk * self);
 FLUFF_PRIVATE_API void _free_ir_chunk(IRChunk * self);
 
+FLUFF_PRIVATE_API size_t _ir_chunk_inlined_at(const IRChunk * self, size_t ip, const IRInlineSite ** sites);
+
 FLUFF_PRIVATE_API void _ir_chunk_append(IRChunk * self, const void * data, size_t size);
 FLUFF_PRIVATE_API void _ir_chunk_append_opcode(IRChunk * self, uint8_t opcode);
-FLUFF_PRIVATE_API void _ir_chunk_append_int(IRChunk * self, FluffInt v);
-FLUFF_PRIVATE_API void _ir_chunk_append_float(IRChunk * self, FluffFloat v);
-FLUFF_PRIVATE_API void _ir_chunk_append_string(IRChunk * self, const char * str);
-FLUFF_PRIVATE_API void _ir_chunk_append_string_n(IRChunk * self, const char * str, size_t len);
+FLUFF_PRIVATE_API void _ir_chunk_append_uint(IRChunk * self, uint64_t v);
+FLUFF_PRIVATE_API void _ir_chunk_append_i8(IRChunk * self, int8_t v);
+FLUFF_PRIVATE_API void _ir_chunk_append_i32(IRChunk * self, int32_t v);
+FLUFF_PRIVATE_API void _ir_chunk_append_const(IRChunk * self, uint32_t index);
 FLUFF_PRIVATE_API void _ir_chunk_append_chunk(IRChunk * self, IRChunk * chunk);
+FLUFF_PRIVATE_API void _ir_chunk_patch_i32(IRChunk * self, size_t offset, int32_t v);
+
+FLUFF_PRIVATE_API void   _ir_chunk_append_instruction(IRChunk * self, uint8_t op, uint64_t arg, uint64_t arg2);
+FLUFF_PRIVATE_API size_t _ir_instruction_size(uint8_t op, uint64_t arg, uint64_t arg2);
+
+typedef struct IRBinary IRBinary;
+
+// This struct represents a decoded instruction.
+// NOTE: short jumps and nibble opcodes are widened to their long form, 'arg' and 'arg2' hold their operands
+typedef struct IRInstruction {
+    uint8_t  op;
+    uint64_t arg, arg2;
+    int32_t  jump;
+    size_t   size;
+} IRInstruction;
+
+FLUFF_PRIVATE_API const char *  _ir_opcode_name(uint8_t op);
+FLUFF_PRIVATE_API uint64_t      _ir_read_uint(const uint8_t * code, size_t * ip);
+FLUFF_PRIVATE_API IRInstruction _ir_decode(const uint8_t * code, size_t ip);
+FLUFF_PRIVATE_API bool          _ir_stack_use(const IRInstruction * inst, size_t * pops, size_t * pushes);
+FLUFF_PRIVATE_API bool          _ir_stack_effect(const IRInstruction * inst, size_t depth, size_t * next);
+FLUFF_PRIVATE_API uint8_t       _ir_generic_opcode(uint8_t op);
+
+#define IR_FLOW_UNKNOWN SIZE_MAX
+
+// This struct represents an instruction of a chunk along with the stack it runs on, as the tiers compiling it see it.
+// NOTE: 'depth' is the stack size before it runs, unreachable instructions never get one
+typedef struct IRFlowInst {
+    IRInstruction inst;
+    size_t        offset;
+    size_t        target;
+    size_t        depth;
+    bool          label;
+} IRFlowInst;
+
+FLUFF_PRIVATE_API bool _ir_flow_chunk(const IRChunk * chunk, size_t preserve, IRFlowInst ** insts, size_t * count, size_t * stack_size);
+FLUFF_PRIVATE_API bool _ir_flow_depths(IRFlowInst * insts, size_t count, size_t preserve, size_t * stack_size);
+
+FLUFF_PRIVATE_API void _ir_chunk_dump(IRChunk * self, const IRBinary * binary);
+
+/* -===============
+     IRConstant
+   ===============- */
 
-FLUFF_PRIVATE_API void _ir_chunk_dump(IRChunk * self);
+typedef struct FluffKlass FluffKlass;
+
+// This struct represents a literal stored once inside the constant pool of a binary.
+typedef struct IRConstant {
+    uint8_t  type;
+    uint64_t hash;
+    union {
+        FluffInt     i;
+        FluffFloat   f;
+        FluffString  s;
+        FluffKlass * klass;
+    } data;
+} IRConstant;
 
 /* -=============
      IRBinary
    =============- */
 
+typedef struct FluffMethod FluffMethod;
+
 // This struct represents a binary inside the IR.
+// NOTE: functions are compiled into the chunk of their method, 'IR_OP_PUSH_FUNC' refers to them by index
 typedef struct IRBinary {
     IRChunk main_chunk;
+
+    FluffMethod ** methods;
+    size_t         method_count, method_capacity;
+
+    // NOTE: literals are deduplicated, every chunk refers to them by their index in the pool
+    IRConstant * constants;
+    size_t       constant_count, constant_capacity;
+
+    // NOTE: open addressing, each bucket holds (index + 1) so zeroes mean empty
+    uint32_t * buckets;
+    size_t     bucket_count;
 } IRBinary;
 
 FLUFF_PRIVATE_API IRBinary * _new_ir_binary();
 FLUFF_PRIVATE_API void       _free_ir_binary(IRBinary * self);
 
+FLUFF_PRIVATE_API size_t _ir_binary_add_method(IRBinary * self, FluffMethod * method);
+
+FLUFF_PRIVATE_API uint32_t           _ir_binary_add_int(IRBinary * self, FluffInt v);
+FLUFF_PRIVATE_API uint32_t           _ir_binary_add_float(IRBinary * self, FluffFloat v);
+FLUFF_PRIVATE_API uint32_t           _ir_binary_add_string(IRBinary * self, const char * str, size_t len);
+FLUFF_PRIVATE_API uint32_t           _ir_binary_add_klass(IRBinary * self, FluffKlass * klass);
+FLUFF_PRIVATE_API const IRConstant * _ir_binary_get_constant(const IRBinary * self, uint32_t index);
+FLUFF_PRIVATE_API void               _ir_binary_truncate_constants(IRBinary * self, size_t count);
+FLUFF_PRIVATE_API size_t             _ir_binary_code_size(const IRBinary * self);
+FLUFF_PRIVATE_API size_t             _ir_binary_memory_usage(const IRBinary * self);
+
+FLUFF_PRIVATE_API void   _ir_binary_clear(IRBinary * self);
+FLUFF_PRIVATE_API void   _ir_binary_dump(IRBinary * self);
+
 #endif
\ No newline at end of file
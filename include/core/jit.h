@@ -0,0 +1,88 @@
+#pragma once
+#ifndef FLUFF_CORE_JIT_H
+#define FLUFF_CORE_JIT_H
+
+/* -=============
+     Includes
+   =============- */
+
+#include <base.h>
+#include <core/ir.h>
+
+/* -===========
+     Macros
+   ===========- */
+
+// NOTE: how many calls and loop iterations a chunk goes through before it's compiled to native code
+#ifndef FLUFF_JIT_THRESHOLD
+#define FLUFF_JIT_THRESHOLD 1000
+#endif
+
+// NOTE: only x86-64 Linux is supported, with the stencils generated at build time (FLUFF_JIT_STENCILS),
+// chunks keep running on the interpreter anywhere else
+#if defined(__x86_64__) && defined(__linux__) && defined(FLUFF_JIT_STENCILS)
+#define FLUFF_JIT_AVAILABLE 1
+#else
+#define FLUFF_JIT_AVAILABLE 0
+#endif
+
+/* -============
+     JitCode
+   ============- */
+
+/*
+    Native code is copied and patched together from stencils, the code of each opcode precompiled from
+    tools/jit_stencils.c into a table the build generates (see tools/jit_stencil_gen.c).
+    Every stencil takes the VM and the frame base the VM pushed for the chunk, and jumps to the next one.
+
+    The stack size before each instruction is known when compiling, so entries are addressed straight from
+    the frame base. Ints, floats and bools are handled inline, anything else goes through helpers that run
+    it like the stack interpreter would.
+
+    Since every stencil can be entered like the chunk itself, a frame running a long loop on the interpreter
+    moves into the code at the loop header (on-stack replacement): entries are laid out the same way on both
+    sides, so the frame is taken over as it is. The code never speculates on classes, so it has no reason to
+    give the frame back and runs it to its end.
+*/
+
+typedef struct FluffVM FluffVM;
+typedef struct FluffObject FluffObject;
+
+typedef FluffResult(* JitEntryFn)(FluffVM *, FluffObject *);
+
+// This struct represents a place where a frame running on the interpreter can move into native code.
+// NOTE: these are loop headers, the frame has to have 'depth' entries there like it always does
+typedef struct JitOsrEntry {
+    size_t     ip;
+    size_t     depth;
+    JitEntryFn entry;
+} JitOsrEntry;
+
+// This struct represents the native code of a chunk.
+typedef struct JitCode {
+    // NOTE: empty when the chunk couldn't be compiled, so it's never tried again
+    JitEntryFn entry;
+    void     * memory;
+    size_t     size;
+
+    // NOTE: the code is only valid for the instance and frame size it was compiled for
+    FluffInstance * instance;
+    size_t          preserve;
+
+    // NOTE: the biggest stack size the chunk reaches
+    size_t stack_size;
+
+    // NOTE: loops running on the interpreter move into the code at their header, see _jit_osr_entry
+    JitOsrEntry * osr_entries;
+    size_t        osr_count;
+} JitCode;
+
+typedef struct Trace Trace;
+
+FLUFF_PRIVATE_API JitCode * _jit_compile_chunk(FluffVM * vm, IRChunk * chunk, size_t preserve);
+FLUFF_PRIVATE_API JitCode * _jit_compile_trace(FluffVM * vm, Trace * trace);
+FLUFF_PRIVATE_API void      _free_jit_code(JitCode * self);
+
+FLUFF_PRIVATE_API JitEntryFn _jit_osr_entry(const JitCode * self, size_t ip, size_t depth);
+
+#endif
\ No newline at end of file
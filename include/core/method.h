@@ -27,6 +27,7 @@ typedef struct FluffModule FluffModule;
 typedef struct FluffKlass FluffKlass;
 typedef struct FluffObject FluffObject;
 typedef struct FluffVM FluffVM;
+typedef struct IRChunk IRChunk;
 
 typedef FluffResult(* FluffMethodCallback)(FluffVM *, size_t);
 
@@ -49,11 +50,17 @@ typedef struct FluffMethod {
     size_t           property_count;
 
     FluffMethodCallback callback;
+    IRChunk           * chunk;
 
     uint8_t flags;
     size_t  index;
 } FluffMethod;
 
+FLUFF_API FluffMethod * fluff_new_method(const char * name, FluffMethodCallback callback);
+FLUFF_API void          fluff_free_method(FluffMethod * self);
+
+FLUFF_API size_t fluff_method_add_param(FluffMethod * self, const char * name, FluffKlass * klass);
+
 FLUFF_PRIVATE_API FluffMethod * _new_method(const char * name, size_t len);
 FLUFF_PRIVATE_API void          _free_method(FluffMethod * self);
 
@@ -8,6 +8,7 @@
 
 #include <base.h>
 #include <core/string.h>
+#include <core/symbol.h>
 
 /* -===========
      Module
@@ -30,6 +31,8 @@ typedef struct FluffModule {
 
     FluffModule * requirements[FLUFF_MAX_MODULE_REQUIREMENTS];
 
+    SymbolTable symbols;
+
     size_t index;
 } FluffModule;
 
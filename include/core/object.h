@@ -100,6 +100,7 @@ FLUFF_PRIVATE_API void _ref_object(FluffObject * self, FluffObject * obj);
 FLUFF_PRIVATE_API void _clone_object(FluffObject * self, FluffObject * obj);
 FLUFF_PRIVATE_API void _free_object(FluffObject * self);
 
+FLUFF_PRIVATE_API void _object_copy_primitive(FluffObject * self, FluffObject * obj);
 FLUFF_PRIVATE_API void _object_alloc(FluffObject * self, FluffObject * clone_obj);
 
 FLUFF_PRIVATE_API ObjectTable * _object_get_table(FluffObject * self);
@@ -0,0 +1,98 @@
+#pragma once
+#ifndef FLUFF_CORE_OPTIMIZER_H
+#define FLUFF_CORE_OPTIMIZER_H
+
+/* -=============
+     Includes
+   =============- */
+
+#include <base.h>
+#include <core/ir.h>
+
+/* -=============
+     Peephole
+   =============- */
+
+// This struct represents what the peephole optimizer did to one or more chunks.
+typedef struct IROptStats {
+    size_t chunks;
+    size_t passes;
+
+    size_t bytes_before, bytes_after;
+    size_t instructions_before, instructions_after;
+
+    size_t push_pops;   // pure pushes dropped along with the POP that follows them
+    size_t not_jumps;   // NOT folded into the conditional jump after it
+    size_t jumps;       // jumps retargeted past a JMP or removed for landing on the next instruction
+    size_t pop_merges;  // POP and POPN merged together
+    size_t nops;        // NOPs dropped
+    size_t dead;        // unreachable instructions dropped after a JMP or RET
+    size_t short_jumps; // jumps encoded in their short form
+
+    size_t superinstructions; // sequences fused into a single instruction
+    size_t tail_calls;        // calls right before a return made to reuse the frame
+    size_t inlined;           // calls replaced with the body of the function they call
+} IROptStats;
+
+FLUFF_PRIVATE_API void _ir_optimize_chunk(IRChunk * chunk, IROptStats * stats);
+FLUFF_PRIVATE_API void _ir_optimize_binary(IRBinary * binary, IROptStats * stats);
+
+FLUFF_PRIVATE_API void _ir_opt_stats_dump(const IROptStats * stats);
+
+/* -===========
+     Layout
+   ===========- */
+
+// This struct represents how the condition of a conditional jump went on a profiled run, 'ip' is its address.
+typedef struct IRBranchWeight {
+    size_t   ip;
+    uint64_t truthy, falsy;
+} IRBranchWeight;
+
+FLUFF_PRIVATE_API size_t * _ir_layout_chunk(IRChunk * chunk, const IRBranchWeight * weights, size_t count);
+
+/* -=============
+     Inlining
+   =============- */
+
+/*
+    Calls to small functions are replaced with their body before the peephole pass runs, in chunks whose calls
+    were all checked against the functions they call ('typed'). Functions are bound when the code is compiled,
+    so the function a PUSH_FUNC pushes is the one its CALL runs.
+
+    The slot the function was pushed into is kept as a void, the arguments sit right above it like they would on
+    the frame of the function, so its locals are only shifted by the size of the stack below. Returns store their
+    value into that slot and pop everything above it, then jump past the body.
+
+    Only leaves are inlined, functions calling nothing, with at most FLUFF_INLINE_MAX_SIZE instructions once
+    their returns are expanded.
+
+    Compiling with a profile (see core/pgo.h) goes through the calls that are left once more, after the profile
+    was applied: functions the profiled run called at least FLUFF_INLINE_HOT_CALLS times are inlined up to
+    FLUFF_INLINE_HOT_MAX_SIZE instructions.
+
+    Inlined code keeps a site for every instruction (see 'IRInlineSite'), naming the function it came from and
+    where it was in there, so an error raised inside of it still goes through the frame of that function. Sites
+    follow the code of the function as later passes move it, they point to the instruction as it ends up.
+*/
+
+// NOTE: bodies past this size cost more in code than they save in calls
+#ifndef FLUFF_INLINE_MAX_SIZE
+#define FLUFF_INLINE_MAX_SIZE 24
+#endif
+
+// NOTE: a function called this often saves enough calls to pay for a bigger body
+#ifndef FLUFF_INLINE_HOT_CALLS
+#define FLUFF_INLINE_HOT_CALLS 1000
+#endif
+
+#ifndef FLUFF_INLINE_HOT_MAX_SIZE
+#define FLUFF_INLINE_HOT_MAX_SIZE 96
+#endif
+
+FLUFF_PRIVATE_API void     _ir_inline_binary(IRBinary * binary, IROptStats * stats);
+FLUFF_PRIVATE_API size_t * _ir_inline_hot_chunk(IRBinary * binary, IRChunk * chunk, size_t preserve, const FluffMethod * owner,
+                                                const uint64_t * calls, size_t * inlined);
+FLUFF_PRIVATE_API void     _ir_inline_moved(IRBinary * binary, uint64_t method, const size_t * origins);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,60 @@
+#pragma once
+#ifndef FLUFF_CORE_PGO_H
+#define FLUFF_CORE_PGO_H
+
+/* -=============
+     Includes
+   =============- */
+
+#include <base.h>
+#include <core/ir.h>
+
+/* -=============
+     Feedback
+   =============- */
+
+/*
+    A VM recording feedback ('pgo_out' in the config) counts the calls and loop iterations of every chunk of the
+    binary it runs, along with the way its conditional jumps went. Once the run ends those counts are written into
+    a profile, with the opcodes quickening left in each chunk.
+
+    Compiling the same code with that profile ('pgo_in') puts it back in the shape the run left it in, without
+    having to run it first:
+        - the blocks of an if/else are swapped when the jump in front of them was mostly taken, so the hot one
+          follows the condition
+        - generic opcodes are quickened into the form the run rewrote them into
+        - chunks that got hot start right below the JIT threshold, so they're compiled the first time they run
+        - functions called often are inlined into their callers with a bigger size limit (see core/optimizer.h),
+          once everything above was done
+
+    Superinstructions don't come from the profile: the sequences the optimizer fuses are fixed, they were picked
+    with the opcode profiler (see core/profiler.h) and are fused wherever they show up.
+
+    Chunks are matched by their place in the binary (the main chunk, then every method) and by a hash of their
+    code before the profile reshaped it, chunks that changed since the profile was written are left alone.
+    Addresses in the profile refer to that code as well, chunks that calls were inlined into keep a map back to it
+    so a run of the inlined code still writes a profile the next compilation can read.
+*/
+
+// This struct represents what is known about the way a chunk runs.
+typedef struct IRFeedback {
+    uint64_t hash;
+    size_t   size;
+
+    // NOTE: the address in the profiled code of every address starting an instruction, only there once code moved
+    size_t * origins;
+
+    // NOTE: only while recording, 'truthy' and 'falsy' count the conditions of the jump at each address
+    uint64_t   hotness;
+    uint64_t   calls;
+    uint64_t * truthy;
+    uint64_t * falsy;
+} IRFeedback;
+
+FLUFF_PRIVATE_API void _free_ir_feedback(IRFeedback * self);
+
+FLUFF_PRIVATE_API void        _pgo_record_binary(IRBinary * binary);
+FLUFF_PRIVATE_API FluffResult _pgo_write(const IRBinary * binary, const char * path);
+FLUFF_PRIVATE_API void        _pgo_apply(IRBinary * binary, const char * path);
+
+#endif
\ No newline at end of file
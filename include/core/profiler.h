@@ -0,0 +1,51 @@
+#pragma once
+#ifndef FLUFF_CORE_PROFILER_H
+#define FLUFF_CORE_PROFILER_H
+
+/* -=============
+     Includes
+   =============- */
+
+#include <base.h>
+#include <core/ir.h>
+#include <core/vm.h>
+
+#ifdef FLUFF_VM_PROFILE
+
+/* -==============
+     VMProfile
+   ==============- */
+
+// This struct represents a trigram of opcodes and how many times it ran.
+typedef struct VMProfileGram {
+    uint32_t key;
+    uint64_t count;
+} VMProfileGram;
+
+// This struct represents the opcode n-grams a VM executed, used to pick superinstructions.
+// NOTE: only instructions laid out one after another in a chunk form a sequence, taken jumps and calls break it
+typedef struct VMProfile {
+    uint64_t   executed;
+    uint64_t   unigrams[0x100];
+    uint64_t * bigrams;
+
+    // NOTE: open addressing keyed by the 3 opcodes, empty buckets have no count
+    VMProfileGram * trigrams;
+    size_t          trigram_count, trigram_capacity;
+
+    const IRChunk * chunk;
+    size_t          next_ip;
+    uint8_t         history[2];
+    size_t          history_count;
+} VMProfile;
+
+FLUFF_PRIVATE_API void _new_vm_profile(VMProfile * self);
+FLUFF_PRIVATE_API void _free_vm_profile(VMProfile * self);
+
+FLUFF_PRIVATE_API void _vm_profile_attach(VMProfile * self, FluffVM * vm);
+FLUFF_PRIVATE_API void _vm_profile_record(VMProfile * self, const IRChunk * chunk, size_t ip);
+FLUFF_PRIVATE_API void _vm_profile_dump(VMProfile * self, size_t top);
+
+#endif
+
+#endif
\ No newline at end of file
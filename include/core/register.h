@@ -0,0 +1,66 @@
+#pragma once
+#ifndef FLUFF_CORE_REGISTER_H
+#define FLUFF_CORE_REGISTER_H
+
+/* -=============
+     Includes
+   =============- */
+
+#include <base.h>
+#include <core/ir.h>
+
+/* -===============
+     IRRegChunk
+   ===============- */
+
+/*
+    Register IR reuses the opcodes of the stack IR, operands are registers of the frame:
+        PUSH_VOID/TRUE/FALSE a           r[a] = constant
+        PUSH_INT/FLOAT/STRING a, x       r[a] = K[x]
+        PUSH_FUNC a, x                   r[a] = methods[x]
+        GET_LOCAL a, b                   r[a] = r[b]
+        ADD...OR, IADD...FLE a, b, c     r[a] = r[b] op r[c]
+        BIT_NOT/NEGATE/NOT a, b          r[a] = op r[b]
+        ADD_INT/SUB_INT a, b, x          r[a] = r[b] op K[x]
+        IS/AS a, b, x                    r[a] = r[b] is/as K[x]
+        JMP x                            jumps by x instructions
+        JZ/JNZ a, x                      jumps by x instructions if r[a] is false/true
+        LT_JZ/ILT_JZ b, c, x             jumps by x instructions unless r[b] < r[c]
+        ILT_JNZ b, c, x                  jumps by x instructions if r[b] < r[c]
+        CHECK b, x                       fails unless r[b] is of class K[x]
+        CALL a, b                        calls r[a] with r[a + 1]...r[a + b], the result lands in r[a]
+        RET a                            returns r[a]
+
+    Registers are the stack slots of the frame, so r[0] is the callee and arguments follow it.
+    Jumps are relative to the instruction right after them.
+*/
+
+// This struct represents a register instruction.
+typedef struct IRRegInstruction {
+    uint8_t  op;
+    uint16_t a, b, c;
+    int32_t  x;
+} IRRegInstruction;
+
+// This struct represents the register form of an IR chunk.
+typedef struct IRRegChunk {
+    IRRegInstruction * code;
+    size_t             size, capacity;
+
+    // NOTE: how many stack slots a frame running this chunk takes
+    size_t register_count;
+
+    // NOTE: the address of the stack instruction every one of them was translated from, errors report those
+    size_t * addresses;
+} IRRegChunk;
+
+FLUFF_PRIVATE_API void _new_ir_reg_chunk(IRRegChunk * self);
+FLUFF_PRIVATE_API void _free_ir_reg_chunk(IRRegChunk * self);
+
+FLUFF_PRIVATE_API size_t _ir_reg_chunk_append(IRRegChunk * self, uint8_t op, uint16_t a, uint16_t b, uint16_t c, int32_t x);
+FLUFF_PRIVATE_API void   _ir_reg_chunk_dump(const IRRegChunk * self);
+
+FLUFF_PRIVATE_API FluffResult _ir_translate_chunk(IRChunk * chunk, size_t preserve);
+FLUFF_PRIVATE_API void        _ir_translate_binary(IRBinary * binary);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,53 @@
+#pragma once
+#ifndef FLUFF_CORE_SYMBOL_H
+#define FLUFF_CORE_SYMBOL_H
+
+/* -=============
+     Includes
+   =============- */
+
+#include <base.h>
+
+/* -===========
+     Macros
+   ===========- */
+
+#define SYMBOL_NONE UINT32_MAX
+
+/* -================
+     SymbolTable
+   ================- */
+
+// This struct represents an interned name inside a symbol table.
+typedef struct SymbolEntry {
+    uint64_t hash;
+    uint32_t offset;
+    uint32_t length;
+} SymbolEntry;
+
+// This struct represents a table of interned names, where each name is identified by a 32-bit id.
+// NOTE: ids are given in order of first appearance and are never invalidated.
+typedef struct SymbolTable {
+    SymbolEntry * entries;
+    size_t        entry_count, entry_capacity;
+
+    // NOTE: open addressing, each bucket holds (id + 1) so zeroes mean empty
+    uint32_t * buckets;
+    size_t     bucket_count;
+
+    char * names;
+    size_t names_size, names_capacity;
+} SymbolTable;
+
+FLUFF_PRIVATE_API void _new_symbol_table(SymbolTable * self);
+FLUFF_PRIVATE_API void _free_symbol_table(SymbolTable * self);
+
+FLUFF_PRIVATE_API uint32_t     _symbol_table_intern(SymbolTable * self, const char * name, size_t len);
+FLUFF_PRIVATE_API uint32_t     _symbol_table_find(SymbolTable * self, const char * name, size_t len);
+FLUFF_PRIVATE_API const char * _symbol_table_get(SymbolTable * self, uint32_t id);
+FLUFF_PRIVATE_API size_t       _symbol_table_get_len(SymbolTable * self, uint32_t id);
+FLUFF_PRIVATE_API size_t       _symbol_table_size(SymbolTable * self);
+
+FLUFF_PRIVATE_API void _symbol_table_dump(SymbolTable * self);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,138 @@
+#pragma once
+#ifndef FLUFF_CORE_TRACE_H
+#define FLUFF_CORE_TRACE_H
+
+/* -=============
+     Includes
+   =============- */
+
+#include <base.h>
+#include <core/ir.h>
+#include <core/jit.h>
+
+/* -===========
+     Macros
+   ===========- */
+
+// NOTE: how many iterations a loop goes through before the next one is recorded
+#ifndef FLUFF_TRACE_THRESHOLD
+#define FLUFF_TRACE_THRESHOLD 64
+#endif
+
+// NOTE: recordings longer than this are aborted, the loop keeps running on the interpreter
+#ifndef FLUFF_TRACE_MAX_LENGTH
+#define FLUFF_TRACE_MAX_LENGTH 1024
+#endif
+
+// NOTE: how many recordings a loop can abort before it's never recorded again
+#ifndef FLUFF_TRACE_MAX_ABORTS
+#define FLUFF_TRACE_MAX_ABORTS 4
+#endif
+
+/* -==========
+     Trace
+   ==========- */
+
+/*
+    Traces are recorded by the stack interpreter once a loop gets hot, starting at its header (the target of
+    its backward jump). Each instruction the loop frame runs is recorded along with the classes of the entries
+    it reads and the way its branches went, calls are recorded as a whole.
+
+    The recording becomes a linear list of operations: branches turn into side exits back to the interpreter
+    for the way they didn't go, and guards check the classes the recording saw before ints, floats and bools
+    are handled inline. Guards on entries already known to have the class are removed, the ones holding for
+    the whole loop are hoisted in front of it, and values written into entries of a known class only write
+    their data.
+*/
+
+typedef struct FluffVM FluffVM;
+typedef struct FluffKlass FluffKlass;
+
+// This struct represents a place where a trace gives control back to the interpreter.
+typedef struct TraceExit {
+    size_t   ip;
+    size_t   depth;
+    uint64_t count;
+} TraceExit;
+
+typedef enum TraceOpKind {
+    TRACE_OP_INST,      // 'inst' compiled like the JIT does, branches leave through 'exit'
+    TRACE_OP_GUARD,     // leaves through 'exit' unless entry 'a' is of class 'klass'
+    TRACE_OP_COPY,      // copies the primitive in entry 'a' into entry 'b'
+    TRACE_OP_COPY_DATA, // same, but 'b' already has the class of 'a'
+    TRACE_OP_SET_DATA,  // sets the value of entry 'a' to 'value', it already has the right class
+    TRACE_OP_ADD_DATA,  // adds 'value' to the int in entry 'a'
+    TRACE_OP_LOOP,      // where each iteration starts, past the hoisted guards
+    TRACE_OP_JUMP_LOOP, // back to TRACE_OP_LOOP
+} TraceOpKind;
+
+// This struct represents an operation of a trace.
+typedef struct TraceOp {
+    TraceOpKind   kind;
+    IRInstruction inst;
+    size_t        depth;
+    size_t        a, b;
+    FluffKlass  * klass;
+    uint64_t      value;
+
+    // NOTE: index in the exits of the trace, SIZE_MAX when the operation never leaves
+    size_t exit;
+} TraceOp;
+
+// This struct represents a trace of a loop compiled to native code.
+typedef struct Trace {
+    IRChunk * chunk;
+    size_t    header;
+    size_t    depth;
+
+    TraceOp   * ops;
+    size_t      op_count;
+    TraceExit * exits;
+    size_t      exit_count;
+
+    // NOTE: empty when the trace couldn't be compiled
+    JitCode * native;
+
+    // NOTE: what the optimizer did, reported by _trace_dump_stats
+    size_t   recorded;
+    size_t   guards, guards_removed, guards_hoisted;
+    size_t   unboxed;
+    uint64_t entered;
+} Trace;
+
+// This struct represents a loop of a chunk, found through its backward jump.
+typedef struct TraceLoop {
+    size_t  header;
+    size_t  hotness;
+    size_t  aborts;
+    Trace * trace;
+} TraceLoop;
+
+// This struct represents an instruction as it was recorded.
+// NOTE: 'klass' holds the classes of the entries it reads, see trace_operands
+typedef struct TraceRecord {
+    IRInstruction inst;
+    size_t        ip;
+    size_t        depth;
+    FluffKlass  * klass[2];
+    bool          taken;
+} TraceRecord;
+
+// This struct represents the recording of a loop, the VM keeps it while the loop runs.
+// NOTE: loops are kept by index, the chunk may find new ones while recording
+typedef struct TraceRecorder {
+    IRChunk * chunk;
+    size_t    loop;
+    size_t    frame;
+
+    TraceRecord * records;
+    size_t        count, capacity;
+} TraceRecorder;
+
+FLUFF_PRIVATE_API FluffResult _trace_run_loop(FluffVM * vm, size_t * ip);
+FLUFF_PRIVATE_API void        _trace_record(FluffVM * vm, size_t ip);
+FLUFF_PRIVATE_API void        _trace_abort(FluffVM * vm);
+FLUFF_PRIVATE_API void        _free_trace_loops(IRChunk * chunk);
+FLUFF_PRIVATE_API void        _trace_dump_stats(const IRBinary * binary);
+
+#endif
\ No newline at end of file
@@ -9,47 +9,83 @@
 #include <base.h>
 #include <core/object.h>
 #include <core/string.h>
-
-/* -============
-     VMEntry
-   ============- */
-
-typedef struct VMEntry VMEntry;
-
-typedef struct VMEntry {
-    VMEntry   * prev;
-    FluffObject obj;
-} VMEntry;
+#include <core/ir.h>
 
 /* -============
      VMFrame
    ============- */
 
+// This struct represents a call frame, its entries live in the VM stack starting at 'base'.
 typedef struct VMFrame {
-    VMEntry * last_entry;
-    size_t    entry_count;
+    size_t base;
+
+    // NOTE: how many entries it started with, the arguments and the callee below them on IR frames
+    size_t preserve;
+
+    // NOTE: only frames running IR have a chunk, native calls leave it empty
+    const IRChunk * chunk;
+    size_t          ip;
 } VMFrame;
 
-FLUFF_PRIVATE_API void      _vm_frame_push(VMFrame * self, FluffObject * obj);
-FLUFF_PRIVATE_API void      _vm_frame_pop(VMFrame * self);
-FLUFF_PRIVATE_API void      _vm_frame_popn(VMFrame * self, size_t count);
-FLUFF_PRIVATE_API void      _vm_frame_clear(VMFrame * self);
-FLUFF_PRIVATE_API VMEntry * _vm_frame_at(VMFrame * self, int idx);
+// NOTE: frames are allocated this many at a time, a power of two keeps finding their place in a segment cheap
+#ifndef FLUFF_VM_FRAME_SEGMENT_SIZE
+#define FLUFF_VM_FRAME_SEGMENT_SIZE 64
+#endif
+
+// NOTE: errors name the frames they went through, past this many the rest are only counted
+#ifndef FLUFF_VM_TRACE_FRAMES
+#define FLUFF_VM_TRACE_FRAMES 16
+#endif
+
+// This struct represents a block of frames, blocks are linked as calls go deeper and kept once they return.
+typedef struct VMFrameSegment {
+    struct VMFrameSegment * prev, * next;
+    VMFrame                 frames[FLUFF_VM_FRAME_SEGMENT_SIZE];
+} VMFrameSegment;
 
 /* -=======
      VM
    =======- */
 
 typedef struct FluffModule FluffModule;
+typedef struct TraceRecorder TraceRecorder;
+
+#ifdef FLUFF_VM_PROFILE
+// Callback run before every instruction, 'ip' points to its opcode.
+typedef void (* VMTraceFn)(void * data, const IRChunk * chunk, size_t ip);
+#endif
 
 // This struct represents a VM.
 typedef struct FluffVM {
     FluffInstance * instance;
     FluffModule   * module;
+    IRBinary      * binary;
+
+    FluffObject * stack;
+    size_t        stack_count, stack_capacity;
+
+    // NOTE: 'frames' is the segment holding the last frame pushed, or the first one while none are
+    VMFrame          current_frame;
+    VMFrameSegment * frames;
+    size_t           frame_count;
+
+    // NOTE: set when hot chunks are compiled to native code, 'tail_call' is the chunk native code left to run in
+    //       its frame once it returned
+    bool      jit;
+    IRChunk * tail_call;
+
+    // NOTE: set when hot loops are traced, 'recorder' is only there while one of them is being recorded
+    bool            tracing;
+    TraceRecorder * recorder;
 
-    VMFrame   current_frame;
-    VMFrame * frames;
-    size_t    frame_count, frame_capacity;
+    // NOTE: set when the chunks it runs count their calls, loops and branches for a profile (see core/pgo.h)
+    bool feedback;
+
+#ifdef FLUFF_VM_PROFILE
+    size_t    executed;
+    VMTraceFn trace_fn;
+    void    * trace_data;
+#endif
 } FluffVM;
 
 FLUFF_API FluffVM * fluff_new_vm(FluffInstance * instance, FluffModule * module);
@@ -73,11 +109,48 @@ FLUFF_API size_t        fluff_vm_frame_size(FluffVM * self);
 
 FLUFF_API FluffResult fluff_vm_invoke(FluffVM * self, FluffObject * object, size_t argc);
 
+/* -=- Instructions -=- */
+
+// NOTE: these run single instructions on the current frame like the interpreters do, code compiled ahead of time
+// (see core/aot.h) calls them for anything it doesn't handle inline. Locals are indexed from the frame base.
+typedef FluffResult(* FluffBinaryFn)(FluffObject *, FluffObject *, FluffObject *);
+typedef FluffResult(* FluffUnaryFn)(FluffObject *, FluffObject *);
+
+FLUFF_API FluffResult fluff_vm_reserve(FluffVM * self, size_t count);
+FLUFF_API FluffResult fluff_vm_push_function(FluffVM * self, FluffMethod * method);
+FLUFF_API FluffResult fluff_vm_get_local(FluffVM * self, size_t idx);
+FLUFF_API FluffResult fluff_vm_set_local(FluffVM * self, size_t idx);
+FLUFF_API FluffResult fluff_vm_store_local(FluffVM * self, size_t idx);
+FLUFF_API FluffResult fluff_vm_binary(FluffVM * self, FluffBinaryFn fn, bool is_bool);
+FLUFF_API FluffResult fluff_vm_unary(FluffVM * self, FluffUnaryFn fn, bool is_bool);
+FLUFF_API FluffResult fluff_vm_pop_condition(FluffVM * self, bool * condition);
+FLUFF_API FluffResult fluff_vm_check(FluffVM * self, FluffKlass * klass);
+FLUFF_API FluffResult fluff_vm_is(FluffVM * self, FluffKlass * klass);
+FLUFF_API FluffResult fluff_vm_as(FluffVM * self, FluffKlass * klass);
+FLUFF_API FluffResult fluff_vm_call(FluffVM * self, size_t argc);
+
+// NOTE: a call of the running function from its tail, which code compiled ahead of time turns into a jump back to its
+//       start. The arguments become the only entries of the frame, the callee under them and the rest are freed.
+FLUFF_API FluffResult fluff_vm_reenter(FluffVM * self, size_t argc, bool typed);
+
 FLUFF_PRIVATE_API void _new_vm(FluffVM * self, FluffInstance * instance, FluffModule * module);
 FLUFF_PRIVATE_API void _free_vm(FluffVM * self);
 
+FLUFF_PRIVATE_API FluffResult   _vm_reserve(FluffVM * self, size_t count);
+FLUFF_PRIVATE_API FluffObject * _vm_stack_at(FluffVM * self, int idx);
+FLUFF_PRIVATE_API void          _vm_stack_popn(FluffVM * self, size_t count);
+
+FLUFF_PRIVATE_API FluffResult _vm_execute(FluffVM * self, IRBinary * binary);
+FLUFF_PRIVATE_API FluffResult _vm_run(FluffVM * self, const IRChunk * chunk, size_t preserve);
+FLUFF_PRIVATE_API FluffResult _vm_run_registers(FluffVM * self, const IRChunk * chunk, size_t preserve);
+FLUFF_PRIVATE_API FluffResult _vm_run_native(FluffVM * self, IRChunk * chunk, size_t preserve);
+FLUFF_PRIVATE_API FluffResult _vm_run_chunk(FluffVM * self, IRChunk * chunk, size_t preserve);
+FLUFF_PRIVATE_API FluffResult _vm_call(FluffVM * self, size_t argc, bool typed);
+FLUFF_PRIVATE_API FluffResult _vm_tail_call(FluffVM * self, size_t argc, bool typed);
+
 FLUFF_PRIVATE_API FluffResult _vm_push_frame(FluffVM * self, size_t preserve);
 FLUFF_PRIVATE_API FluffResult _vm_pop_frame(FluffVM * self, size_t preserve);
+FLUFF_PRIVATE_API void        _vm_replace_frame(FluffVM * self, size_t preserve);
 FLUFF_PRIVATE_API void        _vm_clear_frames(FluffVM * self);
 
 #endif
\ No newline at end of file
@@ -9,6 +9,7 @@
 #include <util/container.h>
 #include <core/config.h>
 #include <core/string.h>
+#include <core/symbol.h>
 #include <core/instance.h>
 #include <core/module.h>
 #include <core/class.h>
@@ -16,8 +17,15 @@
 #include <core/object.h>
 #include <core/ir.h>
 #include <core/vm.h>
+#include <core/optimizer.h>
+#include <core/register.h>
+#include <core/profiler.h>
+#include <core/pgo.h>
+#include <core/aot.h>
 #include <parser/text.h>
 #include <parser/lexer.h>
+#include <parser/ast.h>
+#include <parser/analyser.h>
 #include <parser/codegen.h>
 #include <parser/interpret.h>
 
@@ -0,0 +1,50 @@
+#pragma once
+#ifndef FLUFF_PARSER_ANALYSER_H
+#define FLUFF_PARSER_ANALYSER_H
+
+/* -=============
+     Includes
+   =============- */
+
+#include <base.h>
+#include <parser/lexer.h>
+#include <parser/ast.h>
+
+/* -=============
+     Analyser
+   =============- */
+
+// This struct represents a parser that builds a syntax tree out of a token stream.
+typedef struct Analyser {
+    Lexer * lexer;
+    Ast   * ast;
+
+    size_t index;
+    size_t depth;
+    Token  eof;
+
+    // NOTE: lists are gathered here first and then copied into the tree at once
+    AstIndex * scratch;
+    size_t     scratch_count, scratch_capacity;
+} Analyser;
+
+FLUFF_PRIVATE_API void _new_analyser(Analyser * self, Lexer * lexer, Ast * ast);
+FLUFF_PRIVATE_API void _free_analyser(Analyser * self);
+
+FLUFF_PRIVATE_API FluffResult _analyser_read(Analyser * self);
+FLUFF_PRIVATE_API AstIndex    _analyser_read_statement(Analyser * self);
+FLUFF_PRIVATE_API AstIndex    _analyser_read_block(Analyser * self);
+FLUFF_PRIVATE_API AstIndex    _analyser_read_decl(Analyser * self);
+FLUFF_PRIVATE_API AstIndex    _analyser_read_func(Analyser * self);
+FLUFF_PRIVATE_API AstIndex    _analyser_read_class(Analyser * self);
+FLUFF_PRIVATE_API AstIndex    _analyser_read_if(Analyser * self);
+FLUFF_PRIVATE_API AstIndex    _analyser_read_type(Analyser * self);
+FLUFF_PRIVATE_API AstIndex    _analyser_read_expr(Analyser * self, int precedence);
+FLUFF_PRIVATE_API AstIndex    _analyser_read_primary(Analyser * self);
+
+FLUFF_PRIVATE_API const Token * _analyser_peek(Analyser * self, size_t offset);
+FLUFF_PRIVATE_API bool          _analyser_check(Analyser * self, TokenType type);
+FLUFF_PRIVATE_API bool          _analyser_match(Analyser * self, TokenType type);
+FLUFF_PRIVATE_API uint32_t      _analyser_consume(Analyser * self);
+
+#endif
\ No newline at end of file
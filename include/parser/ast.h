@@ -0,0 +1,130 @@
+#pragma once
+#ifndef FLUFF_PARSER_AST_H
+#define FLUFF_PARSER_AST_H
+
+/* -=============
+     Includes
+   =============- */
+
+#include <base.h>
+#include <parser/lexer.h>
+
+/* -===========
+     Macros
+   ===========- */
+
+#define AST_NONE UINT32_MAX
+
+/* -============
+     AstNode
+   ============- */
+
+typedef uint32_t AstIndex;
+
+typedef enum AstNodeType {
+    AST_NODE_NONE,
+
+    AST_NODE_ROOT,
+    AST_NODE_BLOCK,
+
+    AST_NODE_BOOL,
+    AST_NODE_INT,
+    AST_NODE_FLOAT,
+    AST_NODE_STRING,
+    AST_NODE_NULL,
+    AST_NODE_LABEL,
+    AST_NODE_SELF,
+    AST_NODE_SUPER,
+    AST_NODE_ARRAY,
+
+    AST_NODE_UNARY,
+    AST_NODE_BINARY,
+    AST_NODE_ASSIGN,
+    AST_NODE_CALL,
+    AST_NODE_MEMBER,
+    AST_NODE_INDEX,
+    AST_NODE_AS,
+    AST_NODE_IS,
+
+    AST_NODE_TYPE,
+    AST_NODE_DECL,
+    AST_NODE_PARAM,
+    AST_NODE_FUNC,
+    AST_NODE_CLASS,
+
+    AST_NODE_IF,
+    AST_NODE_WHILE,
+    AST_NODE_FOR,
+    AST_NODE_RETURN,
+    AST_NODE_BREAK,
+    AST_NODE_CONTINUE,
+    AST_NODE_REQUIRES,
+} AstNodeType;
+
+FLUFF_PRIVATE_API const char * _ast_node_type_string(AstNodeType type);
+
+#define AST_FLAG_PUB     0x1
+#define AST_FLAG_VIRTUAL 0x2
+
+/*
+    This struct represents a node in the syntax tree. What 'lhs' and 'rhs' hold depends on the type:
+        ROOT, BLOCK, ARRAY  = lhs: list of children
+        UNARY               = lhs: operand
+        BINARY              = lhs: left operand, rhs: right operand
+        ASSIGN, INDEX       = lhs: target, rhs: value
+        CALL                = lhs: callee, rhs: list of arguments
+        MEMBER              = lhs: object, 'token' is the member name
+        AS, IS              = lhs: value, rhs: type
+        DECL, PARAM         = lhs: type or AST_NONE, rhs: value or AST_NONE, 'token' is the name
+        FUNC                = lhs: list of parameters, rhs: extra [return type, body], 'token' is the name
+        CLASS               = lhs: list of base types, rhs: list of members, 'token' is the name
+        IF                  = lhs: condition, rhs: extra [then, else]
+        WHILE               = lhs: condition, rhs: body
+        FOR                 = lhs: iterable, rhs: body, 'token' is the variable name
+        RETURN              = lhs: value or AST_NONE
+    Literals, labels and types only use 'token'.
+    NOTE: a list is an index into the extra data holding its size followed by its items
+*/
+typedef struct AstNode {
+    uint8_t  type;
+    uint8_t  op;
+    uint16_t flags;
+    uint32_t token;
+    AstIndex lhs, rhs;
+} AstNode;
+
+/* -========
+     Ast
+   ========- */
+
+// This struct represents the syntax tree of a compilation unit.
+// NOTE: nodes live in a single arena and point to each other by index, so the whole tree is freed at once
+typedef struct Ast {
+    Lexer * lexer;
+
+    AstNode * nodes;
+    uint32_t  node_count, node_capacity;
+
+    uint32_t * extra;
+    uint32_t   extra_count, extra_capacity;
+
+    AstIndex root;
+} Ast;
+
+FLUFF_PRIVATE_API void _new_ast(Ast * self, Lexer * lexer);
+FLUFF_PRIVATE_API void _free_ast(Ast * self);
+FLUFF_PRIVATE_API void _ast_clear(Ast * self);
+
+FLUFF_PRIVATE_API AstIndex _ast_push(Ast * self, AstNodeType type, uint32_t token, AstIndex lhs, AstIndex rhs);
+FLUFF_PRIVATE_API uint32_t _ast_push_extra(Ast * self, const uint32_t * data, size_t count);
+FLUFF_PRIVATE_API uint32_t _ast_push_list(Ast * self, const AstIndex * items, size_t count);
+
+FLUFF_PRIVATE_API AstNode *        _ast_get(Ast * self, AstIndex index);
+FLUFF_PRIVATE_API const Token *    _ast_get_token(Ast * self, AstIndex index);
+FLUFF_PRIVATE_API size_t           _ast_list_size(Ast * self, uint32_t list);
+FLUFF_PRIVATE_API const AstIndex * _ast_list_items(Ast * self, uint32_t list);
+FLUFF_PRIVATE_API size_t           _ast_memory_usage(Ast * self);
+
+FLUFF_PRIVATE_API void _ast_dump(Ast * self);
+
+#endif
\ No newline at end of file
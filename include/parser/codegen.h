@@ -1,6 +1,6 @@
 #pragma once
-#ifndef FLUFF_PARSER_CODECHUNK_H
-#define FLUFF_PARSER_CODECHUNK_H
+#ifndef FLUFF_PARSER_CODEGEN_H
+#define FLUFF_PARSER_CODEGEN_H
 
 /* -=============
      Includes
@@ -11,9 +11,126 @@
 #include <parser/lexer.h>
 #include <core/ir.h>
 
-/* -==============
-     CodeChunk
-   ==============- */
+/* -============
+     CodeGen
+   ============- */
 
+typedef struct FluffInstance FluffInstance;
+
+// This struct represents a value known at compile time, 'op' is the instruction that pushes it.
+// NOTE: 'op' is IR_OP_NOP when the value isn't known, 'index' points into the constant pool otherwise
+typedef struct CodeGenValue {
+    uint8_t  op;
+    uint32_t index;
+} CodeGenValue;
+
+// This struct represents the type of an expression known at compile time.
+// NOTE: 'klass' is a core class index, or -1 when the type is only known at runtime
+// NOTE: 'method' is the function a value of type 'func' refers to, when it's known
+typedef struct CodeGenType {
+    int           klass;
+    FluffMethod * method;
+} CodeGenType;
+
+// This struct represents a local variable, it lives in the stack slot matching its position.
+typedef struct CodeGenLocal {
+    // NOTE: hidden locals (callees and loop counters) have no name token
+    uint32_t token;
+    uint32_t depth;
+    bool     constant;
+
+    // NOTE: every value stored into a local with a known type is checked against it
+    CodeGenType type;
+
+    // NOTE: constants initialized with a known value are replaced by it wherever they're read
+    CodeGenValue value;
+} CodeGenLocal;
+
+// This struct represents a function known by name, it may be referenced before its definition.
+// NOTE: 'declared' tells whether the signature of its method is known, calls are only checked against it then
+typedef struct CodeGenFunc {
+    uint32_t token;
+    size_t   index;
+    bool     declared;
+    bool     defined;
+} CodeGenFunc;
+
+// This struct represents a loop being compiled.
+typedef struct CodeGenLoop {
+    struct CodeGenLoop * prev;
+
+    // NOTE: 'start' is SIZE_MAX when 'continue' has to jump forward
+    size_t start;
+    size_t local_count;
+    size_t jump_base;
+} CodeGenLoop;
+
+// This struct represents a 'break' or 'continue' waiting for the end of its loop.
+typedef struct CodeGenJump {
+    size_t offset;
+    bool   is_break;
+} CodeGenJump;
+
+// This struct represents a single-pass compiler that emits IR straight out of a token stream.
+typedef struct CodeGen {
+    Lexer         * lexer;
+    IRBinary      * binary;
+    IRChunk       * chunk;
+    FluffInstance * instance;
+
+    size_t index;
+    size_t depth;
+    Token  eof;
+    bool   strict;
+
+    // NOTE: the type of the last expression compiled and the function being compiled, NULL for the main chunk
+    CodeGenType   type;
+    FluffMethod * method;
+
+    CodeGenLocal * locals;
+    size_t         local_count, local_capacity;
+    size_t         local_base;
+    uint32_t       scope_depth;
+
+    CodeGenFunc * funcs;
+    size_t        func_count, func_capacity;
+
+    CodeGenLoop * loop;
+    CodeGenJump * jumps;
+    size_t        jump_count, jump_capacity;
+
+    // NOTE: the last known value pushed, it's only foldable while its instruction ends the chunk
+    CodeGenValue folded;
+    IRChunk    * folded_chunk;
+    size_t       folded_start, folded_end;
+} CodeGen;
+
+FLUFF_PRIVATE_API void _new_codegen(CodeGen * self, Lexer * lexer, IRBinary * binary, FluffInstance * instance);
+FLUFF_PRIVATE_API void _free_codegen(CodeGen * self);
+
+FLUFF_PRIVATE_API FluffResult _codegen_compile(CodeGen * self);
+FLUFF_PRIVATE_API FluffResult _codegen_compile_statement(CodeGen * self);
+FLUFF_PRIVATE_API FluffResult _codegen_compile_block(CodeGen * self);
+FLUFF_PRIVATE_API FluffResult _codegen_compile_decl(CodeGen * self);
+FLUFF_PRIVATE_API FluffResult _codegen_compile_func(CodeGen * self);
+FLUFF_PRIVATE_API FluffResult _codegen_compile_if(CodeGen * self);
+FLUFF_PRIVATE_API FluffResult _codegen_compile_while(CodeGen * self);
+FLUFF_PRIVATE_API FluffResult _codegen_compile_for(CodeGen * self);
+FLUFF_PRIVATE_API FluffResult _codegen_compile_jump(CodeGen * self);
+FLUFF_PRIVATE_API FluffResult _codegen_compile_expr(CodeGen * self, int precedence);
+FLUFF_PRIVATE_API FluffResult _codegen_compile_primary(CodeGen * self, int precedence);
+
+FLUFF_PRIVATE_API void   _codegen_emit(CodeGen * self, uint8_t op);
+FLUFF_PRIVATE_API void   _codegen_emit_uint(CodeGen * self, uint8_t op, uint64_t v);
+FLUFF_PRIVATE_API void   _codegen_emit_const(CodeGen * self, uint8_t op, uint32_t index);
+FLUFF_PRIVATE_API void   _codegen_emit_value(CodeGen * self, CodeGenValue value);
+FLUFF_PRIVATE_API size_t _codegen_emit_jump(CodeGen * self, uint8_t op);
+FLUFF_PRIVATE_API void   _codegen_emit_loop(CodeGen * self, size_t start);
+FLUFF_PRIVATE_API void   _codegen_patch_jump(CodeGen * self, size_t offset);
+
+FLUFF_PRIVATE_API const Token * _codegen_peek(CodeGen * self, size_t offset);
+FLUFF_PRIVATE_API bool          _codegen_check(CodeGen * self, TokenType type);
+FLUFF_PRIVATE_API bool          _codegen_match(CodeGen * self, TokenType type);
+FLUFF_PRIVATE_API uint32_t      _codegen_consume(CodeGen * self);
 
 #endif
\ No newline at end of file
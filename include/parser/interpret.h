@@ -9,17 +9,29 @@
 #include <base.h>
 #include <core/string.h>
 #include <parser/lexer.h>
+#include <parser/ast.h>
+#include <core/ir.h>
 
 /* -================
      Interpreter
    ================- */
 
 typedef struct FluffModule FluffModule;
+typedef struct FluffVM FluffVM;
 
 typedef struct FluffInterpreter {
     const char * path;
 
     FluffModule * module;
+
+    // NOTE: the source is kept along with its tokens so edits only relex what changed, then it's compiled again
+    char * source;
+    size_t source_len, source_capacity;
+    Lexer  lexer;
+
+    // NOTE: only checking fills the syntax tree, compiling reads the tokens straight, see 'FluffConfig.check'
+    Ast        ast;
+    IRBinary * binary;
 } FluffInterpreter;
 
 FLUFF_API FluffInterpreter * fluff_new_interpreter(FluffModule * module);
@@ -27,6 +39,8 @@ FLUFF_API void               fluff_free_interpreter(FluffInterpreter * self);
 
 FLUFF_API FluffResult fluff_interpreter_read_string(FluffInterpreter * self, const char * source);
 FLUFF_API FluffResult fluff_interpreter_read_file(FluffInterpreter * self, const char * path);
+FLUFF_API FluffResult fluff_interpreter_edit(FluffInterpreter * self, size_t offset, size_t removed, const char * text, size_t inserted);
+FLUFF_API FluffResult fluff_interpreter_run(FluffInterpreter * self, FluffVM * vm);
 
 FLUFF_PRIVATE_API FluffResult fluff_interpreter_read(FluffInterpreter * self, const char * source, size_t n);
 
@@ -8,6 +8,7 @@
 
 #include <base.h>
 #include <parser/text.h>
+#include <core/symbol.h>
 
 /* -===========
      Macros
@@ -15,6 +16,9 @@
 
 #define _make_token(__type) ((Token){ .type = __type, .data = { 0 } })
 
+// NOTE: prefix operators bind tighter than every binary operator
+#define TOKEN_UNARY_PRECEDENCE 14
+
 /* -==========
      Token
    ==========- */
@@ -141,6 +145,10 @@ typedef enum TokenType {
 
 FLUFF_PRIVATE_API const char *  _token_type_string(TokenType type);
 FLUFF_PRIVATE_API TokenCategory _token_type_get_category(TokenType type);
+FLUFF_PRIVATE_API int           _token_type_get_precedence(TokenType type);
+FLUFF_PRIVATE_API bool          _token_type_is_right_associative(TokenType type);
+FLUFF_PRIVATE_API bool          _token_type_is_prefix_operator(TokenType type);
+FLUFF_PRIVATE_API bool          _token_type_is_type_keyword(TokenType type);
 
 typedef struct Token {
     TokenType type;
@@ -152,6 +160,7 @@ typedef struct Token {
         FluffInt   i;
         FluffFloat f;
         FluffBool  b;
+        uint32_t   sym;
     } data;
 } Token;
 
@@ -168,16 +177,24 @@ typedef struct Lexer {
     size_t       len;
 
     Token * tokens;
-    size_t  token_count;
+    size_t  token_count, token_capacity;
+
+    SymbolTable * symbols;
 
     TextSect prev_location;
     TextSect location;
+
+    // NOTE: set when the last parse stopped at an error, the tokens end early then
+    bool failed;
 } Lexer;
 
 FLUFF_PRIVATE_API void _new_lexer(Lexer * self, FluffInterpreter * interpret, const char * str, size_t len);
 FLUFF_PRIVATE_API void _free_lexer(Lexer * self);
 
 FLUFF_PRIVATE_API FluffResult _lexer_parse(Lexer * self);
+FLUFF_PRIVATE_API FluffResult _lexer_parse_next(Lexer * self);
+FLUFF_PRIVATE_API FluffResult _lexer_parse_parallel(Lexer * self, size_t thread_count);
+FLUFF_PRIVATE_API FluffResult _lexer_edit(Lexer * self, const char * str, size_t len, size_t offset, size_t removed, size_t inserted);
 FLUFF_PRIVATE_API FluffResult _lexer_parse_comment(Lexer * self);
 FLUFF_PRIVATE_API FluffResult _lexer_parse_number(Lexer * self);
 FLUFF_PRIVATE_API FluffResult _lexer_parse_label(Lexer * self);
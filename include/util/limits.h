@@ -46,4 +46,8 @@
 #define FLUFF_MAX_LEXER_TOKENS 65536
 #endif
 
+#ifndef FLUFF_MAX_PARSER_DEPTH
+#define FLUFF_MAX_PARSER_DEPTH 1024
+#endif
+
 #endif
\ No newline at end of file
@@ -26,6 +26,60 @@ FluffResult println_callback(FluffVM * vm, size_t argc) {
     return FLUFF_OK;
 }
 
+#ifdef FLUFF_VM_PROFILE
+// NOTE: runs a script and reports the opcode sequences it executed the most, see 'VMProfile'
+static void cli_profile(FluffInstance * instance, const char * path) {
+    FluffInterpreter * interpret = fluff_new_interpreter(fluff_instance_get_core_module(instance));
+    FluffVM          * vm        = fluff_new_vm(instance, fluff_instance_get_core_module(instance));
+
+    VMProfile profile;
+    _new_vm_profile(&profile);
+    _vm_profile_attach(&profile, vm);
+
+    if (fluff_interpreter_read_file(interpret, path) == FLUFF_OK && fluff_interpreter_run(interpret, vm) == FLUFF_OK)
+        _vm_profile_dump(&profile, 24);
+
+    _free_vm_profile(&profile);
+    fluff_free_vm(vm);
+    fluff_free_interpreter(interpret);
+}
+#endif
+
+// NOTE: flags like '--jit' or '--pgo-out' set how it runs, see 'fluff_make_config_by_args'
+static void cli_run(FluffInstance * instance, const char * path) {
+    FluffInterpreter * interpret = fluff_new_interpreter(fluff_instance_get_core_module(instance));
+    FluffVM          * vm        = fluff_new_vm(instance, fluff_instance_get_core_module(instance));
+
+    if (fluff_interpreter_read_file(interpret, path) == FLUFF_OK) {
+        // NOTE: a checked source only has its syntax tree, there's nothing to run
+        if (fluff_get_config().check) {
+            fluff_write_fmt("%s: %zu tokens, %u nodes (%zu bytes)\n", 
+                path, interpret->lexer.token_count, interpret->ast.node_count, _ast_memory_usage(&interpret->ast)
+            );
+        } else fluff_interpreter_run(interpret, vm);
+    }
+
+    fluff_free_vm(vm);
+    fluff_free_interpreter(interpret);
+}
+
+// NOTE: compiles a script into a C file to be built against libfluff, see core/aot.h
+static void cli_compile(FluffInstance * instance, const char * path, const char * out_path) {
+    FluffInterpreter * interpret = fluff_new_interpreter(fluff_instance_get_core_module(instance));
+
+    if (fluff_interpreter_read_file(interpret, path) == FLUFF_OK) {
+        FILE * out = fopen(out_path, "w");
+        if (out) {
+            const FluffResult res = _aot_emit_c(instance, interpret->binary, path, out);
+            fclose(out);
+            if (res == FLUFF_FAILURE) remove(out_path);
+        } else {
+            fluff_push_error("failed to open file '%s': %s", out_path, strerror(errno));
+        }
+    }
+    fluff_free_interpreter(interpret);
+}
+
 FLUFF_API void fluff_private_test(FluffInstance * instance) {
     // FluffInterpreter * interpret = fluff_new_interpreter(module);
     // fluff_interpreter_read_file(interpret, "/home/saka/projects/fluff/hello.fluff");
@@ -45,6 +99,20 @@ FLUFF_API void fluff_private_test(FluffInstance * instance) {
 }
 
 FLUFF_API void fluff_cli(FluffInstance * instance, int argc, const char ** argv) {
+#ifdef FLUFF_VM_PROFILE
+    if (argc > 2 && !strcmp(argv[1], "--profile")) {
+        cli_profile(instance, argv[2]);
+        return;
+    }
+#endif
+    if (argc > 2 && !strcmp(argv[1], "run")) {
+        cli_run(instance, argv[2]);
+        return;
+    }
+    if (argc > 4 && !strcmp(argv[1], "compile") && !strcmp(argv[2], "--emit-c")) {
+        cli_compile(instance, argv[3], argv[4]);
+        return;
+    }
     fluff_private_test(instance);
 }
 
@@ -0,0 +1,550 @@
+/* -=============
+     Includes
+   =============- */
+
+#define FLUFF_IMPLEMENTATION
+#include <base.h>
+#include <error.h>
+#include <core/aot.h>
+#include <core/ir.h>
+#include <core/method.h>
+#include <core/instance.h>
+#include <core/class.h>
+#include <core/config.h>
+
+#include <math.h>
+
+/* -==============
+     Internals
+   ==============- */
+
+// NOTE: what typed opcodes stand for, in the order they follow, along with the C operators they compile into
+static const uint8_t aot_arith_ops[] = {
+    IR_OP_ADD, IR_OP_SUB, IR_OP_MUL, IR_OP_EQ, IR_OP_NE, IR_OP_GT, IR_OP_GE, IR_OP_LT, IR_OP_LE,
+};
+static const char * const aot_arith_operators[] = {
+    "+", "-", "*", "==", "!=", ">", ">=", "<", "<=",
+};
+
+// NOTE: written at the top of every file, the code of each chunk is made of these
+static const char * const aot_prelude =
+    "#include <fluff.h>\n"
+    "#include <math.h>\n"
+    "#include <stdio.h>\n"
+    "#include <stdlib.h>\n"
+    "\n"
+    "#define AOT_VOID  aot_klass[FLUFF_KLASS_VOID]\n"
+    "#define AOT_BOOL  aot_klass[FLUFF_KLASS_BOOL]\n"
+    "#define AOT_INT   aot_klass[FLUFF_KLASS_INT]\n"
+    "#define AOT_FLOAT aot_klass[FLUFF_KLASS_FLOAT]\n"
+    "\n"
+    "#define AOT_OBJECT(__klass, __field, __v) ((FluffObject){ .instance = vm->instance, .klass = (__klass), .data.__field = (__v) })\n"
+    "#define AOT_UNBOXED(__obj) ((__obj).klass == AOT_INT || (__obj).klass == AOT_FLOAT || (__obj).klass == AOT_BOOL)\n"
+    "\n"
+    "// NOTE: the stack size is only put back into the VM before calling into it, entries may have moved afterwards\n"
+    "#define AOT_RUN(__depth, __expr) do {\\\n"
+    "        vm->stack_count = base + (__depth);\\\n"
+    "        if ((__expr) == FLUFF_FAILURE) return FLUFF_FAILURE;\\\n"
+    "        f = &vm->stack[base];\\\n"
+    "    } while (0)\n"
+    "\n"
+    "#define AOT_RETURN(__depth) do {\\\n"
+    "        vm->stack_count = base + (__depth);\\\n"
+    "        return FLUFF_OK;\\\n"
+    "    } while (0)\n"
+    "\n"
+    "static FluffKlass * aot_klass[FLUFF_KLASS_FUNC + 1];\n";
+
+// This struct represents the compilation of a chunk into a C function.
+// NOTE: the instruction count stands for the end of the chunk, where the stack VM returns void
+typedef struct Aot {
+    FluffInstance  * instance;
+    const IRBinary * binary;
+    FILE           * out;
+
+    const IRChunk * chunk;
+    const char    * name;
+    size_t          preserve;
+
+    // NOTE: how many entries of the IR frame the callback frame doesn't have, the callee of functions
+    size_t lower;
+
+    // NOTE: the index of the method in 'aot_methods', SIZE_MAX for the main chunk
+    size_t method;
+
+    IRFlowInst * insts;
+    size_t       count;
+    size_t       stack_size;
+    bool         conditions;
+    bool         reenters;
+} Aot;
+
+static void aot_write(Aot * self, const char * restrict fmt, ...) {
+    va_list args;
+    va_start(args, fmt);
+    if (* fmt) fputs("    ", self->out);
+    vfprintf(self->out, fmt, args);
+    fputc('\n', self->out);
+    va_end(args);
+}
+
+// NOTE: anything but printable ASCII is escaped, so the literal reads the same whatever the source encoding is
+static void aot_write_string(FILE * out, const char * str, size_t len) {
+    fputc('"', out);
+    for (size_t i = 0; i < len; ++i) {
+        const unsigned char c = (unsigned char)str[i];
+        if (c == '"' || c == '\\' || c == '?') fprintf(out, "\\%c", c);
+        else if (c >= 0x20 && c < 0x7f) fputc(c, out);
+        else fprintf(out, "\\%03o", c);
+    }
+    fputc('"', out);
+}
+
+static void aot_format_int(char * buf, size_t len, FluffInt v) {
+    if (v == INT64_MIN) fluff_format(buf, len, "INT64_MIN");
+    else fluff_format(buf, len, "INT64_C(%lld)", (long long)v);
+}
+
+// NOTE: hexadecimal literals keep every bit of the float
+static void aot_format_float(char * buf, size_t len, FluffFloat v) {
+    if (isnan(v))      fluff_format(buf, len, "NAN");
+    else if (isinf(v)) fluff_format(buf, len, (v < 0 ? "-INFINITY" : "INFINITY"));
+    else               fluff_format(buf, len, "%a", v);
+}
+
+// NOTE: only core classes are ever referred to by the code generator, anything else can't be compiled
+static bool aot_format_klass(Aot * self, char * buf, size_t len, const FluffKlass * klass) {
+    if (!klass) {
+        fluff_format(buf, len, "NULL");
+        return true;
+    }
+    for (uint8_t i = FLUFF_KLASS_VOID; i <= FLUFF_KLASS_FUNC; ++i) {
+        if (fluff_instance_get_core_class(self->instance, i) != klass) continue;
+        fluff_format(buf, len, "aot_klass[%u]", (unsigned)i);
+        return true;
+    }
+    return false;
+}
+
+FLUFF_CONSTEXPR const char * aot_binary_fn(uint8_t op) {
+    switch (op) {
+        case IR_OP_ADD:     return "fluff_object_add";
+        case IR_OP_SUB:     return "fluff_object_sub";
+        case IR_OP_MUL:     return "fluff_object_mul";
+        case IR_OP_DIV:     return "fluff_object_div";
+        case IR_OP_MOD:     return "fluff_object_mod";
+        case IR_OP_POW:     return "fluff_object_pow";
+        case IR_OP_BIT_AND: return "fluff_object_bit_and";
+        case IR_OP_BIT_OR:  return "fluff_object_bit_or";
+        case IR_OP_BIT_XOR: return "fluff_object_bit_xor";
+        case IR_OP_BIT_SHL: return "fluff_object_bit_shl";
+        case IR_OP_BIT_SHR: return "fluff_object_bit_shr";
+        case IR_OP_EQ:      return "fluff_object_eq";
+        case IR_OP_NE:      return "fluff_object_ne";
+        case IR_OP_GT:      return "fluff_object_gt";
+        case IR_OP_GE:      return "fluff_object_ge";
+        case IR_OP_LT:      return "fluff_object_lt";
+        case IR_OP_LE:      return "fluff_object_le";
+        case IR_OP_AND:     return "fluff_object_and";
+        default:            return "fluff_object_or";
+    }
+}
+
+FLUFF_CONSTEXPR const char * aot_unary_fn(uint8_t op) {
+    switch (op) {
+        case IR_OP_BIT_NOT: return "fluff_object_bit_not";
+        case IR_OP_NEGATE:  return "fluff_object_negate";
+        default:            return "fluff_object_not";
+    }
+}
+
+FLUFF_CONSTEXPR size_t aot_arith_index(uint8_t op) {
+    if (_ir_opcode_is_typed(op)) return (op - IR_OP_IADD) % FLUFF_LENOF(aot_arith_ops);
+
+    size_t index = 0;
+    while (index < FLUFF_LENOF(aot_arith_ops) && aot_arith_ops[index] != op) ++index;
+    return index;
+}
+
+// NOTE: only a call with as many arguments as the function has parameters can take its frame over
+FLUFF_CONSTEXPR bool aot_reenters(const Aot * self, const IRInstruction * inst) {
+    return (inst->op == IR_OP_TAIL_CALL && self->method != SIZE_MAX && inst->arg == self->preserve - self->lower);
+}
+
+/* -=- Compiler -=- */
+// Writes 'inst' for the stack size 'depth' it runs with, as entries of the callback frame.
+static FluffResult aot_emit_inst(Aot * self, const IRFlowInst * t) {
+    const IRInstruction * inst  = &t->inst;
+    const size_t          depth = t->depth - self->lower;
+    const size_t          top   = depth - 1;
+
+    // NOTE: the callee isn't on the callback frame, nothing refers to it but calls to the chunk
+    const bool local = (inst->op == IR_OP_GET_LOCAL || inst->op == IR_OP_SET_LOCAL || inst->op == IR_OP_STORE_LOCAL ||
+                        inst->op == IR_OP_INC_LOCAL || inst->op == IR_OP_ADD_LOCALS);
+    if (local && (inst->arg < self->lower || (inst->op == IR_OP_ADD_LOCALS && inst->arg2 < self->lower))) return FLUFF_FAILURE;
+    const size_t slot  = (local ? inst->arg - self->lower : 0);
+    const size_t slot2 = (inst->op == IR_OP_ADD_LOCALS ? inst->arg2 - self->lower : 0);
+
+    char value[64];
+    switch (inst->op) {
+        case IR_OP_NOP:
+        case IR_OP_PROMOTE: return FLUFF_OK;
+        case IR_OP_JMP: {
+            aot_write(self, "goto L%zu;", t->target);
+            return FLUFF_OK;
+        }
+        // NOTE: anything but a bool makes the VM fail, bools own nothing so the condition is dropped as it is
+        case IR_OP_JZ:
+        case IR_OP_JNZ: {
+            aot_write(self, "if (f[%zu].klass != AOT_BOOL) AOT_RUN(%zu, fluff_vm_pop_condition(vm, &cond));", top, depth);
+            aot_write(self, "if (%sf[%zu].data._bool) goto L%zu;", (inst->op == IR_OP_JZ ? "!" : ""), top, t->target);
+            return FLUFF_OK;
+        }
+        case IR_OP_LT_JZ: {
+            aot_write(self, "if (f[%zu].klass == AOT_INT && f[%zu].klass == AOT_INT) cond = (f[%zu].data._int < f[%zu].data._int);",
+                depth - 2, top, depth - 2, top
+            );
+            aot_write(self, "else {");
+            aot_write(self, "    AOT_RUN(%zu, fluff_vm_binary(vm, fluff_object_lt, true));", depth);
+            aot_write(self, "    AOT_RUN(%zu, fluff_vm_pop_condition(vm, &cond));", depth - 1);
+            aot_write(self, "}");
+            aot_write(self, "if (!cond) goto L%zu;", t->target);
+            return FLUFF_OK;
+        }
+        case IR_OP_ILT_JZ:
+        case IR_OP_ILT_JNZ: {
+            aot_write(self, "if (%s(f[%zu].data._int < f[%zu].data._int)) goto L%zu;",
+                (inst->op == IR_OP_ILT_JZ ? "!" : ""), depth - 2, top, t->target
+            );
+            return FLUFF_OK;
+        }
+        case IR_OP_PUSH_TRUE:
+        case IR_OP_PUSH_FALSE: {
+            aot_write(self, "f[%zu] = AOT_OBJECT(AOT_BOOL, _bool, %s);", depth, (inst->op == IR_OP_PUSH_TRUE ? "true" : "false"));
+            return FLUFF_OK;
+        }
+        case IR_OP_PUSH_INT: {
+            aot_format_int(value, sizeof(value), self->binary->constants[inst->arg].data.i);
+            aot_write(self, "f[%zu] = AOT_OBJECT(AOT_INT, _int, %s);", depth, value);
+            return FLUFF_OK;
+        }
+        case IR_OP_PUSH_FLOAT: {
+            aot_format_float(value, sizeof(value), self->binary->constants[inst->arg].data.f);
+            aot_write(self, "f[%zu] = AOT_OBJECT(AOT_FLOAT, _float, %s);", depth, value);
+            return FLUFF_OK;
+        }
+        case IR_OP_PUSH_VOID: {
+            aot_write(self, "AOT_RUN(%zu, fluff_vm_push_null_object(vm, AOT_VOID));", depth);
+            return FLUFF_OK;
+        }
+        case IR_OP_PUSH_STRING: {
+            const FluffString * str = &self->binary->constants[inst->arg].data.s;
+            fprintf(self->out, "    AOT_RUN(%zu, fluff_vm_push_string_n(vm, ", depth);
+            aot_write_string(self->out, str->data, (size_t)str->length);
+            fprintf(self->out, ", %zu));\n", (size_t)str->length);
+            return FLUFF_OK;
+        }
+        case IR_OP_PUSH_FUNC: {
+            if (inst->arg >= self->binary->method_count) return FLUFF_FAILURE;
+            aot_write(self, "AOT_RUN(%zu, fluff_vm_push_function(vm, aot_methods[%zu]));", depth, (size_t)inst->arg);
+            return FLUFF_OK;
+        }
+        case IR_OP_POP:
+        case IR_OP_POPN: {
+            const size_t n = (inst->op == IR_OP_POP ? 1 : inst->arg);
+            if (n > 0) aot_write(self, "AOT_RUN(%zu, fluff_vm_popn(vm, %zu));", depth, n);
+            return FLUFF_OK;
+        }
+        case IR_OP_GET_LOCAL: {
+            aot_write(self, "if (AOT_UNBOXED(f[%zu])) f[%zu] = f[%zu];", slot, depth, slot);
+            aot_write(self, "else AOT_RUN(%zu, fluff_vm_get_local(vm, %zu));", depth, slot);
+            return FLUFF_OK;
+        }
+        case IR_OP_SET_LOCAL: {
+            if (slot == top) return FLUFF_OK;
+            aot_write(self, "if (AOT_UNBOXED(f[%zu]) && AOT_UNBOXED(f[%zu])) f[%zu] = f[%zu];", slot, top, slot, top);
+            aot_write(self, "else AOT_RUN(%zu, fluff_vm_set_local(vm, %zu));", depth, slot);
+            return FLUFF_OK;
+        }
+        // NOTE: the top entry is moved, so only what the local held has to be freed
+        case IR_OP_STORE_LOCAL: {
+            if (slot == top) {
+                aot_write(self, "AOT_RUN(%zu, fluff_vm_popn(vm, 1));", depth);
+                return FLUFF_OK;
+            }
+            aot_write(self, "if (AOT_UNBOXED(f[%zu])) f[%zu] = f[%zu];", slot, slot, top);
+            aot_write(self, "else AOT_RUN(%zu, fluff_vm_store_local(vm, %zu));", depth, slot);
+            return FLUFF_OK;
+        }
+        case IR_OP_INC_LOCAL: {
+            aot_format_int(value, sizeof(value), self->binary->constants[inst->arg2].data.i);
+            aot_write(self, "if (f[%zu].klass == AOT_INT) f[%zu].data._int += %s;", slot, slot, value);
+            aot_write(self, "else {");
+            aot_write(self, "    AOT_RUN(%zu, fluff_vm_get_local(vm, %zu));", depth, slot);
+            aot_write(self, "    AOT_RUN(%zu, fluff_vm_push_int(vm, %s));", depth + 1, value);
+            aot_write(self, "    AOT_RUN(%zu, fluff_vm_binary(vm, fluff_object_add, false));", depth + 2);
+            aot_write(self, "    AOT_RUN(%zu, fluff_vm_store_local(vm, %zu));", depth + 1, slot);
+            aot_write(self, "}");
+            return FLUFF_OK;
+        }
+        case IR_OP_ADD_LOCALS: {
+            aot_write(self, "if (f[%zu].klass == AOT_INT && f[%zu].klass == AOT_INT) f[%zu] = AOT_OBJECT(AOT_INT, _int, f[%zu].data._int + f[%zu].data._int);",
+                slot, slot2, depth, slot, slot2
+            );
+            aot_write(self, "else {");
+            aot_write(self, "    AOT_RUN(%zu, fluff_vm_get_local(vm, %zu));", depth, slot);
+            aot_write(self, "    AOT_RUN(%zu, fluff_vm_get_local(vm, %zu));", depth + 1, slot2);
+            aot_write(self, "    AOT_RUN(%zu, fluff_vm_binary(vm, fluff_object_add, false));", depth + 2);
+            aot_write(self, "}");
+            return FLUFF_OK;
+        }
+        case IR_OP_ADD_INT:
+        case IR_OP_SUB_INT: {
+            const bool add = (inst->op == IR_OP_ADD_INT);
+            aot_format_int(value, sizeof(value), self->binary->constants[inst->arg].data.i);
+            aot_write(self, "if (f[%zu].klass == AOT_INT) f[%zu].data._int %s= %s;", top, top, (add ? "+" : "-"), value);
+            aot_write(self, "else {");
+            aot_write(self, "    AOT_RUN(%zu, fluff_vm_push_int(vm, %s));", depth, value);
+            aot_write(self, "    AOT_RUN(%zu, fluff_vm_binary(vm, %s, false));", depth + 1, (add ? "fluff_object_add" : "fluff_object_sub"));
+            aot_write(self, "}");
+            return FLUFF_OK;
+        }
+        case IR_OP_CHECK:
+        case IR_OP_IS:
+        case IR_OP_AS: {
+            const FluffKlass * klass = self->binary->constants[inst->arg].data.klass;
+            if (!aot_format_klass(self, value, sizeof(value), klass)) return FLUFF_FAILURE;
+            if (inst->op == IR_OP_CHECK) {
+                if (!klass) return FLUFF_FAILURE;
+                aot_write(self, "if (f[%zu].klass != %s) AOT_RUN(%zu, fluff_vm_check(vm, %s));", top, value, depth, value);
+                return FLUFF_OK;
+            }
+            aot_write(self, "AOT_RUN(%zu, fluff_vm_%s(vm, %s));", depth, (inst->op == IR_OP_IS ? "is" : "as"), value);
+            return FLUFF_OK;
+        }
+        // NOTE: C functions don't reuse frames, a tail call of the function itself jumps back to its start and any
+        //       other runs as a call returned from right after
+        case IR_OP_TAIL_CALL: {
+            if (aot_reenters(self, inst)) {
+                const size_t callee = depth - inst->arg - 1;
+                aot_write(self, "if (f[%zu].klass == aot_klass[FLUFF_KLASS_FUNC] && f[%zu].data._method == aot_methods[%zu]) {", callee, callee, self->method);
+                aot_write(self, "    AOT_RUN(%zu, fluff_vm_reenter(vm, %zu, %s));", depth, (size_t)inst->arg, (self->chunk->typed ? "true" : "false"));
+                aot_write(self, "    goto entry;");
+                aot_write(self, "}");
+            }
+            aot_write(self, "AOT_RUN(%zu, fluff_vm_call(vm, %zu));", depth, (size_t)inst->arg);
+            return FLUFF_OK;
+        }
+        case IR_OP_CALL: {
+            aot_write(self, "AOT_RUN(%zu, fluff_vm_call(vm, %zu));", depth, (size_t)inst->arg);
+            return FLUFF_OK;
+        }
+        case IR_OP_RET: {
+            aot_write(self, "AOT_RETURN(%zu);", depth);
+            return FLUFF_OK;
+        }
+        default: break;
+    }
+
+    const bool typed = _ir_opcode_is_typed(inst->op);
+    if (typed || (inst->op >= IR_OP_ADD && inst->op <= IR_OP_MUL) || (inst->op >= IR_OP_EQ && inst->op <= IR_OP_LE)) {
+        const size_t       index    = aot_arith_index(inst->op);
+        const char * const operator = aot_arith_operators[index];
+        const bool         is_bool  = (index >= 3);
+        const size_t       lhs      = depth - 2;
+
+        // NOTE: typed opcodes were proven by the compiler, the others only take the inline path when both classes match
+        for (size_t kind = 0; kind < 2; ++kind) {
+            const bool is_int = (kind == 0);
+            if (typed && is_int != (inst->op < IR_OP_FADD)) continue;
+
+            const char * klass = (is_int ? "AOT_INT" : "AOT_FLOAT");
+            const char * field = (is_int ? "_int" : "_float");
+            if (typed) {
+                fputs("    ", self->out);
+            } else {
+                fprintf(self->out, "    %sif (f[%zu].klass == %s && f[%zu].klass == %s) ", (kind > 0 ? "else " : ""), lhs, klass, top, klass);
+            }
+            fprintf(self->out, "f[%zu] = AOT_OBJECT(%s, %s, f[%zu].data.%s %s f[%zu].data.%s);\n",
+                lhs, (is_bool ? "AOT_BOOL" : klass), (is_bool ? "_bool" : field), lhs, field, operator, top, field
+            );
+        }
+        if (!typed) aot_write(self, "else AOT_RUN(%zu, fluff_vm_binary(vm, %s, %s));", depth, aot_binary_fn(aot_arith_ops[index]), (is_bool ? "true" : "false"));
+        return FLUFF_OK;
+    }
+    if (_ir_opcode_is_binary(inst->op)) {
+        aot_write(self, "AOT_RUN(%zu, fluff_vm_binary(vm, %s, %s));", depth, aot_binary_fn(inst->op), (inst->op >= IR_OP_EQ ? "true" : "false"));
+        return FLUFF_OK;
+    }
+    if (_ir_opcode_is_unary(inst->op)) {
+        aot_write(self, "AOT_RUN(%zu, fluff_vm_unary(vm, %s, %s));", depth, aot_unary_fn(inst->op), (inst->op == IR_OP_NOT ? "true" : "false"));
+        return FLUFF_OK;
+    }
+    return FLUFF_FAILURE;
+}
+
+static FluffResult aot_emit_chunk(Aot * self, const char * function) {
+    const size_t argc = self->preserve - self->lower;
+
+    fprintf(self->out, "\n// %s\n", self->name);
+    fprintf(self->out, "static FluffResult %s(FluffVM * vm, size_t argc) {\n", function);
+    aot_write(self, "if (argc != %zu) {", argc);
+    aot_write(self, "    fluff_push_error(\"function '%%s' expects %%zu arguments, got %%zu\", \"%s\", (size_t)%zu, argc);", self->name, argc);
+    aot_write(self, "    return FLUFF_FAILURE;");
+    aot_write(self, "}");
+    aot_write(self, "");
+    aot_write(self, "const size_t base = vm->current_frame.base;");
+    if (self->stack_size - self->preserve > 0)
+        aot_write(self, "if (fluff_vm_reserve(vm, %zu) == FLUFF_FAILURE) return FLUFF_FAILURE;", self->stack_size - self->preserve);
+    aot_write(self, "FluffObject * f = &vm->stack[base];");
+    if (self->conditions) aot_write(self, "bool cond;");
+    aot_write(self, "");
+    if (self->reenters) fprintf(self->out, "entry:\n");
+
+    for (size_t i = 0; i <= self->count; ++i) {
+        const IRFlowInst * t = &self->insts[i];
+        if (t->depth == IR_FLOW_UNKNOWN) continue;
+        if (t->label) fprintf(self->out, "L%zu:\n", i);
+
+        if (i < self->count) {
+            if (aot_emit_inst(self, t) == FLUFF_FAILURE) {
+                fluff_push_error("'%s' can't be compiled ahead of time ('%s' at %zu)", self->name, _ir_opcode_name(t->inst.op), t->offset);
+                return FLUFF_FAILURE;
+            }
+            continue;
+        }
+
+        const size_t depth = t->depth - self->lower;
+        aot_write(self, "AOT_RUN(%zu, fluff_vm_push_null_object(vm, AOT_VOID));", depth);
+        aot_write(self, "AOT_RETURN(%zu);", depth + 1);
+    }
+    fprintf(self->out, "}\n");
+    return FLUFF_OK;
+}
+
+// Compiles 'chunk' into the C function 'function', IR frames running it start with 'preserve' entries.
+static FluffResult aot_compile(Aot * self, const IRChunk * chunk, const char * name, size_t preserve, size_t method, const char * function) {
+    self->chunk      = chunk;
+    self->name       = name;
+    self->preserve   = preserve;
+    self->lower      = (preserve > 0 ? 1 : 0);
+    self->method     = method;
+    self->insts      = NULL;
+    self->count      = 0;
+    self->stack_size = 0;
+    self->conditions = false;
+    self->reenters   = false;
+
+    // NOTE: every path into an instruction has to agree on the stack size, since entries are addressed by it
+    FluffResult res = FLUFF_OK;
+    if (!_ir_flow_chunk(chunk, preserve, &self->insts, &self->count, &self->stack_size) || self->stack_size > FLUFF_MAX_VM_STACK) {
+        fluff_push_error("'%s' can't be compiled ahead of time (unbalanced stack)", name);
+        res = FLUFF_FAILURE;
+    }
+    for (size_t i = 0; res == FLUFF_OK && i < self->count; ++i) {
+        const uint8_t op = self->insts[i].inst.op;
+        if (self->insts[i].depth != IR_FLOW_UNKNOWN && (op == IR_OP_JZ || op == IR_OP_JNZ || op == IR_OP_LT_JZ)) self->conditions = true;
+        if (self->insts[i].depth != IR_FLOW_UNKNOWN && aot_reenters(self, &self->insts[i].inst)) self->reenters = true;
+    }
+    if (res == FLUFF_OK) res = aot_emit_chunk(self, function);
+
+    if (self->insts) fluff_free(self->insts);
+    return res;
+}
+
+static void aot_emit_entry(Aot * self) {
+    const IRBinary * binary = self->binary;
+
+    fprintf(self->out, "\n// NOTE: runs the main chunk on 'vm', its result is left on top of the stack\n");
+    fprintf(self->out, "FluffResult fluff_aot_run(FluffVM * vm) {\n");
+    aot_write(self, "for (uint8_t i = FLUFF_KLASS_VOID; i <= FLUFF_KLASS_FUNC; ++i)");
+    aot_write(self, "    aot_klass[i] = fluff_instance_get_core_class(vm->instance, i);");
+    aot_write(self, "");
+    for (size_t i = 0; i < binary->method_count; ++i) {
+        const FluffMethod * method = binary->methods[i];
+        if (method->chunk) aot_write(self, "aot_methods[%zu] = fluff_new_method(\"%s\", aot_method_%zu);", i, method->name, i);
+        else aot_write(self, "aot_methods[%zu] = fluff_new_method(\"%s\", NULL);", i, method->name);
+
+        char klass[64];
+        for (size_t k = 0; k < method->property_count; ++k) {
+            if (!aot_format_klass(self, klass, sizeof(klass), method->properties[k].type)) fluff_format(klass, sizeof(klass), "NULL");
+            aot_write(self, "fluff_method_add_param(aot_methods[%zu], \"%s\", %s);", i, method->properties[k].name, klass);
+        }
+    }
+    aot_write(self, "FluffMethod * entry = fluff_new_method(\"main\", aot_main_chunk);");
+    aot_write(self, "");
+    aot_write(self, "FluffResult res = fluff_vm_push_function(vm, entry);");
+    aot_write(self, "if (res == FLUFF_OK) res = fluff_vm_call(vm, 0);");
+    aot_write(self, "");
+    aot_write(self, "// NOTE: functions left on the stack keep their method alive");
+    aot_write(self, "for (size_t i = 0; i < %zu; ++i)", binary->method_count);
+    aot_write(self, "    fluff_free_method(aot_methods[i]);");
+    aot_write(self, "fluff_free_method(entry);");
+    aot_write(self, "return res;");
+    fprintf(self->out, "}\n");
+
+    fprintf(self->out, "\n#ifndef FLUFF_AOT_NO_MAIN\n");
+    fprintf(self->out, "static void aot_print(FluffObject * obj) {\n");
+    aot_write(self, "if (!obj || obj->klass == AOT_VOID) return;");
+    aot_write(self, "if (obj->klass == AOT_BOOL)        printf(\"%%s\\n\", FLUFF_BOOLALPHA(obj->data._bool));");
+    aot_write(self, "else if (obj->klass == AOT_INT)    printf(\"%%lld\\n\", (long long)obj->data._int);");
+    aot_write(self, "else if (obj->klass == AOT_FLOAT)  printf(\"%%g\\n\", obj->data._float);");
+    aot_write(self, "else if (obj->klass == aot_klass[FLUFF_KLASS_STRING])");
+    aot_write(self, "    printf(\"%%.*s\\n\", (int)obj->data._string.length, obj->data._string.data);");
+    fprintf(self->out, "}\n\n");
+
+    fprintf(self->out, "int main(int argc, const char * argv[]) {\n");
+    aot_write(self, "FluffConfig cfg = fluff_make_config_by_args(argc - 1, argv + 1);");
+    aot_write(self, "if (fluff_init(&cfg, FLUFF_CURRENT_VERSION) != FLUFF_OK)");
+    aot_write(self, "    fluff_panic(\"unmatched fluff versions\");");
+    aot_write(self, "");
+    aot_write(self, "char     msg_buf[2048] = { 0 };");
+    aot_write(self, "FluffLog logs[32]      = { 0 };");
+    aot_write(self, "fluff_set_log(logs, 32);");
+    aot_write(self, "fluff_set_log_msg_buffer(msg_buf, 2048);");
+    aot_write(self, "");
+    aot_write(self, "FluffInstance   * instance = fluff_new_instance();");
+    aot_write(self, "FluffVM         * vm       = fluff_new_vm(instance, fluff_instance_get_core_module(instance));");
+    aot_write(self, "const FluffResult res      = fluff_aot_run(vm);");
+    aot_write(self, "if (res == FLUFF_OK) aot_print(fluff_vm_at(vm, -1));");
+    aot_write(self, "fluff_logger_print();");
+    aot_write(self, "");
+    aot_write(self, "fluff_free_vm(vm);");
+    aot_write(self, "fluff_free_instance(instance);");
+    aot_write(self, "fluff_close();");
+    aot_write(self, "return (res == FLUFF_OK ? EXIT_SUCCESS : EXIT_FAILURE);");
+    fprintf(self->out, "}\n#endif\n");
+}
+
+/* -========
+     AOT
+   ========- */
+
+FLUFF_PRIVATE_API FluffResult _aot_emit_c(FluffInstance * instance, const IRBinary * binary, const char * path, FILE * out) {
+    Aot self;
+    FLUFF_CLEANUP(&self);
+    self.instance = instance;
+    self.binary   = binary;
+    self.out      = out;
+
+    fprintf(out, "// NOTE: generated by 'fluff compile --emit-c' from '%s', don't edit it\n\n", path);
+    fputs(aot_prelude, out);
+    fprintf(out, "static FluffMethod * aot_methods[%zu];\n", FLUFF_MAX(binary->method_count, (size_t)1));
+
+    fprintf(out, "\nstatic FluffResult aot_main_chunk(FluffVM * vm, size_t argc);\n");
+    for (size_t i = 0; i < binary->method_count; ++i)
+        if (binary->methods[i]->chunk) fprintf(out, "static FluffResult aot_method_%zu(FluffVM * vm, size_t argc);\n", i);
+
+    if (aot_compile(&self, &binary->main_chunk, "main", 0, SIZE_MAX, "aot_main_chunk") == FLUFF_FAILURE) return FLUFF_FAILURE;
+    for (size_t i = 0; i < binary->method_count; ++i) {
+        const FluffMethod * method = binary->methods[i];
+        if (!method->chunk) continue;
+
+        char function[64];
+        fluff_format(function, sizeof(function), "aot_method_%zu", i);
+        if (aot_compile(&self, method->chunk, method->name, method->property_count + 1, i, function) == FLUFF_FAILURE)
+            return FLUFF_FAILURE;
+    }
+    aot_emit_entry(&self);
+    return FLUFF_OK;
+}
\ No newline at end of file
@@ -27,6 +27,16 @@
             .free_mutex_fn     = fluff_default_free_mutex,\
             .strict_mode       = false,\
             .manual_mem        = false,\
+            .opt_stats         = false,\
+            .dump_ir           = false,\
+            .check             = false,\
+            .register_vm       = false,\
+            .jit               = false,\
+            .trace_jit         = false,\
+            .trace_stats       = false,\
+            .pgo_in            = NULL,\
+            .pgo_out           = NULL,\
+            .lexer_threads     = 1,\
         };
 
 const FluffConfig global_default_config = DEFAULT_CONFIG;
@@ -65,6 +75,17 @@ FLUFF_API FluffResult fluff_init(FluffConfig * cfg, FluffVersion version) {
     if (cfg->mutex_lock_fn)   global_config.mutex_lock_fn   = cfg->mutex_lock_fn;
     if (cfg->mutex_unlock_fn) global_config.mutex_unlock_fn = cfg->mutex_unlock_fn;
     if (cfg->free_mutex_fn)   global_config.free_mutex_fn   = cfg->free_mutex_fn;
+    if (cfg->lexer_threads)   global_config.lexer_threads   = cfg->lexer_threads;
+    if (cfg->strict_mode)     global_config.strict_mode     = cfg->strict_mode;
+    if (cfg->opt_stats)       global_config.opt_stats       = cfg->opt_stats;
+    if (cfg->dump_ir)         global_config.dump_ir         = cfg->dump_ir;
+    if (cfg->check)           global_config.check           = cfg->check;
+    if (cfg->register_vm)     global_config.register_vm     = cfg->register_vm;
+    if (cfg->jit)             global_config.jit             = cfg->jit;
+    if (cfg->trace_jit)       global_config.trace_jit       = cfg->trace_jit;
+    if (cfg->trace_stats)     global_config.trace_stats     = cfg->trace_stats;
+    if (cfg->pgo_in)          global_config.pgo_in          = cfg->pgo_in;
+    if (cfg->pgo_out)         global_config.pgo_out         = cfg->pgo_out;
 
     return FLUFF_OK;
 }
@@ -76,6 +97,20 @@ FLUFF_API void fluff_close() {
 FLUFF_API FluffConfig fluff_make_config_by_args(int argc, const char ** argv) {
     FluffConfig cfg = global_default_config;
     if (argc == 0 || argv == NULL) return cfg;
+
+    for (int i = 0; i < argc; ++i) {
+        if (!strcmp(argv[i], "--strict"))      cfg.strict_mode = true;
+        if (!strcmp(argv[i], "--opt-stats"))   cfg.opt_stats   = true;
+        if (!strcmp(argv[i], "--dump-ir"))     cfg.dump_ir     = true;
+        if (!strcmp(argv[i], "--check"))       cfg.check       = true;
+        if (!strcmp(argv[i], "--register-vm")) cfg.register_vm = true;
+        if (!strcmp(argv[i], "--jit"))         cfg.jit         = true;
+        if (!strcmp(argv[i], "--trace-jit"))   cfg.trace_jit   = true;
+        if (!strcmp(argv[i], "--trace-stats")) cfg.trace_stats = true;
+        if (i + 1 < argc && !strcmp(argv[i], "--pgo-in"))  cfg.pgo_in  = argv[++i];
+        if (i + 1 < argc && !strcmp(argv[i], "--pgo-out")) cfg.pgo_out = argv[++i];
+        if (i + 1 < argc && !strcmp(argv[i], "--lexer-threads")) cfg.lexer_threads = strtoull(argv[++i], NULL, 10);
+    }
     return cfg;
 }
 
@@ -110,6 +110,7 @@ FLUFF_PRIVATE_API void _free_instance(FluffInstance * self) {
         old->instance = NULL;
         fluff_free_module(old);
     }
+    self->core_module.instance = NULL;
     _free_module(&self->core_module);
     FLUFF_CLEANUP(self);
 }
@@ -6,16 +6,27 @@
 #include <base.h>
 #include <error.h>
 #include <core/ir.h>
+#include <core/register.h>
+#include <core/jit.h>
+#include <core/trace.h>
+#include <core/pgo.h>
+#include <core/method.h>
+#include <core/class.h>
 #include <core/config.h>
 
 /* -==============
      Internals
    ==============- */
 
+#define IR_CHUNK_MIN_CAPACITY 256
+#define IR_BINARY_MIN_BUCKETS 64
+
 #define ARG_TYPE_NONE   0x0
-#define ARG_TYPE_INT    0x1
-#define ARG_TYPE_FLOAT  0x2
-#define ARG_TYPE_STRING 0x3
+#define ARG_TYPE_UINT   0x1
+#define ARG_TYPE_CONST  0x2
+#define ARG_TYPE_JUMP8  0x3
+#define ARG_TYPE_JUMP32 0x4
+#define ARG_TYPE_NIBBLE 0x5
 
 typedef struct OpcodeInfo {
     const char * name;
@@ -25,28 +36,39 @@ typedef struct OpcodeInfo {
 #define MAKE_OPCODE(__index, __name, __arg1, __arg2)\
         [__index] = (OpcodeInfo){ #__name, ARG_TYPE_##__arg1, ARG_TYPE_##__arg2 }, 
 
-static OpcodeInfo op_info[0xff] = {
+static OpcodeInfo op_info[0x100] = {
     MAKE_OPCODE(0x00, NOP,         NONE,   NONE)
-    MAKE_OPCODE(0x01, JMP,         INT,    NONE)
-    MAKE_OPCODE(0x02, JZ,          INT,    NONE)
-    MAKE_OPCODE(0x03, JNZ,         INT,    NONE)
+    MAKE_OPCODE(0x01, JMP,         JUMP32, NONE)
+    MAKE_OPCODE(0x02, JZ,          JUMP32, NONE)
+    MAKE_OPCODE(0x03, JNZ,         JUMP32, NONE)
+    MAKE_OPCODE(0x04, JMP_S,       JUMP8,  NONE)
+    MAKE_OPCODE(0x05, JZ_S,        JUMP8,  NONE)
+    MAKE_OPCODE(0x06, JNZ_S,       JUMP8,  NONE)
+    MAKE_OPCODE(0x07, LT_JZ,       JUMP32, NONE)
+    MAKE_OPCODE(0x08, LT_JZ_S,     JUMP8,  NONE)
+    MAKE_OPCODE(0x09, LT_JZ_INT,   JUMP32, NONE)
+    MAKE_OPCODE(0x0a, LT_JZ_INT_S, JUMP8,  NONE)
+    MAKE_OPCODE(0x0b, ILT_JZ,      JUMP32, NONE)
+    MAKE_OPCODE(0x0c, ILT_JZ_S,    JUMP8,  NONE)
+    MAKE_OPCODE(0x0d, ILT_JNZ,     JUMP32, NONE)
+    MAKE_OPCODE(0x0e, ILT_JNZ_S,   JUMP8,  NONE)
     MAKE_OPCODE(0x10, PUSH_VOID,   NONE,   NONE)
     MAKE_OPCODE(0x11, PUSH_TRUE,   NONE,   NONE)
     MAKE_OPCODE(0x12, PUSH_FALSE,  NONE,   NONE)
-    MAKE_OPCODE(0x13, PUSH_INT,    INT,    NONE)
-    MAKE_OPCODE(0x14, PUSH_FLOAT,  FLOAT,  NONE)
-    MAKE_OPCODE(0x15, PUSH_STRING, STRING, NONE)
-    MAKE_OPCODE(0x16, PUSH_OBJECT, NONE,   NONE)
-    MAKE_OPCODE(0x17, PUSH_ARRAY,  INT,    NONE)
+    MAKE_OPCODE(0x13, PUSH_INT,    CONST,  NONE)
+    MAKE_OPCODE(0x14, PUSH_FLOAT,  CONST,  NONE)
+    MAKE_OPCODE(0x15, PUSH_STRING, CONST,  NONE)
+    MAKE_OPCODE(0x16, PUSH_OBJECT, CONST,  NONE)
+    MAKE_OPCODE(0x17, PUSH_ARRAY,  UINT,   NONE)
     MAKE_OPCODE(0x18, POP,         NONE,   NONE)
-    MAKE_OPCODE(0x19, POPN,        INT,    NONE)
-    MAKE_OPCODE(0x20, NEW_LOCAL,   NONE,   NONE)
-    MAKE_OPCODE(0x21, SET_LOCAL,   NONE,   NONE)
-    MAKE_OPCODE(0x22, GET_LOCAL,   NONE,   NONE)
-    MAKE_OPCODE(0x23, GET_MEMBER,  NONE,   NONE)
-    MAKE_OPCODE(0x24, SET_MEMBER,  NONE,   NONE)
-    MAKE_OPCODE(0x25, GET_ITEM,    NONE,   NONE)
-    MAKE_OPCODE(0x26, SET_ITEM,    NONE,   NONE)
+    MAKE_OPCODE(0x19, POPN,        UINT,   NONE)
+    MAKE_OPCODE(0x1a, PUSH_FUNC,   UINT,   NONE)
+    MAKE_OPCODE(0x20, SET_LOCAL,   UINT,   NONE)
+    MAKE_OPCODE(0x21, GET_LOCAL,   UINT,   NONE)
+    MAKE_OPCODE(0x22, GET_MEMBER,  CONST,  NONE)
+    MAKE_OPCODE(0x23, SET_MEMBER,  CONST,  NONE)
+    MAKE_OPCODE(0x24, GET_ITEM,    NONE,   NONE)
+    MAKE_OPCODE(0x25, SET_ITEM,    NONE,   NONE)
     MAKE_OPCODE(0x31, ADD,         NONE,   NONE)
     MAKE_OPCODE(0x32, SUB,         NONE,   NONE)
     MAKE_OPCODE(0x33, MUL,         NONE,   NONE)
@@ -70,36 +92,226 @@ static OpcodeInfo op_info[0xff] = {
     MAKE_OPCODE(0x46, AND,         NONE,   NONE)
     MAKE_OPCODE(0x47, OR,          NONE,   NONE)
     MAKE_OPCODE(0x48, NOT,         NONE,   NONE)
-    MAKE_OPCODE(0x49, IS,          NONE,   NONE)
-    MAKE_OPCODE(0x4a, AS,          NONE,   NONE)
-    MAKE_OPCODE(0x70, CALL,        INT,    NONE)
+    MAKE_OPCODE(0x49, IS,          CONST,  NONE)
+    MAKE_OPCODE(0x4a, AS,          CONST,  NONE)
+    MAKE_OPCODE(0x4b, CHECK,       CONST,  NONE)
+    MAKE_OPCODE(0x50, STORE_LOCAL, UINT,   NONE)
+    MAKE_OPCODE(0x51, INC_LOCAL,   UINT,   CONST)
+    MAKE_OPCODE(0x52, ADD_LOCALS,  UINT,   UINT)
+    MAKE_OPCODE(0x53, ADD_INT,     CONST,  NONE)
+    MAKE_OPCODE(0x54, SUB_INT,     CONST,  NONE)
+    MAKE_OPCODE(0x58, ADD_INT_INT,     NONE, NONE)
+    MAKE_OPCODE(0x59, ADD_FLOAT_FLOAT, NONE, NONE)
+    MAKE_OPCODE(0x5a, SUB_INT_INT,     NONE, NONE)
+    MAKE_OPCODE(0x5b, SUB_FLOAT_FLOAT, NONE, NONE)
+    MAKE_OPCODE(0x5c, MUL_INT_INT,     NONE, NONE)
+    MAKE_OPCODE(0x5d, MUL_FLOAT_FLOAT, NONE, NONE)
+    MAKE_OPCODE(0x5e, EQ_INT_INT,      NONE, NONE)
+    MAKE_OPCODE(0x5f, EQ_FLOAT_FLOAT,  NONE, NONE)
+    MAKE_OPCODE(0x60, NE_INT_INT,      NONE, NONE)
+    MAKE_OPCODE(0x61, NE_FLOAT_FLOAT,  NONE, NONE)
+    MAKE_OPCODE(0x62, GT_INT_INT,      NONE, NONE)
+    MAKE_OPCODE(0x63, GT_FLOAT_FLOAT,  NONE, NONE)
+    MAKE_OPCODE(0x64, GE_INT_INT,      NONE, NONE)
+    MAKE_OPCODE(0x65, GE_FLOAT_FLOAT,  NONE, NONE)
+    MAKE_OPCODE(0x66, LT_INT_INT,      NONE, NONE)
+    MAKE_OPCODE(0x67, LT_FLOAT_FLOAT,  NONE, NONE)
+    MAKE_OPCODE(0x68, LE_INT_INT,      NONE, NONE)
+    MAKE_OPCODE(0x69, LE_FLOAT_FLOAT,  NONE, NONE)
+    MAKE_OPCODE(0x70, CALL,        UINT,   NONE)
+    MAKE_OPCODE(0x71, RET,         NONE,   NONE)
+    MAKE_OPCODE(0x72, TAIL_CALL,   UINT,   NONE)
+    MAKE_OPCODE(0x80, SET_LOCAL_N, NIBBLE, NONE)
+    MAKE_OPCODE(0x90, GET_LOCAL_N, NIBBLE, NONE)
+    MAKE_OPCODE(0xa0, CALL_N,      NIBBLE, NONE)
+    MAKE_OPCODE(0xb0, IADD,        NONE,   NONE)
+    MAKE_OPCODE(0xb1, ISUB,        NONE,   NONE)
+    MAKE_OPCODE(0xb2, IMUL,        NONE,   NONE)
+    MAKE_OPCODE(0xb3, IEQ,         NONE,   NONE)
+    MAKE_OPCODE(0xb4, INE,         NONE,   NONE)
+    MAKE_OPCODE(0xb5, IGT,         NONE,   NONE)
+    MAKE_OPCODE(0xb6, IGE,         NONE,   NONE)
+    MAKE_OPCODE(0xb7, ILT,         NONE,   NONE)
+    MAKE_OPCODE(0xb8, ILE,         NONE,   NONE)
+    MAKE_OPCODE(0xb9, FADD,        NONE,   NONE)
+    MAKE_OPCODE(0xba, FSUB,        NONE,   NONE)
+    MAKE_OPCODE(0xbb, FMUL,        NONE,   NONE)
+    MAKE_OPCODE(0xbc, FEQ,         NONE,   NONE)
+    MAKE_OPCODE(0xbd, FNE,         NONE,   NONE)
+    MAKE_OPCODE(0xbe, FGT,         NONE,   NONE)
+    MAKE_OPCODE(0xbf, FGE,         NONE,   NONE)
+    MAKE_OPCODE(0xc0, FLT,         NONE,   NONE)
+    MAKE_OPCODE(0xc1, FLE,         NONE,   NONE)
 };
 
-FLUFF_CONSTEXPR size_t _ir_chunk_dump_arg(IRChunk * self, size_t i, uint8_t type) {
-    size_t offset = 0;
+FLUFF_CONSTEXPR void _ir_constant_dump(const IRConstant * constant) {
+    switch (constant->type) {
+        case IR_CONSTANT_INT:    { printf("%ld", constant->data.i); break; }
+        case IR_CONSTANT_FLOAT:  { printf("%f", constant->data.f); break; }
+        case IR_CONSTANT_STRING: { printf("\"%.*s\"", (int)constant->data.s.length, constant->data.s.data); break; }
+        case IR_CONSTANT_KLASS:  { printf("<class %p>", (void *)constant->data.klass); break; }
+        default: break;
+    }
+}
+
+// NOTE: nibble opcodes share the entry of their first variant
+FLUFF_CONSTEXPR const OpcodeInfo * _ir_opcode_info(uint8_t op) {
+    return &op_info[(_ir_opcode_is_nibble(op) ? op & ~IR_OP_NIBBLE_MASK : op)];
+}
+
+FLUFF_CONSTEXPR void _ir_decode_arg(const uint8_t * code, size_t * ip, IRInstruction * inst, uint64_t * arg, uint8_t type) {
+    switch (type) {
+        case ARG_TYPE_UINT:
+        case ARG_TYPE_CONST:  { * arg = _ir_read_uint(code, ip); break; }
+        case ARG_TYPE_JUMP8:  { inst->jump = (int8_t)code[(* ip)++]; break; }
+        case ARG_TYPE_JUMP32: {
+            memcpy(&inst->jump, &code[* ip], sizeof(inst->jump));
+            * ip += sizeof(inst->jump);
+            break;
+        }
+        case ARG_TYPE_NIBBLE: { * arg = inst->op & IR_OP_NIBBLE_MASK; break; }
+        default: break;
+    }
+}
+
+FLUFF_CONSTEXPR size_t _ir_arg_size(uint8_t type, uint64_t arg) {
+    switch (type) {
+        case ARG_TYPE_UINT:
+        case ARG_TYPE_CONST: {
+            size_t size = 0;
+            do {
+                ++size;
+                arg >>= 7;
+            } while (arg != 0);
+            return size;
+        }
+        case ARG_TYPE_JUMP8:  return sizeof(int8_t);
+        case ARG_TYPE_JUMP32: return sizeof(int32_t);
+        default:              return 0;
+    }
+}
+
+FLUFF_CONSTEXPR uint8_t _ir_widen_opcode(uint8_t op) {
+    switch (op) {
+        case IR_OP_JMP_S:       return IR_OP_JMP;
+        case IR_OP_JZ_S:        return IR_OP_JZ;
+        case IR_OP_JNZ_S:       return IR_OP_JNZ;
+        case IR_OP_LT_JZ_S:     return IR_OP_LT_JZ;
+        case IR_OP_LT_JZ_INT_S: return IR_OP_LT_JZ_INT;
+        case IR_OP_ILT_JZ_S:    return IR_OP_ILT_JZ;
+        case IR_OP_ILT_JNZ_S:   return IR_OP_ILT_JNZ;
+        default: break;
+    }
+    if (!_ir_opcode_is_nibble(op)) return op;
+    switch (op & ~IR_OP_NIBBLE_MASK) {
+        case IR_OP_SET_LOCAL_N: return IR_OP_SET_LOCAL;
+        case IR_OP_GET_LOCAL_N: return IR_OP_GET_LOCAL;
+        default:                return IR_OP_CALL;
+    }
+}
 
-    // NOTE: scary!
+FLUFF_CONSTEXPR void _ir_chunk_dump_arg(IRChunk * self, const IRBinary * binary, size_t * ip, uint8_t op, uint8_t type) {
     switch (type) {
-        case ARG_TYPE_INT: {
-            offset += sizeof(FluffInt);
-            printf("%ld", * ((FluffInt *)&self->data[i]));
+        case ARG_TYPE_UINT: {
+            printf("%lu", _ir_read_uint(self->data, ip));
+            break;
+        }
+        case ARG_TYPE_CONST: {
+            const uint64_t v = _ir_read_uint(self->data, ip);
+            printf("#%lu", v);
+
+            const IRConstant * constant = (binary && v < IR_CONSTANT_NONE ? _ir_binary_get_constant(binary, (uint32_t)v) : NULL);
+            if (constant) {
+                printf(" (");
+                _ir_constant_dump(constant);
+                putchar(')');
+            }
+            break;
+        }
+        case ARG_TYPE_JUMP8: {
+            const int8_t v = (int8_t)self->data[* ip];
+            * ip += sizeof(v);
+            printf("%+d -> %.4zx", v, (size_t)((ptrdiff_t)* ip + v));
             break;
         }
-        case ARG_TYPE_FLOAT: {
-            offset += sizeof(FluffFloat);
-            printf("%f", * ((FluffFloat *)&self->data[i]));
+        case ARG_TYPE_JUMP32: {
+            int32_t v;
+            memcpy(&v, &self->data[* ip], sizeof(v));
+            * ip += sizeof(v);
+            printf("%+d -> %.4zx", v, (size_t)((ptrdiff_t)* ip + v));
             break;
         }
-        case ARG_TYPE_STRING: {
-            // TODO: theres a buffer overflow here lmfao
-            offset += strlen((char *)&self->data[i]) + 1;
-            printf("%.*s", (int)offset, &self->data[i]);
+        case ARG_TYPE_NIBBLE: {
+            printf("%u", op & IR_OP_NIBBLE_MASK);
             break;
         }
         default: break;
     }
+}
 
-    return offset;
+FLUFF_CONSTEXPR uint64_t _ir_constant_hash(uint8_t type, const void * data, size_t size) {
+    return fluff_hash_combine(fluff_hash(data, size), type);
+}
+
+FLUFF_CONSTEXPR bool _ir_constant_equals(const IRConstant * constant, uint8_t type, const void * data, size_t size) {
+    if (constant->type != type) return false;
+    if (type == IR_CONSTANT_STRING)
+        return constant->data.s.length == size && !memcmp(constant->data.s.data, data, size);
+    // NOTE: floats are compared bitwise so 0.0 and -0.0 stay apart and NaNs still dedupe
+    return !memcmp(&constant->data, data, size);
+}
+
+FLUFF_CONSTEXPR size_t _ir_binary_probe(IRBinary * self, uint64_t hash, uint8_t type, const void * data, size_t size) {
+    const size_t mask = self->bucket_count - 1;
+
+    size_t i = (size_t)hash & mask;
+    while (self->buckets[i] != 0) {
+        const IRConstant * constant = &self->constants[self->buckets[i] - 1];
+        if (constant->hash == hash && _ir_constant_equals(constant, type, data, size)) break;
+        i = (i + 1) & mask;
+    }
+    return i;
+}
+
+FLUFF_CONSTEXPR void _ir_binary_rehash(IRBinary * self, size_t bucket_count) {
+    if (self->buckets) fluff_free(self->buckets);
+    self->bucket_count = bucket_count;
+    self->buckets      = fluff_alloc(NULL, sizeof(uint32_t) * bucket_count);
+    FLUFF_CLEANUP_N(self->buckets, sizeof(uint32_t) * bucket_count);
+
+    const size_t mask = bucket_count - 1;
+    for (size_t index = 0; index < self->constant_count; ++index) {
+        size_t i = (size_t)self->constants[index].hash & mask;
+        while (self->buckets[i] != 0) i = (i + 1) & mask;
+        self->buckets[i] = (uint32_t)(index + 1);
+    }
+}
+
+// NOTE: strings pass their characters as 'data', every other constant passes its payload
+static uint32_t _ir_binary_add_constant(IRBinary * self, uint8_t type, const void * data, size_t size) {
+    // NOTE: keeps the load factor under 1/2 so probing stays short
+    if ((self->constant_count + 1) * 2 > self->bucket_count)
+        _ir_binary_rehash(self, FLUFF_MAX(self->bucket_count * 2, IR_BINARY_MIN_BUCKETS));
+
+    const uint64_t hash = _ir_constant_hash(type, data, size);
+    const size_t   i    = _ir_binary_probe(self, hash, type, data, size);
+    if (self->buckets[i] != 0) return self->buckets[i] - 1;
+
+    fluff_assert(self->constant_count < IR_CONSTANT_NONE - 1, "constant pool is too big (%zu constants)", self->constant_count);
+    if (self->constant_count >= self->constant_capacity) {
+        self->constant_capacity = FLUFF_MAX(self->constant_capacity * 2, IR_BINARY_MIN_BUCKETS);
+        self->constants         = fluff_alloc(self->constants, sizeof(IRConstant) * self->constant_capacity);
+    }
+
+    IRConstant * constant = &self->constants[self->constant_count];
+    FLUFF_CLEANUP(constant);
+    constant->type = type;
+    constant->hash = hash;
+    if (type == IR_CONSTANT_STRING) _new_string_n(&constant->data.s, data, size);
+    else memcpy(&constant->data, data, size);
+
+    self->buckets[i] = (uint32_t)(self->constant_count + 1);
+    return (uint32_t)self->constant_count++;
 }
 
 /* -============
@@ -111,14 +323,51 @@ FLUFF_PRIVATE_API void _new_ir_chunk(IRChunk * self) {
 }
 
 FLUFF_PRIVATE_API void _free_ir_chunk(IRChunk * self) {
-    fluff_free(self->data);
+    if (self->data) fluff_free(self->data);
+    if (self->registers) {
+        _free_ir_reg_chunk(self->registers);
+        fluff_free(self->registers);
+    }
+    if (self->native) {
+        _free_jit_code(self->native);
+        fluff_free(self->native);
+    }
+    if (self->loops) _free_trace_loops(self);
+    if (self->feedback) {
+        _free_ir_feedback(self->feedback);
+        fluff_free(self->feedback);
+    }
+    if (self->inlined) fluff_free(self->inlined);
     FLUFF_CLEANUP(self);
 }
 
+// Gives how many functions the instruction at 'ip' was inlined through, 'sites' gets the outermost of them.
+// NOTE: the sites of an instruction all start where it does, so they follow each other
+FLUFF_PRIVATE_API size_t _ir_chunk_inlined_at(const IRChunk * self, size_t ip, const IRInlineSite ** sites) {
+    size_t lo = 0, hi = self->inlined_count;
+    while (lo < hi) {
+        const size_t mid = (lo + hi) / 2;
+        if (self->inlined[mid].start <= ip) lo = mid + 1;
+        else hi = mid;
+    }
+    if (lo == 0 || self->inlined[lo - 1].end <= ip) return 0;
+
+    size_t first = lo - 1;
+    while (first > 0 && self->inlined[first - 1].start == self->inlined[lo - 1].start) --first;
+    * sites = &self->inlined[first];
+    return lo - first;
+}
+
 FLUFF_PRIVATE_API void _ir_chunk_append(IRChunk * self, const void * data, size_t size) {
     const size_t index = self->size;
     self->size += size;
-    self->data  = fluff_alloc(self->data, self->size);
+    fluff_assert(self->size <= FLUFF_MAX_IR_SIZE, "IR chunk is too big (%zu bytes)", self->size);
+
+    // NOTE: the code is emitted a few bytes at a time, so it has to grow geometrically
+    if (self->size > self->capacity) {
+        self->capacity = FLUFF_MAX(self->capacity * 2, FLUFF_MAX(self->size, IR_CHUNK_MIN_CAPACITY));
+        self->data     = fluff_alloc(self->data, self->capacity);
+    }
     memcpy(&self->data[index], data, size);
 }
 
@@ -126,39 +375,295 @@ FLUFF_PRIVATE_API void _ir_chunk_append_opcode(IRChunk * self, uint8_t opcode) {
     _ir_chunk_append(self, &opcode, sizeof(opcode));
 }
 
-FLUFF_PRIVATE_API void _ir_chunk_append_int(IRChunk * self, FluffInt v) {
+FLUFF_PRIVATE_API void _ir_chunk_append_uint(IRChunk * self, uint64_t v) {
+    uint8_t buf[IR_VARINT_MAX_SIZE];
+    size_t  len = 0;
+    do {
+        buf[len] = (uint8_t)(v & 0x7f);
+        v >>= 7;
+        if (v != 0) buf[len] |= 0x80;
+        ++len;
+    } while (v != 0);
+    _ir_chunk_append(self, buf, len);
+}
+
+FLUFF_PRIVATE_API void _ir_chunk_append_i8(IRChunk * self, int8_t v) {
     _ir_chunk_append(self, &v, sizeof(v));
 }
 
-FLUFF_PRIVATE_API void _ir_chunk_append_float(IRChunk * self, FluffFloat v) {
+FLUFF_PRIVATE_API void _ir_chunk_append_i32(IRChunk * self, int32_t v) {
     _ir_chunk_append(self, &v, sizeof(v));
 }
 
-FLUFF_PRIVATE_API void _ir_chunk_append_string(IRChunk * self, const char * str) {
-    _ir_chunk_append(self, str, strlen(str) + 1);
+FLUFF_PRIVATE_API void _ir_chunk_append_const(IRChunk * self, uint32_t index) {
+    _ir_chunk_append_uint(self, index);
 }
 
-FLUFF_PRIVATE_API void _ir_chunk_append_string_n(IRChunk * self, const char * str, size_t len) {
-    _ir_chunk_append(self, str, len);
-    const char n = '\0';
-    _ir_chunk_append(self, &n, 1);
+// NOTE: takes the long form of any non-jump opcode, the nibble form is picked whenever 'arg' fits
+FLUFF_PRIVATE_API void _ir_chunk_append_instruction(IRChunk * self, uint8_t op, uint64_t arg, uint64_t arg2) {
+    if (arg <= IR_OP_NIBBLE_MAX) {
+        switch (op) {
+            case IR_OP_SET_LOCAL: { _ir_chunk_append_opcode(self, IR_OP_SET_LOCAL_N | (uint8_t)arg); return; }
+            case IR_OP_GET_LOCAL: { _ir_chunk_append_opcode(self, IR_OP_GET_LOCAL_N | (uint8_t)arg); return; }
+            case IR_OP_CALL:      { _ir_chunk_append_opcode(self, IR_OP_CALL_N | (uint8_t)arg); return; }
+            default: break;
+        }
+    }
+    _ir_chunk_append_opcode(self, op);
+    if (op_info[op].arg1 == ARG_TYPE_UINT || op_info[op].arg1 == ARG_TYPE_CONST)
+        _ir_chunk_append_uint(self, arg);
+    if (op_info[op].arg2 == ARG_TYPE_UINT || op_info[op].arg2 == ARG_TYPE_CONST)
+        _ir_chunk_append_uint(self, arg2);
+}
+
+// NOTE: the size '_ir_chunk_append_instruction' would take, jumps count as their long form
+FLUFF_PRIVATE_API size_t _ir_instruction_size(uint8_t op, uint64_t arg, uint64_t arg2) {
+    if (arg <= IR_OP_NIBBLE_MAX && (op == IR_OP_SET_LOCAL || op == IR_OP_GET_LOCAL || op == IR_OP_CALL))
+        return sizeof(IROpcode);
+    return sizeof(IROpcode) + _ir_arg_size(op_info[op].arg1, arg) + _ir_arg_size(op_info[op].arg2, arg2);
 }
 
 FLUFF_PRIVATE_API void _ir_chunk_append_chunk(IRChunk * self, IRChunk * chunk) {
     _ir_chunk_append(self, chunk->data, chunk->size);
 }
 
-FLUFF_PRIVATE_API void _ir_chunk_dump(IRChunk * self) {
+FLUFF_PRIVATE_API void _ir_chunk_patch_i32(IRChunk * self, size_t offset, int32_t v) {
+    fluff_assert(offset + sizeof(v) <= self->size, "patch at %zu is out of bounds", offset);
+    memcpy(&self->data[offset], &v, sizeof(v));
+}
+
+FLUFF_PRIVATE_API void _ir_chunk_dump(IRChunk * self, const IRBinary * binary) {
     size_t i = 0;
     while (i < self->size) {
-        uint8_t type = self->data[i];
-        printf("%.2x\t%-16s ", type, op_info[type].name);
+        const uint8_t      op   = self->data[i];
+        const OpcodeInfo * info = _ir_opcode_info(op);
+        printf("%.4zx\t%.2x\t%-16s ", i, op, (info->name ? info->name : "???"));
         i += sizeof(IROpcode);
-        i += _ir_chunk_dump_arg(self, i, op_info[type].arg1);
+        _ir_chunk_dump_arg(self, binary, &i, op, info->arg1);
         putchar('\t');
-        i += _ir_chunk_dump_arg(self, i, op_info[type].arg2);
+        _ir_chunk_dump_arg(self, binary, &i, op, info->arg2);
         putchar('\n');
     }
+
+    if (self->registers) {
+        printf("registers (%zu):\n", self->registers->register_count);
+        _ir_reg_chunk_dump(self->registers);
+    }
+}
+
+/* -=- Decoding -=- */
+FLUFF_PRIVATE_API const char * _ir_opcode_name(uint8_t op) {
+    const char * name = _ir_opcode_info(op)->name;
+    return (name ? name : "???");
+}
+
+FLUFF_PRIVATE_API uint64_t _ir_read_uint(const uint8_t * code, size_t * ip) {
+    uint64_t v     = 0;
+    unsigned shift = 0;
+    uint8_t  byte;
+    do {
+        byte   = code[(* ip)++];
+        v     |= (uint64_t)(byte & 0x7f) << shift;
+        shift += 7;
+    } while ((byte & 0x80) && shift < 64);
+    return v;
+}
+
+FLUFF_PRIVATE_API IRInstruction _ir_decode(const uint8_t * code, size_t ip) {
+    const size_t       start = ip;
+    const OpcodeInfo * info  = _ir_opcode_info(code[ip]);
+
+    IRInstruction inst = { .op = code[ip], .arg = 0, .arg2 = 0, .jump = 0, .size = 0 };
+    ip += sizeof(IROpcode);
+    _ir_decode_arg(code, &ip, &inst, &inst.arg, info->arg1);
+    _ir_decode_arg(code, &ip, &inst, &inst.arg2, info->arg2);
+
+    inst.op   = _ir_widen_opcode(inst.op);
+    inst.size = ip - start;
+    return inst;
+}
+
+// Gives how many entries 'inst' pops and pushes, returns false for opcodes it doesn't know.
+// NOTE: quickened opcodes aren't known, they only show up in chunks that already ran
+FLUFF_PRIVATE_API bool _ir_stack_use(const IRInstruction * inst, size_t * pops, size_t * pushes) {
+    * pops = * pushes = 0;
+    switch (inst->op) {
+        case IR_OP_NOP:
+        case IR_OP_JMP:
+        case IR_OP_PROMOTE:
+        case IR_OP_SET_LOCAL:
+        case IR_OP_INC_LOCAL:  break;
+        case IR_OP_JZ:
+        case IR_OP_JNZ:
+        case IR_OP_POP:
+        case IR_OP_STORE_LOCAL: { * pops = 1; break; }
+        case IR_OP_LT_JZ:
+        case IR_OP_ILT_JZ:
+        case IR_OP_ILT_JNZ:    { * pops = 2; break; }
+        case IR_OP_POPN:       { * pops = inst->arg; break; }
+        case IR_OP_PUSH_VOID:
+        case IR_OP_PUSH_TRUE:
+        case IR_OP_PUSH_FALSE:
+        case IR_OP_PUSH_INT:
+        case IR_OP_PUSH_FLOAT:
+        case IR_OP_PUSH_STRING:
+        case IR_OP_PUSH_FUNC:
+        case IR_OP_GET_LOCAL:
+        case IR_OP_ADD_LOCALS: { * pushes = 1; break; }
+        case IR_OP_ADD_INT:
+        case IR_OP_SUB_INT:
+        case IR_OP_IS:
+        case IR_OP_AS:
+        case IR_OP_CHECK:
+        case IR_OP_RET:        { * pops = * pushes = 1; break; }
+        case IR_OP_CALL:
+        case IR_OP_TAIL_CALL:  { * pops = inst->arg + 1; * pushes = 1; break; }
+        default: {
+            if (_ir_opcode_is_binary(inst->op)) {
+                * pops   = 2;
+                * pushes = 1;
+                break;
+            }
+            if (_ir_opcode_is_unary(inst->op)) {
+                * pops = * pushes = 1;
+                break;
+            }
+            return false;
+        }
+    }
+    return true;
+}
+
+// Gives the stack size after 'inst' runs, returns false for opcodes it doesn't know or when the stack would underflow.
+FLUFF_PRIVATE_API bool _ir_stack_effect(const IRInstruction * inst, size_t depth, size_t * next) {
+    size_t pops, pushes;
+    if (!_ir_stack_use(inst, &pops, &pushes)) return false;
+
+    switch (inst->op) {
+        case IR_OP_GET_LOCAL:
+        case IR_OP_ADD_LOCALS: {
+            if (inst->arg >= depth || inst->arg2 >= depth) return false;
+            break;
+        }
+        case IR_OP_SET_LOCAL:
+        case IR_OP_INC_LOCAL:
+        case IR_OP_STORE_LOCAL: {
+            if (inst->arg >= depth) return false;
+            break;
+        }
+        default: break;
+    }
+    if (pops > depth) return false;
+    * next = depth - pops + pushes;
+    return true;
+}
+
+// Gives the generic form of a quickened opcode, the opcodes that aren't quickened are given back as they are.
+// NOTE: quickened arithmetic follows the order of the generic opcodes, an int and a float form for each of them
+FLUFF_PRIVATE_API uint8_t _ir_generic_opcode(uint8_t op) {
+    static const uint8_t arith_ops[] = {
+        IR_OP_ADD, IR_OP_SUB, IR_OP_MUL, IR_OP_EQ, IR_OP_NE, IR_OP_GT, IR_OP_GE, IR_OP_LT, IR_OP_LE,
+    };
+    if (op == IR_OP_LT_JZ_INT) return IR_OP_LT_JZ;
+    // NOTE: a tail call returns through the RET after it, only the stack VM runs it as it is
+    if (op == IR_OP_TAIL_CALL) return IR_OP_CALL;
+    if (op >= IR_OP_ADD_INT_INT && op <= IR_OP_LE_FLOAT_FLOAT) return arith_ops[(op - IR_OP_ADD_INT_INT) / 2];
+    return op;
+}
+
+// Decodes 'chunk' into 'insts' along with the stack size before each of them, 'count' entries and the end of the chunk last.
+// Gives the biggest stack the chunk needs in 'stack_size', returns false when a jump lands inside an instruction or
+// the depths don't work out (see '_ir_flow_depths'). 'insts' is always allocated.
+// NOTE: quickened opcodes are decoded as their generic form, tail calls are kept for the tiers that reuse frames
+FLUFF_PRIVATE_API bool _ir_flow_chunk(const IRChunk * chunk, size_t preserve, IRFlowInst ** insts, size_t * count, size_t * stack_size) {
+    // NOTE: every instruction takes at least a byte, so the chunk size bounds their count
+    IRFlowInst * out = fluff_alloc(NULL, sizeof(IRFlowInst) * (chunk->size + 1));
+    size_t       n   = 0;
+    size_t       ip  = 0;
+    while (ip < chunk->size) {
+        IRFlowInst * t = &out[n++];
+        FLUFF_CLEANUP(t);
+        t->inst = _ir_decode(chunk->data, ip);
+        if (t->inst.op != IR_OP_TAIL_CALL) t->inst.op = _ir_generic_opcode(t->inst.op);
+        t->offset = ip;
+        ip += t->inst.size;
+    }
+
+    IRFlowInst * end = &out[n];
+    FLUFF_CLEANUP(end);
+    end->offset = ip;
+
+    * insts = out;
+    * count = n;
+    for (size_t i = 0; i < n; ++i) {
+        IRFlowInst * t = &out[i];
+        if (!_ir_opcode_is_jump(t->inst.op)) continue;
+
+        const size_t target = (size_t)((ptrdiff_t)(t->offset + t->inst.size) + t->inst.jump);
+        size_t lo = 0, hi = n;
+        while (lo < hi) {
+            const size_t mid = (lo + hi) / 2;
+            if (out[mid].offset < target) lo = mid + 1;
+            else hi = mid;
+        }
+        if (out[lo].offset != target) return false;
+        t->target = lo;
+    }
+    return _ir_flow_depths(out, n, preserve, stack_size);
+}
+
+// Walks every path of 'insts' from the first one, which runs with 'preserve' entries, and gives the stack size before
+// each of them. Jump targets reached are labelled, 'stack_size' (if any) gets the biggest stack along the way.
+// NOTE: every path into an instruction has to agree on the stack size, since entries are addressed by it, and running
+//       off the end pushes the void being returned
+FLUFF_PRIVATE_API bool _ir_flow_depths(IRFlowInst * insts, size_t count, size_t preserve, size_t * stack_size) {
+    for (size_t i = 0; i <= count; ++i) {
+        insts[i].depth = IR_FLOW_UNKNOWN;
+        insts[i].label = false;
+    }
+
+    size_t * pending = fluff_alloc(NULL, sizeof(size_t) * (count + 1));
+    size_t   pending_count = 0;
+    size_t   max = preserve;
+
+    bool ok = true;
+    insts[0].depth = preserve;
+    pending[pending_count++] = 0;
+    while (pending_count > 0 && ok) {
+        const size_t i = pending[--pending_count];
+        IRFlowInst * t = &insts[i];
+        if (i == count) continue;
+
+        size_t next;
+        if (!_ir_stack_effect(&t->inst, t->depth, &next)) {
+            ok = false;
+            break;
+        }
+        max = FLUFF_MAX(max, FLUFF_MAX(next, t->depth));
+
+        size_t successors[2], successor_count = 0;
+        if (t->inst.op != IR_OP_JMP && t->inst.op != IR_OP_RET) successors[successor_count++] = i + 1;
+        if (_ir_opcode_is_jump(t->inst.op)) {
+            successors[successor_count++] = t->target;
+            insts[t->target].label = true;
+        }
+
+        for (size_t k = 0; k < successor_count; ++k) {
+            IRFlowInst * s = &insts[successors[k]];
+            if (s->depth == IR_FLOW_UNKNOWN) {
+                s->depth = next;
+                pending[pending_count++] = successors[k];
+            } else if (s->depth != next) {
+                ok = false;
+                break;
+            }
+        }
+    }
+    fluff_free(pending);
+
+    if (insts[count].depth != IR_FLOW_UNKNOWN) max = FLUFF_MAX(max, insts[count].depth + 1);
+    if (stack_size) * stack_size = max;
+    return ok;
 }
 
 /* -=============
@@ -172,5 +677,98 @@ FLUFF_PRIVATE_API IRBinary * _new_ir_binary() {
 }
 
 FLUFF_PRIVATE_API void _free_ir_binary(IRBinary * self) {
+    _ir_binary_clear(self);
+    if (self->methods)   fluff_free(self->methods);
+    if (self->constants) fluff_free(self->constants);
+    if (self->buckets)   fluff_free(self->buckets);
     fluff_free(self);
+}
+
+FLUFF_PRIVATE_API size_t _ir_binary_add_method(IRBinary * self, FluffMethod * method) {
+    if (self->method_count >= self->method_capacity) {
+        self->method_capacity = FLUFF_MAX(self->method_capacity * 2, 8);
+        self->methods         = fluff_alloc(self->methods, sizeof(FluffMethod *) * self->method_capacity);
+    }
+    self->methods[self->method_count] = method;
+    return self->method_count++;
+}
+
+FLUFF_PRIVATE_API void _ir_binary_clear(IRBinary * self) {
+    _free_ir_chunk(&self->main_chunk);
+    while (self->method_count > 0)
+        _free_method(self->methods[--self->method_count]);
+
+    while (self->constant_count > 0) {
+        IRConstant * constant = &self->constants[--self->constant_count];
+        if (constant->type == IR_CONSTANT_STRING) _free_string(&constant->data.s);
+    }
+    if (self->buckets) FLUFF_CLEANUP_N(self->buckets, sizeof(uint32_t) * self->bucket_count);
+}
+
+/* -=- Constants -=- */
+FLUFF_PRIVATE_API uint32_t _ir_binary_add_int(IRBinary * self, FluffInt v) {
+    return _ir_binary_add_constant(self, IR_CONSTANT_INT, &v, sizeof(v));
+}
+
+FLUFF_PRIVATE_API uint32_t _ir_binary_add_float(IRBinary * self, FluffFloat v) {
+    return _ir_binary_add_constant(self, IR_CONSTANT_FLOAT, &v, sizeof(v));
+}
+
+FLUFF_PRIVATE_API uint32_t _ir_binary_add_string(IRBinary * self, const char * str, size_t len) {
+    return _ir_binary_add_constant(self, IR_CONSTANT_STRING, str, len);
+}
+
+FLUFF_PRIVATE_API uint32_t _ir_binary_add_klass(IRBinary * self, FluffKlass * klass) {
+    return _ir_binary_add_constant(self, IR_CONSTANT_KLASS, &klass, sizeof(klass));
+}
+
+// NOTE: drops the constants added last, nothing may refer to them anymore
+FLUFF_PRIVATE_API void _ir_binary_truncate_constants(IRBinary * self, size_t count) {
+    const size_t mask = self->bucket_count - 1;
+    while (self->constant_count > count) {
+        IRConstant * constant = &self->constants[--self->constant_count];
+
+        // NOTE: the newest constant is never on the probe path of an older one, so its bucket can be emptied
+        size_t i = (size_t)constant->hash & mask;
+        while (self->buckets[i] != self->constant_count + 1) i = (i + 1) & mask;
+        self->buckets[i] = 0;
+
+        if (constant->type == IR_CONSTANT_STRING) _free_string(&constant->data.s);
+    }
+}
+
+FLUFF_PRIVATE_API const IRConstant * _ir_binary_get_constant(const IRBinary * self, uint32_t index) {
+    if (index >= self->constant_count) return NULL;
+    return &self->constants[index];
+}
+
+FLUFF_PRIVATE_API size_t _ir_binary_code_size(const IRBinary * self) {
+    size_t size = self->main_chunk.size;
+    for (size_t i = 0; i < self->method_count; ++i)
+        if (self->methods[i]->chunk) size += self->methods[i]->chunk->size;
+    return size;
+}
+
+FLUFF_PRIVATE_API size_t _ir_binary_memory_usage(const IRBinary * self) {
+    size_t size = _ir_binary_code_size(self) + sizeof(IRConstant) * self->constant_count;
+    for (size_t i = 0; i < self->constant_count; ++i)
+        if (self->constants[i].type == IR_CONSTANT_STRING) size += self->constants[i].data.s.capacity;
+    return size;
+}
+
+FLUFF_PRIVATE_API void _ir_binary_dump(IRBinary * self) {
+    printf("constants:\n");
+    for (size_t i = 0; i < self->constant_count; ++i) {
+        printf("#%zu\t", i);
+        _ir_constant_dump(&self->constants[i]);
+        putchar('\n');
+    }
+
+    printf("\nmain:\n");
+    _ir_chunk_dump(&self->main_chunk, self);
+    for (size_t i = 0; i < self->method_count; ++i) {
+        printf("\n[%zu] %s:\n", i, self->methods[i]->name);
+        if (self->methods[i]->chunk) _ir_chunk_dump(self->methods[i]->chunk, self);
+    }
+    printf("\n%zu bytes of code, %zu constants\n", _ir_binary_code_size(self), self->constant_count);
 }
\ No newline at end of file
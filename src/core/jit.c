@@ -0,0 +1,806 @@
+/* -=============
+     Includes
+   =============- */
+
+#define FLUFF_IMPLEMENTATION
+#include <base.h>
+#include <error.h>
+#include <core/jit.h>
+#include <core/trace.h>
+#include <core/vm.h>
+#include <core/object.h>
+#include <core/instance.h>
+#include <core/class.h>
+#include <core/method.h>
+#include <core/config.h>
+
+#if FLUFF_JIT_AVAILABLE
+#include <sys/mman.h>
+#endif
+
+/* -==============
+     Internals
+   ==============- */
+
+#if FLUFF_JIT_AVAILABLE
+
+#define JIT_MIN_CAPACITY 1024
+
+// NOTE: every hole a stencil can have, named after the symbol standing for it in tools/jit_stencils.c
+typedef enum JitHoleKind {
+    JIT_HOLE_CONTINUE,
+    JIT_HOLE_TARGET,
+    JIT_HOLE_INSTANCE,
+    JIT_HOLE_INT_CLASS,
+    JIT_HOLE_FLOAT_CLASS,
+    JIT_HOLE_BOOL_CLASS,
+    JIT_HOLE_SLOT_A,
+    JIT_HOLE_SLOT_B,
+    JIT_HOLE_HELPER,
+    JIT_HOLE_DEPTH,
+    JIT_HOLE_ARG,
+    JIT_HOLE_ARG2,
+    JIT_HOLE_COUNT,
+} JitHoleKind;
+
+// This struct represents a 64-bit immediate in a stencil, it's patched with 'addend' plus what it stands for.
+// NOTE: 'jump' is set when the immediate is only loaded to jump to it
+typedef struct JitHole {
+    uint32_t    offset;
+    JitHoleKind kind;
+    int64_t     addend;
+    bool        jump;
+} JitHole;
+
+// This struct represents the precompiled code of an opcode, see tools/jit_stencils.c.
+typedef struct JitStencil {
+    const uint8_t * code;
+    size_t          size;
+    const JitHole * holes;
+    size_t          hole_count;
+} JitStencil;
+
+#include <jit_stencils.h>
+
+// NOTE: what typed opcodes stand for, in the order they follow
+static const uint8_t jit_arith_ops[] = {
+    IR_OP_ADD, IR_OP_SUB, IR_OP_MUL, IR_OP_EQ, IR_OP_NE, IR_OP_GT, IR_OP_GE, IR_OP_LT, IR_OP_LE,
+};
+
+typedef FluffResult(* JitBinaryFn)(FluffObject *, FluffObject *, FluffObject *);
+typedef FluffResult(* JitUnaryFn)(FluffObject *, FluffObject *);
+
+// NOTE: helpers get the stack size of the instruction calling them, they give back the frame base or NULL on failure
+typedef FluffObject *(* JitHelperFn)(FluffVM *, size_t, uint64_t, uint64_t);
+
+typedef struct JitFixup {
+    size_t  at;
+    size_t  label;
+    int64_t addend;
+    bool    jump;
+} JitFixup;
+
+// This struct represents the compilation of a chunk into native code.
+// NOTE: the instruction count stands for the end of the chunk, where the stack VM returns void
+typedef struct Jit {
+    FluffVM * vm;
+    IRChunk * chunk;
+
+    IRFlowInst * insts;
+    size_t       count;
+    size_t       stack_size;
+
+    // NOTE: what the holes every stencil shares are filled with
+    uint64_t values[JIT_HOLE_COUNT];
+
+    uint8_t * code;
+    size_t    size, capacity;
+
+    // NOTE: native offset of each instruction, jumps to labels are patched once every one of them is known
+    size_t   * labels;
+    JitFixup * fixups;
+    size_t     fixup_count, fixup_capacity;
+} Jit;
+
+/* -=- Helpers -=- */
+
+// NOTE: native code keeps the stack size to itself, helpers put it back into the VM before touching the stack
+FLUFF_CONSTEXPR FluffObject * jit_sync(FluffVM * self, size_t depth) {
+    self->stack_count = self->current_frame.base + depth;
+    return &self->stack[self->current_frame.base];
+}
+
+FLUFF_CONSTEXPR FluffObject * jit_frame(FluffVM * self) {
+    return &self->stack[self->current_frame.base];
+}
+
+FLUFF_CONSTEXPR FluffKlass * jit_core_class(FluffVM * self, uint8_t type) {
+    return fluff_instance_get_core_class(self->instance, type);
+}
+
+static FluffObject * jit_help_binary(FluffVM * self, size_t depth, uint64_t fn, uint64_t is_bool) {
+    FluffObject * lhs = &jit_sync(self, depth)[depth - 2];
+
+    FluffObject result;
+    _new_null_object(&result, self->instance, (is_bool ? jit_core_class(self, FLUFF_KLASS_BOOL) : lhs->klass));
+    if (((JitBinaryFn)(uintptr_t)fn)(lhs, lhs + 1, &result) == FLUFF_FAILURE) return NULL;
+
+    _vm_stack_popn(self, 2);
+    self->stack[self->stack_count++] = result;
+    return jit_frame(self);
+}
+
+static FluffObject * jit_help_unary(FluffVM * self, size_t depth, uint64_t fn, uint64_t is_bool) {
+    FluffObject * operand = &jit_sync(self, depth)[depth - 1];
+
+    FluffObject result;
+    _new_null_object(&result, self->instance, (is_bool ? jit_core_class(self, FLUFF_KLASS_BOOL) : operand->klass));
+    if (((JitUnaryFn)(uintptr_t)fn)(operand, &result) == FLUFF_FAILURE) return NULL;
+
+    _free_object(operand);
+    * operand = result;
+    return jit_frame(self);
+}
+
+static FluffObject * jit_help_push(FluffVM * self, size_t depth, uint64_t op, uint64_t arg) {
+    jit_sync(self, depth);
+    FluffResult res = FLUFF_FAILURE;
+    switch (op) {
+        case IR_OP_PUSH_VOID: {
+            res = fluff_vm_push_null_object(self, jit_core_class(self, FLUFF_KLASS_VOID));
+            break;
+        }
+        case IR_OP_PUSH_STRING: {
+            const FluffString * str = &self->binary->constants[arg].data.s;
+            res = fluff_vm_push_string_n(self, str->data, str->length);
+            break;
+        }
+        case IR_OP_PUSH_FUNC: {
+            if (!self->binary || arg >= self->binary->method_count) {
+                fluff_push_error("attempt to push an unknown function (%zu)", (size_t)arg);
+                break;
+            }
+
+            FluffObject obj;
+            _new_function_object(&obj, self->instance, self->binary->methods[arg]);
+            res = fluff_vm_push(self, &obj);
+            break;
+        }
+        default: break;
+    }
+    return (res == FLUFF_OK ? jit_frame(self) : NULL);
+}
+
+static FluffObject * jit_help_popn(FluffVM * self, size_t depth, uint64_t count, uint64_t unused) {
+    jit_sync(self, depth);
+    _vm_stack_popn(self, count);
+    return jit_frame(self);
+}
+
+static FluffObject * jit_help_get_local(FluffVM * self, size_t depth, uint64_t slot, uint64_t unused) {
+    FluffObject * frame = jit_sync(self, depth);
+    _ref_object(&frame[depth], &frame[slot]);
+    ++self->stack_count;
+    return frame;
+}
+
+static FluffObject * jit_help_set_local(FluffVM * self, size_t depth, uint64_t slot, uint64_t unused) {
+    FluffObject * frame = jit_sync(self, depth);
+    _free_object(&frame[slot]);
+    _ref_object(&frame[slot], &frame[depth - 1]);
+    return frame;
+}
+
+// NOTE: the top entry is moved into the local rather than referenced and then popped
+static FluffObject * jit_help_store_local(FluffVM * self, size_t depth, uint64_t slot, uint64_t unused) {
+    FluffObject * frame = jit_sync(self, depth);
+    _free_object(&frame[slot]);
+    frame[slot] = frame[depth - 1];
+    --self->stack_count;
+    return frame;
+}
+
+static FluffObject * jit_help_inc_local(FluffVM * self, size_t depth, uint64_t slot, uint64_t v) {
+    FluffObject * local = &jit_sync(self, depth)[slot];
+
+    FluffObject rhs, result;
+    _new_int_object(&rhs, self->instance, (FluffInt)v);
+    _new_null_object(&result, self->instance, local->klass);
+    if (fluff_object_add(local, &rhs, &result) == FLUFF_FAILURE) return NULL;
+
+    _free_object(local);
+    * local = result;
+    return jit_frame(self);
+}
+
+static FluffObject * jit_help_add_locals(FluffVM * self, size_t depth, uint64_t lhs, uint64_t rhs) {
+    FluffObject * frame = jit_sync(self, depth);
+    _new_null_object(&frame[depth], self->instance, frame[lhs].klass);
+    if (fluff_object_add(&frame[lhs], &frame[rhs], &frame[depth]) == FLUFF_FAILURE) return NULL;
+    ++self->stack_count;
+    return frame;
+}
+
+static FluffObject * jit_help_add_int(FluffVM * self, size_t depth, uint64_t v, uint64_t op) {
+    FluffObject * lhs = &jit_sync(self, depth)[depth - 1];
+
+    FluffObject rhs, result;
+    _new_int_object(&rhs, self->instance, (FluffInt)v);
+    _new_null_object(&result, self->instance, lhs->klass);
+    if ((op == IR_OP_ADD_INT ? fluff_object_add : fluff_object_sub)(lhs, &rhs, &result) == FLUFF_FAILURE) return NULL;
+
+    _free_object(lhs);
+    * lhs = result;
+    return jit_frame(self);
+}
+
+// NOTE: only called once the condition turned out not to be a bool
+static FluffObject * jit_help_condition(FluffVM * self, size_t depth, uint64_t unused, uint64_t unused2) {
+    const FluffObject * obj = &jit_sync(self, depth)[depth - 1];
+    fluff_push_error("condition must be of type 'bool', not '%.*s'",
+        FLUFF_STR_BUFFER_FMT(_class_get_common_data(obj->klass)->name)
+    );
+    return NULL;
+}
+
+// NOTE: only called once the check failed
+static FluffObject * jit_help_check(FluffVM * self, size_t depth, uint64_t klass, uint64_t unused) {
+    const FluffObject * obj = &jit_sync(self, depth)[depth - 1];
+    fluff_push_error("expected a value of type '%.*s', found '%.*s'",
+        FLUFF_STR_BUFFER_FMT(_class_get_common_data((FluffKlass *)(uintptr_t)klass)->name),
+        FLUFF_STR_BUFFER_FMT(_class_get_common_data(obj->klass)->name)
+    );
+    return NULL;
+}
+
+static FluffObject * jit_help_is(FluffVM * self, size_t depth, uint64_t klass, uint64_t unused) {
+    FluffObject * top = &jit_sync(self, depth)[depth - 1];
+    const bool    is  = (klass && top->klass && fluff_object_is_same_class(top, (FluffKlass *)(uintptr_t)klass));
+    _free_object(top);
+    _new_bool_object(top, self->instance, is);
+    return jit_frame(self);
+}
+
+// NOTE: the converted object is moved into the stack, only its box is freed
+static FluffObject * jit_help_as(FluffVM * self, size_t depth, uint64_t klass, uint64_t unused) {
+    FluffObject * top = &jit_sync(self, depth)[depth - 1];
+    FluffObject * obj = fluff_object_as(top, (FluffKlass *)(uintptr_t)klass);
+    if (!obj) return NULL;
+
+    _free_object(top);
+    * top = * obj;
+    fluff_free(obj);
+    return jit_frame(self);
+}
+
+static FluffObject * jit_help_call(FluffVM * self, size_t depth, uint64_t argc, uint64_t typed) {
+    jit_sync(self, depth);
+    if (_vm_call(self, argc, typed) == FLUFF_FAILURE) return NULL;
+    return jit_frame(self);
+}
+
+// NOTE: the native code returns right after, the callee runs in its frame once it did (see _vm_tail_call)
+static FluffObject * jit_help_tail_call(FluffVM * self, size_t depth, uint64_t argc, uint64_t typed) {
+    jit_sync(self, depth);
+    if (_vm_tail_call(self, argc, typed) == FLUFF_FAILURE) return NULL;
+    return self->stack;
+}
+
+// NOTE: running off the end of a chunk returns void, like on the interpreters
+static FluffObject * jit_help_ret(FluffVM * self, size_t depth, uint64_t push_void, uint64_t unused) {
+    jit_sync(self, depth);
+    if (push_void && fluff_vm_push_null_object(self, jit_core_class(self, FLUFF_KLASS_VOID)) == FLUFF_FAILURE) return NULL;
+    if (_vm_pop_frame(self, 1) == FLUFF_FAILURE) return NULL;
+    return self->stack;
+}
+
+FLUFF_CONSTEXPR JitBinaryFn jit_binary_fn(uint8_t op) {
+    switch (op) {
+        case IR_OP_ADD:     return fluff_object_add;
+        case IR_OP_SUB:     return fluff_object_sub;
+        case IR_OP_MUL:     return fluff_object_mul;
+        case IR_OP_DIV:     return fluff_object_div;
+        case IR_OP_MOD:     return fluff_object_mod;
+        case IR_OP_POW:     return fluff_object_pow;
+        case IR_OP_BIT_AND: return fluff_object_bit_and;
+        case IR_OP_BIT_OR:  return fluff_object_bit_or;
+        case IR_OP_BIT_XOR: return fluff_object_bit_xor;
+        case IR_OP_BIT_SHL: return fluff_object_bit_shl;
+        case IR_OP_BIT_SHR: return fluff_object_bit_shr;
+        case IR_OP_EQ:      return fluff_object_eq;
+        case IR_OP_NE:      return fluff_object_ne;
+        case IR_OP_GT:      return fluff_object_gt;
+        case IR_OP_GE:      return fluff_object_ge;
+        case IR_OP_LT:      return fluff_object_lt;
+        case IR_OP_LE:      return fluff_object_le;
+        case IR_OP_AND:     return fluff_object_and;
+        default:            return fluff_object_or;
+    }
+}
+
+FLUFF_CONSTEXPR JitUnaryFn jit_unary_fn(uint8_t op) {
+    switch (op) {
+        case IR_OP_BIT_NOT: return fluff_object_bit_not;
+        case IR_OP_NEGATE:  return fluff_object_negate;
+        default:            return fluff_object_not;
+    }
+}
+
+/* -=- Stencils -=- */
+
+// Copies a stencil and fills its holes with 'values', it continues to the label 'next' and jumps to 'target'.
+// NOTE: jumps are only patched once every label has been placed, see jit_link
+static void jit_copy_stencil(Jit * self, JitStencilType type, size_t next, size_t target, const uint64_t * values) {
+    const JitStencil * stencil = &jit_stencils[type];
+    if (self->size + stencil->size > self->capacity) {
+        self->capacity = FLUFF_MAX(FLUFF_MAX(self->capacity * 2, self->size + stencil->size), JIT_MIN_CAPACITY);
+        self->code     = fluff_alloc(self->code, self->capacity);
+    }
+
+    const size_t start = self->size;
+    memcpy(&self->code[start], stencil->code, stencil->size);
+    self->size += stencil->size;
+
+    for (size_t i = 0; i < stencil->hole_count; ++i) {
+        const JitHole * hole = &stencil->holes[i];
+        if (hole->kind == JIT_HOLE_CONTINUE || hole->kind == JIT_HOLE_TARGET) {
+            if (self->fixup_count >= self->fixup_capacity) {
+                self->fixup_capacity = FLUFF_MAX(self->fixup_capacity * 2, 16);
+                self->fixups         = fluff_alloc(self->fixups, sizeof(JitFixup) * self->fixup_capacity);
+            }
+            self->fixups[self->fixup_count++] = (JitFixup){
+                .at     = start + hole->offset,
+                .label  = (hole->kind == JIT_HOLE_CONTINUE ? next : target),
+                .addend = hole->addend,
+                .jump   = hole->jump,
+            };
+            continue;
+        }
+
+        const uint64_t v = values[hole->kind] + (uint64_t)hole->addend;
+        memcpy(&self->code[start + hole->offset], &v, sizeof(v));
+    }
+}
+
+FLUFF_CONSTEXPR uint64_t jit_slot(size_t index) {
+    return index * sizeof(FluffObject);
+}
+
+FLUFF_CONSTEXPR uint64_t jit_helper(JitHelperFn fn) {
+    return (uint64_t)(uintptr_t)fn;
+}
+
+// NOTE: quickened and typed arithmetic share the generic stencil table, in the order 'jit_arith_ops' follows
+static const JitStencilType jit_arith_stencils[][3] = {
+    { JIT_STENCIL_ADD, JIT_STENCIL_IADD, JIT_STENCIL_FADD },
+    { JIT_STENCIL_SUB, JIT_STENCIL_ISUB, JIT_STENCIL_FSUB },
+    { JIT_STENCIL_MUL, JIT_STENCIL_IMUL, JIT_STENCIL_FMUL },
+    { JIT_STENCIL_EQ,  JIT_STENCIL_IEQ,  JIT_STENCIL_FEQ  },
+    { JIT_STENCIL_NE,  JIT_STENCIL_INE,  JIT_STENCIL_FNE  },
+    { JIT_STENCIL_GT,  JIT_STENCIL_IGT,  JIT_STENCIL_FGT  },
+    { JIT_STENCIL_GE,  JIT_STENCIL_IGE,  JIT_STENCIL_FGE  },
+    { JIT_STENCIL_LT,  JIT_STENCIL_ILT,  JIT_STENCIL_FLT  },
+    { JIT_STENCIL_LE,  JIT_STENCIL_ILE,  JIT_STENCIL_FLE  },
+};
+
+FLUFF_CONSTEXPR size_t jit_arith_index(uint8_t op) {
+    if (_ir_opcode_is_typed(op)) return (op - IR_OP_IADD) % FLUFF_LENOF(jit_arith_ops);
+
+    size_t index = 0;
+    while (jit_arith_ops[index] != op) ++index;
+    return index;
+}
+
+// Emits 'inst' for the stack size 'depth' it runs with, jumping to the label 'target'.
+static void jit_emit_inst(Jit * self, const IRInstruction * inst, size_t depth, size_t next, size_t target) {
+    const size_t top = depth - 1;
+
+    uint64_t values[JIT_HOLE_COUNT];
+    memcpy(values, self->values, sizeof(values));
+    values[JIT_HOLE_DEPTH] = depth;
+
+    JitStencilType type = JIT_STENCIL_HELPER;
+    switch (inst->op) {
+        case IR_OP_NOP:
+        case IR_OP_PROMOTE: return;
+        case IR_OP_JMP: {
+            type = JIT_STENCIL_JMP;
+            break;
+        }
+        case IR_OP_JZ:
+        case IR_OP_JNZ: {
+            type = (inst->op == IR_OP_JZ ? JIT_STENCIL_JZ : JIT_STENCIL_JNZ);
+            values[JIT_HOLE_SLOT_A] = jit_slot(top);
+            values[JIT_HOLE_HELPER] = jit_helper(jit_help_condition);
+            break;
+        }
+        case IR_OP_LT_JZ:
+        case IR_OP_ILT_JZ:
+        case IR_OP_ILT_JNZ: {
+            type = (inst->op == IR_OP_LT_JZ ? JIT_STENCIL_LT_JZ : (inst->op == IR_OP_ILT_JZ ? JIT_STENCIL_ILT_JZ : JIT_STENCIL_ILT_JNZ));
+            values[JIT_HOLE_SLOT_A] = jit_slot(depth - 2);
+            values[JIT_HOLE_SLOT_B] = jit_slot(top);
+            values[JIT_HOLE_HELPER] = jit_helper(jit_help_binary);
+            values[JIT_HOLE_ARG]    = (uint64_t)(uintptr_t)fluff_object_lt;
+            values[JIT_HOLE_ARG2]   = true;
+            break;
+        }
+        case IR_OP_PUSH_TRUE:
+        case IR_OP_PUSH_FALSE: {
+            type = JIT_STENCIL_PUSH_BOOL;
+            values[JIT_HOLE_SLOT_A] = jit_slot(depth);
+            values[JIT_HOLE_ARG]    = (inst->op == IR_OP_PUSH_TRUE);
+            break;
+        }
+        case IR_OP_PUSH_INT:
+        case IR_OP_PUSH_FLOAT: {
+            const IRConstant * constant = &self->vm->binary->constants[inst->arg];
+            if (inst->op == IR_OP_PUSH_INT) memcpy(&values[JIT_HOLE_ARG], &constant->data.i, sizeof(uint64_t));
+            else memcpy(&values[JIT_HOLE_ARG], &constant->data.f, sizeof(uint64_t));
+
+            type = (inst->op == IR_OP_PUSH_INT ? JIT_STENCIL_PUSH_INT : JIT_STENCIL_PUSH_FLOAT);
+            values[JIT_HOLE_SLOT_A] = jit_slot(depth);
+            break;
+        }
+        case IR_OP_PUSH_VOID:
+        case IR_OP_PUSH_STRING:
+        case IR_OP_PUSH_FUNC: {
+            values[JIT_HOLE_HELPER] = jit_helper(jit_help_push);
+            values[JIT_HOLE_ARG]    = inst->op;
+            values[JIT_HOLE_ARG2]   = inst->arg;
+            break;
+        }
+        case IR_OP_POP:
+        case IR_OP_POPN: {
+            if (inst->op == IR_OP_POPN && inst->arg == 0) return;
+            values[JIT_HOLE_HELPER] = jit_helper(jit_help_popn);
+            values[JIT_HOLE_ARG]    = (inst->op == IR_OP_POP ? 1 : inst->arg);
+            break;
+        }
+        case IR_OP_GET_LOCAL: {
+            type = JIT_STENCIL_GET_LOCAL;
+            values[JIT_HOLE_SLOT_A] = jit_slot(inst->arg);
+            values[JIT_HOLE_SLOT_B] = jit_slot(depth);
+            values[JIT_HOLE_HELPER] = jit_helper(jit_help_get_local);
+            values[JIT_HOLE_ARG]    = inst->arg;
+            break;
+        }
+        case IR_OP_SET_LOCAL: {
+            if (inst->arg == top) return;
+            type = JIT_STENCIL_SET_LOCAL;
+            values[JIT_HOLE_SLOT_A] = jit_slot(inst->arg);
+            values[JIT_HOLE_SLOT_B] = jit_slot(top);
+            values[JIT_HOLE_HELPER] = jit_helper(jit_help_set_local);
+            values[JIT_HOLE_ARG]    = inst->arg;
+            break;
+        }
+        case IR_OP_STORE_LOCAL: {
+            if (inst->arg == top) {
+                values[JIT_HOLE_HELPER] = jit_helper(jit_help_popn);
+                values[JIT_HOLE_ARG]    = 1;
+                break;
+            }
+            type = JIT_STENCIL_STORE_LOCAL;
+            values[JIT_HOLE_SLOT_A] = jit_slot(inst->arg);
+            values[JIT_HOLE_SLOT_B] = jit_slot(top);
+            values[JIT_HOLE_HELPER] = jit_helper(jit_help_store_local);
+            values[JIT_HOLE_ARG]    = inst->arg;
+            break;
+        }
+        case IR_OP_INC_LOCAL: {
+            type = JIT_STENCIL_INC_LOCAL;
+            values[JIT_HOLE_SLOT_A] = jit_slot(inst->arg);
+            values[JIT_HOLE_HELPER] = jit_helper(jit_help_inc_local);
+            values[JIT_HOLE_ARG]    = inst->arg;
+            values[JIT_HOLE_ARG2]   = (uint64_t)self->vm->binary->constants[inst->arg2].data.i;
+            break;
+        }
+        case IR_OP_ADD_LOCALS: {
+            type = JIT_STENCIL_ADD_LOCALS;
+            values[JIT_HOLE_SLOT_A] = jit_slot(inst->arg);
+            values[JIT_HOLE_SLOT_B] = jit_slot(inst->arg2);
+            values[JIT_HOLE_HELPER] = jit_helper(jit_help_add_locals);
+            values[JIT_HOLE_ARG]    = inst->arg;
+            values[JIT_HOLE_ARG2]   = inst->arg2;
+            break;
+        }
+        case IR_OP_ADD_INT:
+        case IR_OP_SUB_INT: {
+            type = (inst->op == IR_OP_ADD_INT ? JIT_STENCIL_ADD_INT : JIT_STENCIL_SUB_INT);
+            values[JIT_HOLE_SLOT_A] = jit_slot(top);
+            values[JIT_HOLE_HELPER] = jit_helper(jit_help_add_int);
+            values[JIT_HOLE_ARG]    = (uint64_t)self->vm->binary->constants[inst->arg].data.i;
+            values[JIT_HOLE_ARG2]   = inst->op;
+            break;
+        }
+        case IR_OP_CHECK: {
+            type = JIT_STENCIL_CHECK;
+            values[JIT_HOLE_SLOT_A] = jit_slot(top);
+            values[JIT_HOLE_HELPER] = jit_helper(jit_help_check);
+            values[JIT_HOLE_ARG]    = (uint64_t)(uintptr_t)self->vm->binary->constants[inst->arg].data.klass;
+            break;
+        }
+        case IR_OP_IS:
+        case IR_OP_AS: {
+            values[JIT_HOLE_HELPER] = jit_helper(inst->op == IR_OP_IS ? jit_help_is : jit_help_as);
+            values[JIT_HOLE_ARG]    = (uint64_t)(uintptr_t)self->vm->binary->constants[inst->arg].data.klass;
+            break;
+        }
+        case IR_OP_CALL: {
+            values[JIT_HOLE_HELPER] = jit_helper(jit_help_call);
+            values[JIT_HOLE_ARG]    = inst->arg;
+            values[JIT_HOLE_ARG2]   = self->chunk->typed;
+            break;
+        }
+        case IR_OP_TAIL_CALL: {
+            type = JIT_STENCIL_RET;
+            values[JIT_HOLE_HELPER] = jit_helper(jit_help_tail_call);
+            values[JIT_HOLE_ARG]    = inst->arg;
+            values[JIT_HOLE_ARG2]   = self->chunk->typed;
+            break;
+        }
+        case IR_OP_RET: {
+            type = JIT_STENCIL_RET;
+            values[JIT_HOLE_HELPER] = jit_helper(jit_help_ret);
+            values[JIT_HOLE_ARG]    = false;
+            break;
+        }
+        default: {
+            const bool typed = _ir_opcode_is_typed(inst->op);
+            if (typed || (inst->op >= IR_OP_ADD && inst->op <= IR_OP_MUL) || (inst->op >= IR_OP_EQ && inst->op <= IR_OP_LE)) {
+                const size_t index = jit_arith_index(inst->op);
+                const size_t kind  = (!typed ? 0 : (inst->op < IR_OP_FADD ? 1 : 2));
+
+                type = jit_arith_stencils[index][kind];
+                values[JIT_HOLE_SLOT_A] = jit_slot(depth - 2);
+                values[JIT_HOLE_SLOT_B] = jit_slot(top);
+                values[JIT_HOLE_HELPER] = jit_helper(jit_help_binary);
+                values[JIT_HOLE_ARG]    = (uint64_t)(uintptr_t)jit_binary_fn(jit_arith_ops[index]);
+                values[JIT_HOLE_ARG2]   = (index >= 3);
+            } else if (_ir_opcode_is_binary(inst->op)) {
+                values[JIT_HOLE_HELPER] = jit_helper(jit_help_binary);
+                values[JIT_HOLE_ARG]    = (uint64_t)(uintptr_t)jit_binary_fn(inst->op);
+                values[JIT_HOLE_ARG2]   = (inst->op >= IR_OP_EQ);
+            } else {
+                values[JIT_HOLE_HELPER] = jit_helper(jit_help_unary);
+                values[JIT_HOLE_ARG]    = (uint64_t)(uintptr_t)jit_unary_fn(inst->op);
+                values[JIT_HOLE_ARG2]   = (inst->op == IR_OP_NOT);
+            }
+            break;
+        }
+    }
+    jit_copy_stencil(self, type, next, target, values);
+}
+
+/* -=- Compiler -=- */
+static void jit_set_values(Jit * self) {
+    self->values[JIT_HOLE_INSTANCE]    = (uint64_t)(uintptr_t)self->vm->instance;
+    self->values[JIT_HOLE_INT_CLASS]   = (uint64_t)(uintptr_t)jit_core_class(self->vm, FLUFF_KLASS_INT);
+    self->values[JIT_HOLE_FLOAT_CLASS] = (uint64_t)(uintptr_t)jit_core_class(self->vm, FLUFF_KLASS_FLOAT);
+    self->values[JIT_HOLE_BOOL_CLASS]  = (uint64_t)(uintptr_t)jit_core_class(self->vm, FLUFF_KLASS_BOOL);
+}
+
+static void jit_emit(Jit * self) {
+    jit_set_values(self);
+    self->labels = fluff_alloc(NULL, sizeof(size_t) * (self->count + 1));
+    for (size_t i = 0; i <= self->count; ++i) {
+        const IRFlowInst * t = &self->insts[i];
+        self->labels[i] = self->size;
+        if (t->depth == IR_FLOW_UNKNOWN) continue;
+
+        if (i < self->count) {
+            jit_emit_inst(self, &t->inst, t->depth, i + 1, t->target);
+            continue;
+        }
+
+        uint64_t values[JIT_HOLE_COUNT];
+        memcpy(values, self->values, sizeof(values));
+        values[JIT_HOLE_DEPTH]  = t->depth;
+        values[JIT_HOLE_HELPER] = jit_helper(jit_help_ret);
+        values[JIT_HOLE_ARG]    = true;
+        jit_copy_stencil(self, JIT_STENCIL_RET, i + 1, i + 1, values);
+    }
+}
+
+/* -=- Traces -=- */
+
+// NOTE: leaves a trace, the interpreter picks up at 'ip' once the stack size is back into the VM
+static FluffObject * jit_help_exit(FluffVM * self, size_t depth, uint64_t exit, uint64_t ip) {
+    ++((TraceExit *)(uintptr_t)exit)->count;
+    self->current_frame.ip = ip;
+    return jit_sync(self, depth);
+}
+
+// NOTE: operations are labeled by their index, the exits of the trace come right after them
+static void jit_emit_trace_op(Jit * self, Trace * trace, size_t index, size_t loop) {
+    const TraceOp * op   = &trace->ops[index];
+    const size_t    exit = (op->exit == SIZE_MAX ? index + 1 : trace->op_count + op->exit);
+
+    uint64_t values[JIT_HOLE_COUNT];
+    memcpy(values, self->values, sizeof(values));
+    values[JIT_HOLE_DEPTH]  = op->depth;
+    values[JIT_HOLE_SLOT_A] = jit_slot(op->a);
+    values[JIT_HOLE_SLOT_B] = jit_slot(op->b);
+    values[JIT_HOLE_ARG]    = op->value;
+
+    JitStencilType type = JIT_STENCIL_JMP;
+    switch (op->kind) {
+        case TRACE_OP_INST: {
+            jit_emit_inst(self, &op->inst, op->depth, index + 1, exit);
+            return;
+        }
+        case TRACE_OP_GUARD: {
+            type = JIT_STENCIL_GUARD;
+            values[JIT_HOLE_ARG] = (uint64_t)(uintptr_t)op->klass;
+            break;
+        }
+        case TRACE_OP_COPY:      { type = JIT_STENCIL_COPY;      break; }
+        case TRACE_OP_COPY_DATA: { type = JIT_STENCIL_COPY_DATA; break; }
+        case TRACE_OP_SET_DATA:  { type = JIT_STENCIL_SET_DATA;  break; }
+        case TRACE_OP_ADD_DATA:  { type = JIT_STENCIL_ADD_DATA;  break; }
+        case TRACE_OP_LOOP:      return;
+        case TRACE_OP_JUMP_LOOP: {
+            jit_copy_stencil(self, JIT_STENCIL_JMP, index + 1, loop, values);
+            return;
+        }
+    }
+    jit_copy_stencil(self, type, index + 1, exit, values);
+}
+
+static void jit_emit_trace(Jit * self, Trace * trace) {
+    jit_set_values(self);
+
+    size_t loop = 0;
+    self->labels = fluff_alloc(NULL, sizeof(size_t) * (trace->op_count + trace->exit_count));
+    for (size_t i = 0; i < trace->op_count; ++i) {
+        self->labels[i] = self->size;
+        if (trace->ops[i].kind == TRACE_OP_LOOP) loop = i;
+        jit_emit_trace_op(self, trace, i, loop);
+    }
+
+    // NOTE: each exit is a stub returning to the interpreter, with the stack size it expects
+    for (size_t i = 0; i < trace->exit_count; ++i) {
+        const TraceExit * exit = &trace->exits[i];
+        self->labels[trace->op_count + i] = self->size;
+
+        uint64_t values[JIT_HOLE_COUNT];
+        memcpy(values, self->values, sizeof(values));
+        values[JIT_HOLE_DEPTH]  = exit->depth;
+        values[JIT_HOLE_HELPER] = jit_helper(jit_help_exit);
+        values[JIT_HOLE_ARG]    = (uint64_t)(uintptr_t)exit;
+        values[JIT_HOLE_ARG2]   = exit->ip;
+        jit_copy_stencil(self, JIT_STENCIL_RET, 0, 0, values);
+    }
+}
+
+// Patches the jumps between stencils once the code has its final address.
+// NOTE: stencils load their jump targets as 64-bit immediates, those feeding an indirect jump become direct ones
+static void jit_link(Jit * self, uint8_t * memory) {
+    for (size_t i = 0; i < self->fixup_count; ++i) {
+        const JitFixup * fixup  = &self->fixups[i];
+        const uint8_t  * target = memory + self->labels[fixup->label] + fixup->addend;
+
+        if (!fixup->jump) {
+            const uint64_t v = (uint64_t)(uintptr_t)target;
+            memcpy(&memory[fixup->at], &v, sizeof(v));
+            continue;
+        }
+
+        uint8_t     * at     = &memory[fixup->at - 2];
+        const int32_t offset = (int32_t)(target - (at + 5));
+        at[0] = 0xe9;
+        memcpy(&at[1], &offset, sizeof(offset));
+    }
+}
+
+// NOTE: the code is written while the memory is writable and only then made executable
+static void jit_install(Jit * self, JitCode * code) {
+    void * memory = mmap(NULL, self->size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED) return;
+
+    memcpy(memory, self->code, self->size);
+    jit_link(self, memory);
+    if (mprotect(memory, self->size, PROT_READ | PROT_EXEC) != 0) {
+        munmap(memory, self->size);
+        return;
+    }
+    code->memory = memory;
+    code->size   = self->size;
+    code->entry  = (JitEntryFn)(uintptr_t)memory;
+}
+
+// NOTE: loop headers are the targets of backward jumps, only the ones the compiler reached can be entered
+static void jit_osr_entries(Jit * self, JitCode * code) {
+    for (size_t i = 0; i < self->count; ++i) {
+        const IRFlowInst * t = &self->insts[i];
+        if (!_ir_opcode_is_jump(t->inst.op) || t->target > i) continue;
+
+        const IRFlowInst * header = &self->insts[t->target];
+        if (header->depth == IR_FLOW_UNKNOWN || _jit_osr_entry(code, header->offset, header->depth)) continue;
+
+        code->osr_entries = fluff_alloc(code->osr_entries, sizeof(JitOsrEntry) * (code->osr_count + 1));
+        code->osr_entries[code->osr_count++] = (JitOsrEntry){
+            .ip    = header->offset,
+            .depth = header->depth,
+            .entry = (JitEntryFn)(uintptr_t)((uint8_t *)code->memory + self->labels[t->target]),
+        };
+    }
+}
+
+static void jit_free(Jit * self) {
+    if (self->insts)  fluff_free(self->insts);
+    if (self->code)   fluff_free(self->code);
+    if (self->labels) fluff_free(self->labels);
+    if (self->fixups) fluff_free(self->fixups);
+    FLUFF_CLEANUP(self);
+}
+
+#endif
+
+/* -============
+     JitCode
+   ============- */
+
+FLUFF_PRIVATE_API JitCode * _jit_compile_chunk(FluffVM * vm, IRChunk * chunk, size_t preserve) {
+    JitCode * self = fluff_alloc(NULL, sizeof(JitCode));
+    FLUFF_CLEANUP(self);
+    self->instance = vm->instance;
+    self->preserve = preserve;
+
+#if FLUFF_JIT_AVAILABLE
+    Jit jit;
+    FLUFF_CLEANUP(&jit);
+    jit.vm    = vm;
+    jit.chunk = chunk;
+    // NOTE: every path into an instruction has to agree on the stack size, since entries are addressed by it
+    if (_ir_flow_chunk(chunk, preserve, &jit.insts, &jit.count, &jit.stack_size) && jit.stack_size <= FLUFF_MAX_VM_STACK) {
+        jit_emit(&jit);
+        jit_install(&jit, self);
+        if (self->entry) jit_osr_entries(&jit, self);
+        self->stack_size = jit.stack_size;
+    }
+    jit_free(&jit);
+#endif
+    return self;
+}
+
+// NOTE: the code runs with the frame the loop runs in, it returns once one of the exits of the trace is taken
+FLUFF_PRIVATE_API JitCode * _jit_compile_trace(FluffVM * vm, Trace * trace) {
+    JitCode * self = fluff_alloc(NULL, sizeof(JitCode));
+    FLUFF_CLEANUP(self);
+    self->instance = vm->instance;
+    self->preserve = trace->depth;
+
+#if FLUFF_JIT_AVAILABLE
+    Jit jit;
+    FLUFF_CLEANUP(&jit);
+    jit.vm         = vm;
+    jit.chunk      = trace->chunk;
+    jit.stack_size = trace->depth;
+    for (size_t i = 0; i < trace->op_count; ++i)
+        jit.stack_size = FLUFF_MAX(jit.stack_size, trace->ops[i].depth + 1);
+
+    if (jit.stack_size <= FLUFF_MAX_VM_STACK) {
+        jit_emit_trace(&jit, trace);
+        jit_install(&jit, self);
+        self->stack_size = jit.stack_size;
+    }
+    jit_free(&jit);
+#endif
+    return self;
+}
+
+FLUFF_PRIVATE_API void _free_jit_code(JitCode * self) {
+#if FLUFF_JIT_AVAILABLE
+    if (self->memory) munmap(self->memory, self->size);
+#endif
+    if (self->osr_entries) fluff_free(self->osr_entries);
+    FLUFF_CLEANUP(self);
+}
+
+// Gives where a frame at the loop header 'ip' with 'depth' entries moves into the code, or NULL when it can't.
+FLUFF_PRIVATE_API JitEntryFn _jit_osr_entry(const JitCode * self, size_t ip, size_t depth) {
+    for (size_t i = 0; i < self->osr_count; ++i)
+        if (self->osr_entries[i].ip == ip && self->osr_entries[i].depth == depth) return self->osr_entries[i].entry;
+    return NULL;
+}
\ No newline at end of file
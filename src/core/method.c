@@ -12,6 +12,7 @@
 #include <core/instance.h>
 #include <core/object.h>
 #include <core/vm.h>
+#include <core/ir.h>
 #include <core/config.h>
 
 /* -==============
@@ -23,6 +24,16 @@
    ===========- */
 
 /* -=- Initializers -=- */
+FLUFF_API FluffMethod * fluff_new_method(const char * name, FluffMethodCallback callback) {
+    FluffMethod * self = _new_method(name, strlen(name));
+    self->callback = callback;
+    return self;
+}
+
+FLUFF_API void fluff_free_method(FluffMethod * self) {
+    _free_method(self);
+}
+
 FLUFF_PRIVATE_API FluffMethod * _new_method(const char * name, size_t len) {
     FluffMethod * self = fluff_alloc(NULL, sizeof(FluffMethod));
     FLUFF_CLEANUP(self);
@@ -34,8 +45,14 @@ FLUFF_PRIVATE_API FluffMethod * _new_method(const char * name, size_t len) {
 FLUFF_PRIVATE_API void _free_method(FluffMethod * self) {
     if (--self->ref_count > 0) return;
 
-    FLUFF_CLEANUP_N(self->properties, self->property_count);
-    fluff_free(self->properties);
+    if (self->chunk) {
+        _free_ir_chunk(self->chunk);
+        fluff_free(self->chunk);
+    }
+    if (self->properties) {
+        FLUFF_CLEANUP_N(self->properties, sizeof(MethodProperty) * self->property_count);
+        fluff_free(self->properties);
+    }
     FLUFF_CLEANUP(self);
     fluff_free(self);
 }
@@ -49,4 +66,8 @@ FLUFF_PRIVATE_API size_t _method_add_property(FluffMethod * self, const char * n
     strncpy(property.name, name, FLUFF_MAX_FIELD_NAME_LEN);
     self->properties[property.index] = property;
     return property.index;
+}
+
+FLUFF_API size_t fluff_method_add_param(FluffMethod * self, const char * name, FluffKlass * klass) {
+    return _method_add_property(self, name, klass);
 }
\ No newline at end of file
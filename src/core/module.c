@@ -59,6 +59,7 @@ FLUFF_API FluffKlass * fluff_module_get_class_by_id(FluffModule * self, size_t i
 FLUFF_PRIVATE_API void _new_module(FluffModule * self, const char * name) {
     FLUFF_CLEANUP(self);
     strncpy(self->name, name, FLUFF_MAX_MODULE_NAME_LEN);
+    _new_symbol_table(&self->symbols);
 }
 
 FLUFF_PRIVATE_API void _free_module(FluffModule * self) {
@@ -72,6 +73,7 @@ FLUFF_PRIVATE_API void _free_module(FluffModule * self) {
         current = current->next_klass;
         _free_class(old);
     }
+    _free_symbol_table(&self->symbols);
     FLUFF_CLEANUP(self);
 }
 
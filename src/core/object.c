@@ -43,9 +43,9 @@ FLUFF_CONSTEXPR FluffObject * _int2float(FluffObject * self) {
 }
 
 FLUFF_CONSTEXPR FluffObject * _int2string(FluffObject * self) {
-    char buf[16] = { 0 };
-    fluff_format(buf, 16, "%ld", self->data._int);
-    return fluff_new_string_object_n(self->instance, buf, 16);
+    char buf[32] = { 0 };
+    const int len = fluff_format(buf, sizeof(buf), "%ld", self->data._int);
+    return fluff_new_string_object_n(self->instance, buf, (size_t)len);
 }
 
 FLUFF_CONSTEXPR FluffObject * _float2bool(FluffObject * self) {
@@ -57,9 +57,9 @@ FLUFF_CONSTEXPR FluffObject * _float2int(FluffObject * self) {
 }
 
 FLUFF_CONSTEXPR FluffObject * _float2string(FluffObject * self) {
-    char buf[16] = { 0 };
-    fluff_format(buf, 16, "%f", self->data._float);
-    return fluff_new_string_object_n(self->instance, buf, 16);
+    char buf[64] = { 0 };
+    const int len = fluff_format(buf, sizeof(buf), "%f", self->data._float);
+    return fluff_new_string_object_n(self->instance, buf, FLUFF_MIN((size_t)len, sizeof(buf) - 1));
 }
 
 FLUFF_CONSTEXPR FluffObject * _string2bool(FluffObject * self) {
@@ -143,7 +143,7 @@ FLUFF_CONSTEXPR FluffResult _int_mod(FluffObject * lhs, FluffObject * rhs, Fluff
 }
 
 FLUFF_CONSTEXPR FluffResult _int_pow(FluffObject * lhs, FluffObject * rhs, FluffObject * result) {
-    lhs->data._int = pow(lhs->data._int, rhs->data._int);
+    result->data._int = pow(lhs->data._int, rhs->data._int);
     return FLUFF_OK;
 }
 
@@ -436,38 +436,42 @@ FLUFF_API bool fluff_object_is_same_class(FluffObject * self, FluffKlass * klass
 }
 
 FLUFF_API FluffObject * fluff_object_as(FluffObject * self, FluffKlass * klass) {
-    if (fluff_object_is_same_class(self, klass)) return FLUFF_OK;
     if (!self->klass || !klass) {
         fluff_push_error("cannot convert an object to/from an incomplete type");
         return NULL;
     }
+    if (fluff_object_is_same_class(self, klass)) return fluff_ref_object(self);
 
     if (FLUFF_HAS_FLAG(klass->flags, FLUFF_KLASS_PRIMITIVE)) {
-        if (klass == fluff_instance_get_core_class(klass->instance, FLUFF_KLASS_BOOL)) {
-            if (self->klass == fluff_instance_get_core_class(self->instance, FLUFF_KLASS_INT))
+        if (self->klass == fluff_instance_get_core_class(self->instance, FLUFF_KLASS_BOOL)) {
+            if (klass == fluff_instance_get_core_class(self->instance, FLUFF_KLASS_INT))
                 return _bool2int(self);
-            if (self->klass == fluff_instance_get_core_class(self->instance, FLUFF_KLASS_FLOAT))
+            if (klass == fluff_instance_get_core_class(self->instance, FLUFF_KLASS_FLOAT))
                 return _bool2float(self);
-            if (self->klass == fluff_instance_get_core_class(self->instance, FLUFF_KLASS_STRING))
+            if (klass == fluff_instance_get_core_class(self->instance, FLUFF_KLASS_STRING))
                 return _bool2string(self);
         }
-        if (klass == fluff_instance_get_core_class(klass->instance, FLUFF_KLASS_INT)) {
-            if (self->klass == fluff_instance_get_core_class(self->instance, FLUFF_KLASS_BOOL))
+        if (self->klass == fluff_instance_get_core_class(self->instance, FLUFF_KLASS_INT)) {
+            if (klass == fluff_instance_get_core_class(self->instance, FLUFF_KLASS_BOOL))
                 return _int2bool(self);
-            if (self->klass == fluff_instance_get_core_class(self->instance, FLUFF_KLASS_FLOAT))
+            if (klass == fluff_instance_get_core_class(self->instance, FLUFF_KLASS_FLOAT))
                 return _int2float(self);
-            if (self->klass == fluff_instance_get_core_class(self->instance, FLUFF_KLASS_STRING))
+            if (klass == fluff_instance_get_core_class(self->instance, FLUFF_KLASS_STRING))
                 return _int2string(self);
         }
-        if (klass == fluff_instance_get_core_class(klass->instance, FLUFF_KLASS_FLOAT)) {
-            if (self->klass == fluff_instance_get_core_class(self->instance, FLUFF_KLASS_BOOL))
+        if (self->klass == fluff_instance_get_core_class(self->instance, FLUFF_KLASS_FLOAT)) {
+            if (klass == fluff_instance_get_core_class(self->instance, FLUFF_KLASS_BOOL))
                 return _float2bool(self);
-            if (self->klass == fluff_instance_get_core_class(self->instance, FLUFF_KLASS_INT))
+            if (klass == fluff_instance_get_core_class(self->instance, FLUFF_KLASS_INT))
                 return _float2int(self);
-            if (self->klass == fluff_instance_get_core_class(self->instance, FLUFF_KLASS_STRING))
+            if (klass == fluff_instance_get_core_class(self->instance, FLUFF_KLASS_STRING))
                 return _float2string(self);
         }
-    } else {
+        if (self->klass == fluff_instance_get_core_class(self->instance, FLUFF_KLASS_STRING)) {
+            if (klass == fluff_instance_get_core_class(self->instance, FLUFF_KLASS_BOOL))
+                return _string2bool(self);
+        }
+    } else if (!FLUFF_HAS_FLAG(self->klass->flags, FLUFF_KLASS_PRIMITIVE)) {
         FluffObject * obj = _object_cast(self, klass);
         if (obj) return obj;
     }
@@ -581,7 +585,7 @@ FLUFF_PRIVATE_API void _clone_object(FluffObject * self, FluffObject * obj) {
     self->instance = obj->instance;
     if (self->klass) {
         if (FLUFF_HAS_FLAG(self->klass->flags, FLUFF_KLASS_PRIMITIVE)) {
-            self->data = obj->data;
+            _object_copy_primitive(self, obj);
         } else {
             _object_alloc(self, obj);
         }
@@ -593,9 +597,9 @@ FLUFF_PRIVATE_API void _ref_object(FluffObject * self, FluffObject * obj) {
     self->klass    = obj->klass;
     if (obj->klass) {
         if (FLUFF_HAS_FLAG(obj->klass->flags, FLUFF_KLASS_PRIMITIVE)) {
-            self->data = obj->data;
+            _object_copy_primitive(self, obj);
         } else {
-            ++_object_get_table(obj)->ref_count;
+            if (obj->data._data) ++_object_get_table(obj)->ref_count;
             self->data._data = obj->data._data;
         }
     }
@@ -606,7 +610,7 @@ FLUFF_PRIVATE_API void _free_object(FluffObject * self) {
         if (self->klass == fluff_instance_get_core_class(self->instance, FLUFF_KLASS_STRING)) {
             _free_string(&self->data._string);
         } else if (self->klass == fluff_instance_get_core_class(self->instance, FLUFF_KLASS_FUNC)) {
-            _free_method(self->data._method);
+            if (self->data._method) _free_method(self->data._method);
         } else if (!FLUFF_HAS_FLAG(self->klass->flags, FLUFF_KLASS_PRIMITIVE) && self->data._data) {
             _object_deref(self);
         }
@@ -614,6 +618,18 @@ FLUFF_PRIVATE_API void _free_object(FluffObject * self) {
     FLUFF_CLEANUP(self);
 }
 
+FLUFF_PRIVATE_API void _object_copy_primitive(FluffObject * self, FluffObject * obj) {
+    // NOTE: strings and methods own their data, so they can't be copied bit by bit
+    if (obj->klass == fluff_instance_get_core_class(obj->instance, FLUFF_KLASS_STRING)) {
+        self->data._string = (FluffString){ 0 };
+        _copy_string(&self->data._string, &obj->data._string);
+    } else {
+        self->data = obj->data;
+        if (obj->klass == fluff_instance_get_core_class(obj->instance, FLUFF_KLASS_FUNC) && obj->data._method)
+            ++obj->data._method->ref_count;
+    }
+}
+
 FLUFF_PRIVATE_API void _object_alloc(FluffObject * self, FluffObject * clone_obj) {
     const size_t inherits = (_class_get_common_data(self->klass)->inherits ? 1 : 0);
 
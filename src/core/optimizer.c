@@ -0,0 +1,879 @@
+/* -=============
+     Includes
+   =============- */
+
+#define FLUFF_IMPLEMENTATION
+#include <base.h>
+#include <error.h>
+#include <core/optimizer.h>
+#include <core/method.h>
+#include <core/config.h>
+
+/* -==============
+     Internals
+   ==============- */
+
+// This struct represents an instruction being optimized.
+// NOTE: jumps refer to their target by index, the instruction count stands for the end of the chunk
+typedef struct OptInst {
+    uint8_t  op;
+    uint64_t arg, arg2;
+    size_t   target;
+    size_t   origin;
+    size_t   frame;
+    bool     dead;
+    bool     label;
+    bool     is_short;
+} OptInst;
+
+// This struct represents a function an instruction was inlined from, 'parent' being the one it was inlined into in turn.
+// NOTE: instructions point to the innermost of them in 'frame', SIZE_MAX when they're the chunk's own
+typedef struct OptFrame {
+    uint64_t method;
+    size_t   origin;
+    size_t   parent;
+} OptFrame;
+
+typedef struct Optimizer {
+    OptInst * insts;
+    size_t  * addresses;
+    size_t    count;
+
+    OptFrame * frames;
+    size_t     frame_count, frame_capacity;
+} Optimizer;
+
+FLUFF_CONSTEXPR bool opt_is_pure_push(uint8_t op) {
+    switch (op) {
+        case IR_OP_PUSH_VOID:
+        case IR_OP_PUSH_TRUE:
+        case IR_OP_PUSH_FALSE:
+        case IR_OP_PUSH_INT:
+        case IR_OP_PUSH_FLOAT:
+        case IR_OP_PUSH_STRING:
+        case IR_OP_PUSH_FUNC:
+        case IR_OP_GET_LOCAL: return true;
+        default:              return false;
+    }
+}
+
+FLUFF_CONSTEXPR uint64_t opt_pop_count(const OptInst * inst) {
+    return (inst->op == IR_OP_POPN ? inst->arg : 1);
+}
+
+FLUFF_CONSTEXPR void opt_set_pop_count(OptInst * inst, uint64_t count) {
+    inst->op  = (count == 1 ? IR_OP_POP : IR_OP_POPN);
+    inst->arg = (count == 1 ? 0 : count);
+    if (count == 0) inst->dead = true;
+}
+
+FLUFF_CONSTEXPR size_t opt_resolve(Optimizer * self, size_t index) {
+    while (index < self->count && self->insts[index].dead) ++index;
+    return index;
+}
+
+// NOTE: 'label' tells whether a jump lands anywhere between 'index' (excluded) and the next instruction
+FLUFF_CONSTEXPR size_t opt_next(Optimizer * self, size_t index, bool * label) {
+    * label = false;
+    while (++index < self->count) {
+        * label |= self->insts[index].label;
+        if (!self->insts[index].dead) break;
+    }
+    return index;
+}
+
+// NOTE: labels stay on dead instructions, since the jumps landing there fall through to the next one
+FLUFF_CONSTEXPR void opt_mark_labels(Optimizer * self) {
+    for (size_t i = 0; i < self->count; ++i) self->insts[i].label = false;
+    for (size_t i = 0; i < self->count; ++i) {
+        OptInst * inst = &self->insts[i];
+        if (inst->dead || !_ir_opcode_is_jump(inst->op)) continue;
+        inst->target = opt_resolve(self, inst->target);
+        if (inst->target < self->count) self->insts[inst->target].label = true;
+    }
+}
+
+FLUFF_CONSTEXPR size_t opt_add_frame(Optimizer * self, uint64_t method, size_t origin, size_t parent) {
+    if (self->frame_count >= self->frame_capacity) {
+        self->frame_capacity = FLUFF_MAX(self->frame_capacity * 2, 16);
+        self->frames         = fluff_alloc(self->frames, sizeof(OptFrame) * self->frame_capacity);
+    }
+    self->frames[self->frame_count] = (OptFrame){ .method = method, .origin = origin, .parent = parent };
+    return self->frame_count++;
+}
+
+static void opt_decode(Optimizer * self, const IRChunk * chunk) {
+    size_t ip = 0, site = 0;
+    while (ip < chunk->size) {
+        const IRInstruction decoded = _ir_decode(chunk->data, ip);
+
+        OptInst * inst = &self->insts[self->count];
+        FLUFF_CLEANUP(inst);
+        inst->op     = decoded.op;
+        inst->arg    = decoded.arg;
+        inst->arg2   = decoded.arg2;
+        inst->origin = ip;
+        inst->frame  = SIZE_MAX;
+        for (; site < chunk->inlined_count && chunk->inlined[site].start == ip; ++site)
+            inst->frame = opt_add_frame(self, chunk->inlined[site].method, chunk->inlined[site].origin, inst->frame);
+        // NOTE: holds the target address until every instruction has one
+        inst->target = (size_t)((ptrdiff_t)(ip + decoded.size) + decoded.jump);
+
+        self->addresses[self->count++] = ip;
+        ip += decoded.size;
+    }
+    self->addresses[self->count] = ip;
+
+    for (size_t i = 0; i < self->count; ++i) {
+        OptInst * inst = &self->insts[i];
+        if (!_ir_opcode_is_jump(inst->op)) continue;
+
+        size_t lo = 0, hi = self->count;
+        while (lo < hi) {
+            const size_t mid = (lo + hi) / 2;
+            if (self->addresses[mid] < inst->target) lo = mid + 1;
+            else hi = mid;
+        }
+        fluff_assert(self->addresses[lo] == inst->target, "jump at %zx lands inside an instruction (%zx)", self->addresses[i], inst->target);
+        inst->target = lo;
+    }
+}
+
+// NOTE: every instruction takes at least a byte, so the chunk size bounds their count
+static void opt_begin(Optimizer * self, const IRChunk * chunk) {
+    self->insts     = fluff_alloc(NULL, sizeof(OptInst) * chunk->size);
+    self->addresses = fluff_alloc(NULL, sizeof(size_t) * (chunk->size + 1));
+    self->count     = 0;
+    self->frames         = NULL;
+    self->frame_count    = 0;
+    self->frame_capacity = 0;
+    opt_decode(self, chunk);
+}
+
+FLUFF_CONSTEXPR void opt_end(Optimizer * self) {
+    fluff_free(self->insts);
+    fluff_free(self->addresses);
+    if (self->frames) fluff_free(self->frames);
+}
+
+static bool opt_peephole(Optimizer * self, size_t i, IROptStats * stats) {
+    OptInst * inst = &self->insts[i];
+    bool      label;
+    size_t    j    = opt_next(self, i, &label);
+    OptInst * next = (j < self->count && !label ? &self->insts[j] : NULL);
+
+    switch (inst->op) {
+        case IR_OP_NOP: {
+            inst->dead = true;
+            ++stats->nops;
+            return true;
+        }
+        case IR_OP_JMP:
+        case IR_OP_JZ:
+        case IR_OP_JNZ: {
+            inst->target = opt_resolve(self, inst->target);
+
+            // NOTE: jumps looping onto each other hit the step limit and are left alone
+            size_t target = inst->target, steps = 0;
+            while (target < self->count && target != i && self->insts[target].op == IR_OP_JMP && steps++ < self->count)
+                target = opt_resolve(self, self->insts[target].target);
+            if (steps <= self->count && target != inst->target) {
+                inst->target = target;
+                ++stats->jumps;
+                return true;
+            }
+
+            // NOTE: conditional jumps stay, they still check the type of their condition
+            if (inst->op == IR_OP_JMP && inst->target == j) {
+                inst->dead = true;
+                ++stats->jumps;
+                return true;
+            }
+            break;
+        }
+        case IR_OP_NOT: {
+            if (!next || (next->op != IR_OP_JZ && next->op != IR_OP_JNZ)) break;
+            next->op   = (next->op == IR_OP_JZ ? IR_OP_JNZ : IR_OP_JZ);
+            inst->dead = true;
+            ++stats->not_jumps;
+            return true;
+        }
+        case IR_OP_POP:
+        case IR_OP_POPN: {
+            if (!next || (next->op != IR_OP_POP && next->op != IR_OP_POPN)) break;
+            opt_set_pop_count(inst, opt_pop_count(inst) + opt_pop_count(next));
+            next->dead = true;
+            ++stats->pop_merges;
+            return true;
+        }
+        default: {
+            if (!opt_is_pure_push(inst->op) || !next || (next->op != IR_OP_POP && next->op != IR_OP_POPN)) break;
+            opt_set_pop_count(next, opt_pop_count(next) - 1);
+            inst->dead = true;
+            ++stats->push_pops;
+            return true;
+        }
+    }
+
+    // NOTE: nothing after an unconditional transfer runs until the next place a jump lands on
+    if (inst->op == IR_OP_JMP || inst->op == IR_OP_RET) {
+        bool changed = false;
+        for (size_t k = i + 1; k < self->count && !self->insts[k].label; ++k) {
+            if (self->insts[k].dead) continue;
+            self->insts[k].dead = true;
+            ++stats->dead;
+            changed = true;
+        }
+        return changed;
+    }
+    return false;
+}
+
+static void opt_compact(Optimizer * self) {
+    // NOTE: 'addresses' is reused to map old indices onto new ones, dead instructions map onto the next live one
+    size_t count = 0;
+    for (size_t i = 0; i < self->count; ++i) {
+        self->addresses[i] = count;
+        if (!self->insts[i].dead) ++count;
+    }
+    self->addresses[self->count] = count;
+
+    count = 0;
+    for (size_t i = 0; i < self->count; ++i) {
+        if (self->insts[i].dead) continue;
+        OptInst * inst = &self->insts[count++];
+        * inst = self->insts[i];
+        if (_ir_opcode_is_jump(inst->op)) inst->target = self->addresses[inst->target];
+    }
+    self->count = count;
+}
+
+// NOTE: 'count' instructions starting at 'i' can only be fused when no jump lands past the first one
+FLUFF_CONSTEXPR bool opt_is_sequence(Optimizer * self, size_t i, size_t count) {
+    if (i + count > self->count) return false;
+    for (size_t k = i + 1; k < i + count; ++k)
+        if (self->insts[k].label) return false;
+    return true;
+}
+
+// NOTE: a typed add only runs on ints, which the superinstructions handle like the generic one
+FLUFF_CONSTEXPR bool opt_is_add(uint8_t op) {
+    return (op == IR_OP_ADD || op == IR_OP_IADD);
+}
+
+// Replaces the sequence at 'i' with the superinstruction standing for it, returns how many instructions it took.
+static size_t opt_fuse(Optimizer * self, size_t i) {
+    OptInst * inst = &self->insts[i];
+    size_t    count = 0;
+
+    if (opt_is_sequence(self, i, 5) && inst[0].op == IR_OP_GET_LOCAL && inst[1].op == IR_OP_PUSH_INT && opt_is_add(inst[2].op) && 
+        inst[3].op == IR_OP_SET_LOCAL && inst[3].arg == inst[0].arg && inst[4].op == IR_OP_POP) {
+        inst->op   = IR_OP_INC_LOCAL;
+        inst->arg2 = inst[1].arg;
+        count      = 5;
+    } else if (opt_is_sequence(self, i, 3) && inst[0].op == IR_OP_GET_LOCAL && inst[1].op == IR_OP_GET_LOCAL && opt_is_add(inst[2].op)) {
+        inst->op   = IR_OP_ADD_LOCALS;
+        inst->arg2 = inst[1].arg;
+        count      = 3;
+    } else if (opt_is_sequence(self, i, 2)) {
+        switch (inst[0].op) {
+            case IR_OP_SET_LOCAL: {
+                if (inst[1].op != IR_OP_POP) break;
+                inst->op = IR_OP_STORE_LOCAL;
+                count    = 2;
+                break;
+            }
+            case IR_OP_PUSH_INT: {
+                if (!opt_is_add(inst[1].op) && inst[1].op != IR_OP_SUB && inst[1].op != IR_OP_ISUB) break;
+                inst->op = (opt_is_add(inst[1].op) ? IR_OP_ADD_INT : IR_OP_SUB_INT);
+                count    = 2;
+                break;
+            }
+            case IR_OP_LT:
+            case IR_OP_ILT: {
+                if (inst[1].op != IR_OP_JZ) break;
+                inst->op     = (inst->op == IR_OP_ILT ? IR_OP_ILT_JZ : IR_OP_LT_JZ);
+                inst->target = inst[1].target;
+                count        = 2;
+                break;
+            }
+            default: break;
+        }
+    }
+
+    for (size_t k = 1; k < count; ++k) inst[k].dead = true;
+    return count;
+}
+
+// NOTE: relative to the end of the short form, a target past the jump moves back as the jump shrinks
+FLUFF_CONSTEXPR ptrdiff_t opt_short_offset(Optimizer * self, size_t i) {
+    const size_t    target = self->insts[i].target;
+    const ptrdiff_t shrink = (target > i ? (ptrdiff_t)(sizeof(int32_t) - sizeof(int8_t)) : 0);
+    return (ptrdiff_t)self->addresses[target] - shrink - (ptrdiff_t)(self->addresses[i] + sizeof(IROpcode) + sizeof(int8_t));
+}
+
+FLUFF_CONSTEXPR void opt_layout(Optimizer * self) {
+    size_t address = 0;
+    for (size_t i = 0; i < self->count; ++i) {
+        const OptInst * inst = &self->insts[i];
+        self->addresses[i] = address;
+        if (_ir_opcode_is_jump(inst->op))
+            address += sizeof(IROpcode) + (inst->is_short ? sizeof(int8_t) : sizeof(int32_t));
+        else
+            address += _ir_instruction_size(inst->op, inst->arg, inst->arg2);
+    }
+    self->addresses[self->count] = address;
+}
+
+// Gives how many functions the instruction at 'i' was inlined through, along with their sites in 'out' when it isn't NULL.
+static size_t opt_inline_sites(const Optimizer * self, size_t i, IRInlineSite * out) {
+    size_t depth = 0;
+    for (size_t f = self->insts[i].frame; f != SIZE_MAX; f = self->frames[f].parent) ++depth;
+    if (!out) return depth;
+
+    size_t k = depth;
+    for (size_t f = self->insts[i].frame; f != SIZE_MAX; f = self->frames[f].parent)
+        out[--k] = (IRInlineSite){
+            .start  = self->addresses[i],
+            .end    = self->addresses[i + 1],
+            .method = self->frames[f].method,
+            .origin = self->frames[f].origin,
+        };
+    return depth;
+}
+
+static void opt_encode(Optimizer * self, IRChunk * chunk, IROptStats * stats) {
+    // NOTE: shrinking a jump never pushes another one out of range, so this settles on its own
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        opt_layout(self);
+        for (size_t i = 0; i < self->count; ++i) {
+            OptInst * inst = &self->insts[i];
+            if (!_ir_opcode_is_jump(inst->op) || inst->is_short) continue;
+
+            const ptrdiff_t offset = opt_short_offset(self, i);
+            if (offset < INT8_MIN || offset > INT8_MAX) continue;
+            inst->is_short = true;
+            changed        = true;
+        }
+    }
+
+    IRChunk out;
+    _new_ir_chunk(&out);
+    for (size_t i = 0; i < self->count; ++i) {
+        const OptInst * inst = &self->insts[i];
+        if (!_ir_opcode_is_jump(inst->op)) {
+            _ir_chunk_append_instruction(&out, inst->op, inst->arg, inst->arg2);
+            continue;
+        }
+
+        const size_t end = self->addresses[i + 1];
+        const ptrdiff_t offset = (ptrdiff_t)self->addresses[inst->target] - (ptrdiff_t)end;
+        if (inst->is_short) {
+            _ir_chunk_append_opcode(&out, _ir_opcode_short_jump(inst->op));
+            _ir_chunk_append_i8(&out, (int8_t)offset);
+            ++stats->short_jumps;
+        } else {
+            _ir_chunk_append_opcode(&out, inst->op);
+            _ir_chunk_append_i32(&out, (int32_t)offset);
+        }
+    }
+
+    for (size_t i = 0; i < self->count; ++i) out.inlined_count += opt_inline_sites(self, i, NULL);
+    if (out.inlined_count > 0) {
+        out.inlined = fluff_alloc(NULL, sizeof(IRInlineSite) * out.inlined_count);
+        for (size_t i = 0, k = 0; i < self->count; ++i) k += opt_inline_sites(self, i, &out.inlined[k]);
+    }
+
+    // NOTE: feedback refers to the code it was recorded on through its origins, the passes moving code keep it
+    out.typed       = chunk->typed;
+    out.feedback    = chunk->feedback;
+    chunk->feedback = NULL;
+    _free_ir_chunk(chunk);
+    * chunk = out;
+}
+
+// Tells where the if/else headed by the conditional jump at 'j' ends, or 0 when it doesn't head one.
+// NOTE: the then block ends with a JMP past the else block, and no jump lands inside either block from outside it
+static size_t opt_if_else_end(Optimizer * self, size_t j) {
+    const size_t start = self->insts[j].target;
+    if (start <= j + 1 || start >= self->count) return 0;
+
+    const OptInst * exit = &self->insts[start - 1];
+    if (exit->op != IR_OP_JMP || exit->target <= start) return 0;
+    const size_t end = exit->target;
+
+    for (size_t k = 0; k < self->count; ++k) {
+        if (k == j || !_ir_opcode_is_jump(self->insts[k].op)) continue;
+        const size_t target = self->insts[k].target;
+        if (target > j && target < start && !(k > j && k < start)) return 0;
+        if (target >= start && target < end && !(k >= start && k < end)) return 0;
+    }
+    return end;
+}
+
+// Gives the jump taken exactly when 'op' isn't, or NOP when there's none.
+// NOTE: a generic LT_JZ has none, it would need an inverse for every form it quickens into
+FLUFF_CONSTEXPR uint8_t opt_invert_jump(uint8_t op) {
+    switch (op) {
+        case IR_OP_JZ:      return IR_OP_JNZ;
+        case IR_OP_JNZ:     return IR_OP_JZ;
+        case IR_OP_ILT_JZ:  return IR_OP_ILT_JNZ;
+        case IR_OP_ILT_JNZ: return IR_OP_ILT_JZ;
+        default:            return IR_OP_NOP;
+    }
+}
+
+// Moves the else block of the if/else headed by the jump at 'j' in front of its then block, the jump is inverted.
+// NOTE: the JMP ending the then block now ends the else block, the then block falls through to the end instead
+static void opt_swap_blocks(Optimizer * self, size_t j, size_t end, size_t * map, OptInst * moved) {
+    const size_t start = self->insts[j].target;
+    for (size_t i = 0; i <= self->count; ++i) map[i] = i;
+
+    size_t next = j + 1;
+    for (size_t i = start; i < end; ++i) map[i] = next++;
+    map[start - 1] = next++;
+    for (size_t i = j + 1; i < start - 1; ++i) map[i] = next++;
+
+    for (size_t i = j + 1; i < end; ++i) moved[map[i]] = self->insts[i];
+    memcpy(&self->insts[j + 1], &moved[j + 1], sizeof(OptInst) * (end - j - 1));
+
+    for (size_t i = 0; i < self->count; ++i)
+        if (_ir_opcode_is_jump(self->insts[i].op)) self->insts[i].target = map[self->insts[i].target];
+    self->insts[j].op     = opt_invert_jump(self->insts[j].op);
+    self->insts[j].target = map[j + 1];
+}
+
+// Gives the stack size before every instruction in 'depths', the end of the chunk last, SIZE_MAX where it's never reached.
+// NOTE: like on the JIT, it fails on opcodes whose effect isn't known and on places reached with different sizes
+static bool opt_depths(Optimizer * self, size_t preserve, size_t * depths) {
+    IRFlowInst * insts = fluff_alloc(NULL, sizeof(IRFlowInst) * (self->count + 1));
+    FLUFF_CLEANUP_N(insts, sizeof(IRFlowInst) * (self->count + 1));
+    for (size_t i = 0; i < self->count; ++i) {
+        const uint8_t op = (self->insts[i].op == IR_OP_TAIL_CALL ? IR_OP_TAIL_CALL : _ir_generic_opcode(self->insts[i].op));
+        insts[i].inst   = (IRInstruction){ .op = op, .arg = self->insts[i].arg, .arg2 = self->insts[i].arg2 };
+        insts[i].target = self->insts[i].target;
+    }
+
+    const bool ok = _ir_flow_depths(insts, self->count, preserve, NULL);
+    for (size_t i = 0; i <= self->count; ++i) depths[i] = insts[i].depth;
+    fluff_free(insts);
+    return ok;
+}
+
+// Gives the PUSH_FUNC pushing the function called at 'call', or SIZE_MAX when it's pushed some other way.
+// NOTE: the arguments have to be reached through it alone, no jump lands in between from outside or leaves
+static size_t opt_find_callee(Optimizer * self, const size_t * depths, size_t call) {
+    const uint64_t argc = self->insts[call].arg;
+    if (depths[call] == SIZE_MAX || depths[call] < argc + 1) return SIZE_MAX;
+    const size_t slot = depths[call] - argc - 1;
+
+    size_t push = call;
+    while (push > 0 && depths[--push] > slot)
+        if (depths[push] == SIZE_MAX) return SIZE_MAX;
+    if (depths[push] != slot || self->insts[push].op != IR_OP_PUSH_FUNC) return SIZE_MAX;
+
+    for (size_t k = 0; k < self->count; ++k) {
+        if (!_ir_opcode_is_jump(self->insts[k].op)) continue;
+        const size_t target = self->insts[k].target;
+        if ((k > push && k < call) != (target > push && target <= call)) return SIZE_MAX;
+    }
+    return push;
+}
+
+// NOTE: a return becomes a SET_LOCAL into the slot of the callee, the pops down to it and a JMP past the body
+FLUFF_CONSTEXPR size_t opt_inlined_size(const OptInst * inst, size_t depth) {
+    if (inst->op != IR_OP_RET) return 1;
+    return (depth > 1 ? 3 : 2);
+}
+
+// Tells if 'callee' can take the place of a call, 'map' gets the index every instruction of it moves to in the body.
+// NOTE: only leaves are inlined, so recursion never expands and every return is reached with a known stack size
+static bool opt_can_inline(Optimizer * callee, const size_t * depths, size_t * map, size_t max_size) {
+    if (depths[callee->count] != SIZE_MAX) return false;
+
+    size_t size = 0;
+    for (size_t i = 0; i < callee->count; ++i) {
+        map[i] = size;
+        if (depths[i] == SIZE_MAX) continue;
+        if (callee->insts[i].op == IR_OP_CALL || callee->insts[i].op == IR_OP_TAIL_CALL) return false;
+        size += opt_inlined_size(&callee->insts[i], depths[i]);
+    }
+    map[callee->count] = size;
+    return size <= max_size;
+}
+
+FLUFF_CONSTEXPR void opt_shift_locals(OptInst * inst, size_t slot) {
+    switch (inst->op) {
+        case IR_OP_ADD_LOCALS:  inst->arg2 += slot; // fallthrough
+        case IR_OP_GET_LOCAL:
+        case IR_OP_SET_LOCAL:
+        case IR_OP_STORE_LOCAL:
+        case IR_OP_INC_LOCAL:   inst->arg += slot; break;
+        default:                break;
+    }
+}
+
+// This struct represents a call being inlined, along with the function it calls.
+typedef struct OptSite {
+    uint64_t  method;
+    size_t    slot;
+    Optimizer callee;
+    size_t  * depths;
+    size_t  * map;
+} OptSite;
+
+FLUFF_CONSTEXPR OptInst * opt_emit(OptInst * out, size_t * count, uint8_t op, uint64_t arg, size_t frame) {
+    OptInst * inst = &out[(* count)++];
+    FLUFF_CLEANUP(inst);
+    inst->op     = op;
+    inst->arg    = arg;
+    inst->origin = SIZE_MAX;
+    inst->frame  = frame;
+    return inst;
+}
+
+// Copies the functions 'frame' of 'from' went through into 'to', below 'root'.
+static size_t opt_copy_frames(Optimizer * to, const Optimizer * from, size_t frame, size_t root) {
+    if (frame == SIZE_MAX) return root;
+    const size_t parent = opt_copy_frames(to, from, from->frames[frame].parent, root);
+    return opt_add_frame(to, from->frames[frame].method, from->frames[frame].origin, parent);
+}
+
+// Writes the body of 'site' at 'base' of 'self', in place of its call.
+// NOTE: the instructions of the body remember where they were in the callee, even those it inlined itself
+static void opt_emit_body(Optimizer * self, const OptSite * site, size_t base, OptInst * out, size_t * count) {
+    const Optimizer * callee = &site->callee;
+    const size_t      end    = base + site->map[callee->count];
+
+    for (size_t i = 0; i < callee->count; ++i) {
+        const size_t depth = site->depths[i];
+        if (depth == SIZE_MAX) continue;
+
+        const size_t root = opt_add_frame(self, site->method, callee->addresses[i], SIZE_MAX);
+        if (callee->insts[i].op == IR_OP_RET) {
+            opt_emit(out, count, IR_OP_SET_LOCAL, site->slot, root);
+            if (depth > 1) opt_set_pop_count(opt_emit(out, count, IR_OP_POP, 0, root), depth - 1);
+            opt_emit(out, count, IR_OP_JMP, 0, root)->target = end;
+            continue;
+        }
+
+        OptInst * inst = &out[(* count)++];
+        * inst = callee->insts[i];
+        inst->origin = SIZE_MAX;
+        inst->frame  = opt_copy_frames(self, callee, callee->insts[i].frame, root);
+        opt_shift_locals(inst, site->slot);
+        if (_ir_opcode_is_jump(inst->op)) inst->target = base + site->map[inst->target];
+    }
+}
+
+// Gives the size a body of 'method' can be inlined up to, 0 when it's left alone.
+// NOTE: without a profile every function gets the same size, with one only those it found hot are looked at again
+FLUFF_CONSTEXPR size_t opt_inline_max_size(const IRBinary * binary, uint64_t method, const uint64_t * calls) {
+    if (!calls) return FLUFF_INLINE_MAX_SIZE;
+    return (method < binary->method_count && calls[method] >= FLUFF_INLINE_HOT_CALLS ? FLUFF_INLINE_HOT_MAX_SIZE : 0);
+}
+
+// Inlines the calls of 'chunk' to small leaf functions, gives how many of them were.
+// 'calls' counts how many times each method ran on a profiled run, or is NULL, 'inlined' then counts the calls to each
+// method that were inlined. 'origins' gets the address the chunk had for every address starting an instruction,
+// SIZE_MAX inside the bodies, when it isn't NULL and something was inlined.
+// NOTE: arguments were already checked against the parameters of the function, the values end up where its frame would be
+static size_t opt_inline_chunk(IRBinary * binary, IRChunk * chunk, size_t preserve, const FluffMethod * owner,
+                               const uint64_t * calls, size_t * inlined, size_t ** origins) {
+    if (chunk->size == 0) return 0;
+
+    Optimizer self;
+    opt_begin(&self, chunk);
+    size_t * depths = fluff_alloc(NULL, sizeof(size_t) * (self.count + 1));
+    size_t * sites  = fluff_alloc(NULL, sizeof(size_t) * self.count);
+
+    OptSite * found = NULL;
+    size_t    found_count = 0;
+
+    if (opt_depths(&self, preserve, depths)) {
+        for (size_t i = 0; i < self.count; ++i) {
+            sites[i] = SIZE_MAX;
+            if (self.insts[i].op != IR_OP_CALL) continue;
+
+            const size_t push = opt_find_callee(&self, depths, i);
+            if (push == SIZE_MAX) continue;
+
+            const FluffMethod * method   = binary->methods[self.insts[push].arg];
+            const size_t        max_size = opt_inline_max_size(binary, self.insts[push].arg, calls);
+            if (method == owner || !method->chunk || method->chunk->size == 0 || max_size == 0 ||
+                method->property_count != self.insts[i].arg) continue;
+
+            OptSite site;
+            opt_begin(&site.callee, method->chunk);
+            site.method = self.insts[push].arg;
+            site.slot   = depths[push];
+            site.depths = fluff_alloc(NULL, sizeof(size_t) * (site.callee.count + 1));
+            site.map    = fluff_alloc(NULL, sizeof(size_t) * (site.callee.count + 1));
+            if (!opt_depths(&site.callee, method->property_count + 1, site.depths) || 
+                !opt_can_inline(&site.callee, site.depths, site.map, max_size)) {
+                opt_end(&site.callee);
+                fluff_free(site.depths);
+                fluff_free(site.map);
+                continue;
+            }
+
+            // NOTE: the slot of the function holds the result once the body is done
+            if (inlined) ++inlined[self.insts[push].arg];
+            self.insts[push].op  = IR_OP_PUSH_VOID;
+            self.insts[push].arg = 0;
+
+            found = fluff_alloc(found, sizeof(OptSite) * (found_count + 1));
+            found[found_count] = site;
+            sites[i] = found_count++;
+        }
+    }
+
+    if (found_count > 0) {
+        // NOTE: 'depths' is reused to map the instructions of the chunk onto their new index
+        size_t size = 0;
+        for (size_t i = 0; i < self.count; ++i) {
+            depths[i] = size;
+            size += (sites[i] == SIZE_MAX ? 1 : found[sites[i]].map[found[sites[i]].callee.count]);
+        }
+        depths[self.count] = size;
+
+        OptInst * out   = fluff_alloc(NULL, sizeof(OptInst) * size);
+        size_t    count = 0;
+        for (size_t i = 0; i < self.count; ++i) {
+            if (sites[i] != SIZE_MAX) {
+                opt_emit_body(&self, &found[sites[i]], depths[i], out, &count);
+                continue;
+            }
+            out[count] = self.insts[i];
+            if (_ir_opcode_is_jump(out[count].op)) out[count].target = depths[out[count].target];
+            ++count;
+        }
+
+        fluff_free(self.insts);
+        fluff_free(self.addresses);
+        self.insts     = out;
+        self.addresses = fluff_alloc(NULL, sizeof(size_t) * (count + 1));
+        self.count     = count;
+
+        IROptStats stats;
+        FLUFF_CLEANUP(&stats);
+        opt_encode(&self, chunk, &stats);
+
+        if (origins) {
+            * origins = fluff_alloc(NULL, sizeof(size_t) * chunk->size);
+            for (size_t i = 0; i < chunk->size; ++i) (* origins)[i] = SIZE_MAX;
+            for (size_t i = 0; i < self.count; ++i) (* origins)[self.addresses[i]] = self.insts[i].origin;
+        }
+    }
+
+    for (size_t i = 0; i < found_count; ++i) {
+        opt_end(&found[i].callee);
+        fluff_free(found[i].depths);
+        fluff_free(found[i].map);
+    }
+    if (found) fluff_free(found);
+    fluff_free(sites);
+    fluff_free(depths);
+    opt_end(&self);
+    return found_count;
+}
+
+/* -=============
+     Peephole
+   =============- */
+
+// Gives the address the chunk had for every address starting an instruction in 'origins' when it isn't NULL.
+static void opt_optimize_chunk(IRChunk * chunk, IROptStats * stats, size_t ** origins) {
+    ++stats->chunks;
+    stats->bytes_before += chunk->size;
+    if (chunk->size == 0) return;
+
+    Optimizer self;
+    opt_begin(&self, chunk);
+    stats->instructions_before += self.count;
+
+    // NOTE: one rewrite often uncovers another, so this runs until nothing changes
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        ++stats->passes;
+
+        opt_mark_labels(&self);
+        for (size_t i = opt_resolve(&self, 0); i < self.count; i = opt_resolve(&self, i + 1))
+            changed |= opt_peephole(&self, i, stats);
+        opt_compact(&self);
+    }
+
+    // NOTE: fusing comes last, the rewrites above only know about the plain instructions
+    opt_mark_labels(&self);
+    for (size_t i = 0; i < self.count; ++i) {
+        const size_t count = opt_fuse(&self, i);
+        if (count == 0) continue;
+        ++stats->superinstructions;
+        i += count - 1;
+    }
+    opt_compact(&self);
+
+    for (size_t i = 0; i < self.count; ++i) {
+        OptInst * inst = &self.insts[i];
+
+        // NOTE: the RET stays, jumps may land on it and the tiers running a plain CALL return through it
+        if (inst->op == IR_OP_CALL && i + 1 < self.count && self.insts[i + 1].op == IR_OP_RET) {
+            inst->op = IR_OP_TAIL_CALL;
+            ++stats->tail_calls;
+        }
+    }
+
+    stats->instructions_after += self.count;
+    opt_encode(&self, chunk, stats);
+    stats->bytes_after += chunk->size;
+
+    if (origins) {
+        * origins = fluff_alloc(NULL, sizeof(size_t) * FLUFF_MAX(chunk->size, 1));
+        for (size_t i = 0; i < chunk->size; ++i) (* origins)[i] = SIZE_MAX;
+        for (size_t i = 0; i < self.count; ++i) (* origins)[self.addresses[i]] = self.insts[i].origin;
+    }
+    opt_end(&self);
+}
+
+FLUFF_PRIVATE_API void _ir_optimize_chunk(IRChunk * chunk, IROptStats * stats) {
+    opt_optimize_chunk(chunk, stats, NULL);
+}
+
+// NOTE: inlined code points into the functions it came from, so they tell where their code went once it's optimized
+FLUFF_PRIVATE_API void _ir_optimize_binary(IRBinary * binary, IROptStats * stats) {
+    const size_t inlined = stats->inlined;
+    _ir_inline_binary(binary, stats);
+    _ir_optimize_chunk(&binary->main_chunk, stats);
+    for (size_t i = 0; i < binary->method_count; ++i) {
+        IRChunk * chunk   = binary->methods[i]->chunk;
+        size_t  * origins = NULL;
+        if (!chunk) continue;
+
+        opt_optimize_chunk(chunk, stats, (stats->inlined != inlined ? &origins : NULL));
+        if (!origins) continue;
+        _ir_inline_moved(binary, i, origins);
+        fluff_free(origins);
+    }
+}
+
+FLUFF_PRIVATE_API void _ir_opt_stats_dump(const IROptStats * stats) {
+    printf("peephole: %zu chunks, %zu passes\n", stats->chunks, stats->passes);
+    printf("  bytes:        %zu -> %zu\n", stats->bytes_before, stats->bytes_after);
+    printf("  instructions: %zu -> %zu\n", stats->instructions_before, stats->instructions_after);
+    printf("  push/pop pairs:  %zu\n", stats->push_pops);
+    printf("  not+jumps:       %zu\n", stats->not_jumps);
+    printf("  jumps collapsed: %zu\n", stats->jumps);
+    printf("  pops merged:     %zu\n", stats->pop_merges);
+    printf("  nops:            %zu\n", stats->nops);
+    printf("  dead code:       %zu\n", stats->dead);
+    printf("  short jumps:     %zu\n", stats->short_jumps);
+    printf("  fused:           %zu\n", stats->superinstructions);
+    printf("  inlined calls:   %zu\n", stats->inlined);
+    printf("  tail calls:      %zu\n", stats->tail_calls);
+}
+
+/* -===========
+     Layout
+   ===========- */
+
+// Lays out the hot block of every if/else right after its condition, given how their jumps went ('weights' sorted by address).
+// Gives the address the chunk had for every address starting an instruction, or NULL when nothing moved.
+FLUFF_PRIVATE_API size_t * _ir_layout_chunk(IRChunk * chunk, const IRBranchWeight * weights, size_t count) {
+    if (chunk->size == 0 || count == 0) return NULL;
+
+    Optimizer self;
+    opt_begin(&self, chunk);
+
+    size_t  * map   = fluff_alloc(NULL, sizeof(size_t) * (self.count + 1));
+    OptInst * moved = fluff_alloc(NULL, sizeof(OptInst) * self.count);
+    size_t    swaps = 0;
+
+    for (size_t w = 0; w < count; ++w) {
+        size_t j = 0;
+        while (j < self.count && self.insts[j].origin != weights[w].ip) ++j;
+        if (j == self.count || opt_invert_jump(self.insts[j].op) == IR_OP_NOP) continue;
+
+        const bool     on_true = (self.insts[j].op == IR_OP_JNZ || self.insts[j].op == IR_OP_ILT_JNZ);
+        const uint64_t taken   = (on_true ? weights[w].truthy : weights[w].falsy);
+        const uint64_t fallen  = (on_true ? weights[w].falsy : weights[w].truthy);
+        if (taken <= fallen) continue;
+
+        const size_t end = opt_if_else_end(&self, j);
+        if (end == 0) continue;
+        opt_swap_blocks(&self, j, end, map, moved);
+        ++swaps;
+    }
+
+    size_t * origins = NULL;
+    if (swaps > 0) {
+        IROptStats stats;
+        FLUFF_CLEANUP(&stats);
+        opt_encode(&self, chunk, &stats);
+
+        origins = fluff_alloc(NULL, sizeof(size_t) * chunk->size);
+        for (size_t i = 0; i < chunk->size; ++i) origins[i] = SIZE_MAX;
+        for (size_t i = 0; i < self.count; ++i) origins[self.addresses[i]] = self.insts[i].origin;
+    }
+
+    fluff_free(moved);
+    fluff_free(map);
+    opt_end(&self);
+    return origins;
+}
+
+/* -=============
+     Inlining
+   =============- */
+
+// NOTE: methods come first, a function whose calls were all inlined becomes a leaf the main chunk can inline in turn
+FLUFF_PRIVATE_API void _ir_inline_binary(IRBinary * binary, IROptStats * stats) {
+    for (size_t i = 0; i < binary->method_count; ++i) {
+        FluffMethod * method = binary->methods[i];
+        if (method->chunk && method->chunk->typed)
+            stats->inlined += opt_inline_chunk(binary, method->chunk, method->property_count + 1, method, NULL, NULL, NULL);
+    }
+    if (binary->main_chunk.typed) stats->inlined += opt_inline_chunk(binary, &binary->main_chunk, 0, NULL, NULL, NULL, NULL);
+}
+
+// Inlines the calls of a chunk the optimizer already went through to functions found hot on a profiled run, 'calls'
+// counting how many times each method ran and 'inlined' how many calls to each of them were inlined so far.
+// Gives the address the chunk had for every address starting an instruction, or NULL when nothing was inlined
+// (like '_ir_layout_chunk').
+FLUFF_PRIVATE_API size_t * _ir_inline_hot_chunk(IRBinary * binary, IRChunk * chunk, size_t preserve, const FluffMethod * owner,
+                                                const uint64_t * calls, size_t * inlined) {
+    size_t * origins = NULL;
+    if (!chunk->typed || opt_inline_chunk(binary, chunk, preserve, owner, calls, inlined, &origins) == 0) return NULL;
+    return origins;
+}
+
+// Points the sites of code inlined from 'method' to where their instruction went once the code of the method moved,
+// 'origins' giving the address it had for every address starting an instruction (like '_ir_layout_chunk').
+// NOTE: instructions that were removed point to the next one that's left
+FLUFF_PRIVATE_API void _ir_inline_moved(IRBinary * binary, uint64_t method, const size_t * origins) {
+    const IRChunk * moved_chunk = binary->methods[method]->chunk;
+
+    size_t size = 0;
+    for (size_t ip = 0; ip < moved_chunk->size; ++ip)
+        if (origins[ip] != SIZE_MAX) size = FLUFF_MAX(size, origins[ip] + 1);
+
+    size_t * moved = fluff_alloc(NULL, sizeof(size_t) * (size + 1));
+    for (size_t ip = 0; ip <= size; ++ip) moved[ip] = SIZE_MAX;
+    for (size_t ip = 0; ip < moved_chunk->size; ++ip)
+        if (origins[ip] != SIZE_MAX) moved[origins[ip]] = ip;
+    moved[size] = moved_chunk->size;
+    for (size_t ip = size; ip-- > 0;)
+        if (moved[ip] == SIZE_MAX) moved[ip] = moved[ip + 1];
+
+    for (size_t i = 0; i <= binary->method_count; ++i) {
+        IRChunk * chunk = (i < binary->method_count ? binary->methods[i]->chunk : &binary->main_chunk);
+        if (!chunk) continue;
+        for (size_t k = 0; k < chunk->inlined_count; ++k) {
+            IRInlineSite * site = &chunk->inlined[k];
+            if (site->method == method) site->origin = moved[FLUFF_MIN(site->origin, size)];
+        }
+    }
+    fluff_free(moved);
+}
\ No newline at end of file
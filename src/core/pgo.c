@@ -0,0 +1,295 @@
+/* -=============
+     Includes
+   =============- */
+
+#define FLUFF_IMPLEMENTATION
+#include <base.h>
+#include <error.h>
+#include <core/pgo.h>
+#include <core/optimizer.h>
+#include <core/method.h>
+#include <core/jit.h>
+#include <core/config.h>
+
+#include <inttypes.h>
+
+/* -==============
+     Internals
+   ==============- */
+
+#define PGO_MAGIC   "fluff-profile"
+#define PGO_VERSION 2
+
+// This struct represents an opcode quickening left in a chunk, in its long form.
+typedef struct PgoSite {
+    size_t  ip;
+    uint8_t op;
+} PgoSite;
+
+// This struct represents the profile of a chunk being read.
+typedef struct PgoChunk {
+    size_t   index;
+    uint64_t hash;
+    size_t   size;
+    uint64_t hotness;
+    uint64_t calls;
+
+    IRBranchWeight * branches;
+    size_t           branch_count, branch_capacity;
+
+    PgoSite * sites;
+    size_t    site_count, site_capacity;
+} PgoChunk;
+
+// NOTE: the main chunk comes first, methods without a chunk keep their index
+FLUFF_CONSTEXPR IRChunk * pgo_chunk_at(const IRBinary * binary, size_t index) {
+    if (index == 0) return (IRChunk *)&binary->main_chunk;
+    if (index > binary->method_count) return NULL;
+    return binary->methods[index - 1]->chunk;
+}
+
+// Hashes the code of a chunk as if it never ran, quickened opcodes count as their generic form.
+static uint64_t pgo_hash(const IRChunk * chunk) {
+    if (chunk->size == 0) return fluff_hash(NULL, 0);
+
+    uint8_t * code = fluff_alloc(NULL, chunk->size);
+    memcpy(code, chunk->data, chunk->size);
+    for (size_t ip = 0; ip < chunk->size; ip += _ir_decode(chunk->data, ip).size)
+        code[ip] = (code[ip] == IR_OP_LT_JZ_INT_S ? IR_OP_LT_JZ_S : _ir_generic_opcode(code[ip]));
+
+    const uint64_t hash = fluff_hash(code, chunk->size);
+    fluff_free(code);
+    return hash;
+}
+
+FLUFF_CONSTEXPR IRFeedback * pgo_attach(IRChunk * chunk, uint64_t hash, size_t size) {
+    chunk->feedback = fluff_alloc(NULL, sizeof(IRFeedback));
+    FLUFF_CLEANUP(chunk->feedback);
+    chunk->feedback->hash = hash;
+    chunk->feedback->size = size;
+    return chunk->feedback;
+}
+
+FLUFF_CONSTEXPR void pgo_add_branch(PgoChunk * self, IRBranchWeight weight) {
+    if (self->branch_count >= self->branch_capacity) {
+        self->branch_capacity = FLUFF_MAX(self->branch_capacity * 2, 16);
+        self->branches        = fluff_alloc(self->branches, sizeof(IRBranchWeight) * self->branch_capacity);
+    }
+    self->branches[self->branch_count++] = weight;
+}
+
+FLUFF_CONSTEXPR void pgo_add_site(PgoChunk * self, PgoSite site) {
+    if (self->site_count >= self->site_capacity) {
+        self->site_capacity = FLUFF_MAX(self->site_capacity * 2, 16);
+        self->sites         = fluff_alloc(self->sites, sizeof(PgoSite) * self->site_capacity);
+    }
+    self->sites[self->site_count++] = site;
+}
+
+// Gives where each instruction of the profiled code of 'size' bytes went, other addresses hold SIZE_MAX.
+static size_t * pgo_moved(const IRChunk * chunk, const size_t * origins, size_t size) {
+    size_t * moved = fluff_alloc(NULL, sizeof(size_t) * size);
+    for (size_t i = 0; i < size; ++i) moved[i] = SIZE_MAX;
+    for (size_t ip = 0; ip < chunk->size; ip += _ir_decode(chunk->data, ip).size) {
+        const size_t origin = (origins ? origins[ip] : ip);
+        if (origin < size) moved[origin] = ip;
+    }
+    return moved;
+}
+
+// NOTE: instructions are written in the order of the profiled code, so profiles don't depend on the blocks that moved
+static void pgo_write_chunk(FILE * f, size_t index, const IRChunk * chunk) {
+    const IRFeedback * feedback = chunk->feedback;
+    fprintf(f, "chunk %zu %016" PRIx64 " %zu %" PRIu64 "\n", index, feedback->hash, feedback->size, feedback->hotness);
+    if (feedback->calls) fprintf(f, "calls %" PRIu64 "\n", feedback->calls);
+
+    size_t * moved = pgo_moved(chunk, feedback->origins, feedback->size);
+    for (size_t origin = 0; origin < feedback->size; ++origin) {
+        const size_t ip = moved[origin];
+        if (ip == SIZE_MAX) continue;
+        if (feedback->truthy[ip] || feedback->falsy[ip])
+            fprintf(f, "branch %zu %" PRIu64 " %" PRIu64 "\n", origin, feedback->truthy[ip], feedback->falsy[ip]);
+
+        // NOTE: tail calls are left by the optimizer rather than the run, the code the profile is read into has them
+        const uint8_t op = _ir_decode(chunk->data, ip).op;
+        if (_ir_generic_opcode(op) != op && op != IR_OP_TAIL_CALL) fprintf(f, "quick %zu %02x\n", origin, op);
+    }
+    fluff_free(moved);
+}
+
+// Quickens the opcode at 'ip' into 'op' when it's still the generic form of it, short jumps stay short.
+FLUFF_CONSTEXPR void pgo_quicken(IRChunk * chunk, size_t ip, uint8_t op) {
+    if (ip >= chunk->size || _ir_decode(chunk->data, ip).op != _ir_generic_opcode(op)) return;
+    chunk->data[ip] = (chunk->data[ip] == IR_OP_LT_JZ_S ? IR_OP_LT_JZ_INT_S : op);
+}
+
+// NOTE: 'calls' gets the call count of methods, indexed like the methods of the binary
+static void pgo_apply_chunk(IRBinary * binary, PgoChunk * profile, uint64_t * calls) {
+    IRChunk * chunk = pgo_chunk_at(binary, profile->index);
+    if (!chunk || chunk->feedback || chunk->size != profile->size || pgo_hash(chunk) != profile->hash) return;
+    if (profile->index > 0) calls[profile->index - 1] = profile->calls;
+
+    size_t * origins = _ir_layout_chunk(chunk, profile->branches, profile->branch_count);
+    size_t * moved   = NULL;
+    if (origins) {
+        pgo_attach(chunk, profile->hash, profile->size)->origins = origins;
+        moved = pgo_moved(chunk, origins, profile->size);
+        if (profile->index > 0) _ir_inline_moved(binary, profile->index - 1, origins);
+    }
+
+    for (size_t i = 0; i < profile->site_count; ++i) {
+        const size_t ip = profile->sites[i].ip;
+        if (ip < profile->size) pgo_quicken(chunk, (moved ? moved[ip] : ip), profile->sites[i].op);
+    }
+    if (moved) fluff_free(moved);
+
+    chunk->hotness = (size_t)FLUFF_MIN(profile->hotness, FLUFF_JIT_THRESHOLD - 1);
+}
+
+// Inlines the calls of 'chunk' to functions the profile found hot.
+// NOTE: the addresses of the code the profile was read into are kept, so a profile of the inlined code still matches it
+static void pgo_inline_chunk(IRBinary * binary, IRChunk * chunk, size_t preserve, const FluffMethod * owner,
+                             const uint64_t * calls, size_t * inlined) {
+    const uint64_t hash = (chunk->feedback ? 0 : pgo_hash(chunk));
+    const size_t   size = chunk->size;
+
+    size_t * origins = _ir_inline_hot_chunk(binary, chunk, preserve, owner, calls, inlined);
+    if (!origins) return;
+
+    IRFeedback * feedback = (chunk->feedback ? chunk->feedback : pgo_attach(chunk, hash, size));
+    if (feedback->origins) {
+        for (size_t ip = 0; ip < chunk->size; ++ip)
+            if (origins[ip] != SIZE_MAX) origins[ip] = feedback->origins[origins[ip]];
+        fluff_free(feedback->origins);
+    }
+    feedback->origins = origins;
+}
+
+// NOTE: methods come first like on the first inlining pass, so hot functions calling hot leaves can become leaves too
+static void pgo_inline_binary(IRBinary * binary, const uint64_t * calls) {
+    bool hot = false;
+    for (size_t i = 0; i < binary->method_count; ++i) hot |= (calls[i] >= FLUFF_INLINE_HOT_CALLS);
+    if (!hot) return;
+
+    // NOTE: chunks get their feedback before anything is inlined into them, its hash is the one of the profiled code
+    for (size_t i = 0; i < binary->method_count; ++i) {
+        IRChunk * chunk = binary->methods[i]->chunk;
+        if (chunk && !chunk->feedback && calls[i] >= FLUFF_INLINE_HOT_CALLS) pgo_attach(chunk, pgo_hash(chunk), chunk->size);
+    }
+
+    size_t * inlined = fluff_alloc(NULL, sizeof(size_t) * binary->method_count);
+    FLUFF_CLEANUP_N(inlined, sizeof(size_t) * binary->method_count);
+    for (size_t i = 0; i < binary->method_count; ++i) {
+        FluffMethod * method = binary->methods[i];
+        if (method->chunk) pgo_inline_chunk(binary, method->chunk, method->property_count + 1, method, calls, inlined);
+    }
+    pgo_inline_chunk(binary, &binary->main_chunk, 0, NULL, calls, inlined);
+
+    // NOTE: inlined calls don't reach the function anymore, a profile of this code counts them from the one it was
+    //       compiled with so the next compilation inlines them again
+    for (size_t i = 0; i < binary->method_count; ++i)
+        if (inlined[i] > 0) binary->methods[i]->chunk->feedback->calls = calls[i];
+    fluff_free(inlined);
+}
+
+/* -=============
+     Feedback
+   =============- */
+
+/* -=- Initializers -=- */
+FLUFF_PRIVATE_API void _free_ir_feedback(IRFeedback * self) {
+    if (self->origins) fluff_free(self->origins);
+    if (self->truthy)  fluff_free(self->truthy);
+    if (self->falsy)   fluff_free(self->falsy);
+    FLUFF_CLEANUP(self);
+}
+
+/* -=- Recording -=- */
+FLUFF_PRIVATE_API void _pgo_record_binary(IRBinary * binary) {
+    for (size_t i = 0; i <= binary->method_count; ++i) {
+        IRChunk * chunk = pgo_chunk_at(binary, i);
+        if (!chunk || (chunk->feedback && chunk->feedback->truthy)) continue;
+
+        IRFeedback * feedback = (chunk->feedback ? chunk->feedback : pgo_attach(chunk, pgo_hash(chunk), chunk->size));
+        feedback->truthy = fluff_alloc(NULL, sizeof(uint64_t) * (chunk->size + 1));
+        feedback->falsy  = fluff_alloc(NULL, sizeof(uint64_t) * (chunk->size + 1));
+        FLUFF_CLEANUP_N(feedback->truthy, sizeof(uint64_t) * (chunk->size + 1));
+        FLUFF_CLEANUP_N(feedback->falsy, sizeof(uint64_t) * (chunk->size + 1));
+    }
+}
+
+FLUFF_PRIVATE_API FluffResult _pgo_write(const IRBinary * binary, const char * path) {
+    FILE * f = fopen(path, "w");
+    if (!f) {
+        fluff_push_error("failed to open file '%s': %s", path, strerror(errno));
+        return FLUFF_FAILURE;
+    }
+
+    fprintf(f, "%s %d\n", PGO_MAGIC, PGO_VERSION);
+    for (size_t i = 0; i <= binary->method_count; ++i) {
+        const IRChunk * chunk = pgo_chunk_at(binary, i);
+        if (chunk && chunk->feedback && chunk->feedback->truthy) pgo_write_chunk(f, i, chunk);
+    }
+    fclose(f);
+    return FLUFF_OK;
+}
+
+/* -=- Compilation -=- */
+// NOTE: a missing profile only warns, the first run of a program has none yet
+FLUFF_PRIVATE_API void _pgo_apply(IRBinary * binary, const char * path) {
+    FILE * f = fopen(path, "r");
+    if (!f) {
+        fluff_push_warn("no profile to read at '%s': %s", path, strerror(errno));
+        return;
+    }
+
+    char line[128];
+    int  version = 0;
+    if (!fgets(line, sizeof(line), f) || sscanf(line, PGO_MAGIC " %d", &version) != 1 || version != PGO_VERSION) {
+        fluff_push_warn("'%s' is not a profile this version can read", path);
+        fclose(f);
+        return;
+    }
+
+    PgoChunk profile;
+    FLUFF_CLEANUP(&profile);
+    bool started = false;
+
+    uint64_t * calls = fluff_alloc(NULL, sizeof(uint64_t) * FLUFF_MAX(binary->method_count, (size_t)1));
+    FLUFF_CLEANUP_N(calls, sizeof(uint64_t) * FLUFF_MAX(binary->method_count, (size_t)1));
+
+    while (fgets(line, sizeof(line), f)) {
+        PgoChunk       next;
+        IRBranchWeight weight;
+        unsigned       op;
+
+        if (sscanf(line, "chunk %zu %" SCNx64 " %zu %" SCNu64, &next.index, &next.hash, &next.size, &next.hotness) == 4) {
+            if (started) pgo_apply_chunk(binary, &profile, calls);
+            profile.index        = next.index;
+            profile.hash         = next.hash;
+            profile.size         = next.size;
+            profile.hotness      = next.hotness;
+            profile.calls        = 0;
+            profile.branch_count = profile.site_count = 0;
+            started = true;
+        } else if (started && sscanf(line, "calls %" SCNu64, &next.calls) == 1) {
+            profile.calls = next.calls;
+        } else if (started && sscanf(line, "branch %zu %" SCNu64 " %" SCNu64, &weight.ip, &weight.truthy, &weight.falsy) == 3) {
+            pgo_add_branch(&profile, weight);
+        } else if (started && sscanf(line, "quick %zu %x", &weight.ip, &op) == 2) {
+            pgo_add_site(&profile, (PgoSite){ .ip = weight.ip, .op = (uint8_t)op });
+        } else {
+            // NOTE: chunks read so far keep their profile, the one being read is dropped
+            fluff_push_warn("'%s' is not a profile this version can read", path);
+            started = false;
+            break;
+        }
+    }
+    if (started) pgo_apply_chunk(binary, &profile, calls);
+    pgo_inline_binary(binary, calls);
+
+    if (profile.branches) fluff_free(profile.branches);
+    if (profile.sites)    fluff_free(profile.sites);
+    fluff_free(calls);
+    fclose(f);
+}
\ No newline at end of file
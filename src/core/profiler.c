@@ -0,0 +1,135 @@
+/* -=============
+     Includes
+   =============- */
+
+#define FLUFF_IMPLEMENTATION
+#include <base.h>
+#include <error.h>
+#include <core/profiler.h>
+#include <core/config.h>
+
+#ifdef FLUFF_VM_PROFILE
+
+/* -==============
+     Internals
+   ==============- */
+
+#define VM_PROFILE_MIN_TRIGRAMS 256
+
+#define VM_PROFILE_KEY2(__a, __b)      (((uint32_t)(__a) << 8) | (uint32_t)(__b))
+#define VM_PROFILE_KEY3(__a, __b, __c) (((uint32_t)(__a) << 16) | ((uint32_t)(__b) << 8) | (uint32_t)(__c))
+
+FLUFF_CONSTEXPR size_t vm_profile_probe(VMProfileGram * grams, size_t capacity, uint32_t key) {
+    const size_t mask = capacity - 1;
+    size_t i = (size_t)(key * 0x9e3779b1u) & mask;
+    while (grams[i].count != 0 && grams[i].key != key) i = (i + 1) & mask;
+    return i;
+}
+
+FLUFF_CONSTEXPR void vm_profile_add_trigram(VMProfile * self, uint32_t key) {
+    // NOTE: keeps the load factor under 1/2 so probing stays short
+    if ((self->trigram_count + 1) * 2 > self->trigram_capacity) {
+        const size_t    capacity = FLUFF_MAX(self->trigram_capacity * 2, VM_PROFILE_MIN_TRIGRAMS);
+        VMProfileGram * grams    = fluff_alloc(NULL, sizeof(VMProfileGram) * capacity);
+        FLUFF_CLEANUP_N(grams, sizeof(VMProfileGram) * capacity);
+
+        for (size_t i = 0; i < self->trigram_capacity; ++i)
+            if (self->trigrams[i].count != 0) grams[vm_profile_probe(grams, capacity, self->trigrams[i].key)] = self->trigrams[i];
+
+        if (self->trigrams) fluff_free(self->trigrams);
+        self->trigrams         = grams;
+        self->trigram_capacity = capacity;
+    }
+
+    VMProfileGram * gram = &self->trigrams[vm_profile_probe(self->trigrams, self->trigram_capacity, key)];
+    if (gram->count == 0) {
+        gram->key = key;
+        ++self->trigram_count;
+    }
+    ++gram->count;
+}
+
+static int vm_profile_compare(const void * a, const void * b) {
+    const uint64_t lhs = ((const VMProfileGram *)a)->count;
+    const uint64_t rhs = ((const VMProfileGram *)b)->count;
+    return (lhs < rhs) - (lhs > rhs);
+}
+
+static void vm_profile_dump_grams(VMProfile * self, VMProfileGram * grams, size_t count, size_t n, size_t top) {
+    qsort(grams, count, sizeof(VMProfileGram), vm_profile_compare);
+    for (size_t i = 0; i < FLUFF_MIN(count, top); ++i) {
+        printf("%12lu  %5.2f%%  ", grams[i].count, (self->executed ? 100.0 * grams[i].count / self->executed : 0.0));
+        for (size_t k = n; k > 0; --k)
+            printf("%s%s", _ir_opcode_name((uint8_t)(grams[i].key >> ((k - 1) * 8))), (k > 1 ? " " : "\n"));
+    }
+}
+
+static void vm_profile_trace(void * data, const IRChunk * chunk, size_t ip) {
+    _vm_profile_record(data, chunk, ip);
+}
+
+/* -==============
+     VMProfile
+   ==============- */
+
+/* -=- Initializers -=- */
+FLUFF_PRIVATE_API void _new_vm_profile(VMProfile * self) {
+    FLUFF_CLEANUP(self);
+    self->bigrams = fluff_alloc(NULL, sizeof(uint64_t) * 0x10000);
+    FLUFF_CLEANUP_N(self->bigrams, sizeof(uint64_t) * 0x10000);
+}
+
+FLUFF_PRIVATE_API void _free_vm_profile(VMProfile * self) {
+    if (self->bigrams)  fluff_free(self->bigrams);
+    if (self->trigrams) fluff_free(self->trigrams);
+    FLUFF_CLEANUP(self);
+}
+
+/* -=- Recording -=- */
+FLUFF_PRIVATE_API void _vm_profile_attach(VMProfile * self, FluffVM * vm) {
+    vm->trace_fn   = vm_profile_trace;
+    vm->trace_data = self;
+}
+
+// NOTE: opcodes are recorded in their long form, so nibble and short variants count as one
+FLUFF_PRIVATE_API void _vm_profile_record(VMProfile * self, const IRChunk * chunk, size_t ip) {
+    const IRInstruction inst = _ir_decode(chunk->data, ip);
+    ++self->executed;
+    ++self->unigrams[inst.op];
+
+    if (chunk != self->chunk || ip != self->next_ip) self->history_count = 0;
+    if (self->history_count >= 1) ++self->bigrams[VM_PROFILE_KEY2(self->history[1], inst.op)];
+    if (self->history_count >= 2) vm_profile_add_trigram(self, VM_PROFILE_KEY3(self->history[0], self->history[1], inst.op));
+
+    self->history[0]    = self->history[1];
+    self->history[1]    = inst.op;
+    self->history_count = FLUFF_MIN(self->history_count + 1, 2);
+    self->chunk         = chunk;
+    self->next_ip       = ip + inst.size;
+}
+
+FLUFF_PRIVATE_API void _vm_profile_dump(VMProfile * self, size_t top) {
+    VMProfileGram * grams = fluff_alloc(NULL, sizeof(VMProfileGram) * FLUFF_MAX(0x10000, self->trigram_count));
+
+    size_t count = 0;
+    for (uint32_t i = 0; i < 0x100; ++i)
+        if (self->unigrams[i] != 0) grams[count++] = (VMProfileGram){ .key = i, .count = self->unigrams[i] };
+    printf("%lu instructions executed\n\nopcodes:\n", self->executed);
+    vm_profile_dump_grams(self, grams, count, 1, top);
+
+    count = 0;
+    for (uint32_t i = 0; i < 0x10000; ++i)
+        if (self->bigrams[i] != 0) grams[count++] = (VMProfileGram){ .key = i, .count = self->bigrams[i] };
+    printf("\nbigrams:\n");
+    vm_profile_dump_grams(self, grams, count, 2, top);
+
+    count = 0;
+    for (size_t i = 0; i < self->trigram_capacity; ++i)
+        if (self->trigrams[i].count != 0) grams[count++] = self->trigrams[i];
+    printf("\ntrigrams:\n");
+    vm_profile_dump_grams(self, grams, count, 3, top);
+
+    fluff_free(grams);
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,350 @@
+/* -=============
+     Includes
+   =============- */
+
+#define FLUFF_IMPLEMENTATION
+#include <base.h>
+#include <error.h>
+#include <core/register.h>
+#include <core/method.h>
+#include <core/config.h>
+
+/* -==============
+     Internals
+   ==============- */
+
+#define IR_REG_CHUNK_MIN_CAPACITY 64
+
+// This struct represents the translation of a stack chunk into registers.
+// NOTE: the instruction count stands for the end of the chunk, where the stack VM returns void
+typedef struct Translator {
+    IRFlowInst * insts;
+    size_t       count;
+    IRRegChunk * out;
+
+    // NOTE: where the translation of every instruction starts, jumps are fixed up with them once it's done
+    size_t * starts;
+
+    // NOTE: values read from locals aren't copied right away, 'alias' tells which register a slot mirrors
+    uint16_t * alias;
+    size_t     depth;
+
+    // NOTE: the last instruction emitted, if its destination may still be renamed
+    size_t last;
+} Translator;
+
+typedef struct TranslateFixup {
+    size_t inst;
+    size_t target;
+} TranslateFixup;
+
+FLUFF_CONSTEXPR void translate_emit(Translator * self, uint8_t op, size_t a, size_t b, size_t c, int32_t x, bool renamable) {
+    const size_t index = _ir_reg_chunk_append(self->out, op, (uint16_t)a, (uint16_t)b, (uint16_t)c, x);
+    self->last = (renamable ? index : SIZE_MAX);
+}
+
+FLUFF_CONSTEXPR void translate_materialize(Translator * self, size_t slot) {
+    if (self->alias[slot] == slot) return;
+    translate_emit(self, IR_OP_GET_LOCAL, slot, self->alias[slot], 0, 0, false);
+    self->alias[slot] = (uint16_t)slot;
+}
+
+FLUFF_CONSTEXPR void translate_materialize_all(Translator * self) {
+    for (size_t s = 0; s < self->depth; ++s) translate_materialize(self, s);
+}
+
+// NOTE: slots mirroring 'slot' get their own copy before it changes
+FLUFF_CONSTEXPR void translate_write(Translator * self, size_t slot) {
+    for (size_t s = slot + 1; s < self->depth; ++s)
+        if (self->alias[s] == slot) translate_materialize(self, s);
+    self->alias[slot] = (uint16_t)slot;
+}
+
+FLUFF_CONSTEXPR void translate_pop(Translator * self, size_t count) {
+    for (size_t s = self->depth - count; s < self->depth; ++s) self->alias[s] = (uint16_t)s;
+    self->depth -= count;
+}
+
+// NOTE: the last instruction can write to 'local' directly when nothing else reads the slot it wrote
+FLUFF_CONSTEXPR bool translate_can_rename(Translator * self, size_t slot, size_t local) {
+    if (self->last == SIZE_MAX || self->out->code[self->last].a != slot || self->alias[slot] != slot) return false;
+    for (size_t s = 0; s < self->depth; ++s)
+        if ((s != slot && self->alias[s] == slot) || (s != local && self->alias[s] == local)) return false;
+    return true;
+}
+
+static void translate_store(Translator * self, size_t local, bool pop) {
+    const size_t slot = self->depth - 1;
+    const size_t src  = self->alias[slot];
+    if (local != slot && local != src) {
+        if (translate_can_rename(self, slot, local)) {
+            self->out->code[self->last].a = (uint16_t)local;
+            self->alias[local] = (uint16_t)local;
+            self->alias[slot]  = (uint16_t)local;
+            self->last         = SIZE_MAX;
+        } else {
+            translate_write(self, local);
+            translate_emit(self, IR_OP_GET_LOCAL, local, src, 0, 0, false);
+        }
+    }
+    if (pop) translate_pop(self, 1);
+}
+
+static void translate_inst(Translator * self, size_t i, TranslateFixup * fixups, size_t * fixup_count) {
+    const IRInstruction * inst = &self->insts[i].inst;
+    const size_t          d    = self->depth;
+
+    switch (inst->op) {
+        case IR_OP_NOP:
+        case IR_OP_PROMOTE: break;
+        case IR_OP_PUSH_VOID:
+        case IR_OP_PUSH_TRUE:
+        case IR_OP_PUSH_FALSE:
+        case IR_OP_PUSH_INT:
+        case IR_OP_PUSH_FLOAT:
+        case IR_OP_PUSH_STRING:
+        case IR_OP_PUSH_FUNC: {
+            translate_write(self, d);
+            translate_emit(self, inst->op, d, 0, 0, (int32_t)inst->arg, true);
+            ++self->depth;
+            break;
+        }
+        case IR_OP_POP:
+        case IR_OP_POPN: {
+            translate_pop(self, (inst->op == IR_OP_POP ? 1 : inst->arg));
+            break;
+        }
+        case IR_OP_GET_LOCAL: {
+            self->alias[d] = self->alias[inst->arg];
+            ++self->depth;
+            break;
+        }
+        case IR_OP_SET_LOCAL:
+        case IR_OP_STORE_LOCAL: {
+            translate_store(self, inst->arg, (inst->op == IR_OP_STORE_LOCAL));
+            break;
+        }
+        case IR_OP_INC_LOCAL: {
+            const size_t src = self->alias[inst->arg];
+            translate_write(self, inst->arg);
+            translate_emit(self, IR_OP_ADD_INT, inst->arg, src, 0, (int32_t)inst->arg2, true);
+            break;
+        }
+        case IR_OP_ADD_LOCALS: {
+            const size_t b = self->alias[inst->arg], c = self->alias[inst->arg2];
+            translate_write(self, d);
+            translate_emit(self, IR_OP_ADD, d, b, c, 0, true);
+            ++self->depth;
+            break;
+        }
+        case IR_OP_ADD_INT:
+        case IR_OP_SUB_INT:
+        case IR_OP_IS:
+        case IR_OP_AS: {
+            const size_t b = self->alias[d - 1];
+            translate_write(self, d - 1);
+            translate_emit(self, inst->op, d - 1, b, 0, (int32_t)inst->arg, true);
+            break;
+        }
+        case IR_OP_JMP: {
+            translate_materialize_all(self);
+            fixups[(* fixup_count)++] = (TranslateFixup){ .inst = self->out->size, .target = self->insts[i].target };
+            translate_emit(self, IR_OP_JMP, 0, 0, 0, 0, false);
+            break;
+        }
+        case IR_OP_JZ:
+        case IR_OP_JNZ: {
+            const size_t a = self->alias[d - 1];
+            translate_pop(self, 1);
+            translate_materialize_all(self);
+            fixups[(* fixup_count)++] = (TranslateFixup){ .inst = self->out->size, .target = self->insts[i].target };
+            translate_emit(self, inst->op, a, 0, 0, 0, false);
+            break;
+        }
+        case IR_OP_LT_JZ:
+        case IR_OP_ILT_JZ:
+        case IR_OP_ILT_JNZ: {
+            const size_t b = self->alias[d - 2], c = self->alias[d - 1];
+            translate_pop(self, 2);
+            translate_materialize_all(self);
+            fixups[(* fixup_count)++] = (TranslateFixup){ .inst = self->out->size, .target = self->insts[i].target };
+            translate_emit(self, inst->op, 0, b, c, 0, false);
+            break;
+        }
+        case IR_OP_CHECK: {
+            translate_emit(self, IR_OP_CHECK, 0, self->alias[d - 1], 0, (int32_t)inst->arg, false);
+            break;
+        }
+        case IR_OP_CALL:
+        case IR_OP_TAIL_CALL: {
+            // NOTE: the callee frame starts at the callee, so it and its arguments need real copies
+            const size_t a = d - inst->arg - 1;
+            for (size_t s = a; s < d; ++s) translate_materialize(self, s);
+            translate_pop(self, inst->arg);
+            translate_emit(self, inst->op, a, inst->arg, 0, 0, false);
+            break;
+        }
+        case IR_OP_RET: {
+            translate_emit(self, IR_OP_RET, self->alias[d - 1], 0, 0, 0, false);
+            break;
+        }
+        default: {
+            if (_ir_opcode_is_binary(inst->op)) {
+                const size_t b = self->alias[d - 2], c = self->alias[d - 1];
+                translate_pop(self, 1);
+                translate_write(self, d - 2);
+                translate_emit(self, inst->op, d - 2, b, c, 0, true);
+            } else {
+                const size_t b = self->alias[d - 1];
+                translate_write(self, d - 1);
+                translate_emit(self, inst->op, d - 1, b, 0, 0, true);
+            }
+            break;
+        }
+    }
+}
+
+/* -===============
+     IRRegChunk
+   ===============- */
+
+FLUFF_PRIVATE_API void _new_ir_reg_chunk(IRRegChunk * self) {
+    FLUFF_CLEANUP(self);
+}
+
+FLUFF_PRIVATE_API void _free_ir_reg_chunk(IRRegChunk * self) {
+    if (self->code) fluff_free(self->code);
+    if (self->addresses) fluff_free(self->addresses);
+    FLUFF_CLEANUP(self);
+}
+
+FLUFF_PRIVATE_API size_t _ir_reg_chunk_append(IRRegChunk * self, uint8_t op, uint16_t a, uint16_t b, uint16_t c, int32_t x) {
+    if (self->size >= self->capacity) {
+        self->capacity = FLUFF_MAX(self->capacity * 2, IR_REG_CHUNK_MIN_CAPACITY);
+        self->code     = fluff_alloc(self->code, sizeof(IRRegInstruction) * self->capacity);
+    }
+    self->code[self->size] = (IRRegInstruction){ .op = op, .a = a, .b = b, .c = c, .x = x };
+    return self->size++;
+}
+
+FLUFF_PRIVATE_API void _ir_reg_chunk_dump(const IRRegChunk * self) {
+    for (size_t i = 0; i < self->size; ++i) {
+        const IRRegInstruction * inst = &self->code[i];
+        printf("%.4zx\t%-16s ", i, _ir_opcode_name(inst->op));
+        switch (inst->op) {
+            case IR_OP_PUSH_VOID:
+            case IR_OP_PUSH_TRUE:
+            case IR_OP_PUSH_FALSE:
+            case IR_OP_RET:       { printf("r%u", inst->a); break; }
+            case IR_OP_PUSH_INT:
+            case IR_OP_PUSH_FLOAT:
+            case IR_OP_PUSH_STRING:
+            case IR_OP_PUSH_FUNC: { printf("r%u #%d", inst->a, inst->x); break; }
+            case IR_OP_GET_LOCAL: { printf("r%u r%u", inst->a, inst->b); break; }
+            case IR_OP_CALL:
+            case IR_OP_TAIL_CALL: { printf("r%u %u", inst->a, inst->b); break; }
+            case IR_OP_ADD_INT:
+            case IR_OP_SUB_INT:
+            case IR_OP_IS:
+            case IR_OP_AS:        { printf("r%u r%u #%d", inst->a, inst->b, inst->x); break; }
+            case IR_OP_JMP:       { printf("%+d -> %.4zx", inst->x, (size_t)((ptrdiff_t)i + 1 + inst->x)); break; }
+            case IR_OP_JZ:
+            case IR_OP_JNZ:       { printf("r%u %+d -> %.4zx", inst->a, inst->x, (size_t)((ptrdiff_t)i + 1 + inst->x)); break; }
+            case IR_OP_CHECK:     { printf("r%u #%d", inst->b, inst->x); break; }
+            case IR_OP_LT_JZ:
+            case IR_OP_ILT_JZ:
+            case IR_OP_ILT_JNZ:   { printf("r%u r%u %+d -> %.4zx", inst->b, inst->c, inst->x, (size_t)((ptrdiff_t)i + 1 + inst->x)); break; }
+            default: {
+                if (_ir_opcode_is_binary(inst->op)) printf("r%u r%u r%u", inst->a, inst->b, inst->c);
+                else printf("r%u r%u", inst->a, inst->b);
+                break;
+            }
+        }
+        putchar('\n');
+    }
+}
+
+/* -=- Translation -=- */
+// NOTE: leaves the chunk alone when it uses something the register VM doesn't run
+FLUFF_PRIVATE_API FluffResult _ir_translate_chunk(IRChunk * chunk, size_t preserve) {
+    IRRegChunk * out = fluff_alloc(NULL, sizeof(IRRegChunk));
+    _new_ir_reg_chunk(out);
+
+    Translator self = {
+        .insts  = NULL,
+        .count  = 0,
+        .out    = out,
+        .starts = fluff_alloc(NULL, sizeof(size_t) * (chunk->size + 1)),
+        .alias  = NULL,
+        .depth  = 0,
+        .last   = SIZE_MAX,
+    };
+    TranslateFixup * fixups      = fluff_alloc(NULL, sizeof(TranslateFixup) * (chunk->size + 1));
+    size_t           fixup_count = 0;
+
+    // NOTE: every path into an instruction has to agree on the stack size, 'register_count' takes the biggest one
+    FluffResult res = FLUFF_OK;
+    if (!_ir_flow_chunk(chunk, preserve, &self.insts, &self.count, &out->register_count) || out->register_count >= UINT16_MAX)
+        res = FLUFF_FAILURE;
+    if (res == FLUFF_OK) {
+        self.alias = fluff_alloc(NULL, sizeof(uint16_t) * (out->register_count + 1));
+        for (size_t s = 0; s <= out->register_count; ++s) self.alias[s] = (uint16_t)s;
+
+        bool reachable = true;
+        for (size_t i = 0; i <= self.count; ++i) {
+            const IRFlowInst * t = &self.insts[i];
+            if (t->label) {
+                // NOTE: jumps leave every slot holding its own value, the path falling through has to as well
+                if (reachable) translate_materialize_all(&self);
+                else for (size_t s = 0; s <= out->register_count; ++s) self.alias[s] = (uint16_t)s;
+                self.last = SIZE_MAX;
+            }
+            self.starts[i] = out->size;
+            if (t->depth == IR_FLOW_UNKNOWN) continue;
+            self.depth = t->depth;
+
+            if (i == self.count) {
+                translate_emit(&self, IR_OP_PUSH_VOID, self.depth, 0, 0, 0, false);
+                translate_emit(&self, IR_OP_RET, self.depth, 0, 0, 0, false);
+                break;
+            }
+            translate_inst(&self, i, fixups, &fixup_count);
+            reachable = (t->inst.op != IR_OP_JMP && t->inst.op != IR_OP_RET);
+        }
+
+        for (size_t i = 0; i < fixup_count; ++i)
+            out->code[fixups[i].inst].x = (int32_t)((ptrdiff_t)self.starts[fixups[i].target] - (ptrdiff_t)(fixups[i].inst + 1));
+
+        out->addresses = fluff_alloc(NULL, sizeof(size_t) * FLUFF_MAX(out->size, 1));
+        for (size_t i = 0; i <= self.count; ++i) {
+            const size_t end = (i < self.count ? self.starts[i + 1] : out->size);
+            for (size_t k = self.starts[i]; k < end; ++k) out->addresses[k] = self.insts[i].offset;
+        }
+    }
+
+    if (self.alias) fluff_free(self.alias);
+    fluff_free(self.insts);
+    fluff_free(self.starts);
+    fluff_free(fixups);
+
+    if (res == FLUFF_FAILURE) {
+        _free_ir_reg_chunk(out);
+        fluff_free(out);
+        return FLUFF_FAILURE;
+    }
+    if (chunk->registers) {
+        _free_ir_reg_chunk(chunk->registers);
+        fluff_free(chunk->registers);
+    }
+    chunk->registers = out;
+    return FLUFF_OK;
+}
+
+// NOTE: the register VM only runs a binary whose main chunk was translated, methods that weren't run on the stack VM
+FLUFF_PRIVATE_API void _ir_translate_binary(IRBinary * binary) {
+    _ir_translate_chunk(&binary->main_chunk, 0);
+    for (size_t i = 0; i < binary->method_count; ++i) {
+        FluffMethod * method = binary->methods[i];
+        if (method->chunk) _ir_translate_chunk(method->chunk, method->property_count + 1);
+    }
+}
\ No newline at end of file
@@ -47,7 +47,7 @@ FLUFF_API void fluff_string_reserve(FluffString * self, size_t new_capacity) {
     if (self->capacity > new_capacity) return;
     self->capacity = new_capacity + 1;
     self->data     = fluff_alloc(self->data, self->capacity);
-    memset(&self->data[self->length + 1], 0, self->capacity - self->length);
+    memset(&self->data[self->length], 0, self->capacity - self->length);
 }
 
 FLUFF_API void fluff_string_resize(FluffString * self, size_t new_size) {
@@ -0,0 +1,125 @@
+/* -=============
+     Includes
+   =============- */
+
+#define FLUFF_IMPLEMENTATION
+#include <base.h>
+#include <error.h>
+#include <core/symbol.h>
+#include <core/config.h>
+
+/* -==============
+     Internals
+   ==============- */
+
+#define SYMBOL_TABLE_MIN_BUCKETS 64
+
+FLUFF_CONSTEXPR size_t _symbol_table_probe(SymbolTable * self, uint64_t hash, const char * name, size_t len) {
+    const size_t mask = self->bucket_count - 1;
+
+    size_t i = (size_t)hash & mask;
+    while (self->buckets[i] != 0) {
+        const SymbolEntry * entry = &self->entries[self->buckets[i] - 1];
+        if (entry->hash == hash && entry->length == len && !memcmp(&self->names[entry->offset], name, len))
+            break;
+        i = (i + 1) & mask;
+    }
+    return i;
+}
+
+FLUFF_CONSTEXPR void _symbol_table_rehash(SymbolTable * self, size_t bucket_count) {
+    fluff_free(self->buckets);
+    self->bucket_count = bucket_count;
+    self->buckets      = fluff_alloc(NULL, sizeof(uint32_t) * bucket_count);
+    FLUFF_CLEANUP_N(self->buckets, sizeof(uint32_t) * bucket_count);
+
+    const size_t mask = bucket_count - 1;
+    for (size_t id = 0; id < self->entry_count; ++id) {
+        size_t i = (size_t)self->entries[id].hash & mask;
+        while (self->buckets[i] != 0) i = (i + 1) & mask;
+        self->buckets[i] = (uint32_t)(id + 1);
+    }
+}
+
+/* -================
+     SymbolTable
+   ================- */
+
+/* -=- Initializers -=- */
+FLUFF_PRIVATE_API void _new_symbol_table(SymbolTable * self) {
+    FLUFF_CLEANUP(self);
+}
+
+FLUFF_PRIVATE_API void _free_symbol_table(SymbolTable * self) {
+    fluff_free(self->entries);
+    fluff_free(self->buckets);
+    fluff_free(self->names);
+    FLUFF_CLEANUP(self);
+}
+
+/* -=- Interning -=- */
+FLUFF_PRIVATE_API uint32_t _symbol_table_intern(SymbolTable * self, const char * name, size_t len) {
+    // NOTE: keeps the load factor under 1/2 so probing stays short
+    if ((self->entry_count + 1) * 2 > self->bucket_count)
+        _symbol_table_rehash(self, FLUFF_MAX(self->bucket_count * 2, SYMBOL_TABLE_MIN_BUCKETS));
+
+    const uint64_t hash = fluff_hash(name, len);
+    const size_t   i    = _symbol_table_probe(self, hash, name, len);
+    if (self->buckets[i] != 0) return self->buckets[i] - 1;
+
+    if (self->entry_count >= SYMBOL_NONE - 1) {
+        fluff_push_error("symbol table overflow");
+        return SYMBOL_NONE;
+    }
+
+    if (self->entry_count >= self->entry_capacity) {
+        self->entry_capacity = FLUFF_MAX(self->entry_capacity * 2, SYMBOL_TABLE_MIN_BUCKETS);
+        self->entries        = fluff_alloc(self->entries, sizeof(SymbolEntry) * self->entry_capacity);
+    }
+
+    if (self->names_size + len + 1 > self->names_capacity) {
+        self->names_capacity = FLUFF_MAX(self->names_capacity * 2, self->names_size + len + 1);
+        self->names          = fluff_alloc(self->names, self->names_capacity);
+    }
+
+    SymbolEntry * entry = &self->entries[self->entry_count];
+    entry->hash   = hash;
+    entry->offset = (uint32_t)self->names_size;
+    entry->length = (uint32_t)len;
+
+    memcpy(&self->names[self->names_size], name, len);
+    self->names[self->names_size + len] = '\0';
+    self->names_size += len + 1;
+
+    self->buckets[i] = (uint32_t)(++self->entry_count);
+    return self->buckets[i] - 1;
+}
+
+FLUFF_PRIVATE_API uint32_t _symbol_table_find(SymbolTable * self, const char * name, size_t len) {
+    if (self->bucket_count == 0) return SYMBOL_NONE;
+
+    const size_t i = _symbol_table_probe(self, fluff_hash(name, len), name, len);
+    if (self->buckets[i] == 0) return SYMBOL_NONE;
+    return self->buckets[i] - 1;
+}
+
+/* -=- Getters -=- */
+FLUFF_PRIVATE_API const char * _symbol_table_get(SymbolTable * self, uint32_t id) {
+    if (id >= self->entry_count) return NULL;
+    return &self->names[self->entries[id].offset];
+}
+
+FLUFF_PRIVATE_API size_t _symbol_table_get_len(SymbolTable * self, uint32_t id) {
+    if (id >= self->entry_count) return 0;
+    return self->entries[id].length;
+}
+
+FLUFF_PRIVATE_API size_t _symbol_table_size(SymbolTable * self) {
+    return self->entry_count;
+}
+
+FLUFF_PRIVATE_API void _symbol_table_dump(SymbolTable * self) {
+    for (size_t id = 0; id < self->entry_count; ++id) {
+        printf("[%zu] = '%s'\n", id, &self->names[self->entries[id].offset]);
+    }
+}
\ No newline at end of file
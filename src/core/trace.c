@@ -0,0 +1,652 @@
+/* -=============
+     Includes
+   =============- */
+
+#define FLUFF_IMPLEMENTATION
+#include <base.h>
+#include <error.h>
+#include <core/trace.h>
+#include <core/jit.h>
+#include <core/vm.h>
+#include <core/object.h>
+#include <core/instance.h>
+#include <core/class.h>
+#include <core/method.h>
+#include <core/config.h>
+
+/* -==============
+     Internals
+   ==============- */
+
+#define TRACE_NO_EXIT SIZE_MAX
+
+// This struct represents a trace being built out of a recording.
+typedef struct TraceBuilder {
+    FluffVM             * vm;
+    const TraceRecorder * recorder;
+    Trace               * trace;
+
+    FluffKlass * klass_int, * klass_float, * klass_bool;
+
+    // NOTE: the class each entry is known to have (NULL when it isn't), and the one it's guarded for before
+    // anything writes to it, which is what it has when the iteration starts
+    FluffKlass ** known;
+    FluffKlass ** entry;
+    bool        * written;
+    size_t        slot_count;
+
+    // NOTE: operations are only kept on the last pass, the ones before it find what can be hoisted
+    bool   emit;
+    size_t op_capacity, exit_capacity;
+} TraceBuilder;
+
+FLUFF_CONSTEXPR size_t trace_depth(const FluffVM * vm) {
+    return vm->stack_count - vm->current_frame.base;
+}
+
+/* -=- Loops -=- */
+static TraceLoop * trace_find_loop(IRChunk * chunk, size_t header) {
+    for (size_t i = 0; i < chunk->loop_count; ++i)
+        if (chunk->loops[i].header == header) return &chunk->loops[i];
+
+    if (chunk->loop_count >= chunk->loop_capacity) {
+        chunk->loop_capacity = FLUFF_MAX(chunk->loop_capacity * 2, 4);
+        chunk->loops         = fluff_alloc(chunk->loops, sizeof(TraceLoop) * chunk->loop_capacity);
+    }
+
+    TraceLoop * loop = &chunk->loops[chunk->loop_count++];
+    FLUFF_CLEANUP(loop);
+    loop->header = header;
+    return loop;
+}
+
+static void trace_free(Trace * self) {
+    if (self->ops)   fluff_free(self->ops);
+    if (self->exits) fluff_free(self->exits);
+    if (self->native) {
+        _free_jit_code(self->native);
+        fluff_free(self->native);
+    }
+    fluff_free(self);
+}
+
+/* -=- Recorder -=- */
+
+// Gives the entries 'inst' reads the class of, the recording keeps them in the same order.
+static size_t trace_operands(const IRInstruction * inst, size_t depth, size_t * slots) {
+    switch (inst->op) {
+        case IR_OP_GET_LOCAL:
+        case IR_OP_INC_LOCAL: {
+            slots[0] = inst->arg;
+            return 1;
+        }
+        case IR_OP_SET_LOCAL:
+        case IR_OP_STORE_LOCAL: {
+            slots[0] = inst->arg;
+            slots[1] = depth - 1;
+            return 2;
+        }
+        case IR_OP_ADD_LOCALS: {
+            slots[0] = inst->arg;
+            slots[1] = inst->arg2;
+            return 2;
+        }
+        case IR_OP_ADD_INT:
+        case IR_OP_SUB_INT: {
+            slots[0] = depth - 1;
+            return 1;
+        }
+        default: {
+            if (inst->op != IR_OP_LT_JZ && inst->op != IR_OP_ILT_JZ && inst->op != IR_OP_ILT_JNZ && !_ir_opcode_is_binary(inst->op)) return 0;
+            slots[0] = depth - 2;
+            slots[1] = depth - 1;
+            return 2;
+        }
+    }
+}
+
+static void trace_start(FluffVM * vm, IRChunk * chunk, const TraceLoop * loop) {
+    TraceRecorder * self = fluff_alloc(NULL, sizeof(TraceRecorder));
+    FLUFF_CLEANUP(self);
+    self->chunk = chunk;
+    self->loop  = (size_t)(loop - chunk->loops);
+    self->frame = vm->frame_count;
+    vm->recorder = self;
+}
+
+static void trace_stop(FluffVM * vm) {
+    TraceRecorder * self = vm->recorder;
+    if (self->records) fluff_free(self->records);
+    fluff_free(self);
+    vm->recorder = NULL;
+}
+
+/* -=- Builder -=- */
+FLUFF_CONSTEXPR bool trace_is_primitive(const TraceBuilder * self, const FluffKlass * klass) {
+    return klass && (klass == self->klass_int || klass == self->klass_float || klass == self->klass_bool);
+}
+
+// NOTE: the typed opcodes of ints and floats follow the order of the generic ones
+FLUFF_CONSTEXPR uint8_t trace_typed_op(const TraceBuilder * self, uint8_t op, const FluffKlass * klass) {
+    const uint8_t base = (klass == self->klass_int ? IR_OP_IADD : IR_OP_FADD);
+    if (op <= IR_OP_MUL) return (uint8_t)(base + (op - IR_OP_ADD));
+    return (uint8_t)(base + 3 + (op - IR_OP_EQ));
+}
+
+FLUFF_CONSTEXPR FluffKlass * trace_typed_result(const TraceBuilder * self, uint8_t op) {
+    if ((op - IR_OP_IADD) % 9 >= 3) return self->klass_bool;
+    return (op < IR_OP_FADD ? self->klass_int : self->klass_float);
+}
+
+// NOTE: what the entry is known to be, or else what the recording saw
+FLUFF_CONSTEXPR FluffKlass * trace_expect(const TraceBuilder * self, size_t slot, FluffKlass * seen) {
+    return (self->known[slot] ? self->known[slot] : seen);
+}
+
+static TraceOp trace_op(TraceOpKind kind, size_t depth) {
+    TraceOp op;
+    FLUFF_CLEANUP(&op);
+    op.kind  = kind;
+    op.depth = depth;
+    op.exit  = TRACE_NO_EXIT;
+    return op;
+}
+
+static void trace_push(TraceBuilder * self, const TraceOp * op) {
+    if (!self->emit) return;
+
+    Trace * trace = self->trace;
+    if (trace->op_count >= self->op_capacity) {
+        self->op_capacity = FLUFF_MAX(self->op_capacity * 2, 16);
+        trace->ops        = fluff_alloc(trace->ops, sizeof(TraceOp) * self->op_capacity);
+    }
+    trace->ops[trace->op_count++] = * op;
+}
+
+// NOTE: exits going back to the same place with the same stack size are shared
+static size_t trace_exit(TraceBuilder * self, size_t ip, size_t depth) {
+    if (!self->emit) return TRACE_NO_EXIT;
+
+    Trace * trace = self->trace;
+    for (size_t i = 0; i < trace->exit_count; ++i)
+        if (trace->exits[i].ip == ip && trace->exits[i].depth == depth) return i;
+
+    if (trace->exit_count >= self->exit_capacity) {
+        self->exit_capacity = FLUFF_MAX(self->exit_capacity * 2, 8);
+        trace->exits        = fluff_alloc(trace->exits, sizeof(TraceExit) * self->exit_capacity);
+    }
+    trace->exits[trace->exit_count] = (TraceExit){ .ip = ip, .depth = depth, .count = 0 };
+    return trace->exit_count++;
+}
+
+static void trace_write(TraceBuilder * self, size_t slot, FluffKlass * klass) {
+    self->known[slot]   = klass;
+    self->written[slot] = true;
+}
+
+// NOTE: helpers may free or overwrite anything past what they leave on the stack
+static void trace_forget(TraceBuilder * self, size_t from) {
+    for (size_t i = from; i < self->slot_count; ++i)
+        trace_write(self, i, NULL);
+}
+
+// Guards the entry 'slot' is of class 'klass' before 'record' runs, unless that's known already.
+// NOTE: a failing guard leaves the trace right before the instruction, so the interpreter runs it
+static void trace_guard(TraceBuilder * self, const TraceRecord * record, size_t slot, FluffKlass * klass) {
+    if (self->known[slot] == klass) {
+        if (self->emit) ++self->trace->guards_removed;
+        return;
+    }
+    if (!self->written[slot] && !self->entry[slot]) self->entry[slot] = klass;
+    self->known[slot] = klass;
+    if (!self->emit) return;
+
+    TraceOp op = trace_op(TRACE_OP_GUARD, record->depth);
+    op.a     = slot;
+    op.klass = klass;
+    op.exit  = trace_exit(self, record->ip, record->depth);
+    trace_push(self, &op);
+    ++self->trace->guards;
+}
+
+// NOTE: 'pure' instructions never reach their helper unless they fail, so they leave the other entries alone
+static void trace_inst(TraceBuilder * self, const IRInstruction * inst, size_t depth, size_t exit, bool pure) {
+    TraceOp op = trace_op(TRACE_OP_INST, depth);
+    op.inst = * inst;
+    op.exit = exit;
+    trace_push(self, &op);
+    if (pure) return;
+
+    size_t after = depth;
+    _ir_stack_effect(inst, depth, &after);
+    trace_forget(self, (after > 0 ? after - 1 : 0));
+}
+
+// Compiles a branch as a side exit, the trace goes on the way the branch went while recording.
+static void trace_branch(TraceBuilder * self, const TraceRecord * record, uint8_t op, size_t slot) {
+    const size_t next   = record->ip + record->inst.size;
+    const size_t target = (size_t)((ptrdiff_t)next + record->inst.jump);
+
+    IRInstruction branch;
+    FLUFF_CLEANUP(&branch);
+    branch.op = op;
+    if (record->taken) branch.op = (op == IR_OP_JZ ? IR_OP_JNZ : IR_OP_JZ);
+    trace_inst(self, &branch, slot + 1, trace_exit(self, (record->taken ? next : target), slot), true);
+}
+
+// Guards both operands of an arithmetic instruction when the recording saw two ints or two floats, and gives their class.
+static FluffKlass * trace_arith_class(TraceBuilder * self, const TraceRecord * record, size_t lhs, size_t rhs) {
+    FluffKlass * klass = trace_expect(self, lhs, record->klass[0]);
+    if (klass != self->klass_int && klass != self->klass_float) return NULL;
+    if (trace_expect(self, rhs, record->klass[1]) != klass) return NULL;
+
+    trace_guard(self, record, lhs, klass);
+    trace_guard(self, record, rhs, klass);
+    return klass;
+}
+
+// NOTE: entries already holding a primitive of the same class only get their value written
+static void trace_copy(TraceBuilder * self, const TraceRecord * record, size_t from, size_t to, FluffKlass * klass) {
+    const bool unboxed = (self->known[to] == klass);
+    if (unboxed && self->emit) ++self->trace->unboxed;
+
+    TraceOp op = trace_op((unboxed ? TRACE_OP_COPY_DATA : TRACE_OP_COPY), record->depth);
+    op.a = from;
+    op.b = to;
+    trace_push(self, &op);
+    trace_write(self, to, klass);
+}
+
+static void trace_set(TraceBuilder * self, const TraceRecord * record, size_t slot, FluffKlass * klass, uint64_t value) {
+    if (self->known[slot] != klass) {
+        trace_inst(self, &record->inst, record->depth, TRACE_NO_EXIT, true);
+        trace_write(self, slot, klass);
+        return;
+    }
+    if (self->emit) ++self->trace->unboxed;
+
+    TraceOp op = trace_op(TRACE_OP_SET_DATA, record->depth);
+    op.a     = slot;
+    op.value = value;
+    trace_push(self, &op);
+    trace_write(self, slot, klass);
+}
+
+static void trace_add(TraceBuilder * self, const TraceRecord * record, size_t slot, uint64_t value) {
+    if (self->emit) ++self->trace->unboxed;
+
+    TraceOp op = trace_op(TRACE_OP_ADD_DATA, record->depth);
+    op.a     = slot;
+    op.value = value;
+    trace_push(self, &op);
+    trace_write(self, slot, self->klass_int);
+}
+
+// Turns the recording into operations, starting with the entries of the loop known to have the classes in 'start'.
+static void trace_lower(TraceBuilder * self, FluffKlass ** start) {
+    memcpy(self->known, start, sizeof(FluffKlass *) * self->slot_count);
+    memset(self->written, 0, sizeof(bool) * self->slot_count);
+
+    const TraceRecorder * recorder  = self->recorder;
+    const IRConstant    * constants = self->vm->binary->constants;
+    for (size_t i = 0; i < recorder->count; ++i) {
+        const TraceRecord   * record = &recorder->records[i];
+        const IRInstruction * inst   = &record->inst;
+        const size_t          depth  = record->depth, top = depth - 1;
+
+        switch (inst->op) {
+            case IR_OP_NOP:
+            case IR_OP_PROMOTE:
+            case IR_OP_JMP: break;
+            case IR_OP_JZ:
+            case IR_OP_JNZ: {
+                trace_branch(self, record, inst->op, top);
+                break;
+            }
+            case IR_OP_LT_JZ:
+            case IR_OP_ILT_JZ:
+            case IR_OP_ILT_JNZ: {
+                IRInstruction lt;
+                FLUFF_CLEANUP(&lt);
+                lt.op = IR_OP_ILT;
+                if (inst->op == IR_OP_LT_JZ) {
+                    FluffKlass * klass = trace_arith_class(self, record, depth - 2, top);
+                    lt.op = (klass ? trace_typed_op(self, IR_OP_LT, klass) : IR_OP_LT);
+                }
+                trace_inst(self, &lt, depth, TRACE_NO_EXIT, (lt.op != IR_OP_LT));
+                trace_write(self, depth - 2, self->klass_bool);
+                trace_branch(self, record, (inst->op == IR_OP_ILT_JNZ ? IR_OP_JNZ : IR_OP_JZ), depth - 2);
+                break;
+            }
+            case IR_OP_PUSH_TRUE:
+            case IR_OP_PUSH_FALSE: {
+                trace_set(self, record, depth, self->klass_bool, (inst->op == IR_OP_PUSH_TRUE));
+                break;
+            }
+            case IR_OP_PUSH_INT: {
+                trace_set(self, record, depth, self->klass_int, (uint64_t)constants[inst->arg].data.i);
+                break;
+            }
+            case IR_OP_PUSH_FLOAT: {
+                uint64_t bits;
+                memcpy(&bits, &constants[inst->arg].data.f, sizeof(bits));
+                trace_set(self, record, depth, self->klass_float, bits);
+                break;
+            }
+            case IR_OP_GET_LOCAL: {
+                FluffKlass * klass = trace_expect(self, inst->arg, record->klass[0]);
+                if (trace_is_primitive(self, klass)) {
+                    trace_guard(self, record, inst->arg, klass);
+                    trace_copy(self, record, inst->arg, depth, klass);
+                    break;
+                }
+                trace_inst(self, inst, depth, TRACE_NO_EXIT, false);
+                break;
+            }
+            case IR_OP_SET_LOCAL:
+            case IR_OP_STORE_LOCAL: {
+                if (inst->arg == top) {
+                    if (inst->op == IR_OP_STORE_LOCAL) trace_inst(self, inst, depth, TRACE_NO_EXIT, false);
+                    break;
+                }
+
+                FluffKlass * local = trace_expect(self, inst->arg, record->klass[0]);
+                FluffKlass * value = trace_expect(self, top, record->klass[1]);
+                if (trace_is_primitive(self, local) && trace_is_primitive(self, value)) {
+                    trace_guard(self, record, inst->arg, local);
+                    trace_guard(self, record, top, value);
+                    trace_copy(self, record, top, inst->arg, value);
+                    break;
+                }
+
+                // NOTE: the local ends up with whatever class the top entry had
+                FluffKlass * klass = self->known[top];
+                trace_inst(self, inst, depth, TRACE_NO_EXIT, false);
+                trace_write(self, inst->arg, klass);
+                break;
+            }
+            case IR_OP_INC_LOCAL: {
+                if (trace_expect(self, inst->arg, record->klass[0]) == self->klass_int) {
+                    trace_guard(self, record, inst->arg, self->klass_int);
+                    trace_add(self, record, inst->arg, (uint64_t)constants[inst->arg2].data.i);
+                    break;
+                }
+                trace_inst(self, inst, depth, TRACE_NO_EXIT, false);
+                trace_write(self, inst->arg, NULL);
+                break;
+            }
+            case IR_OP_ADD_INT:
+            case IR_OP_SUB_INT: {
+                if (trace_expect(self, top, record->klass[0]) == self->klass_int) {
+                    const uint64_t v = (uint64_t)constants[inst->arg].data.i;
+                    trace_guard(self, record, top, self->klass_int);
+                    trace_add(self, record, top, (inst->op == IR_OP_ADD_INT ? v : -v));
+                    break;
+                }
+                trace_inst(self, inst, depth, TRACE_NO_EXIT, false);
+                break;
+            }
+            case IR_OP_ADD_LOCALS: {
+                const bool ints = (trace_expect(self, inst->arg, record->klass[0]) == self->klass_int &&
+                                   trace_expect(self, inst->arg2, record->klass[1]) == self->klass_int);
+                if (ints) {
+                    trace_guard(self, record, inst->arg, self->klass_int);
+                    trace_guard(self, record, inst->arg2, self->klass_int);
+                }
+                trace_inst(self, inst, depth, TRACE_NO_EXIT, ints);
+                trace_write(self, depth, (ints ? self->klass_int : NULL));
+                break;
+            }
+            // NOTE: checks of entries whose class is already known are removed like guards
+            case IR_OP_CHECK: {
+                FluffKlass * klass = constants[inst->arg].data.klass;
+                if (self->known[top] == klass) {
+                    if (self->emit) ++self->trace->guards_removed;
+                    break;
+                }
+                trace_inst(self, inst, depth, TRACE_NO_EXIT, true);
+                self->known[top] = klass;
+                break;
+            }
+            case IR_OP_IS: {
+                trace_inst(self, inst, depth, TRACE_NO_EXIT, false);
+                trace_write(self, top, self->klass_bool);
+                break;
+            }
+            default: {
+                const uint8_t op = inst->op;
+                if (_ir_opcode_is_typed(op)) {
+                    trace_inst(self, inst, depth, TRACE_NO_EXIT, true);
+                    trace_write(self, depth - 2, trace_typed_result(self, op));
+                    break;
+                }
+                if ((op >= IR_OP_ADD && op <= IR_OP_MUL) || (op >= IR_OP_EQ && op <= IR_OP_LE)) {
+                    FluffKlass * klass = trace_arith_class(self, record, depth - 2, top);
+                    if (klass) {
+                        IRInstruction typed = * inst;
+                        typed.op = trace_typed_op(self, op, klass);
+                        trace_inst(self, &typed, depth, TRACE_NO_EXIT, true);
+                        trace_write(self, depth - 2, (op >= IR_OP_EQ ? self->klass_bool : klass));
+                        break;
+                    }
+                }
+                trace_inst(self, inst, depth, TRACE_NO_EXIT, false);
+                break;
+            }
+        }
+    }
+}
+
+/*
+    Guards are hoisted in front of the loop when the entry they check isn't written before them, and still has
+    the same class at the end of the iteration. Hoisting them makes the guards depending on them go away, which
+    can change what the end of the iteration knows, so the recording is lowered again until nothing changes.
+*/
+static Trace * trace_build(FluffVM * vm, const TraceRecorder * recorder, size_t header) {
+    Trace * trace = fluff_alloc(NULL, sizeof(Trace));
+    FLUFF_CLEANUP(trace);
+    trace->chunk    = recorder->chunk;
+    trace->header   = header;
+    trace->depth    = recorder->records[0].depth;
+    trace->recorded = recorder->count;
+
+    TraceBuilder self;
+    FLUFF_CLEANUP(&self);
+    self.vm          = vm;
+    self.recorder    = recorder;
+    self.trace       = trace;
+    self.klass_int   = fluff_instance_get_core_class(vm->instance, FLUFF_KLASS_INT);
+    self.klass_float = fluff_instance_get_core_class(vm->instance, FLUFF_KLASS_FLOAT);
+    self.klass_bool  = fluff_instance_get_core_class(vm->instance, FLUFF_KLASS_BOOL);
+
+    // NOTE: an instruction writes at most one entry past the stack it runs with
+    for (size_t i = 0; i < recorder->count; ++i)
+        self.slot_count = FLUFF_MAX(self.slot_count, recorder->records[i].depth + 1);
+
+    FluffKlass ** start = fluff_alloc(NULL, sizeof(FluffKlass *) * self.slot_count);
+    self.known   = fluff_alloc(NULL, sizeof(FluffKlass *) * self.slot_count);
+    self.entry   = fluff_alloc(NULL, sizeof(FluffKlass *) * self.slot_count);
+    self.written = fluff_alloc(NULL, sizeof(bool) * self.slot_count);
+    FLUFF_CLEANUP_N(start, sizeof(FluffKlass *) * self.slot_count);
+    FLUFF_CLEANUP_N(self.entry, sizeof(FluffKlass *) * self.slot_count);
+
+    trace_lower(&self, start);
+    for (size_t i = 0; i < trace->depth; ++i)
+        if (self.entry[i] && self.known[i] == self.entry[i]) start[i] = self.entry[i];
+
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        trace_lower(&self, start);
+        for (size_t i = 0; i < trace->depth; ++i) {
+            if (!start[i] || self.known[i] == start[i]) continue;
+            start[i] = NULL;
+            changed  = true;
+        }
+    }
+
+    self.emit = true;
+    for (size_t i = 0; i < trace->depth; ++i) {
+        if (!start[i]) continue;
+        TraceOp op = trace_op(TRACE_OP_GUARD, trace->depth);
+        op.a     = i;
+        op.klass = start[i];
+        op.exit  = trace_exit(&self, header, trace->depth);
+        trace_push(&self, &op);
+        ++trace->guards_hoisted;
+    }
+
+    TraceOp loop = trace_op(TRACE_OP_LOOP, trace->depth);
+    trace_push(&self, &loop);
+    trace_lower(&self, start);
+    loop.kind = TRACE_OP_JUMP_LOOP;
+    trace_push(&self, &loop);
+
+    fluff_free(start);
+    fluff_free(self.known);
+    fluff_free(self.entry);
+    fluff_free(self.written);
+    return trace;
+}
+
+static void trace_finish(FluffVM * vm) {
+    const TraceRecorder * self = vm->recorder;
+    TraceLoop           * loop = &self->chunk->loops[self->loop];
+
+    Trace * trace = trace_build(vm, self, loop->header);
+    trace->native = _jit_compile_trace(vm, trace);
+    loop->trace   = trace;
+    trace_stop(vm);
+}
+
+/* -=- Statistics -=- */
+static void trace_dump_chunk(const IRChunk * chunk, const char * name) {
+    for (size_t i = 0; i < chunk->loop_count; ++i) {
+        const TraceLoop * loop  = &chunk->loops[i];
+        const Trace     * trace = loop->trace;
+        if (!trace) {
+            printf("trace %s @%zu: not recorded (%zu iterations, %zu aborts)\n", name, loop->header, loop->hotness, loop->aborts);
+            continue;
+        }
+
+        printf("trace %s @%zu: %s, entered %lu times\n", name, loop->header,
+            (trace->native->entry ? "compiled" : "not compiled"), (unsigned long)trace->entered
+        );
+        printf("  instructions: %zu -> %zu ops\n", trace->recorded, trace->op_count);
+        printf("  guards:       %zu (%zu removed, %zu hoisted)\n", trace->guards, trace->guards_removed, trace->guards_hoisted);
+        printf("  unboxed:      %zu\n", trace->unboxed);
+        for (size_t k = 0; k < trace->exit_count; ++k)
+            printf("  exit @%zu:      %lu\n", trace->exits[k].ip, (unsigned long)trace->exits[k].count);
+    }
+}
+
+/* -==========
+     Trace
+   ==========- */
+
+// Counts an iteration of the loop starting at 'ip' in the running chunk, and runs its trace once it has one.
+// NOTE: 'ip' is set to where the trace left, the interpreter goes on from there
+FLUFF_PRIVATE_API FluffResult _trace_run_loop(FluffVM * vm, size_t * ip) {
+    // NOTE: loops aren't entered while one is being recorded, the recorder sees them go by
+    if (vm->recorder) return FLUFF_OK;
+
+    IRChunk   * chunk = (IRChunk *)vm->current_frame.chunk;
+    TraceLoop * loop  = trace_find_loop(chunk, * ip);
+    if (!loop->trace) {
+        if (loop->aborts < FLUFF_TRACE_MAX_ABORTS && ++loop->hotness >= FLUFF_TRACE_THRESHOLD) trace_start(vm, chunk, loop);
+        return FLUFF_OK;
+    }
+
+    Trace         * trace  = loop->trace;
+    const JitCode * native = trace->native;
+    if (!native->entry || native->instance != vm->instance || trace_depth(vm) != trace->depth) return FLUFF_OK;
+
+    // NOTE: like native chunks, the trace gets all the room it needs up front
+    if (_vm_reserve(vm, native->stack_size + 1 - trace->depth) == FLUFF_FAILURE) return FLUFF_FAILURE;
+
+    ++trace->entered;
+    if (native->entry(vm, &vm->stack[vm->current_frame.base]) == FLUFF_FAILURE) return FLUFF_FAILURE;
+    * ip = vm->current_frame.ip;
+    return FLUFF_OK;
+}
+
+// Records the instruction at 'ip' the running frame is about to run.
+// NOTE: the recording ends once the loop frame gets back to the header, returning or looping elsewhere aborts it
+FLUFF_PRIVATE_API void _trace_record(FluffVM * vm, size_t ip) {
+    TraceRecorder * self = vm->recorder;
+    if (vm->frame_count > self->frame) return;
+    if (vm->frame_count < self->frame || vm->current_frame.chunk != self->chunk) {
+        _trace_abort(vm);
+        return;
+    }
+
+    if (self->count > 0) {
+        TraceRecord * last = &self->records[self->count - 1];
+        last->taken = (ip != last->ip + last->inst.size);
+    }
+
+    const TraceLoop * loop  = &self->chunk->loops[self->loop];
+    const size_t      depth = trace_depth(vm);
+    if (ip == loop->header && self->count > 0) {
+        if (depth == self->records[0].depth) trace_finish(vm);
+        else _trace_abort(vm);
+        return;
+    }
+    if (ip >= self->chunk->size || self->count >= FLUFF_TRACE_MAX_LENGTH) {
+        _trace_abort(vm);
+        return;
+    }
+
+    // NOTE: a tail call replaces the loop frame, like returning from it
+    IRInstruction inst = _ir_decode(self->chunk->data, ip);
+    const bool    tail = (inst.op == IR_OP_TAIL_CALL);
+    inst.op = _ir_generic_opcode(inst.op);
+
+    // NOTE: inner loops are traced on their own
+    size_t after;
+    const bool inner = (_ir_opcode_is_jump(inst.op) && inst.jump < 0 &&
+                        (size_t)((ptrdiff_t)(ip + inst.size) + inst.jump) != loop->header);
+    if (inst.op == IR_OP_RET || tail || inner || !_ir_stack_effect(&inst, depth, &after)) {
+        _trace_abort(vm);
+        return;
+    }
+
+    if (self->count >= self->capacity) {
+        self->capacity = FLUFF_MAX(self->capacity * 2, 32);
+        self->records  = fluff_alloc(self->records, sizeof(TraceRecord) * self->capacity);
+    }
+
+    TraceRecord * record = &self->records[self->count++];
+    FLUFF_CLEANUP(record);
+    record->inst  = inst;
+    record->ip    = ip;
+    record->depth = depth;
+
+    size_t slots[2];
+    const size_t count = trace_operands(&inst, depth, slots);
+    for (size_t i = 0; i < count; ++i)
+        record->klass[i] = vm->stack[vm->current_frame.base + slots[i]].klass;
+}
+
+// NOTE: loops aborting too often are never recorded again
+FLUFF_PRIVATE_API void _trace_abort(FluffVM * vm) {
+    const TraceRecorder * self = vm->recorder;
+    TraceLoop           * loop = &self->chunk->loops[self->loop];
+    ++loop->aborts;
+    loop->hotness = 0;
+    trace_stop(vm);
+}
+
+FLUFF_PRIVATE_API void _free_trace_loops(IRChunk * chunk) {
+    for (size_t i = 0; i < chunk->loop_count; ++i)
+        if (chunk->loops[i].trace) trace_free(chunk->loops[i].trace);
+    fluff_free(chunk->loops);
+    chunk->loops      = NULL;
+    chunk->loop_count = chunk->loop_capacity = 0;
+}
+
+FLUFF_PRIVATE_API void _trace_dump_stats(const IRBinary * binary) {
+    trace_dump_chunk(&binary->main_chunk, "<main>");
+    for (size_t i = 0; i < binary->method_count; ++i)
+        if (binary->methods[i]->chunk) trace_dump_chunk(binary->methods[i]->chunk, binary->methods[i]->name);
+}
\ No newline at end of file
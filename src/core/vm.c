@@ -9,57 +9,397 @@
 #include <core/module.h>
 #include <core/instance.h>
 #include <core/class.h>
+#include <core/method.h>
+#include <core/ir.h>
+#include <core/register.h>
+#include <core/jit.h>
+#include <core/trace.h>
+#include <core/pgo.h>
 #include <core/config.h>
 
 /* -==============
      Internals
    ==============- */
 
-/* -============
-     VMFrame
-   ============- */
-
-FLUFF_PRIVATE_API void _vm_frame_push(VMFrame * self, FluffObject * obj) {
-    VMEntry * entry = fluff_alloc(NULL, sizeof(VMEntry));
-    // printf("allocated entry %p\n", entry);
-    FLUFF_CLEANUP(entry);
-    _ref_object(&entry->obj, obj);
-    entry->prev      = self->last_entry;
-    self->last_entry = entry;
-    ++self->entry_count;
-}
-
-FLUFF_PRIVATE_API void _vm_frame_pop(VMFrame * self) {
-    if (self->entry_count == 0 || !self->last_entry) return;
-    VMEntry * entry = self->last_entry;
-    // printf("deallocated entry %p\n", entry);
-    self->last_entry = entry->prev;
-    _free_object(&entry->obj);
-    FLUFF_CLEANUP(entry);
-    fluff_free(entry);
-    --self->entry_count;
-}
-
-FLUFF_PRIVATE_API void _vm_frame_popn(VMFrame * self, size_t count) {
-    while (count-- > 0) {
-        _vm_frame_pop(self);
+#define VM_MIN_STACK_CAPACITY 256
+
+typedef FluffResult(* VMBinaryFn)(FluffObject *, FluffObject *, FluffObject *);
+typedef FluffResult(* VMUnaryFn)(FluffObject *, FluffObject *);
+
+#define VM_NIBBLE_CASES(__op)\
+        case (__op) | 0x0: case (__op) | 0x1: case (__op) | 0x2: case (__op) | 0x3:\
+        case (__op) | 0x4: case (__op) | 0x5: case (__op) | 0x6: case (__op) | 0x7:\
+        case (__op) | 0x8: case (__op) | 0x9: case (__op) | 0xa: case (__op) | 0xb:\
+        case (__op) | 0xc: case (__op) | 0xd: case (__op) | 0xe: case (__op) | 0xf:
+
+// NOTE: a mismatch puts the generic opcode back and runs the instruction again as such
+#define VM_QUICK_CASE(__op, __generic, __klass, __field, __result_klass, __result_field, __operator)\
+        case __op: {\
+            FluffObject * lhs = &self->stack[self->stack_count - 2];\
+            if (lhs->klass != __klass || lhs[1].klass != __klass) {\
+                code[--ip] = __generic;\
+                break;\
+            }\
+            lhs->data.__result_field = (lhs->data.__field __operator lhs[1].data.__field);\
+            lhs->klass               = __result_klass;\
+            --self->stack_count;\
+            break;\
+        }
+
+// NOTE: ints, floats and bools own nothing, so a register holding one is overwritten without being freed
+#define VM_REG_QUICK_CASE(__op, __generic, __klass, __field, __result_klass, __result_field, __operator)\
+        case __op: {\
+            FluffObject * lhs = &r[inst->b], * rhs = &r[inst->c], * dst = &r[inst->a];\
+            if (lhs->klass != __klass || rhs->klass != __klass) {\
+                inst->op = __generic;\
+                --ip;\
+                break;\
+            }\
+            FluffObject result = { .instance = self->instance, .klass = __result_klass };\
+            result.data.__result_field = (lhs->data.__field __operator rhs->data.__field);\
+            if (dst->klass != klass_int && dst->klass != klass_float && dst->klass != klass_bool) _free_object(dst);\
+            * dst = result;\
+            break;\
+        }
+
+#define VM_REG_QUICK_ARITH_CASES(__name, __operator)\
+        VM_REG_QUICK_CASE(IR_OP_##__name##_INT_INT,     IR_OP_##__name, klass_int,   _int,   klass_int,   _int,   __operator)\
+        VM_REG_QUICK_CASE(IR_OP_##__name##_FLOAT_FLOAT, IR_OP_##__name, klass_float, _float, klass_float, _float, __operator)
+
+#define VM_REG_QUICK_CMP_CASES(__name, __operator)\
+        VM_REG_QUICK_CASE(IR_OP_##__name##_INT_INT,     IR_OP_##__name, klass_int,   _int,   klass_bool, _bool, __operator)\
+        VM_REG_QUICK_CASE(IR_OP_##__name##_FLOAT_FLOAT, IR_OP_##__name, klass_float, _float, klass_bool, _bool, __operator)
+
+#define VM_REG_BINARY_CASE(__op, __fn, __is_bool)\
+        case __op: { _vm_try(vm_reg_binary_op(self, __fn, r, inst, __is_bool)); break; }
+
+#define VM_REG_QUICKENED_CASE(__name, __fn, __is_bool)\
+        case IR_OP_##__name: {\
+            vm_quicken_operands(self, &inst->op, &r[inst->b], &r[inst->c], IR_OP_##__name##_INT_INT, IR_OP_##__name##_FLOAT_FLOAT);\
+            _vm_try(vm_reg_binary_op(self, __fn, r, inst, __is_bool));\
+            break;\
+        }
+
+#define VM_QUICK_ARITH_CASES(__name, __operator)\
+        VM_QUICK_CASE(IR_OP_##__name##_INT_INT,     IR_OP_##__name, klass_int,   _int,   klass_int,   _int,   __operator)\
+        VM_QUICK_CASE(IR_OP_##__name##_FLOAT_FLOAT, IR_OP_##__name, klass_float, _float, klass_float, _float, __operator)
+
+#define VM_QUICK_CMP_CASES(__name, __operator)\
+        VM_QUICK_CASE(IR_OP_##__name##_INT_INT,     IR_OP_##__name, klass_int,   _int,   klass_bool, _bool, __operator)\
+        VM_QUICK_CASE(IR_OP_##__name##_FLOAT_FLOAT, IR_OP_##__name, klass_float, _float, klass_bool, _bool, __operator)
+
+// NOTE: the compiler proved the classes of both operands, so typed opcodes check nothing
+#define VM_TYPED_CASE(__op, __field, __result_klass, __result_field, __operator)\
+        case __op: {\
+            FluffObject * lhs = &self->stack[self->stack_count - 2];\
+            lhs->data.__result_field = (lhs->data.__field __operator lhs[1].data.__field);\
+            lhs->klass               = __result_klass;\
+            --self->stack_count;\
+            break;\
+        }
+
+#define VM_TYPED_ARITH_CASES(__name, __operator)\
+        VM_TYPED_CASE(IR_OP_I##__name, _int,   klass_int,   _int,   __operator)\
+        VM_TYPED_CASE(IR_OP_F##__name, _float, klass_float, _float, __operator)
+
+#define VM_TYPED_CMP_CASES(__name, __operator)\
+        VM_TYPED_CASE(IR_OP_I##__name, _int,   klass_bool, _bool, __operator)\
+        VM_TYPED_CASE(IR_OP_F##__name, _float, klass_bool, _bool, __operator)
+
+#define VM_REG_TYPED_CASE(__op, __field, __result_klass, __result_field, __operator)\
+        case __op: {\
+            FluffObject * dst    = &r[inst->a];\
+            FluffObject   result = { .instance = self->instance, .klass = __result_klass };\
+            result.data.__result_field = (r[inst->b].data.__field __operator r[inst->c].data.__field);\
+            if (dst->klass != klass_int && dst->klass != klass_float && dst->klass != klass_bool) _free_object(dst);\
+            * dst = result;\
+            break;\
+        }
+
+#define VM_REG_TYPED_ARITH_CASES(__name, __operator)\
+        VM_REG_TYPED_CASE(IR_OP_I##__name, _int,   klass_int,   _int,   __operator)\
+        VM_REG_TYPED_CASE(IR_OP_F##__name, _float, klass_float, _float, __operator)
+
+#define VM_REG_TYPED_CMP_CASES(__name, __operator)\
+        VM_REG_TYPED_CASE(IR_OP_I##__name, _int,   klass_bool, _bool, __operator)\
+        VM_REG_TYPED_CASE(IR_OP_F##__name, _float, klass_bool, _bool, __operator)
+
+// NOTE: most operands fit in a single byte, so that case skips the loop
+FLUFF_CONSTEXPR size_t vm_read_uint(const uint8_t * code, size_t * ip) {
+    const uint8_t byte = code[* ip];
+    if (!(byte & 0x80)) {
+        ++(* ip);
+        return byte;
+    }
+    return (size_t)_ir_read_uint(code, ip);
+}
+
+FLUFF_CONSTEXPR int32_t vm_read_i32(const uint8_t * code, size_t * ip) {
+    int32_t v;
+    memcpy(&v, &code[* ip], sizeof(v));
+    * ip += sizeof(v);
+    return v;
+}
+
+// NOTE: chunks are only run along with the binary they were compiled into, so the index is trusted
+FLUFF_CONSTEXPR const IRConstant * vm_read_const(FluffVM * self, const uint8_t * code, size_t * ip) {
+    return &self->binary->constants[vm_read_uint(code, ip)];
+}
+
+FLUFF_CONSTEXPR FluffResult vm_apply_binary(FluffVM * self, VMBinaryFn fn, FluffObject * lhs, FluffObject * rhs, bool is_bool, FluffObject * result) {
+    _new_null_object(result, self->instance, 
+        (is_bool ? fluff_instance_get_core_class(self->instance, FLUFF_KLASS_BOOL) : lhs->klass)
+    );
+    return fn(lhs, rhs, result);
+}
+
+FLUFF_CONSTEXPR FluffResult vm_binary_op(FluffVM * self, VMBinaryFn fn, bool is_bool) {
+    FluffObject * lhs = &self->stack[self->stack_count - 2];
+
+    FluffObject result;
+    if (vm_apply_binary(self, fn, lhs, lhs + 1, is_bool, &result) == FLUFF_FAILURE) return FLUFF_FAILURE;
+
+    _vm_stack_popn(self, 2);
+    self->stack[self->stack_count++] = result;
+    return FLUFF_OK;
+}
+
+// NOTE: rewrites the generic instruction at 'code' into its form for int or float operands, if both match
+FLUFF_CONSTEXPR void vm_quicken_operands(FluffVM * self, uint8_t * code, const FluffObject * lhs, const FluffObject * rhs, uint8_t int_op, uint8_t float_op) {
+    if (lhs->klass != rhs->klass) return;
+    if (lhs->klass == fluff_instance_get_core_class(self->instance, FLUFF_KLASS_INT))
+        * code = int_op;
+    else if (lhs->klass == fluff_instance_get_core_class(self->instance, FLUFF_KLASS_FLOAT))
+        * code = float_op;
+}
+
+FLUFF_CONSTEXPR void vm_quicken(FluffVM * self, uint8_t * code, uint8_t int_op, uint8_t float_op) {
+    const FluffObject * lhs = &self->stack[self->stack_count - 2];
+    vm_quicken_operands(self, code, lhs, lhs + 1, int_op, float_op);
+}
+
+FLUFF_CONSTEXPR FluffResult vm_unary_op(FluffVM * self, VMUnaryFn fn, bool is_bool) {
+    FluffObject * operand = &self->stack[self->stack_count - 1];
+
+    FluffObject result;
+    _new_null_object(&result, self->instance, 
+        (is_bool ? fluff_instance_get_core_class(self->instance, FLUFF_KLASS_BOOL) : operand->klass)
+    );
+    if (fn(operand, &result) == FLUFF_FAILURE) return FLUFF_FAILURE;
+
+    _free_object(operand);
+    * operand = result;
+    return FLUFF_OK;
+}
+
+FLUFF_CONSTEXPR FluffResult vm_pop_condition(FluffVM * self, bool * condition) {
+    FluffObject * obj = &self->stack[self->stack_count - 1];
+    if (obj->klass != fluff_instance_get_core_class(self->instance, FLUFF_KLASS_BOOL)) {
+        fluff_push_error("condition must be of type 'bool', not '%.*s'", 
+            FLUFF_STR_BUFFER_FMT(_class_get_common_data(obj->klass)->name)
+        );
+        return FLUFF_FAILURE;
     }
+    * condition = obj->data._bool;
+    _vm_stack_popn(self, 1);
+    return FLUFF_OK;
 }
 
-FLUFF_PRIVATE_API void _vm_frame_clear(VMFrame * self) {
-    _vm_frame_popn(self, self->entry_count);
+FLUFF_CONSTEXPR FluffResult vm_check_klass(const FluffObject * obj, FluffKlass * klass) {
+    if (obj->klass == klass) return FLUFF_OK;
+    fluff_push_error("expected a value of type '%.*s', found '%.*s'", 
+        FLUFF_STR_BUFFER_FMT(_class_get_common_data(klass)->name), FLUFF_STR_BUFFER_FMT(_class_get_common_data(obj->klass)->name)
+    );
+    return FLUFF_FAILURE;
 }
 
-FLUFF_PRIVATE_API VMEntry * _vm_frame_at(VMFrame * self, int idx) {
-    size_t index = (size_t)(idx < 0 ? -idx : self->entry_count - idx) - 1;
-    if (index > self->entry_count) return NULL;
+// Checks the arguments of a call against the parameters of 'method'.
+// NOTE: parameters of type 'object' or of a class the compiler doesn't know yet take any value
+FLUFF_CONSTEXPR FluffResult vm_check_args(FluffVM * self, const FluffMethod * method, const FluffObject * args, size_t argc) {
+    FluffKlass * const klass_object = fluff_instance_get_core_class(self->instance, FLUFF_KLASS_OBJECT);
+    for (size_t i = 0; i < argc && i < method->property_count; ++i) {
+        FluffKlass * klass = method->properties[i].type;
+        if (!klass || klass == klass_object || args[i].klass == klass) continue;
 
-    VMEntry * entry = self->last_entry;
-    while (index > 0 && entry) {
-        entry = entry->prev;
-        --index;
+        fluff_push_error("argument %zu of '%s' must be of type '%.*s', not '%.*s'", i + 1, method->name,
+            FLUFF_STR_BUFFER_FMT(_class_get_common_data(klass)->name), FLUFF_STR_BUFFER_FMT(_class_get_common_data(args[i].klass)->name)
+        );
+        return FLUFF_FAILURE;
+    }
+    return FLUFF_OK;
+}
+
+// Moves 'value' into a register, dropping what it held.
+FLUFF_CONSTEXPR void vm_reg_move(FluffObject * dst, FluffObject * value) {
+    _free_object(dst);
+    * dst = * value;
+}
+
+FLUFF_CONSTEXPR FluffResult vm_reg_binary_op(FluffVM * self, VMBinaryFn fn, FluffObject * r, const IRRegInstruction * inst, bool is_bool) {
+    FluffObject result;
+    if (vm_apply_binary(self, fn, &r[inst->b], &r[inst->c], is_bool, &result) == FLUFF_FAILURE) return FLUFF_FAILURE;
+    vm_reg_move(&r[inst->a], &result);
+    return FLUFF_OK;
+}
+
+FLUFF_CONSTEXPR FluffResult vm_reg_unary_op(FluffVM * self, VMUnaryFn fn, FluffObject * r, const IRRegInstruction * inst, bool is_bool) {
+    FluffObject * operand = &r[inst->b];
+
+    FluffObject result;
+    _new_null_object(&result, self->instance, 
+        (is_bool ? fluff_instance_get_core_class(self->instance, FLUFF_KLASS_BOOL) : operand->klass)
+    );
+    if (fn(operand, &result) == FLUFF_FAILURE) return FLUFF_FAILURE;
+    vm_reg_move(&r[inst->a], &result);
+    return FLUFF_OK;
+}
+
+// Makes room for the registers of the current frame, the ones past its arguments start empty.
+FLUFF_CONSTEXPR FluffResult vm_enter_registers(FluffVM * self, const IRRegChunk * chunk) {
+    const size_t size = self->current_frame.base + chunk->register_count;
+    if (size <= self->stack_count) return FLUFF_OK;
+    if (_vm_reserve(self, size - self->stack_count) == FLUFF_FAILURE) return FLUFF_FAILURE;
+    FLUFF_CLEANUP_N(&self->stack[self->stack_count], sizeof(FluffObject) * (size - self->stack_count));
+    self->stack_count = size;
+    return FLUFF_OK;
+}
+
+// Counts a call or a loop iteration of 'chunk' for the profile written once the run ends.
+FLUFF_CONSTEXPR void vm_feedback_hot(FluffVM * self, const IRChunk * chunk) {
+    if (self->feedback && chunk->feedback) ++chunk->feedback->hotness;
+}
+
+// Counts a call of 'chunk' for the profile written once the run ends, it's part of its hotness as well.
+FLUFF_CONSTEXPR void vm_feedback_call(FluffVM * self, const IRChunk * chunk) {
+    if (!self->feedback || !chunk->feedback) return;
+    ++chunk->feedback->calls;
+    ++chunk->feedback->hotness;
+}
+
+// Counts the way the conditional jump at 'ip' of the running chunk went, for the profile written once the run ends.
+FLUFF_CONSTEXPR void vm_feedback_branch(FluffVM * self, size_t ip, bool condition) {
+    if (!self->feedback) return;
+    const IRFeedback * feedback = self->current_frame.chunk->feedback;
+    if (feedback && feedback->truthy) ++(condition ? feedback->truthy : feedback->falsy)[ip];
+}
+
+// Counts a call into 'chunk' and tells if it runs as native code, it's compiled the first time it's called while hot.
+// NOTE: native code recurses on the C stack, so frames past the recursion limit stay on the interpreter
+FLUFF_CONSTEXPR bool vm_enter_native(FluffVM * self, IRChunk * chunk, size_t preserve) {
+    vm_feedback_call(self, chunk);
+    if (!self->jit || self->frame_count >= FLUFF_MAX_VM_RECURSION) return false;
+    if (!chunk->native) {
+        if (++chunk->hotness < FLUFF_JIT_THRESHOLD) return false;
+        chunk->native = _jit_compile_chunk(self, chunk, preserve);
+    }
+    const JitCode * native = chunk->native;
+    return native->entry && native->preserve == preserve && native->instance == self->instance;
+}
+
+// Counts a loop iteration of the running chunk, it gets compiled on its next call once it's hot.
+// NOTE: like quickened opcodes, hotness is runtime state kept inside the chunk
+FLUFF_CONSTEXPR void vm_count_backedge(FluffVM * self) {
+    vm_feedback_hot(self, self->current_frame.chunk);
+    if (self->jit) ++((IRChunk *)self->current_frame.chunk)->hotness;
+}
+
+// Counts a loop iteration of the running frame, and tells where it moves into native code at the loop header 'ip'.
+// NOTE: long loops may never get back to a call, so the chunk is compiled and entered from there once it's hot
+FLUFF_CONSTEXPR JitEntryFn vm_enter_osr(FluffVM * self, size_t ip) {
+    vm_feedback_hot(self, self->current_frame.chunk);
+
+    // NOTE: a frame being recorded has to finish its iteration on the interpreter
+    if (!self->jit || self->recorder || self->frame_count >= FLUFF_MAX_VM_RECURSION) return NULL;
+
+    IRChunk * chunk = (IRChunk *)self->current_frame.chunk;
+    if (!chunk->native) {
+        if (++chunk->hotness < FLUFF_JIT_THRESHOLD) return NULL;
+        chunk->native = _jit_compile_chunk(self, chunk, self->current_frame.preserve);
+    }
+
+    const JitCode * native = chunk->native;
+    if (!native->entry || native->preserve != self->current_frame.preserve || native->instance != self->instance) return NULL;
+    return _jit_osr_entry(native, ip, self->stack_count - self->current_frame.base);
+}
+
+// Runs the chunks native code left to tail call in the frame it returned from, until one of them returns for real.
+// NOTE: chunks that don't run natively are handed to the interpreters, which push their own frame in place of it
+FLUFF_CONSTEXPR FluffResult vm_run_tail_call(FluffVM * self) {
+    while (self->tail_call) {
+        IRChunk    * chunk    = self->tail_call;
+        const size_t preserve = self->current_frame.preserve;
+        self->tail_call = NULL;
+
+        if (!vm_enter_native(self, chunk, preserve)) {
+            if (_vm_pop_frame(self, preserve) == FLUFF_FAILURE) return FLUFF_FAILURE;
+            return (chunk->registers ? _vm_run_registers(self, chunk, preserve) : _vm_run(self, chunk, preserve));
+        }
+
+        self->current_frame.chunk = chunk;
+        if (_vm_reserve(self, chunk->native->stack_size + 1 - preserve) == FLUFF_FAILURE) return FLUFF_FAILURE;
+        if (chunk->native->entry(self, &self->stack[self->current_frame.base]) == FLUFF_FAILURE) return FLUFF_FAILURE;
+    }
+    return FLUFF_OK;
+}
+
+// Moves the running frame into native code, which runs it to its end and pops it like RET would.
+// NOTE: the frame keeps its entries, native code only needs the room it reserves up front
+FLUFF_CONSTEXPR FluffResult vm_run_osr(FluffVM * self, JitEntryFn entry) {
+    const JitCode * native = self->current_frame.chunk->native;
+    if (_vm_reserve(self, native->stack_size + 1 - fluff_vm_size(self)) == FLUFF_FAILURE) return FLUFF_FAILURE;
+    if (entry(self, &self->stack[self->current_frame.base]) == FLUFF_FAILURE) return FLUFF_FAILURE;
+    return vm_run_tail_call(self);
+}
+
+// Removes the entry right below the top one, this drops the callee once a native call returns.
+FLUFF_CONSTEXPR void vm_drop_second(FluffVM * self) {
+    FluffObject * top = &self->stack[self->stack_count - 1];
+    _free_object(top - 1);
+    top[-1] = * top;
+    --self->stack_count;
+}
+
+FLUFF_CONSTEXPR const char * vm_method_name(const FluffVM * self, uint64_t method) {
+    return (self->binary && method < self->binary->method_count ? self->binary->methods[method]->name : "?");
+}
+
+FLUFF_CONSTEXPR const char * vm_chunk_name(const FluffVM * self, const IRChunk * chunk) {
+    if (!self->binary || chunk == &self->binary->main_chunk) return "<main>";
+    for (size_t i = 0; i < self->binary->method_count; ++i)
+        if (self->binary->methods[i]->chunk == chunk) return self->binary->methods[i]->name;
+    return "?";
+}
+
+// Names the frames of a run that failed in notes, from the one the error was raised in down to the one it started with.
+// NOTE: 'ip' is past the opcode the running frame stopped on, the others stopped past the call they made, on register
+//       frames both are register instructions mapped back to the stack code
+static void vm_note_frames(const FluffVM * self, size_t entry_frame, size_t ip, bool registers) {
+    const VMFrameSegment * segment = self->frames;
+    const VMFrame        * frame   = &self->current_frame;
+    for (size_t depth = self->frame_count; depth > entry_frame; --depth) {
+        if (self->frame_count - depth == FLUFF_VM_TRACE_FRAMES) {
+            fluff_push_note("... and %zu more frames", depth - entry_frame);
+            return;
+        }
+
+        const IRChunk * chunk = frame->chunk;
+        if (chunk) {
+            size_t address = (ip > 0 ? ip - 1 : 0);
+            if (registers && chunk->registers && address < chunk->registers->size)
+                address = chunk->registers->addresses[address];
+
+            // NOTE: functions inlined into the chunk get the frame they would have had, innermost first
+            const IRInlineSite * sites = NULL;
+            for (size_t i = _ir_chunk_inlined_at(chunk, address, &sites); i-- > 0;)
+                fluff_push_note("in '%s' at %.4zx, inlined", vm_method_name(self, sites[i].method), sites[i].origin);
+            fluff_push_note("in '%s' at %.4zx", vm_chunk_name(self, chunk), address);
+        }
+
+        const size_t slot = (depth - 1) % FLUFF_VM_FRAME_SEGMENT_SIZE;
+        frame = &segment->frames[slot];
+        ip    = frame->ip;
+        if (slot == 0) segment = segment->prev;
     }
-    return entry;
 }
 
 /* -=======
@@ -79,81 +419,74 @@ FLUFF_API void fluff_free_vm(FluffVM * self) {
 }
 
 FLUFF_API FluffObject * fluff_vm_at(FluffVM * self, int idx) {
-    VMEntry * entry = _vm_frame_at(&self->current_frame, idx);
-    if (!entry) return NULL;
-    return &entry->obj;
+    return _vm_stack_at(self, idx);
 }
 
 FLUFF_API FluffResult fluff_vm_push(FluffVM * self, FluffObject * obj) {
-    _vm_frame_push(&self->current_frame, obj);
+    if (_vm_reserve(self, 1) == FLUFF_FAILURE) return FLUFF_FAILURE;
+    _ref_object(&self->stack[self->stack_count++], obj);
     return FLUFF_OK;
 }
 
 FLUFF_API FluffResult fluff_vm_push_object(FluffVM * self, FluffKlass * klass) {
-    FluffObject obj;
-    _new_object(&obj, self->instance, klass);
-    _vm_frame_push(&self->current_frame, &obj);
+    if (_vm_reserve(self, 1) == FLUFF_FAILURE) return FLUFF_FAILURE;
+    _new_object(&self->stack[self->stack_count++], self->instance, klass);
     return FLUFF_OK;
 }
 
 FLUFF_API FluffResult fluff_vm_push_null_object(FluffVM * self, FluffKlass * klass) {
-    FluffObject obj;
-    _new_null_object(&obj, self->instance, klass);
-    _vm_frame_push(&self->current_frame, &obj);
+    if (_vm_reserve(self, 1) == FLUFF_FAILURE) return FLUFF_FAILURE;
+    _new_null_object(&self->stack[self->stack_count++], self->instance, klass);
     return FLUFF_OK;
 }
 
 FLUFF_API FluffResult fluff_vm_push_bool(FluffVM * self, FluffBool v) {
-    FluffObject obj;
-    _new_bool_object(&obj, self->instance, v);
-    _vm_frame_push(&self->current_frame, &obj);
+    if (_vm_reserve(self, 1) == FLUFF_FAILURE) return FLUFF_FAILURE;
+    _new_bool_object(&self->stack[self->stack_count++], self->instance, v);
     return FLUFF_OK;
 }
 
 FLUFF_API FluffResult fluff_vm_push_int(FluffVM * self, FluffInt v) {
-    FluffObject obj;
-    _new_int_object(&obj, self->instance, v);
-    _vm_frame_push(&self->current_frame, &obj);
+    if (_vm_reserve(self, 1) == FLUFF_FAILURE) return FLUFF_FAILURE;
+    _new_int_object(&self->stack[self->stack_count++], self->instance, v);
     return FLUFF_OK;
 }
 
 FLUFF_API FluffResult fluff_vm_push_float(FluffVM * self, FluffFloat v) {
-    FluffObject obj;
-    _new_float_object(&obj, self->instance, v);
-    _vm_frame_push(&self->current_frame, &obj);
+    if (_vm_reserve(self, 1) == FLUFF_FAILURE) return FLUFF_FAILURE;
+    _new_float_object(&self->stack[self->stack_count++], self->instance, v);
     return FLUFF_OK;
 }
 
 FLUFF_API FluffResult fluff_vm_push_string(FluffVM * self, const char * str) {
-    FluffObject obj;
-    _new_string_object(&obj, self->instance, str);
-    _vm_frame_push(&self->current_frame, &obj);
+    if (_vm_reserve(self, 1) == FLUFF_FAILURE) return FLUFF_FAILURE;
+    _new_string_object(&self->stack[self->stack_count++], self->instance, str);
     return FLUFF_OK;
 }
 
 FLUFF_API FluffResult fluff_vm_push_string_n(FluffVM * self, const char * str, size_t len) {
-    FluffObject obj;
-    _new_string_object_n(&obj, self->instance, str, len);
-    _vm_frame_push(&self->current_frame, &obj);
+    if (_vm_reserve(self, 1) == FLUFF_FAILURE) return FLUFF_FAILURE;
+    _new_string_object_n(&self->stack[self->stack_count++], self->instance, str, len);
     return FLUFF_OK;
 }
 
 FLUFF_API FluffResult fluff_vm_pop(FluffVM * self) {
-    _vm_frame_pop(&self->current_frame);
+    _vm_stack_popn(self, 1);
     return FLUFF_OK;
 }
 
 FLUFF_API FluffResult fluff_vm_popn(FluffVM * self, size_t n) {
-    _vm_frame_popn(&self->current_frame, n);
+    _vm_stack_popn(self, n);
     return FLUFF_OK;
 }
 
 FLUFF_API size_t fluff_vm_top(FluffVM * self) {
-    return (self->current_frame.entry_count > 0 ? self->current_frame.entry_count - 1 : 0);
+    const size_t size = fluff_vm_size(self);
+    return (size > 0 ? size - 1 : 0);
 }
 
 FLUFF_API size_t fluff_vm_size(FluffVM * self) {
-    return self->current_frame.entry_count;
+    return self->stack_count - self->current_frame.base;
 }
 
 FLUFF_API size_t fluff_vm_frame_top(FluffVM * self) {
@@ -164,108 +497,987 @@ FLUFF_API size_t fluff_vm_frame_size(FluffVM * self) {
     return self->frame_count;
 }
 
-FLUFF_PRIVATE_API FluffResult fluff_vm_invoke(FluffVM * self, FluffObject * object, size_t argc) {
+FLUFF_API FluffResult fluff_vm_invoke(FluffVM * self, FluffObject * object, size_t argc) {
     FluffMethod * method = object->data._method;
     if (!method) {
         fluff_push_error("attempt to call a null method");
         return FLUFF_FAILURE;
     }
+    // NOTE: values coming from the host were never seen by the compiler, so they're always checked
+    if (vm_check_args(self, method, &self->stack[self->stack_count - argc], argc) == FLUFF_FAILURE) return FLUFF_FAILURE;
     if (method->callback) {
-        // TODO: typechecking
-        _vm_push_frame(self, argc);
-        FluffResult res = method->callback(self, argc);
-        // TODO: make void functions not return anything
-        _vm_pop_frame(self, 1);
+        if (_vm_push_frame(self, argc) == FLUFF_FAILURE) return FLUFF_FAILURE;
+        const FluffResult res = method->callback(self, argc);
+        // NOTE: functions that return nothing still leave a void object, so every call yields one value
+        if (res == FLUFF_OK && fluff_vm_size(self) <= argc)
+            fluff_vm_push_null_object(self, fluff_instance_get_core_class(self->instance, FLUFF_KLASS_VOID));
+        _vm_pop_frame(self, (res == FLUFF_OK ? 1 : 0));
         return res;
     }
+    if (method->chunk) {
+        // NOTE: the chunk reads its parameters from fixed slots, so a call with more or less of them can't run
+        if (argc != method->property_count) {
+            fluff_push_error("function '%s' expects %zu arguments, got %zu", method->name, method->property_count, argc);
+            return FLUFF_FAILURE;
+        }
+
+        // NOTE: IR frames keep the callee below their arguments
+        if (_vm_reserve(self, 1) == FLUFF_FAILURE) return FLUFF_FAILURE;
+        FluffObject * args = &self->stack[self->stack_count - argc];
+        memmove(args + 1, args, sizeof(FluffObject) * argc);
+        _new_function_object(args, self->instance, method);
+        ++method->ref_count;
+        ++self->stack_count;
+        return _vm_run_chunk(self, method->chunk, argc + 1);
+    }
     fluff_push_error("attempt to call an incomplete method ('%s')", method->name);
     return FLUFF_FAILURE;
 }
 
+/* -=- Instructions -=- */
+FLUFF_API FluffResult fluff_vm_reserve(FluffVM * self, size_t count) {
+    return _vm_reserve(self, count);
+}
+
+FLUFF_API FluffResult fluff_vm_push_function(FluffVM * self, FluffMethod * method) {
+    FluffObject obj;
+    _new_function_object(&obj, self->instance, method);
+    return fluff_vm_push(self, &obj);
+}
+
+FLUFF_API FluffResult fluff_vm_get_local(FluffVM * self, size_t idx) {
+    if (_vm_reserve(self, 1) == FLUFF_FAILURE) return FLUFF_FAILURE;
+    _ref_object(&self->stack[self->stack_count], &self->stack[self->current_frame.base + idx]);
+    ++self->stack_count;
+    return FLUFF_OK;
+}
+
+FLUFF_API FluffResult fluff_vm_set_local(FluffVM * self, size_t idx) {
+    FluffObject * local = &self->stack[self->current_frame.base + idx];
+    FluffObject * top   = &self->stack[self->stack_count - 1];
+    if (local != top) {
+        _free_object(local);
+        _ref_object(local, top);
+    }
+    return FLUFF_OK;
+}
+
+// NOTE: the top entry is moved into the local rather than referenced and then popped
+FLUFF_API FluffResult fluff_vm_store_local(FluffVM * self, size_t idx) {
+    FluffObject * local = &self->stack[self->current_frame.base + idx];
+    FluffObject * top   = &self->stack[self->stack_count - 1];
+    if (local == top) {
+        _vm_stack_popn(self, 1);
+        return FLUFF_OK;
+    }
+
+    _free_object(local);
+    * local = * top;
+    --self->stack_count;
+    return FLUFF_OK;
+}
+
+FLUFF_API FluffResult fluff_vm_binary(FluffVM * self, FluffBinaryFn fn, bool is_bool) {
+    return vm_binary_op(self, fn, is_bool);
+}
+
+FLUFF_API FluffResult fluff_vm_unary(FluffVM * self, FluffUnaryFn fn, bool is_bool) {
+    return vm_unary_op(self, fn, is_bool);
+}
+
+FLUFF_API FluffResult fluff_vm_pop_condition(FluffVM * self, bool * condition) {
+    return vm_pop_condition(self, condition);
+}
+
+FLUFF_API FluffResult fluff_vm_check(FluffVM * self, FluffKlass * klass) {
+    return vm_check_klass(&self->stack[self->stack_count - 1], klass);
+}
+
+FLUFF_API FluffResult fluff_vm_is(FluffVM * self, FluffKlass * klass) {
+    FluffObject * top = &self->stack[self->stack_count - 1];
+    const bool    is  = (klass && top->klass && fluff_object_is_same_class(top, klass));
+    _free_object(top);
+    _new_bool_object(top, self->instance, is);
+    return FLUFF_OK;
+}
+
+// NOTE: the converted object is moved into the stack, only its box is freed
+FLUFF_API FluffResult fluff_vm_as(FluffVM * self, FluffKlass * klass) {
+    FluffObject * top = &self->stack[self->stack_count - 1];
+    FluffObject * obj = fluff_object_as(top, klass);
+    if (!obj) return FLUFF_FAILURE;
+
+    _free_object(top);
+    * top = * obj;
+    fluff_free(obj);
+    return FLUFF_OK;
+}
+
+FLUFF_API FluffResult fluff_vm_call(FluffVM * self, size_t argc) {
+    return _vm_call(self, argc, false);
+}
+
+FLUFF_API FluffResult fluff_vm_reenter(FluffVM * self, size_t argc, bool typed) {
+    if (argc + 1 > self->stack_count - self->current_frame.base) {
+        fluff_push_error("attempted to reenter with %zu arguments on a %zu entry frame",
+            argc, self->stack_count - self->current_frame.base
+        );
+        return FLUFF_FAILURE;
+    }
+
+    FluffObject * callee = &self->stack[self->stack_count - argc - 1];
+    if (!typed && vm_check_args(self, callee->data._method, callee + 1, argc) == FLUFF_FAILURE) return FLUFF_FAILURE;
+    _vm_replace_frame(self, argc);
+    return FLUFF_OK;
+}
+
 FLUFF_PRIVATE_API void _new_vm(FluffVM * self, FluffInstance * instance, FluffModule * module) {
     FLUFF_CLEANUP(self);
     self->instance = instance;
     self->module   = module;
+    self->jit      = (FLUFF_JIT_AVAILABLE && fluff_get_config().jit);
+    self->tracing  = (FLUFF_JIT_AVAILABLE && fluff_get_config().trace_jit);
+    self->feedback = (fluff_get_config().pgo_out != NULL);
 }
 
 FLUFF_PRIVATE_API void _free_vm(FluffVM * self) {
+    if (self->recorder) _trace_abort(self);
     _vm_clear_frames(self);
+    if (self->stack) fluff_free(self->stack);
     FLUFF_CLEANUP(self);
 }
 
-FLUFF_PRIVATE_API FluffResult _vm_push_frame(FluffVM * self, size_t preserve) {
-    if (preserve > self->current_frame.entry_count) {
-        fluff_push_error("attempted to preserve %zu entries on a %zu entry frame", 
-            preserve, self->current_frame.entry_count
-        );
+/* -=- Stack -=- */
+FLUFF_PRIVATE_API FluffResult _vm_reserve(FluffVM * self, size_t count) {
+    const size_t size = self->stack_count + count;
+    if (size <= self->stack_capacity) return FLUFF_OK;
+    if (size > FLUFF_MAX_VM_STACK) {
+        fluff_push_error("stack overflow (more than %d entries)", FLUFF_MAX_VM_STACK);
         return FLUFF_FAILURE;
     }
 
-    if (self->frame_count >= self->frame_capacity)
-        self->frames = fluff_alloc(self->frames, sizeof(VMFrame) * (++self->frame_capacity));
+    // NOTE: pointers to entries don't survive a push, they have to be taken again afterwards
+    self->stack_capacity = FLUFF_MIN(FLUFF_MAX(FLUFF_MAX(self->stack_capacity * 2, size), VM_MIN_STACK_CAPACITY), FLUFF_MAX_VM_STACK);
+    self->stack          = fluff_alloc(self->stack, sizeof(FluffObject) * self->stack_capacity);
+    return FLUFF_OK;
+}
+
+FLUFF_PRIVATE_API FluffObject * _vm_stack_at(FluffVM * self, int idx) {
+    const size_t size  = fluff_vm_size(self);
+    const size_t index = (idx < 0 ? size - (size_t)(-idx) : (size_t)idx);
+    if (index >= size) return NULL;
+    return &self->stack[self->current_frame.base + index];
+}
+
+FLUFF_PRIVATE_API void _vm_stack_popn(FluffVM * self, size_t count) {
+    count = FLUFF_MIN(count, fluff_vm_size(self));
+    while (count-- > 0)
+        _free_object(&self->stack[--self->stack_count]);
+}
+
+/* -=- Execution -=- */
+FLUFF_PRIVATE_API FluffResult _vm_execute(FluffVM * self, IRBinary * binary) {
+    self->binary = binary;
+    if (self->feedback) _pgo_record_binary(binary);
+    return _vm_run_chunk(self, &binary->main_chunk, 0);
+}
+
+#define _vm_error(...) {\
+            fluff_push_error(__VA_ARGS__);\
+            goto failure;\
+        }
+
+#define _vm_try(__expr) {\
+            if ((__expr) == FLUFF_FAILURE) goto failure;\
+        }
+
+FLUFF_PRIVATE_API FluffResult _vm_run(FluffVM * self, const IRChunk * chunk, size_t preserve) {
+    const size_t entry_frame = self->frame_count;
+    if (_vm_push_frame(self, preserve) == FLUFF_FAILURE) return FLUFF_FAILURE;
+    self->current_frame.chunk = chunk;
+
+    // NOTE: not const, quickening rewrites opcodes in place
+    uint8_t * code = chunk->data;
+    size_t    size = chunk->size;
+    size_t    ip   = 0;
+
+    FluffKlass * const klass_bool  = fluff_instance_get_core_class(self->instance, FLUFF_KLASS_BOOL);
+    FluffKlass * const klass_int   = fluff_instance_get_core_class(self->instance, FLUFF_KLASS_INT);
+    FluffKlass * const klass_float = fluff_instance_get_core_class(self->instance, FLUFF_KLASS_FLOAT);
+
+    while (true) {
+#ifdef FLUFF_VM_PROFILE
+        ++self->executed;
+        if (self->trace_fn && ip < size) self->trace_fn(self->trace_data, self->current_frame.chunk, ip);
+#endif
+        if (self->recorder) _trace_record(self, ip);
+
+        // NOTE: running off the end of a chunk returns nothing
+        uint8_t op = IR_OP_RET;
+        if (ip < size) op = code[ip++];
+        else _vm_try(fluff_vm_push_null_object(self, fluff_instance_get_core_class(self->instance, FLUFF_KLASS_VOID)));
 
-    VMFrame * last_frame = &self->frames[self->frame_count++];
+        switch (op) {
+            case IR_OP_NOP: break;
+            case IR_OP_JMP:
+            case IR_OP_JMP_S: {
+                const int32_t offset = (op == IR_OP_JMP ? vm_read_i32(code, &ip) : (int8_t)code[ip++]);
+                ip += offset;
+                if (offset >= 0) break;
 
-    VMEntry * top_entry    = NULL;
-    VMEntry * bottom_entry = NULL;
-    if (preserve != 0) {
-        top_entry    = _vm_frame_at(&self->current_frame, -((int)preserve));
-        bottom_entry = self->current_frame.last_entry;
-        
-        self->current_frame.entry_count -= preserve;
-        self->current_frame.last_entry   = top_entry->prev;
-        top_entry->prev                  = NULL;
+                const JitEntryFn osr = vm_enter_osr(self, ip);
+                if (osr) {
+                    const bool done = (self->frame_count == entry_frame + 1);
+                    _vm_try(vm_run_osr(self, osr));
+                    if (done) return FLUFF_OK;
+
+                    code = self->current_frame.chunk->data;
+                    size = self->current_frame.chunk->size;
+                    ip   = self->current_frame.ip;
+                    break;
+                }
+                if (self->tracing) _vm_try(_trace_run_loop(self, &ip));
+                break;
+            }
+            case IR_OP_JZ:
+            case IR_OP_JNZ: {
+                const int32_t offset = vm_read_i32(code, &ip);
+                bool condition = false;
+                _vm_try(vm_pop_condition(self, &condition));
+                vm_feedback_branch(self, ip - sizeof(int32_t) - sizeof(IROpcode), condition);
+                if (condition == (op == IR_OP_JNZ)) ip += offset;
+                break;
+            }
+            case IR_OP_JZ_S:
+            case IR_OP_JNZ_S: {
+                const int8_t offset = (int8_t)code[ip++];
+                bool condition = false;
+                _vm_try(vm_pop_condition(self, &condition));
+                vm_feedback_branch(self, ip - sizeof(int8_t) - sizeof(IROpcode), condition);
+                if (condition == (op == IR_OP_JNZ_S)) ip += offset;
+                break;
+            }
+            // NOTE: LT always yields a bool, so its result doesn't go through the stack
+            case IR_OP_LT_JZ:
+            case IR_OP_LT_JZ_S: {
+                FluffObject * lhs = &self->stack[self->stack_count - 2];
+                if (lhs->klass == klass_int && lhs[1].klass == klass_int)
+                    code[ip - 1] = (op == IR_OP_LT_JZ ? IR_OP_LT_JZ_INT : IR_OP_LT_JZ_INT_S);
+
+                const int32_t offset = (op == IR_OP_LT_JZ ? vm_read_i32(code, &ip) : (int8_t)code[ip++]);
+                FluffObject   result;
+                _vm_try(vm_apply_binary(self, fluff_object_lt, lhs, lhs + 1, true, &result));
+                _vm_stack_popn(self, 2);
+                vm_feedback_branch(self, ip - (op == IR_OP_LT_JZ ? sizeof(int32_t) : sizeof(int8_t)) - sizeof(IROpcode), result.data._bool);
+                if (!result.data._bool) ip += offset;
+                break;
+            }
+            case IR_OP_LT_JZ_INT:
+            case IR_OP_LT_JZ_INT_S: {
+                FluffObject * lhs = &self->stack[self->stack_count - 2];
+                if (lhs->klass != klass_int || lhs[1].klass != klass_int) {
+                    code[--ip] = (op == IR_OP_LT_JZ_INT ? IR_OP_LT_JZ : IR_OP_LT_JZ_S);
+                    break;
+                }
+
+                const int32_t offset    = (op == IR_OP_LT_JZ_INT ? vm_read_i32(code, &ip) : (int8_t)code[ip++]);
+                const bool    condition = (lhs->data._int < lhs[1].data._int);
+                self->stack_count -= 2;
+                vm_feedback_branch(self, ip - (op == IR_OP_LT_JZ_INT ? sizeof(int32_t) : sizeof(int8_t)) - sizeof(IROpcode), condition);
+                if (!condition) ip += offset;
+                break;
+            }
+            case IR_OP_ILT_JZ:
+            case IR_OP_ILT_JZ_S:
+            case IR_OP_ILT_JNZ:
+            case IR_OP_ILT_JNZ_S: {
+                const bool          wide      = (op == IR_OP_ILT_JZ || op == IR_OP_ILT_JNZ);
+                const FluffObject * lhs       = &self->stack[self->stack_count - 2];
+                const int32_t       offset    = (wide ? vm_read_i32(code, &ip) : (int8_t)code[ip++]);
+                const bool          condition = (lhs->data._int < lhs[1].data._int);
+                self->stack_count -= 2;
+                vm_feedback_branch(self, ip - (wide ? sizeof(int32_t) : sizeof(int8_t)) - sizeof(IROpcode), condition);
+                if (condition == (op == IR_OP_ILT_JNZ || op == IR_OP_ILT_JNZ_S)) ip += offset;
+                break;
+            }
+            case IR_OP_PUSH_VOID: {
+                _vm_try(fluff_vm_push_null_object(self, fluff_instance_get_core_class(self->instance, FLUFF_KLASS_VOID)));
+                break;
+            }
+            case IR_OP_PUSH_TRUE:
+            case IR_OP_PUSH_FALSE: {
+                _vm_try(fluff_vm_push_bool(self, (op == IR_OP_PUSH_TRUE)));
+                break;
+            }
+            case IR_OP_PUSH_INT: {
+                _vm_try(fluff_vm_push_int(self, vm_read_const(self, code, &ip)->data.i));
+                break;
+            }
+            case IR_OP_PUSH_FLOAT: {
+                _vm_try(fluff_vm_push_float(self, vm_read_const(self, code, &ip)->data.f));
+                break;
+            }
+            case IR_OP_PUSH_STRING: {
+                const FluffString * str = &vm_read_const(self, code, &ip)->data.s;
+                _vm_try(fluff_vm_push_string_n(self, str->data, str->length));
+                break;
+            }
+            case IR_OP_PUSH_FUNC: {
+                const size_t index = vm_read_uint(code, &ip);
+                if (!self->binary || index >= self->binary->method_count)
+                    _vm_error("attempt to push an unknown function (%zu)", index);
+
+                FluffObject obj;
+                _new_function_object(&obj, self->instance, self->binary->methods[index]);
+                _vm_try(fluff_vm_push(self, &obj));
+                break;
+            }
+            case IR_OP_POP: {
+                _vm_stack_popn(self, 1);
+                break;
+            }
+            case IR_OP_POPN: {
+                _vm_stack_popn(self, vm_read_uint(code, &ip));
+                break;
+            }
+            case IR_OP_SET_LOCAL:
+            VM_NIBBLE_CASES(IR_OP_SET_LOCAL_N) {
+                const size_t  slot  = (op == IR_OP_SET_LOCAL ? vm_read_uint(code, &ip) : (size_t)(op & IR_OP_NIBBLE_MASK));
+                FluffObject * local = &self->stack[self->current_frame.base + slot];
+                FluffObject * top   = &self->stack[self->stack_count - 1];
+                if (local != top) {
+                    _free_object(local);
+                    _ref_object(local, top);
+                }
+                break;
+            }
+            case IR_OP_GET_LOCAL:
+            VM_NIBBLE_CASES(IR_OP_GET_LOCAL_N) {
+                const size_t slot = (op == IR_OP_GET_LOCAL ? vm_read_uint(code, &ip) : (size_t)(op & IR_OP_NIBBLE_MASK));
+                _vm_try(_vm_reserve(self, 1));
+                _ref_object(&self->stack[self->stack_count], &self->stack[self->current_frame.base + slot]);
+                ++self->stack_count;
+                break;
+            }
+            case IR_OP_STORE_LOCAL: {
+                FluffObject * local = &self->stack[self->current_frame.base + vm_read_uint(code, &ip)];
+                FluffObject * top   = &self->stack[self->stack_count - 1];
+                if (local == top) {
+                    _vm_stack_popn(self, 1);
+                    break;
+                }
+
+                // NOTE: the top entry is moved into the local rather than referenced and then popped
+                _free_object(local);
+                * local = * top;
+                --self->stack_count;
+                break;
+            }
+            // NOTE: the constant is always an int, so an int on the other side needs no class dispatch
+            case IR_OP_INC_LOCAL: {
+                FluffObject * local = &self->stack[self->current_frame.base + vm_read_uint(code, &ip)];
+                const FluffInt v    = vm_read_const(self, code, &ip)->data.i;
+                if (local->klass == klass_int) {
+                    local->data._int += v;
+                    break;
+                }
+
+                FluffObject rhs, result;
+                _new_int_object(&rhs, self->instance, v);
+                _vm_try(vm_apply_binary(self, fluff_object_add, local, &rhs, false, &result));
+                _free_object(local);
+                * local = result;
+                break;
+            }
+            case IR_OP_ADD_LOCALS: {
+                _vm_try(_vm_reserve(self, 1));
+                FluffObject * lhs = &self->stack[self->current_frame.base + vm_read_uint(code, &ip)];
+                FluffObject * rhs = &self->stack[self->current_frame.base + vm_read_uint(code, &ip)];
+                if (lhs->klass == klass_int && rhs->klass == klass_int) {
+                    _new_int_object(&self->stack[self->stack_count++], self->instance, lhs->data._int + rhs->data._int);
+                    break;
+                }
+                _vm_try(vm_apply_binary(self, fluff_object_add, lhs, rhs, false, &self->stack[self->stack_count]));
+                ++self->stack_count;
+                break;
+            }
+            case IR_OP_ADD_INT:
+            case IR_OP_SUB_INT: {
+                FluffObject  * lhs = &self->stack[self->stack_count - 1];
+                const FluffInt v   = vm_read_const(self, code, &ip)->data.i;
+                if (lhs->klass == klass_int) {
+                    lhs->data._int = (op == IR_OP_ADD_INT ? lhs->data._int + v : lhs->data._int - v);
+                    break;
+                }
+
+                FluffObject rhs, result;
+                _new_int_object(&rhs, self->instance, v);
+                _vm_try(vm_apply_binary(self, (op == IR_OP_ADD_INT ? fluff_object_add : fluff_object_sub), lhs, &rhs, false, &result));
+                _free_object(lhs);
+                * lhs = result;
+                break;
+            }
+            case IR_OP_ADD: {
+                vm_quicken(self, &code[ip - 1], IR_OP_ADD_INT_INT, IR_OP_ADD_FLOAT_FLOAT);
+                _vm_try(vm_binary_op(self, fluff_object_add, false));
+                break;
+            }
+            case IR_OP_SUB: {
+                vm_quicken(self, &code[ip - 1], IR_OP_SUB_INT_INT, IR_OP_SUB_FLOAT_FLOAT);
+                _vm_try(vm_binary_op(self, fluff_object_sub, false));
+                break;
+            }
+            case IR_OP_MUL: {
+                vm_quicken(self, &code[ip - 1], IR_OP_MUL_INT_INT, IR_OP_MUL_FLOAT_FLOAT);
+                _vm_try(vm_binary_op(self, fluff_object_mul, false));
+                break;
+            }
+            case IR_OP_DIV:     { _vm_try(vm_binary_op(self, fluff_object_div, false)); break; }
+            case IR_OP_MOD:     { _vm_try(vm_binary_op(self, fluff_object_mod, false)); break; }
+            case IR_OP_POW:     { _vm_try(vm_binary_op(self, fluff_object_pow, false)); break; }
+            case IR_OP_BIT_AND: { _vm_try(vm_binary_op(self, fluff_object_bit_and, false)); break; }
+            case IR_OP_BIT_OR:  { _vm_try(vm_binary_op(self, fluff_object_bit_or, false)); break; }
+            case IR_OP_BIT_XOR: { _vm_try(vm_binary_op(self, fluff_object_bit_xor, false)); break; }
+            case IR_OP_BIT_SHL: { _vm_try(vm_binary_op(self, fluff_object_bit_shl, false)); break; }
+            case IR_OP_BIT_SHR: { _vm_try(vm_binary_op(self, fluff_object_bit_shr, false)); break; }
+            case IR_OP_EQ: {
+                vm_quicken(self, &code[ip - 1], IR_OP_EQ_INT_INT, IR_OP_EQ_FLOAT_FLOAT);
+                _vm_try(vm_binary_op(self, fluff_object_eq, true));
+                break;
+            }
+            case IR_OP_NE: {
+                vm_quicken(self, &code[ip - 1], IR_OP_NE_INT_INT, IR_OP_NE_FLOAT_FLOAT);
+                _vm_try(vm_binary_op(self, fluff_object_ne, true));
+                break;
+            }
+            case IR_OP_GT: {
+                vm_quicken(self, &code[ip - 1], IR_OP_GT_INT_INT, IR_OP_GT_FLOAT_FLOAT);
+                _vm_try(vm_binary_op(self, fluff_object_gt, true));
+                break;
+            }
+            case IR_OP_GE: {
+                vm_quicken(self, &code[ip - 1], IR_OP_GE_INT_INT, IR_OP_GE_FLOAT_FLOAT);
+                _vm_try(vm_binary_op(self, fluff_object_ge, true));
+                break;
+            }
+            case IR_OP_LT: {
+                vm_quicken(self, &code[ip - 1], IR_OP_LT_INT_INT, IR_OP_LT_FLOAT_FLOAT);
+                _vm_try(vm_binary_op(self, fluff_object_lt, true));
+                break;
+            }
+            case IR_OP_LE: {
+                vm_quicken(self, &code[ip - 1], IR_OP_LE_INT_INT, IR_OP_LE_FLOAT_FLOAT);
+                _vm_try(vm_binary_op(self, fluff_object_le, true));
+                break;
+            }
+            case IR_OP_AND:     { _vm_try(vm_binary_op(self, fluff_object_and, true)); break; }
+            case IR_OP_OR:      { _vm_try(vm_binary_op(self, fluff_object_or, true)); break; }
+            case IR_OP_BIT_NOT: { _vm_try(vm_unary_op(self, fluff_object_bit_not, false)); break; }
+            case IR_OP_NEGATE:  { _vm_try(vm_unary_op(self, fluff_object_negate, false)); break; }
+            case IR_OP_NOT:     { _vm_try(vm_unary_op(self, fluff_object_not, true)); break; }
+            case IR_OP_PROMOTE: break;
+            VM_QUICK_ARITH_CASES(ADD, +)
+            VM_QUICK_ARITH_CASES(SUB, -)
+            VM_QUICK_ARITH_CASES(MUL, *)
+            VM_QUICK_CMP_CASES(EQ, ==)
+            VM_QUICK_CMP_CASES(NE, !=)
+            VM_QUICK_CMP_CASES(GT, >)
+            VM_QUICK_CMP_CASES(GE, >=)
+            VM_QUICK_CMP_CASES(LT, <)
+            VM_QUICK_CMP_CASES(LE, <=)
+            VM_TYPED_ARITH_CASES(ADD, +)
+            VM_TYPED_ARITH_CASES(SUB, -)
+            VM_TYPED_ARITH_CASES(MUL, *)
+            VM_TYPED_CMP_CASES(EQ, ==)
+            VM_TYPED_CMP_CASES(NE, !=)
+            VM_TYPED_CMP_CASES(GT, >)
+            VM_TYPED_CMP_CASES(GE, >=)
+            VM_TYPED_CMP_CASES(LT, <)
+            VM_TYPED_CMP_CASES(LE, <=)
+            case IR_OP_CHECK: {
+                FluffKlass * klass = vm_read_const(self, code, &ip)->data.klass;
+                _vm_try(vm_check_klass(&self->stack[self->stack_count - 1], klass));
+                break;
+            }
+            case IR_OP_IS: {
+                _vm_try(fluff_vm_is(self, vm_read_const(self, code, &ip)->data.klass));
+                break;
+            }
+            case IR_OP_AS: {
+                _vm_try(fluff_vm_as(self, vm_read_const(self, code, &ip)->data.klass));
+                break;
+            }
+            // NOTE: a tail call that can't reuse the frame returns through the RET after it
+            case IR_OP_CALL:
+            case IR_OP_TAIL_CALL:
+            VM_NIBBLE_CASES(IR_OP_CALL_N) {
+                const bool    tail   = (op == IR_OP_TAIL_CALL);
+                const size_t  argc   = (op == IR_OP_CALL || tail ? vm_read_uint(code, &ip) : (size_t)(op & IR_OP_NIBBLE_MASK));
+                FluffObject * callee = &self->stack[self->stack_count - argc - 1];
+                if (callee->klass != fluff_instance_get_core_class(self->instance, FLUFF_KLASS_FUNC) || !callee->data._method)
+                    _vm_error("attempt to call an object of type '%.*s'", 
+                        FLUFF_STR_BUFFER_FMT(_class_get_common_data(callee->klass)->name)
+                    );
+
+                FluffMethod * method = callee->data._method;
+                if (!method->chunk) {
+                    _vm_try(fluff_vm_invoke(self, callee, argc));
+                    vm_drop_second(self);
+                    break;
+                }
+                if (argc != method->property_count)
+                    _vm_error("function '%s' expects %zu arguments, got %zu", method->name, method->property_count, argc);
+                if (!self->current_frame.chunk->typed) _vm_try(vm_check_args(self, method, callee + 1, argc));
+                if (vm_enter_native(self, method->chunk, argc + 1)) {
+                    _vm_try(_vm_run_native(self, method->chunk, argc + 1));
+                    break;
+                }
+
+                if (tail) {
+                    _vm_replace_frame(self, argc + 1);
+                } else {
+                    self->current_frame.ip = ip;
+                    _vm_try(_vm_push_frame(self, argc + 1));
+                }
+                self->current_frame.chunk = method->chunk;
+
+                code = method->chunk->data;
+                size = method->chunk->size;
+                ip   = 0;
+                break;
+            }
+            case IR_OP_RET: {
+                const bool done = (self->frame_count == entry_frame + 1);
+                _vm_try(_vm_pop_frame(self, 1));
+                if (done) return FLUFF_OK;
+
+                code = self->current_frame.chunk->data;
+                size = self->current_frame.chunk->size;
+                ip   = self->current_frame.ip;
+                break;
+            }
+            default: _vm_error("unsupported opcode 0x%.2x", op);
+        }
     }
 
-    * last_frame = self->current_frame;
+failure:
+    if (self->recorder) _trace_abort(self);
+    vm_note_frames(self, entry_frame, ip, false);
+    while (self->frame_count > entry_frame)
+        _vm_pop_frame(self, 0);
+    return FLUFF_FAILURE;
+}
+
+// NOTE: register frames keep the layout of stack ones, so they call into each other through the same stack
+FLUFF_PRIVATE_API FluffResult _vm_run_registers(FluffVM * self, const IRChunk * chunk, size_t preserve) {
+    const size_t entry_frame = self->frame_count;
+    if (_vm_push_frame(self, preserve) == FLUFF_FAILURE) return FLUFF_FAILURE;
+    self->current_frame.chunk = chunk;
 
-    if (preserve != 0) {
-        self->current_frame.last_entry  = bottom_entry;
-        self->current_frame.entry_count = preserve;
+    // NOTE: not const, quickening rewrites opcodes in place
+    IRRegInstruction * code = chunk->registers->code;
+    size_t             ip   = 0;
+    _vm_try(vm_enter_registers(self, chunk->registers));
+
+    // NOTE: the registers move along with the stack, so 'r' is taken again whenever it may grow
+    FluffObject * r = &self->stack[self->current_frame.base];
+
+    FluffKlass * const klass_bool  = fluff_instance_get_core_class(self->instance, FLUFF_KLASS_BOOL);
+    FluffKlass * const klass_int   = fluff_instance_get_core_class(self->instance, FLUFF_KLASS_INT);
+    FluffKlass * const klass_float = fluff_instance_get_core_class(self->instance, FLUFF_KLASS_FLOAT);
+
+    while (true) {
+#ifdef FLUFF_VM_PROFILE
+        ++self->executed;
+#endif
+
+        IRRegInstruction * inst = &code[ip++];
+        switch (inst->op) {
+            case IR_OP_JMP: {
+                if (inst->x < 0) vm_count_backedge(self);
+                ip += inst->x;
+                break;
+            }
+            case IR_OP_JZ:
+            case IR_OP_JNZ: {
+                const FluffObject * obj = &r[inst->a];
+                if (obj->klass != klass_bool)
+                    _vm_error("condition must be of type 'bool', not '%.*s'",
+                        FLUFF_STR_BUFFER_FMT(_class_get_common_data(obj->klass)->name)
+                    );
+                if (obj->data._bool == (inst->op == IR_OP_JNZ)) ip += inst->x;
+                break;
+            }
+            case IR_OP_LT_JZ: {
+                FluffObject * lhs = &r[inst->b], * rhs = &r[inst->c];
+                if (lhs->klass == klass_int && rhs->klass == klass_int) inst->op = IR_OP_LT_JZ_INT;
+
+                FluffObject result;
+                _vm_try(vm_apply_binary(self, fluff_object_lt, lhs, rhs, true, &result));
+                if (!result.data._bool) ip += inst->x;
+                break;
+            }
+            case IR_OP_LT_JZ_INT: {
+                const FluffObject * lhs = &r[inst->b], * rhs = &r[inst->c];
+                if (lhs->klass != klass_int || rhs->klass != klass_int) {
+                    inst->op = IR_OP_LT_JZ;
+                    --ip;
+                    break;
+                }
+                if (!(lhs->data._int < rhs->data._int)) ip += inst->x;
+                break;
+            }
+            case IR_OP_ILT_JZ:
+            case IR_OP_ILT_JNZ: {
+                if ((r[inst->b].data._int < r[inst->c].data._int) == (inst->op == IR_OP_ILT_JNZ)) ip += inst->x;
+                break;
+            }
+            case IR_OP_PUSH_VOID: {
+                _free_object(&r[inst->a]);
+                _new_null_object(&r[inst->a], self->instance, fluff_instance_get_core_class(self->instance, FLUFF_KLASS_VOID));
+                break;
+            }
+            case IR_OP_PUSH_TRUE:
+            case IR_OP_PUSH_FALSE: {
+                _free_object(&r[inst->a]);
+                _new_bool_object(&r[inst->a], self->instance, (inst->op == IR_OP_PUSH_TRUE));
+                break;
+            }
+            case IR_OP_PUSH_INT: {
+                _free_object(&r[inst->a]);
+                _new_int_object(&r[inst->a], self->instance, self->binary->constants[inst->x].data.i);
+                break;
+            }
+            case IR_OP_PUSH_FLOAT: {
+                _free_object(&r[inst->a]);
+                _new_float_object(&r[inst->a], self->instance, self->binary->constants[inst->x].data.f);
+                break;
+            }
+            case IR_OP_PUSH_STRING: {
+                const FluffString * str = &self->binary->constants[inst->x].data.s;
+                _free_object(&r[inst->a]);
+                _new_string_object_n(&r[inst->a], self->instance, str->data, str->length);
+                break;
+            }
+            case IR_OP_PUSH_FUNC: {
+                const size_t index = (size_t)inst->x;
+                if (!self->binary || index >= self->binary->method_count)
+                    _vm_error("attempt to push an unknown function (%zu)", index);
+
+                _free_object(&r[inst->a]);
+                _new_function_object(&r[inst->a], self->instance, self->binary->methods[index]);
+                ++self->binary->methods[index]->ref_count;
+                break;
+            }
+            case IR_OP_GET_LOCAL: {
+                if (inst->a == inst->b) break;
+                _free_object(&r[inst->a]);
+                _ref_object(&r[inst->a], &r[inst->b]);
+                break;
+            }
+            // NOTE: the constant is always an int, so an int on the other side needs no class dispatch
+            case IR_OP_ADD_INT:
+            case IR_OP_SUB_INT: {
+                FluffObject  * lhs = &r[inst->b], * dst = &r[inst->a];
+                const FluffInt v   = self->binary->constants[inst->x].data.i;
+                if (lhs->klass == klass_int) {
+                    const FluffInt result = (inst->op == IR_OP_ADD_INT ? lhs->data._int + v : lhs->data._int - v);
+                    if (dst->klass != klass_int && dst->klass != klass_float && dst->klass != klass_bool) _free_object(dst);
+                    dst->instance  = self->instance;
+                    dst->klass     = klass_int;
+                    dst->data._int = result;
+                    break;
+                }
+
+                FluffObject rhs, result;
+                _new_int_object(&rhs, self->instance, v);
+                _vm_try(vm_apply_binary(self, (inst->op == IR_OP_ADD_INT ? fluff_object_add : fluff_object_sub), lhs, &rhs, false, &result));
+                vm_reg_move(dst, &result);
+                break;
+            }
+            VM_REG_QUICKENED_CASE(ADD, fluff_object_add, false)
+            VM_REG_QUICKENED_CASE(SUB, fluff_object_sub, false)
+            VM_REG_QUICKENED_CASE(MUL, fluff_object_mul, false)
+            VM_REG_BINARY_CASE(IR_OP_DIV,     fluff_object_div,     false)
+            VM_REG_BINARY_CASE(IR_OP_MOD,     fluff_object_mod,     false)
+            VM_REG_BINARY_CASE(IR_OP_POW,     fluff_object_pow,     false)
+            VM_REG_BINARY_CASE(IR_OP_BIT_AND, fluff_object_bit_and, false)
+            VM_REG_BINARY_CASE(IR_OP_BIT_OR,  fluff_object_bit_or,  false)
+            VM_REG_BINARY_CASE(IR_OP_BIT_XOR, fluff_object_bit_xor, false)
+            VM_REG_BINARY_CASE(IR_OP_BIT_SHL, fluff_object_bit_shl, false)
+            VM_REG_BINARY_CASE(IR_OP_BIT_SHR, fluff_object_bit_shr, false)
+            VM_REG_QUICKENED_CASE(EQ, fluff_object_eq, true)
+            VM_REG_QUICKENED_CASE(NE, fluff_object_ne, true)
+            VM_REG_QUICKENED_CASE(GT, fluff_object_gt, true)
+            VM_REG_QUICKENED_CASE(GE, fluff_object_ge, true)
+            VM_REG_QUICKENED_CASE(LT, fluff_object_lt, true)
+            VM_REG_QUICKENED_CASE(LE, fluff_object_le, true)
+            VM_REG_BINARY_CASE(IR_OP_AND,     fluff_object_and,     true)
+            VM_REG_BINARY_CASE(IR_OP_OR,      fluff_object_or,      true)
+            case IR_OP_BIT_NOT: { _vm_try(vm_reg_unary_op(self, fluff_object_bit_not, r, inst, false)); break; }
+            case IR_OP_NEGATE:  { _vm_try(vm_reg_unary_op(self, fluff_object_negate, r, inst, false)); break; }
+            case IR_OP_NOT:     { _vm_try(vm_reg_unary_op(self, fluff_object_not, r, inst, true)); break; }
+            VM_REG_QUICK_ARITH_CASES(ADD, +)
+            VM_REG_QUICK_ARITH_CASES(SUB, -)
+            VM_REG_QUICK_ARITH_CASES(MUL, *)
+            VM_REG_QUICK_CMP_CASES(EQ, ==)
+            VM_REG_QUICK_CMP_CASES(NE, !=)
+            VM_REG_QUICK_CMP_CASES(GT, >)
+            VM_REG_QUICK_CMP_CASES(GE, >=)
+            VM_REG_QUICK_CMP_CASES(LT, <)
+            VM_REG_QUICK_CMP_CASES(LE, <=)
+            VM_REG_TYPED_ARITH_CASES(ADD, +)
+            VM_REG_TYPED_ARITH_CASES(SUB, -)
+            VM_REG_TYPED_ARITH_CASES(MUL, *)
+            VM_REG_TYPED_CMP_CASES(EQ, ==)
+            VM_REG_TYPED_CMP_CASES(NE, !=)
+            VM_REG_TYPED_CMP_CASES(GT, >)
+            VM_REG_TYPED_CMP_CASES(GE, >=)
+            VM_REG_TYPED_CMP_CASES(LT, <)
+            VM_REG_TYPED_CMP_CASES(LE, <=)
+            case IR_OP_CHECK: {
+                _vm_try(vm_check_klass(&r[inst->b], self->binary->constants[inst->x].data.klass));
+                break;
+            }
+            case IR_OP_IS: {
+                FluffKlass  * klass = self->binary->constants[inst->x].data.klass;
+                FluffObject * obj   = &r[inst->b];
+                const bool    is    = (klass && obj->klass && fluff_object_is_same_class(obj, klass));
+                _free_object(&r[inst->a]);
+                _new_bool_object(&r[inst->a], self->instance, is);
+                break;
+            }
+            case IR_OP_AS: {
+                FluffKlass  * klass = self->binary->constants[inst->x].data.klass;
+                FluffObject * obj   = fluff_object_as(&r[inst->b], klass);
+                if (!obj) goto failure;
+
+                // NOTE: the converted object is moved into the register, only its box is freed
+                vm_reg_move(&r[inst->a], obj);
+                fluff_free(obj);
+                break;
+            }
+            // NOTE: a tail call that can't reuse the frame returns through the RET after it
+            case IR_OP_CALL:
+            case IR_OP_TAIL_CALL: {
+                const size_t  argc   = inst->b;
+                FluffObject * callee = &r[inst->a];
+                if (callee->klass != fluff_instance_get_core_class(self->instance, FLUFF_KLASS_FUNC) || !callee->data._method)
+                    _vm_error("attempt to call an object of type '%.*s'",
+                        FLUFF_STR_BUFFER_FMT(_class_get_common_data(callee->klass)->name)
+                    );
+
+                FluffMethod * method = callee->data._method;
+                if (method->chunk && argc != method->property_count)
+                    _vm_error("function '%s' expects %zu arguments, got %zu", method->name, method->property_count, argc);
+                if (method->chunk && !self->current_frame.chunk->typed) _vm_try(vm_check_args(self, method, callee + 1, argc));
+
+                // NOTE: registers past the arguments are dead here, the callee frame starts on top of them
+                _vm_stack_popn(self, self->stack_count - (self->current_frame.base + inst->a + argc + 1));
+                const bool native = (method->chunk && vm_enter_native(self, method->chunk, argc + 1));
+                if (!native && method->chunk && method->chunk->registers) {
+                    if (inst->op == IR_OP_TAIL_CALL) {
+                        _vm_replace_frame(self, argc + 1);
+                    } else {
+                        self->current_frame.ip = ip;
+                        _vm_try(_vm_push_frame(self, argc + 1));
+                    }
+                    self->current_frame.chunk = method->chunk;
+                    code = method->chunk->registers->code;
+                    ip   = 0;
+                    _vm_try(vm_enter_registers(self, method->chunk->registers));
+
+                    r = &self->stack[self->current_frame.base];
+                    break;
+                }
+
+                // NOTE: chunks that couldn't be translated run on the stack interpreter, the result lands on the callee either way
+                if (native) {
+                    _vm_try(_vm_run_native(self, method->chunk, argc + 1));
+                } else if (method->chunk) {
+                    _vm_try(_vm_run(self, method->chunk, argc + 1));
+                } else {
+                    _vm_try(fluff_vm_invoke(self, callee, argc));
+                    vm_drop_second(self);
+                }
+                _vm_try(vm_enter_registers(self, self->current_frame.chunk->registers));
+                r = &self->stack[self->current_frame.base];
+                break;
+            }
+            // NOTE: the result is swapped into the last register, which is the entry a frame leaves behind
+            case IR_OP_RET: {
+                FluffObject * top = &self->stack[self->stack_count - 1];
+                FluffObject   ret = r[inst->a];
+                r[inst->a] = * top;
+                * top      = ret;
+
+                const bool done = (self->frame_count == entry_frame + 1);
+                _vm_try(_vm_pop_frame(self, 1));
+                if (done) return FLUFF_OK;
+
+                _vm_try(vm_enter_registers(self, self->current_frame.chunk->registers));
+                code = self->current_frame.chunk->registers->code;
+                ip   = self->current_frame.ip;
+                r    = &self->stack[self->current_frame.base];
+                break;
+            }
+            default: _vm_error("unsupported register opcode 0x%.2x", inst->op);
+        }
     }
 
-    return FLUFF_OK;
+failure:
+    vm_note_frames(self, entry_frame, ip, true);
+    while (self->frame_count > entry_frame)
+        _vm_pop_frame(self, 0);
+    return FLUFF_FAILURE;
 }
 
-FLUFF_PRIVATE_API FluffResult _vm_pop_frame(FluffVM * self, size_t preserve) {
-    if (preserve > self->current_frame.entry_count) {
-        fluff_push_error("attempted to preserve %zu entries on a %zu entry frame", 
-            preserve, self->current_frame.entry_count
+// NOTE: native code runs on its own C frame, the VM frame it's given is laid out like the ones of the interpreters
+FLUFF_PRIVATE_API FluffResult _vm_run_native(FluffVM * self, IRChunk * chunk, size_t preserve) {
+    const JitCode * native      = chunk->native;
+    const size_t    entry_frame = self->frame_count;
+    if (_vm_push_frame(self, preserve) == FLUFF_FAILURE) return FLUFF_FAILURE;
+    self->current_frame.chunk = chunk;
+
+    // NOTE: inline code writes entries without growing the stack, so the frame gets all the room it needs up front
+    if (_vm_reserve(self, native->stack_size + 1 - preserve) == FLUFF_OK && 
+        native->entry(self, &self->stack[self->current_frame.base]) == FLUFF_OK && 
+        vm_run_tail_call(self) == FLUFF_OK)
+        return FLUFF_OK;
+
+    // NOTE: native code keeps no addresses, its frame is only named
+    self->tail_call = NULL;
+    if (self->frame_count > entry_frame && self->current_frame.chunk)
+        fluff_push_note("in '%s', compiled", vm_chunk_name(self, self->current_frame.chunk));
+    while (self->frame_count > entry_frame)
+        _vm_pop_frame(self, 0);
+    return FLUFF_FAILURE;
+}
+
+FLUFF_PRIVATE_API FluffResult _vm_run_chunk(FluffVM * self, IRChunk * chunk, size_t preserve) {
+    if (vm_enter_native(self, chunk, preserve)) return _vm_run_native(self, chunk, preserve);
+    if (chunk->registers) return _vm_run_registers(self, chunk, preserve);
+    return _vm_run(self, chunk, preserve);
+}
+
+// Calls the entry right below the top 'argc' ones and runs it to its end, the result takes the place of the callee.
+// NOTE: 'typed' skips the argument checks, the caller proved their classes already
+FLUFF_PRIVATE_API FluffResult _vm_call(FluffVM * self, size_t argc, bool typed) {
+    FluffObject * callee = &self->stack[self->stack_count - argc - 1];
+    if (callee->klass != fluff_instance_get_core_class(self->instance, FLUFF_KLASS_FUNC) || !callee->data._method) {
+        fluff_push_error("attempt to call an object of type '%.*s'", 
+            FLUFF_STR_BUFFER_FMT(_class_get_common_data(callee->klass)->name)
         );
         return FLUFF_FAILURE;
     }
 
-    if (self->frame_count == 0) return FLUFF_OK;
+    FluffMethod * method = callee->data._method;
+    if (!method->chunk) {
+        if (fluff_vm_invoke(self, callee, argc) == FLUFF_FAILURE) return FLUFF_FAILURE;
+        vm_drop_second(self);
+        return FLUFF_OK;
+    }
+    if (argc != method->property_count) {
+        fluff_push_error("function '%s' expects %zu arguments, got %zu", method->name, method->property_count, argc);
+        return FLUFF_FAILURE;
+    }
+    if (!typed && vm_check_args(self, method, callee + 1, argc) == FLUFF_FAILURE) return FLUFF_FAILURE;
+    return _vm_run_chunk(self, method->chunk, argc + 1);
+}
 
-    VMFrame * last_frame = &self->frames[--self->frame_count];
+// NOTE: like TAIL_CALL and the RET after it on native code, which can't reuse its C frame. The callee takes over
+//       the frame and is left in 'tail_call', anything that isn't a chunk is called and returned from right away.
+FLUFF_PRIVATE_API FluffResult _vm_tail_call(FluffVM * self, size_t argc, bool typed) {
+    FluffObject * callee = &self->stack[self->stack_count - argc - 1];
+    FluffMethod * method = (callee->klass == fluff_instance_get_core_class(self->instance, FLUFF_KLASS_FUNC) ? callee->data._method : NULL);
+    if (!method || !method->chunk || argc != method->property_count) {
+        if (_vm_call(self, argc, typed) == FLUFF_FAILURE) return FLUFF_FAILURE;
+        return _vm_pop_frame(self, 1);
+    }
+    if (!typed && vm_check_args(self, method, callee + 1, argc) == FLUFF_FAILURE) return FLUFF_FAILURE;
 
-    VMEntry * top_entry    = NULL;
-    VMEntry * bottom_entry = NULL;
+    _vm_replace_frame(self, argc + 1);
+    self->tail_call = method->chunk;
+    return FLUFF_OK;
+}
 
-    if (preserve > 0) {
-        top_entry    = _vm_frame_at(&self->current_frame, -((int)preserve));
-        bottom_entry = self->current_frame.last_entry;
+/* -=- Frames -=- */
+// NOTE: the top 'preserve' entries slide down to where the frame started, everything else in it is freed
+FLUFF_CONSTEXPR void vm_slide_frame(FluffVM * self, size_t preserve) {
+    const size_t base = self->current_frame.base;
+    const size_t keep = self->stack_count - preserve;
+    for (size_t i = base; i < keep; ++i)
+        _free_object(&self->stack[i]);
+    memmove(&self->stack[base], &self->stack[keep], sizeof(FluffObject) * preserve);
+    self->stack_count = base + preserve;
+}
 
-        self->current_frame.last_entry   = top_entry->prev;
-        self->current_frame.entry_count -= preserve;
+FLUFF_CONSTEXPR VMFrameSegment * vm_new_frame_segment(VMFrameSegment * prev) {
+    VMFrameSegment * segment = fluff_alloc(NULL, sizeof(VMFrameSegment));
+    segment->prev = prev;
+    segment->next = NULL;
+    return segment;
+}
 
-        top_entry->prev          = last_frame->last_entry;
-        last_frame->last_entry   = bottom_entry;
-        last_frame->entry_count += preserve;
+FLUFF_PRIVATE_API FluffResult _vm_push_frame(FluffVM * self, size_t preserve) {
+    if (preserve > fluff_vm_size(self)) {
+        fluff_push_error("attempted to preserve %zu entries on a %zu entry frame", 
+            preserve, fluff_vm_size(self)
+        );
+        return FLUFF_FAILURE;
     }
 
-    _vm_frame_clear(&self->current_frame);
+    if (self->frame_count >= FLUFF_MAX_VM_RECURSION) {
+        fluff_push_error("call stack overflow (more than %d frames)", FLUFF_MAX_VM_RECURSION);
+        return FLUFF_FAILURE;
+    }
+
+    // NOTE: segments are only allocated the first time calls get that deep, frames never move once pushed
+    const size_t slot = self->frame_count % FLUFF_VM_FRAME_SEGMENT_SIZE;
+    if (!self->frames) {
+        self->frames = vm_new_frame_segment(NULL);
+    } else if (slot == 0 && self->frame_count > 0) {
+        if (!self->frames->next) self->frames->next = vm_new_frame_segment(self->frames);
+        self->frames = self->frames->next;
+    }
 
-    self->current_frame = self->frames[self->frame_count];
+    self->frames->frames[slot] = self->current_frame;
+    ++self->frame_count;
+    self->current_frame = (VMFrame){ .base = self->stack_count - preserve, .preserve = preserve };
     return FLUFF_OK;
 }
 
+FLUFF_PRIVATE_API FluffResult _vm_pop_frame(FluffVM * self, size_t preserve) {
+    if (preserve > fluff_vm_size(self)) {
+        fluff_push_error("attempted to preserve %zu entries on a %zu entry frame", 
+            preserve, fluff_vm_size(self)
+        );
+        return FLUFF_FAILURE;
+    }
+
+    if (self->frame_count == 0) return FLUFF_OK;
+
+    vm_slide_frame(self, preserve);
+    const size_t slot = --self->frame_count % FLUFF_VM_FRAME_SEGMENT_SIZE;
+    self->current_frame = self->frames->frames[slot];
+    if (slot == 0 && self->frame_count > 0) self->frames = self->frames->prev;
+    return FLUFF_OK;
+}
+
+// NOTE: the frame starts over with the top 'preserve' entries, a tail call keeps the frame count where it is
+FLUFF_PRIVATE_API void _vm_replace_frame(FluffVM * self, size_t preserve) {
+    vm_slide_frame(self, preserve);
+    self->current_frame.preserve = preserve;
+}
+
 FLUFF_PRIVATE_API void _vm_clear_frames(FluffVM * self) {
     while (self->frame_count > 0) {
         _vm_pop_frame(self, 0);
     }
-    _vm_frame_clear(&self->current_frame);
-    fluff_free(self->frames);
-    self->frames         = NULL;
-    self->frame_capacity = 0;
+    _vm_stack_popn(self, fluff_vm_size(self));
+    while (self->frames) {
+        VMFrameSegment * next = self->frames->next;
+        fluff_free(self->frames);
+        self->frames = next;
+    }
 }
\ No newline at end of file
@@ -100,7 +100,9 @@ FLUFF_API void fluff_logger_push_v(FluffLog log, const char * restrict fmt, va_l
     
     int len = fluff_vformat(msg, global_log_msg_size - global_log_msg_count, fmt, args);
     if (len < 0) fluff_panic("error format failure");
-    global_log_msg_size += len;
+    if ((size_t)len >= global_log_msg_size - global_log_msg_count)
+        len = (int)(global_log_msg_size - global_log_msg_count - 1);
+    global_log_msg_count += len + 1;
 
     log.msg     = msg;
     log.msg_len = len;
@@ -122,10 +124,10 @@ FLUFF_API void fluff_logger_print() {
 }
 
 FLUFF_API void fluff_logger_clear() {
+    if (global_log_buffer)     FLUFF_CLEANUP_N(global_log_buffer, sizeof(FluffLog) * global_log_count);
+    if (global_log_msg_buffer) FLUFF_CLEANUP_N(global_log_msg_buffer, global_log_msg_count);
     global_log_count     = 0;
     global_log_msg_count = 0;
-    FLUFF_CLEANUP_N(global_log_buffer, global_log_count);
-    FLUFF_CLEANUP_N(global_log_msg_buffer, global_log_msg_count);
 }
 
 FLUFF_PRIVATE_API const char * _log_type_string(uint8_t type);
\ No newline at end of file
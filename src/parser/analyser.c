@@ -0,0 +1,492 @@
+/* -=============
+     Includes
+   =============- */
+
+#define FLUFF_IMPLEMENTATION
+#include <base.h>
+#include <error.h>
+#include <parser/analyser.h>
+#include <parser/interpret.h>
+#include <core/config.h>
+
+/* -==============
+     Internals
+   ==============- */
+
+FLUFF_CONSTEXPR bool is_assignable(AstNodeType type) {
+    return type == AST_NODE_LABEL || type == AST_NODE_MEMBER || type == AST_NODE_INDEX;
+}
+
+FLUFF_CONSTEXPR AstNodeType literal_node_type(TokenType type) {
+    switch (type) {
+        case TOKEN_BOOL_LITERAL:    return AST_NODE_BOOL;
+        case TOKEN_INTEGER_LITERAL: return AST_NODE_INT;
+        case TOKEN_DECIMAL_LITERAL: return AST_NODE_FLOAT;
+        case TOKEN_STRING_LITERAL:  return AST_NODE_STRING;
+        case TOKEN_LABEL_LITERAL:   return AST_NODE_LABEL;
+        case TOKEN_NULL:            return AST_NODE_NULL;
+        case TOKEN_SELF:            return AST_NODE_SELF;
+        case TOKEN_SUPER:           return AST_NODE_SUPER;
+        default:                    return AST_NODE_NONE;
+    }
+}
+
+FLUFF_CONSTEXPR void analyser_scratch_push(Analyser * self, AstIndex index) {
+    if (self->scratch_count >= self->scratch_capacity) {
+        self->scratch_capacity = FLUFF_MAX(self->scratch_capacity * 2, 64);
+        self->scratch          = fluff_alloc(self->scratch, sizeof(AstIndex) * self->scratch_capacity);
+    }
+    self->scratch[self->scratch_count++] = index;
+}
+
+FLUFF_CONSTEXPR uint32_t analyser_scratch_commit(Analyser * self, size_t base) {
+    const uint32_t list = _ast_push_list(self->ast, &self->scratch[base], self->scratch_count - base);
+    self->scratch_count = base;
+    return list;
+}
+
+FLUFF_CONSTEXPR AstIndex analyser_unexpected(Analyser * self, const char * expected) {
+    const Token * token = _analyser_peek(self, 0);
+    const char  * path  = (self->lexer->interpret ? self->lexer->interpret->path : NULL);
+    if (token->type == TOKEN_EOF) {
+        fluff_push_log(FLUFF_LOG_TYPE_ERROR, path, token->start.line + 1, token->start.column + 1,
+            "expected %s, found end of file", expected
+        );
+    } else {
+        fluff_push_log(FLUFF_LOG_TYPE_ERROR, path, token->start.line + 1, token->start.column + 1,
+            "expected %s, found '%.*s'", expected, (int)token->length, &self->lexer->str[token->start.index]
+        );
+    }
+    return AST_NONE;
+}
+
+#define _analyser_error(...) {\
+            const Token * __token = _analyser_peek(self, 0);\
+            fluff_push_log(FLUFF_LOG_TYPE_ERROR,\
+                (self->lexer->interpret ? self->lexer->interpret->path : NULL),\
+                __token->start.line + 1, __token->start.column + 1, __VA_ARGS__\
+            );\
+            return AST_NONE;\
+        }
+
+#define _analyser_expect(__type, __expected) {\
+            if (!_analyser_match(self, __type)) return analyser_unexpected(self, __expected);\
+        }
+
+#define _analyser_try(__node) {\
+            if ((__node) == AST_NONE) return AST_NONE;\
+        }
+
+#define _analyser_enter() {\
+            if (++self->depth > FLUFF_MAX_PARSER_DEPTH) _analyser_error("code is nested too deeply");\
+        }
+
+#define _analyser_leave() --self->depth
+
+/* -=============
+     Analyser
+   =============- */
+
+/* -=- Initializers -=- */
+FLUFF_PRIVATE_API void _new_analyser(Analyser * self, Lexer * lexer, Ast * ast) {
+    FLUFF_CLEANUP(self);
+    self->lexer = lexer;
+    self->ast   = ast;
+
+    self->eof       = _make_token(TOKEN_EOF);
+    self->eof.start = lexer->location;
+}
+
+FLUFF_PRIVATE_API void _free_analyser(Analyser * self) {
+    if (self->scratch) fluff_free(self->scratch);
+    FLUFF_CLEANUP(self);
+}
+
+/* -=- Parsing -=- */
+FLUFF_PRIVATE_API FluffResult _analyser_read(Analyser * self) {
+    self->ast->lexer = self->lexer;
+    _ast_clear(self->ast);
+
+    const size_t base = self->scratch_count;
+    while (!_analyser_check(self, TOKEN_EOF)) {
+        if (_analyser_match(self, TOKEN_END)) continue;
+
+        const AstIndex statement = _analyser_read_statement(self);
+        if (statement == AST_NONE) return FLUFF_FAILURE;
+        analyser_scratch_push(self, statement);
+    }
+
+    self->ast->root = _ast_push(self->ast, AST_NODE_ROOT, AST_NONE, analyser_scratch_commit(self, base), AST_NONE);
+    return FLUFF_OK;
+}
+
+FLUFF_PRIVATE_API AstIndex _analyser_read_statement(Analyser * self) {
+    uint16_t flags = 0;
+    while (true) {
+        if (_analyser_match(self, TOKEN_PUB)) flags |= AST_FLAG_PUB;
+        else if (_analyser_match(self, TOKEN_VIRTUAL)) flags |= AST_FLAG_VIRTUAL;
+        else break;
+    }
+
+    if (flags || _analyser_check(self, TOKEN_LET) || _analyser_check(self, TOKEN_CONST) || 
+        _analyser_check(self, TOKEN_FUNC) || _analyser_check(self, TOKEN_CLASS)) {
+        AstIndex node = AST_NONE;
+        switch (_analyser_peek(self, 0)->type) {
+            case TOKEN_LET:
+            case TOKEN_CONST: { node = _analyser_read_decl(self); break; }
+            case TOKEN_FUNC:  { node = _analyser_read_func(self); break; }
+            case TOKEN_CLASS: { node = _analyser_read_class(self); break; }
+            default:          return analyser_unexpected(self, "a declaration");
+        }
+        _analyser_try(node);
+
+        _ast_get(self->ast, node)->flags |= flags;
+        return node;
+    }
+
+    switch (_analyser_peek(self, 0)->type) {
+        case TOKEN_LBRACE: return _analyser_read_block(self);
+        case TOKEN_IF:     return _analyser_read_if(self);
+        case TOKEN_WHILE: {
+            const uint32_t token = _analyser_consume(self);
+
+            const AstIndex condition = _analyser_read_expr(self, 0);
+            _analyser_try(condition);
+            const AstIndex body = _analyser_read_block(self);
+            _analyser_try(body);
+            return _ast_push(self->ast, AST_NODE_WHILE, token, condition, body);
+        }
+        case TOKEN_FOR: {
+            _analyser_consume(self);
+
+            const uint32_t name = (uint32_t)self->index;
+            _analyser_expect(TOKEN_LABEL_LITERAL, "a loop variable");
+            _analyser_expect(TOKEN_IN, "'in'");
+
+            const AstIndex iterable = _analyser_read_expr(self, 0);
+            _analyser_try(iterable);
+            const AstIndex body = _analyser_read_block(self);
+            _analyser_try(body);
+            return _ast_push(self->ast, AST_NODE_FOR, name, iterable, body);
+        }
+        case TOKEN_RETURN: {
+            const uint32_t token = _analyser_consume(self);
+
+            AstIndex value = AST_NONE;
+            if (!_analyser_check(self, TOKEN_END)) {
+                value = _analyser_read_expr(self, 0);
+                _analyser_try(value);
+            }
+            _analyser_expect(TOKEN_END, "';' after return");
+            return _ast_push(self->ast, AST_NODE_RETURN, token, value, AST_NONE);
+        }
+        case TOKEN_BREAK:
+        case TOKEN_CONTINUE: {
+            const AstNodeType type  = (_analyser_check(self, TOKEN_BREAK) ? AST_NODE_BREAK : AST_NODE_CONTINUE);
+            const uint32_t    token = _analyser_consume(self);
+            _analyser_expect(TOKEN_END, "';'");
+            return _ast_push(self->ast, type, token, AST_NONE, AST_NONE);
+        }
+        case TOKEN_REQUIRES: {
+            _analyser_consume(self);
+
+            const uint32_t path = (uint32_t)self->index;
+            _analyser_expect(TOKEN_STRING_LITERAL, "a module path");
+            _analyser_expect(TOKEN_END, "';' after requires");
+            return _ast_push(self->ast, AST_NODE_REQUIRES, path, AST_NONE, AST_NONE);
+        }
+        default: {
+            const AstIndex expr = _analyser_read_expr(self, 0);
+            _analyser_try(expr);
+            _analyser_expect(TOKEN_END, "';' after expression");
+            return expr;
+        }
+    }
+}
+
+FLUFF_PRIVATE_API AstIndex _analyser_read_block(Analyser * self) {
+    const uint32_t token = (uint32_t)self->index;
+    _analyser_expect(TOKEN_LBRACE, "'{'");
+    _analyser_enter();
+
+    const size_t base = self->scratch_count;
+    while (!_analyser_match(self, TOKEN_RBRACE)) {
+        if (_analyser_check(self, TOKEN_EOF)) return analyser_unexpected(self, "'}'");
+        if (_analyser_match(self, TOKEN_END)) continue;
+
+        const AstIndex statement = _analyser_read_statement(self);
+        _analyser_try(statement);
+        analyser_scratch_push(self, statement);
+    }
+
+    _analyser_leave();
+    return _ast_push(self->ast, AST_NODE_BLOCK, token, analyser_scratch_commit(self, base), AST_NONE);
+}
+
+FLUFF_PRIVATE_API AstIndex _analyser_read_decl(Analyser * self) {
+    const TokenType op = _analyser_peek(self, 0)->type;
+    _analyser_consume(self);
+
+    const uint32_t name = (uint32_t)self->index;
+    _analyser_expect(TOKEN_LABEL_LITERAL, "a variable name");
+
+    AstIndex type = AST_NONE;
+    if (_analyser_match(self, TOKEN_COLON)) {
+        type = _analyser_read_type(self);
+        _analyser_try(type);
+    }
+
+    AstIndex value = AST_NONE;
+    if (_analyser_match(self, TOKEN_EQUAL)) {
+        value = _analyser_read_expr(self, _token_type_get_precedence(TOKEN_EQUAL) + 1);
+        _analyser_try(value);
+    }
+    _analyser_expect(TOKEN_END, "';' after declaration");
+
+    const AstIndex node = _ast_push(self->ast, AST_NODE_DECL, name, type, value);
+    _ast_get(self->ast, node)->op = (uint8_t)op;
+    return node;
+}
+
+FLUFF_PRIVATE_API AstIndex _analyser_read_func(Analyser * self) {
+    _analyser_consume(self);
+
+    const uint32_t name = (uint32_t)self->index;
+    _analyser_expect(TOKEN_LABEL_LITERAL, "a function name");
+    _analyser_expect(TOKEN_LPAREN, "'('");
+
+    const size_t base = self->scratch_count;
+    if (!_analyser_match(self, TOKEN_RPAREN)) {
+        do {
+            const uint32_t param = (uint32_t)self->index;
+            _analyser_expect(TOKEN_LABEL_LITERAL, "a parameter name");
+            _analyser_expect(TOKEN_COLON, "':' after parameter name");
+
+            const AstIndex type = _analyser_read_type(self);
+            _analyser_try(type);
+
+            AstIndex value = AST_NONE;
+            if (_analyser_match(self, TOKEN_EQUAL)) {
+                value = _analyser_read_expr(self, _token_type_get_precedence(TOKEN_EQUAL) + 1);
+                _analyser_try(value);
+            }
+            analyser_scratch_push(self, _ast_push(self->ast, AST_NODE_PARAM, param, type, value));
+        } while (_analyser_match(self, TOKEN_COMMA));
+        _analyser_expect(TOKEN_RPAREN, "')' after parameters");
+    }
+    const uint32_t params = analyser_scratch_commit(self, base);
+
+    uint32_t extra[2] = { AST_NONE, AST_NONE };
+    if (_analyser_match(self, TOKEN_ARROW)) {
+        extra[0] = _analyser_read_type(self);
+        _analyser_try(extra[0]);
+    }
+
+    // NOTE: functions without a body are only declared
+    if (!_analyser_match(self, TOKEN_END)) {
+        extra[1] = _analyser_read_block(self);
+        _analyser_try(extra[1]);
+    }
+
+    return _ast_push(self->ast, AST_NODE_FUNC, name, params, _ast_push_extra(self->ast, extra, 2));
+}
+
+FLUFF_PRIVATE_API AstIndex _analyser_read_class(Analyser * self) {
+    _analyser_consume(self);
+
+    const uint32_t name = (uint32_t)self->index;
+    _analyser_expect(TOKEN_LABEL_LITERAL, "a class name");
+
+    size_t base = self->scratch_count;
+    if (_analyser_match(self, TOKEN_COLON)) {
+        do {
+            const AstIndex type = _analyser_read_type(self);
+            _analyser_try(type);
+            analyser_scratch_push(self, type);
+        } while (_analyser_match(self, TOKEN_COMMA));
+    }
+    const uint32_t bases = analyser_scratch_commit(self, base);
+
+    _analyser_expect(TOKEN_LBRACE, "'{'");
+    _analyser_enter();
+
+    base = self->scratch_count;
+    while (!_analyser_match(self, TOKEN_RBRACE)) {
+        if (_analyser_match(self, TOKEN_END)) continue;
+
+        uint16_t flags = 0;
+        while (true) {
+            if (_analyser_match(self, TOKEN_PUB)) flags |= AST_FLAG_PUB;
+            else if (_analyser_match(self, TOKEN_VIRTUAL)) flags |= AST_FLAG_VIRTUAL;
+            else break;
+        }
+
+        AstIndex member = AST_NONE;
+        switch (_analyser_peek(self, 0)->type) {
+            case TOKEN_LET:
+            case TOKEN_CONST: { member = _analyser_read_decl(self); break; }
+            case TOKEN_FUNC:  { member = _analyser_read_func(self); break; }
+            default:          return analyser_unexpected(self, "a field or method");
+        }
+        _analyser_try(member);
+
+        _ast_get(self->ast, member)->flags |= flags;
+        analyser_scratch_push(self, member);
+    }
+
+    _analyser_leave();
+    return _ast_push(self->ast, AST_NODE_CLASS, name, bases, analyser_scratch_commit(self, base));
+}
+
+FLUFF_PRIVATE_API AstIndex _analyser_read_if(Analyser * self) {
+    const uint32_t token = _analyser_consume(self);
+
+    const AstIndex condition = _analyser_read_expr(self, 0);
+    _analyser_try(condition);
+
+    uint32_t extra[2] = { AST_NONE, AST_NONE };
+    extra[0] = _analyser_read_block(self);
+    _analyser_try(extra[0]);
+
+    if (_analyser_match(self, TOKEN_ELSE)) {
+        extra[1] = (_analyser_check(self, TOKEN_IF) ? _analyser_read_if(self) : _analyser_read_block(self));
+        _analyser_try(extra[1]);
+    }
+
+    return _ast_push(self->ast, AST_NODE_IF, token, condition, _ast_push_extra(self->ast, extra, 2));
+}
+
+FLUFF_PRIVATE_API AstIndex _analyser_read_type(Analyser * self) {
+    const Token * token = _analyser_peek(self, 0);
+    if (token->type != TOKEN_LABEL_LITERAL && !_token_type_is_type_keyword(token->type))
+        return analyser_unexpected(self, "a type");
+    return _ast_push(self->ast, AST_NODE_TYPE, _analyser_consume(self), AST_NONE, AST_NONE);
+}
+
+FLUFF_PRIVATE_API AstIndex _analyser_read_expr(Analyser * self, int precedence) {
+    _analyser_enter();
+
+    AstIndex lhs = AST_NONE;
+
+    const TokenType prefix = _analyser_peek(self, 0)->type;
+    if (_token_type_is_prefix_operator(prefix)) {
+        const uint32_t token   = _analyser_consume(self);
+        const AstIndex operand = _analyser_read_expr(self, TOKEN_UNARY_PRECEDENCE);
+        _analyser_try(operand);
+
+        lhs = _ast_push(self->ast, AST_NODE_UNARY, token, operand, AST_NONE);
+        _ast_get(self->ast, lhs)->op = (uint8_t)prefix;
+    } else {
+        lhs = _analyser_read_primary(self);
+        _analyser_try(lhs);
+    }
+
+    while (true) {
+        const TokenType op       = _analyser_peek(self, 0)->type;
+        const int       op_level = _token_type_get_precedence(op);
+        if (op_level == 0 || op_level < precedence) break;
+
+        const uint32_t token = _analyser_consume(self);
+        if (op == TOKEN_AS || op == TOKEN_IS) {
+            const AstIndex type = _analyser_read_type(self);
+            _analyser_try(type);
+            lhs = _ast_push(self->ast, (op == TOKEN_AS ? AST_NODE_AS : AST_NODE_IS), token, lhs, type);
+            continue;
+        }
+
+        const AstIndex rhs = _analyser_read_expr(self, (_token_type_is_right_associative(op) ? op_level : op_level + 1));
+        _analyser_try(rhs);
+
+        if (op == TOKEN_EQUAL) {
+            if (!is_assignable(_ast_get(self->ast, lhs)->type)) {
+                self->index = token;
+                _analyser_error("invalid assignment target");
+            }
+            lhs = _ast_push(self->ast, AST_NODE_ASSIGN, token, lhs, rhs);
+        } else {
+            lhs = _ast_push(self->ast, AST_NODE_BINARY, token, lhs, rhs);
+            _ast_get(self->ast, lhs)->op = (uint8_t)op;
+        }
+    }
+
+    _analyser_leave();
+    return lhs;
+}
+
+FLUFF_PRIVATE_API AstIndex _analyser_read_primary(Analyser * self) {
+    const TokenType type = _analyser_peek(self, 0)->type;
+
+    AstIndex node = AST_NONE;
+    if (literal_node_type(type) != AST_NODE_NONE) {
+        node = _ast_push(self->ast, literal_node_type(type), _analyser_consume(self), AST_NONE, AST_NONE);
+    } else if (type == TOKEN_LPAREN) {
+        _analyser_consume(self);
+        node = _analyser_read_expr(self, 0);
+        _analyser_try(node);
+        _analyser_expect(TOKEN_RPAREN, "')'");
+    } else if (type == TOKEN_LBRACKET) {
+        const uint32_t token = _analyser_consume(self);
+        const size_t   base  = self->scratch_count;
+        if (!_analyser_match(self, TOKEN_RBRACKET)) {
+            do {
+                const AstIndex item = _analyser_read_expr(self, _token_type_get_precedence(TOKEN_EQUAL) + 1);
+                _analyser_try(item);
+                analyser_scratch_push(self, item);
+            } while (_analyser_match(self, TOKEN_COMMA));
+            _analyser_expect(TOKEN_RBRACKET, "']'");
+        }
+        node = _ast_push(self->ast, AST_NODE_ARRAY, token, analyser_scratch_commit(self, base), AST_NONE);
+    } else
+        return analyser_unexpected(self, "an expression");
+
+    // Postfix operators
+    while (true) {
+        if (_analyser_check(self, TOKEN_LPAREN)) {
+            const uint32_t token = _analyser_consume(self);
+            const size_t   base  = self->scratch_count;
+            if (!_analyser_match(self, TOKEN_RPAREN)) {
+                do {
+                    const AstIndex arg = _analyser_read_expr(self, _token_type_get_precedence(TOKEN_EQUAL) + 1);
+                    _analyser_try(arg);
+                    analyser_scratch_push(self, arg);
+                } while (_analyser_match(self, TOKEN_COMMA));
+                _analyser_expect(TOKEN_RPAREN, "')' after arguments");
+            }
+            node = _ast_push(self->ast, AST_NODE_CALL, token, node, analyser_scratch_commit(self, base));
+        } else if (_analyser_match(self, TOKEN_DOT)) {
+            const uint32_t name = (uint32_t)self->index;
+            _analyser_expect(TOKEN_LABEL_LITERAL, "a member name");
+            node = _ast_push(self->ast, AST_NODE_MEMBER, name, node, AST_NONE);
+        } else if (_analyser_check(self, TOKEN_LBRACKET)) {
+            const uint32_t token = _analyser_consume(self);
+            const AstIndex index = _analyser_read_expr(self, 0);
+            _analyser_try(index);
+            _analyser_expect(TOKEN_RBRACKET, "']'");
+            node = _ast_push(self->ast, AST_NODE_INDEX, token, node, index);
+        } else break;
+    }
+    return node;
+}
+
+/* -=- Token reading -=- */
+FLUFF_PRIVATE_API const Token * _analyser_peek(Analyser * self, size_t offset) {
+    const size_t index = self->index + offset;
+    if (index >= self->lexer->token_count) return &self->eof;
+    return &self->lexer->tokens[index];
+}
+
+FLUFF_PRIVATE_API bool _analyser_check(Analyser * self, TokenType type) {
+    return _analyser_peek(self, 0)->type == type;
+}
+
+FLUFF_PRIVATE_API bool _analyser_match(Analyser * self, TokenType type) {
+    if (!_analyser_check(self, type)) return false;
+    _analyser_consume(self);
+    return true;
+}
+
+FLUFF_PRIVATE_API uint32_t _analyser_consume(Analyser * self) {
+    const uint32_t index = (uint32_t)self->index;
+    if (self->index < self->lexer->token_count) ++self->index;
+    return index;
+}
\ No newline at end of file
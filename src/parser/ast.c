@@ -0,0 +1,238 @@
+/* -=============
+     Includes
+   =============- */
+
+#define FLUFF_IMPLEMENTATION
+#include <base.h>
+#include <error.h>
+#include <parser/ast.h>
+#include <core/config.h>
+
+/* -==============
+     Internals
+   ==============- */
+
+#define AST_MIN_CAPACITY 64
+
+FLUFF_CONSTEXPR void ast_reserve_nodes(Ast * self, size_t count) {
+    if (count <= self->node_capacity) return;
+    fluff_assert(count < AST_NONE, "syntax tree is too big (%zu nodes)", count);
+
+    self->node_capacity = (uint32_t)FLUFF_MIN(FLUFF_MAX(count, (size_t)self->node_capacity * 2), (size_t)AST_NONE - 1);
+    self->nodes         = fluff_alloc(self->nodes, sizeof(AstNode) * self->node_capacity);
+}
+
+FLUFF_CONSTEXPR void ast_reserve_extra(Ast * self, size_t count) {
+    if (count <= self->extra_capacity) return;
+    fluff_assert(count < UINT32_MAX, "syntax tree is too big (%zu extra items)", count);
+
+    self->extra_capacity = (uint32_t)FLUFF_MIN(FLUFF_MAX(count, (size_t)self->extra_capacity * 2), (size_t)UINT32_MAX - 1);
+    self->extra          = fluff_alloc(self->extra, sizeof(uint32_t) * self->extra_capacity);
+}
+
+static void ast_dump_node(Ast * self, AstIndex index, size_t depth);
+
+static void ast_dump_list(Ast * self, uint32_t list, size_t depth) {
+    const size_t     count = _ast_list_size(self, list);
+    const AstIndex * items = _ast_list_items(self, list);
+    for (size_t i = 0; i < count; ++i) ast_dump_node(self, items[i], depth);
+}
+
+static void ast_dump_node(Ast * self, AstIndex index, size_t depth) {
+    if (index == AST_NONE) return;
+
+    const AstNode * node  = _ast_get(self, index);
+    const Token   * token = _ast_get_token(self, index);
+
+    printf("%*s[%u] = %s", (int)(depth * 2), "", index, _ast_node_type_string(node->type));
+    if (token) printf(" '%.*s'", (int)token->length, &self->lexer->str[token->start.index]);
+    if (node->flags & AST_FLAG_PUB)     printf(" pub");
+    if (node->flags & AST_FLAG_VIRTUAL) printf(" virtual");
+    putchar('\n');
+
+    switch (node->type) {
+        case AST_NODE_ROOT:
+        case AST_NODE_BLOCK:
+        case AST_NODE_ARRAY: {
+            ast_dump_list(self, node->lhs, depth + 1);
+            break;
+        }
+        case AST_NODE_UNARY:
+        case AST_NODE_MEMBER:
+        case AST_NODE_RETURN: {
+            ast_dump_node(self, node->lhs, depth + 1);
+            break;
+        }
+        case AST_NODE_CALL: {
+            ast_dump_node(self, node->lhs, depth + 1);
+            ast_dump_list(self, node->rhs, depth + 1);
+            break;
+        }
+        case AST_NODE_FUNC: {
+            ast_dump_list(self, node->lhs, depth + 1);
+            ast_dump_node(self, self->extra[node->rhs], depth + 1);
+            ast_dump_node(self, self->extra[node->rhs + 1], depth + 1);
+            break;
+        }
+        case AST_NODE_CLASS: {
+            ast_dump_list(self, node->lhs, depth + 1);
+            ast_dump_list(self, node->rhs, depth + 1);
+            break;
+        }
+        case AST_NODE_IF: {
+            ast_dump_node(self, node->lhs, depth + 1);
+            ast_dump_node(self, self->extra[node->rhs], depth + 1);
+            ast_dump_node(self, self->extra[node->rhs + 1], depth + 1);
+            break;
+        }
+        case AST_NODE_BINARY:
+        case AST_NODE_ASSIGN:
+        case AST_NODE_INDEX:
+        case AST_NODE_AS:
+        case AST_NODE_IS:
+        case AST_NODE_DECL:
+        case AST_NODE_PARAM:
+        case AST_NODE_WHILE:
+        case AST_NODE_FOR: {
+            ast_dump_node(self, node->lhs, depth + 1);
+            ast_dump_node(self, node->rhs, depth + 1);
+            break;
+        }
+        default: break;
+    }
+}
+
+/* -========
+     Ast
+   ========- */
+
+/* -=- Initializers -=- */
+FLUFF_PRIVATE_API void _new_ast(Ast * self, Lexer * lexer) {
+    FLUFF_CLEANUP(self);
+    self->lexer = lexer;
+    _ast_clear(self);
+}
+
+FLUFF_PRIVATE_API void _free_ast(Ast * self) {
+    if (self->nodes) fluff_free(self->nodes);
+    if (self->extra) fluff_free(self->extra);
+    FLUFF_CLEANUP(self);
+    self->root = AST_NONE;
+}
+
+FLUFF_PRIVATE_API void _ast_clear(Ast * self) {
+    self->node_count  = 0;
+    self->extra_count = 0;
+    self->root        = AST_NONE;
+
+    // NOTE: almost every node owns a token, so sizing by the token count avoids growing while parsing
+    const size_t token_count = (self->lexer ? self->lexer->token_count : 0);
+    const size_t count       = FLUFF_MAX(token_count + 1, AST_MIN_CAPACITY);
+
+    // NOTE: nothing is kept, so a bigger source gets exactly what it needs instead of twice the old size
+    if (count > self->node_capacity)  self->node_capacity  = 0;
+    if (count > self->extra_capacity) self->extra_capacity = 0;
+    ast_reserve_nodes(self, count);
+    ast_reserve_extra(self, count);
+}
+
+/* -=- Building -=- */
+FLUFF_PRIVATE_API AstIndex _ast_push(Ast * self, AstNodeType type, uint32_t token, AstIndex lhs, AstIndex rhs) {
+    ast_reserve_nodes(self, (size_t)self->node_count + 1);
+
+    AstNode * node = &self->nodes[self->node_count];
+    node->type  = (uint8_t)type;
+    node->op    = 0;
+    node->flags = 0;
+    node->token = token;
+    node->lhs   = lhs;
+    node->rhs   = rhs;
+    return self->node_count++;
+}
+
+FLUFF_PRIVATE_API uint32_t _ast_push_extra(Ast * self, const uint32_t * data, size_t count) {
+    ast_reserve_extra(self, (size_t)self->extra_count + count);
+
+    const uint32_t start = self->extra_count;
+    memcpy(&self->extra[start], data, sizeof(uint32_t) * count);
+    self->extra_count += (uint32_t)count;
+    return start;
+}
+
+FLUFF_PRIVATE_API uint32_t _ast_push_list(Ast * self, const AstIndex * items, size_t count) {
+    ast_reserve_extra(self, (size_t)self->extra_count + count + 1);
+
+    const uint32_t start = self->extra_count;
+    self->extra[start] = (uint32_t)count;
+    if (count > 0) memcpy(&self->extra[start + 1], items, sizeof(AstIndex) * count);
+    self->extra_count += (uint32_t)count + 1;
+    return start;
+}
+
+/* -=- Getters -=- */
+FLUFF_PRIVATE_API AstNode * _ast_get(Ast * self, AstIndex index) {
+    return &self->nodes[index];
+}
+
+FLUFF_PRIVATE_API const Token * _ast_get_token(Ast * self, AstIndex index) {
+    const uint32_t token = self->nodes[index].token;
+    if (!self->lexer || token >= self->lexer->token_count) return NULL;
+    return &self->lexer->tokens[token];
+}
+
+FLUFF_PRIVATE_API size_t _ast_list_size(Ast * self, uint32_t list) {
+    return self->extra[list];
+}
+
+FLUFF_PRIVATE_API const AstIndex * _ast_list_items(Ast * self, uint32_t list) {
+    return &self->extra[list + 1];
+}
+
+FLUFF_PRIVATE_API size_t _ast_memory_usage(Ast * self) {
+    return sizeof(AstNode) * self->node_capacity + sizeof(uint32_t) * self->extra_capacity;
+}
+
+FLUFF_PRIVATE_API void _ast_dump(Ast * self) {
+    ast_dump_node(self, self->root, 0);
+}
+
+/* -=- Utils -=- */
+#define ENUM_CASE(__n) case __n: return #__n;
+
+FLUFF_PRIVATE_API const char * _ast_node_type_string(AstNodeType type) {
+    switch (type) {
+        ENUM_CASE(AST_NODE_NONE)
+        ENUM_CASE(AST_NODE_ROOT)
+        ENUM_CASE(AST_NODE_BLOCK)
+        ENUM_CASE(AST_NODE_BOOL)
+        ENUM_CASE(AST_NODE_INT)
+        ENUM_CASE(AST_NODE_FLOAT)
+        ENUM_CASE(AST_NODE_STRING)
+        ENUM_CASE(AST_NODE_NULL)
+        ENUM_CASE(AST_NODE_LABEL)
+        ENUM_CASE(AST_NODE_SELF)
+        ENUM_CASE(AST_NODE_SUPER)
+        ENUM_CASE(AST_NODE_ARRAY)
+        ENUM_CASE(AST_NODE_UNARY)
+        ENUM_CASE(AST_NODE_BINARY)
+        ENUM_CASE(AST_NODE_ASSIGN)
+        ENUM_CASE(AST_NODE_CALL)
+        ENUM_CASE(AST_NODE_MEMBER)
+        ENUM_CASE(AST_NODE_INDEX)
+        ENUM_CASE(AST_NODE_AS)
+        ENUM_CASE(AST_NODE_IS)
+        ENUM_CASE(AST_NODE_TYPE)
+        ENUM_CASE(AST_NODE_DECL)
+        ENUM_CASE(AST_NODE_PARAM)
+        ENUM_CASE(AST_NODE_FUNC)
+        ENUM_CASE(AST_NODE_CLASS)
+        ENUM_CASE(AST_NODE_IF)
+        ENUM_CASE(AST_NODE_WHILE)
+        ENUM_CASE(AST_NODE_FOR)
+        ENUM_CASE(AST_NODE_RETURN)
+        ENUM_CASE(AST_NODE_BREAK)
+        ENUM_CASE(AST_NODE_CONTINUE)
+        ENUM_CASE(AST_NODE_REQUIRES)
+        default: return "";
+    }
+}
\ No newline at end of file
@@ -0,0 +1,1203 @@
+/* -=============
+     Includes
+   =============- */
+
+#define FLUFF_IMPLEMENTATION
+#include <base.h>
+#include <error.h>
+#include <parser/codegen.h>
+#include <parser/interpret.h>
+#include <core/object.h>
+#include <core/method.h>
+#include <core/class.h>
+#include <core/instance.h>
+#include <core/config.h>
+
+/* -==============
+     Internals
+   ==============- */
+
+#define CODEGEN_NO_TOKEN UINT32_MAX
+
+FLUFF_CONSTEXPR int codegen_type_klass(TokenType type) {
+    switch (type) {
+        case TOKEN_VOID:   return FLUFF_KLASS_VOID;
+        case TOKEN_BOOL:   return FLUFF_KLASS_BOOL;
+        case TOKEN_INT:    return FLUFF_KLASS_INT;
+        case TOKEN_FLOAT:  return FLUFF_KLASS_FLOAT;
+        case TOKEN_STRING: return FLUFF_KLASS_STRING;
+        case TOKEN_ARRAY:  return FLUFF_KLASS_ARRAY;
+        case TOKEN_OBJECT: return FLUFF_KLASS_OBJECT;
+        default:           return -1;
+    }
+}
+
+FLUFF_CONSTEXPR uint8_t codegen_binary_op(TokenType type) {
+    switch (type) {
+        case TOKEN_PLUS:           return IR_OP_ADD;
+        case TOKEN_MINUS:          return IR_OP_SUB;
+        case TOKEN_MULTIPLY:       return IR_OP_MUL;
+        case TOKEN_DIVIDE:         return IR_OP_DIV;
+        case TOKEN_MODULO:         return IR_OP_MOD;
+        case TOKEN_POWER:          return IR_OP_POW;
+        case TOKEN_BIT_AND:        return IR_OP_BIT_AND;
+        case TOKEN_BIT_OR:         return IR_OP_BIT_OR;
+        case TOKEN_BIT_XOR:        return IR_OP_BIT_XOR;
+        case TOKEN_BIT_SHL:        return IR_OP_BIT_SHL;
+        case TOKEN_BIT_SHR:        return IR_OP_BIT_SHR;
+        case TOKEN_EQUALS:         return IR_OP_EQ;
+        case TOKEN_NOT_EQUALS:     return IR_OP_NE;
+        case TOKEN_GREATER:        return IR_OP_GT;
+        case TOKEN_GREATER_EQUALS: return IR_OP_GE;
+        case TOKEN_LESS:           return IR_OP_LT;
+        case TOKEN_LESS_EQUALS:    return IR_OP_LE;
+        case TOKEN_AND:            return IR_OP_AND;
+        case TOKEN_OR:             return IR_OP_OR;
+        default:                   return IR_OP_NOP;
+    }
+}
+
+FLUFF_CONSTEXPR uint8_t codegen_unary_op(TokenType type) {
+    switch (type) {
+        case TOKEN_PLUS:    return IR_OP_PROMOTE;
+        case TOKEN_MINUS:   return IR_OP_NEGATE;
+        case TOKEN_NOT:     return IR_OP_NOT;
+        case TOKEN_BIT_NOT: return IR_OP_BIT_NOT;
+        default:            return IR_OP_NOP;
+    }
+}
+
+FLUFF_CONSTEXPR const char * codegen_path(CodeGen * self) {
+    return (self->lexer->interpret ? self->lexer->interpret->path : NULL);
+}
+
+FLUFF_CONSTEXPR FluffResult codegen_unexpected(CodeGen * self, const char * expected) {
+    const Token * token = _codegen_peek(self, 0);
+    if (token->type == TOKEN_EOF) {
+        fluff_push_log(FLUFF_LOG_TYPE_ERROR, codegen_path(self), token->start.line + 1, token->start.column + 1,
+            "expected %s, found end of file", expected
+        );
+    } else {
+        fluff_push_log(FLUFF_LOG_TYPE_ERROR, codegen_path(self), token->start.line + 1, token->start.column + 1,
+            "expected %s, found '%.*s'", expected, (int)token->length, &self->lexer->str[token->start.index]
+        );
+    }
+    return FLUFF_FAILURE;
+}
+
+#define _codegen_error(...) {\
+            const Token * __token = _codegen_peek(self, 0);\
+            fluff_push_log(FLUFF_LOG_TYPE_ERROR, codegen_path(self),\
+                __token->start.line + 1, __token->start.column + 1, __VA_ARGS__\
+            );\
+            return FLUFF_FAILURE;\
+        }
+
+#define _codegen_expect(__type, __expected) {\
+            if (!_codegen_match(self, __type)) return codegen_unexpected(self, __expected);\
+        }
+
+#define _codegen_try(__expr) {\
+            if ((__expr) == FLUFF_FAILURE) return FLUFF_FAILURE;\
+        }
+
+#define _codegen_enter() {\
+            if (++self->depth > FLUFF_MAX_PARSER_DEPTH) _codegen_error("code is nested too deeply");\
+        }
+
+#define _codegen_leave() --self->depth
+
+#define _codegen_token_text(__token) (int)(__token)->length, &self->lexer->str[(__token)->start.index]
+
+FLUFF_CONSTEXPR bool codegen_same_name(CodeGen * self, uint32_t a, uint32_t b) {
+    const Token * lhs = &self->lexer->tokens[a];
+    const Token * rhs = &self->lexer->tokens[b];
+    if (lhs->data.sym != SYMBOL_NONE && rhs->data.sym != SYMBOL_NONE) return lhs->data.sym == rhs->data.sym;
+    return lhs->length == rhs->length &&
+        !memcmp(&self->lexer->str[lhs->start.index], &self->lexer->str[rhs->start.index], lhs->length);
+}
+
+FLUFF_CONSTEXPR FluffKlass * codegen_get_klass(CodeGen * self, int klass) {
+    if (klass < 0 || !self->instance) return NULL;
+    return fluff_instance_get_core_class(self->instance, (uint8_t)klass);
+}
+
+/* -=- Types -=- */
+#define CODEGEN_DYNAMIC -1
+
+FLUFF_CONSTEXPR CodeGenType codegen_make_type(int klass) {
+    return (CodeGenType){ .klass = klass, .method = NULL };
+}
+
+// NOTE: 'object' holds values of any class and other classes aren't compiled yet, both are only known at runtime
+FLUFF_CONSTEXPR int codegen_klass_index(CodeGen * self, const FluffKlass * klass) {
+    if (!klass || !self->instance) return CODEGEN_DYNAMIC;
+    for (int i = FLUFF_KLASS_VOID; i <= FLUFF_KLASS_FUNC; ++i)
+        if (i != FLUFF_KLASS_OBJECT && klass == fluff_instance_get_core_class(self->instance, (uint8_t)i)) return i;
+    return CODEGEN_DYNAMIC;
+}
+
+// NOTE: types are resolved through the instance, without one nothing is known until runtime
+FLUFF_CONSTEXPR CodeGenType codegen_klass_type(CodeGen * self, int klass) {
+    return codegen_make_type(codegen_klass_index(self, codegen_get_klass(self, klass)));
+}
+
+FLUFF_CONSTEXPR const char * codegen_type_name(int klass) {
+    switch (klass) {
+        case FLUFF_KLASS_VOID:   return "void";
+        case FLUFF_KLASS_BOOL:   return "bool";
+        case FLUFF_KLASS_INT:    return "int";
+        case FLUFF_KLASS_FLOAT:  return "float";
+        case FLUFF_KLASS_STRING: return "string";
+        case FLUFF_KLASS_ARRAY:  return "array";
+        case FLUFF_KLASS_FUNC:   return "func";
+        default:                 return "object";
+    }
+}
+
+FLUFF_CONSTEXPR int codegen_value_klass(CodeGenValue value) {
+    switch (value.op) {
+        case IR_OP_PUSH_TRUE:
+        case IR_OP_PUSH_FALSE: return FLUFF_KLASS_BOOL;
+        case IR_OP_PUSH_INT:   return FLUFF_KLASS_INT;
+        case IR_OP_PUSH_FLOAT: return FLUFF_KLASS_FLOAT;
+        default:               return FLUFF_KLASS_STRING;
+    }
+}
+
+// NOTE: mirrors the operators of the core classes, which only take operands of the same class
+FLUFF_CONSTEXPR int codegen_binary_type(uint8_t op, int lhs, int rhs) {
+    if (lhs != rhs) return CODEGEN_DYNAMIC;
+
+    const bool is_cmp = (op >= IR_OP_EQ && op <= IR_OP_LE);
+    switch (lhs) {
+        case FLUFF_KLASS_BOOL:   return (op == IR_OP_EQ || op == IR_OP_NE || op == IR_OP_AND || op == IR_OP_OR ? FLUFF_KLASS_BOOL : CODEGEN_DYNAMIC);
+        case FLUFF_KLASS_INT:    return (is_cmp ? FLUFF_KLASS_BOOL : (op >= IR_OP_ADD && op <= IR_OP_BIT_SHR ? FLUFF_KLASS_INT : CODEGEN_DYNAMIC));
+        case FLUFF_KLASS_FLOAT:  return (is_cmp ? FLUFF_KLASS_BOOL : (op >= IR_OP_ADD && op <= IR_OP_POW ? FLUFF_KLASS_FLOAT : CODEGEN_DYNAMIC));
+        case FLUFF_KLASS_STRING: return (is_cmp ? FLUFF_KLASS_BOOL : (op == IR_OP_ADD ? FLUFF_KLASS_STRING : CODEGEN_DYNAMIC));
+        default:                 return CODEGEN_DYNAMIC;
+    }
+}
+
+FLUFF_CONSTEXPR int codegen_unary_type(uint8_t op, int operand) {
+    switch (op) {
+        case IR_OP_PROMOTE: return operand;
+        case IR_OP_NEGATE:  return (operand == FLUFF_KLASS_INT || operand == FLUFF_KLASS_FLOAT ? operand : CODEGEN_DYNAMIC);
+        case IR_OP_BIT_NOT: return (operand == FLUFF_KLASS_INT ? FLUFF_KLASS_INT : CODEGEN_DYNAMIC);
+        case IR_OP_NOT:     return (operand == FLUFF_KLASS_BOOL ? FLUFF_KLASS_BOOL : CODEGEN_DYNAMIC);
+        default:            return CODEGEN_DYNAMIC;
+    }
+}
+
+// NOTE: the typed opcodes of ints and floats follow the order of the generic ones, the other classes have none
+FLUFF_CONSTEXPR uint8_t codegen_typed_op(uint8_t op, int klass) {
+    if (klass != FLUFF_KLASS_INT && klass != FLUFF_KLASS_FLOAT) return op;
+
+    const uint8_t base = (klass == FLUFF_KLASS_INT ? IR_OP_IADD : IR_OP_FADD);
+    switch (op) {
+        case IR_OP_ADD: return base;
+        case IR_OP_SUB: return base + 1;
+        case IR_OP_MUL: return base + 2;
+        case IR_OP_EQ:
+        case IR_OP_NE:
+        case IR_OP_GT:
+        case IR_OP_GE:
+        case IR_OP_LT:
+        case IR_OP_LE:  return (uint8_t)(base + 3 + (op - IR_OP_EQ));
+        default:        return op;
+    }
+}
+
+// NOTE: a function without a return type may return anything, unless strict mode makes it return nothing
+FLUFF_CONSTEXPR int codegen_ret_klass(CodeGen * self, const FluffMethod * method) {
+    if (!method->ret_type) return (self->strict ? FLUFF_KLASS_VOID : CODEGEN_DYNAMIC);
+    return codegen_klass_index(self, method->ret_type);
+}
+
+// Makes sure the value on top of the stack is of class 'klass', returns false when it never can be.
+// NOTE: a value only known at runtime is checked by the VM, it's proven from there on
+FLUFF_CONSTEXPR bool codegen_coerce(CodeGen * self, int klass) {
+    if (klass == CODEGEN_DYNAMIC || self->type.klass == klass) return true;
+    if (self->type.klass != CODEGEN_DYNAMIC) return false;
+
+    _codegen_emit_const(self, IR_OP_CHECK, _ir_binary_add_klass(self->binary, codegen_get_klass(self, klass)));
+    self->type = codegen_make_type(klass);
+    return true;
+}
+
+/* -=- Locals -=- */
+FLUFF_CONSTEXPR void codegen_add_local(CodeGen * self, uint32_t token, bool constant, CodeGenType type) {
+    if (self->local_count >= self->local_capacity) {
+        self->local_capacity = FLUFF_MAX(self->local_capacity * 2, 16);
+        self->locals         = fluff_alloc(self->locals, sizeof(CodeGenLocal) * self->local_capacity);
+    }
+    self->locals[self->local_count++] = (CodeGenLocal){ 
+        .token = token, .depth = self->scope_depth, .constant = constant, .type = type, .value = { .op = IR_OP_NOP, .index = 0 }
+    };
+}
+
+// NOTE: only locals of the function being compiled are visible, there are no closures
+FLUFF_CONSTEXPR CodeGenLocal * codegen_find_local(CodeGen * self, uint32_t token, size_t * slot) {
+    for (size_t i = self->local_count; i > self->local_base; --i) {
+        CodeGenLocal * local = &self->locals[i - 1];
+        if (local->token == CODEGEN_NO_TOKEN || !codegen_same_name(self, local->token, token)) continue;
+        * slot = i - 1 - self->local_base;
+        return local;
+    }
+    return NULL;
+}
+
+// NOTE: a condition that can't be a bool is only an error in strict mode, the VM reports it otherwise
+FLUFF_CONSTEXPR FluffResult codegen_check_condition(CodeGen * self) {
+    if (self->strict && self->type.klass != FLUFF_KLASS_BOOL)
+        _codegen_error("condition must be of type 'bool', not '%s'", codegen_type_name(self->type.klass));
+    return FLUFF_OK;
+}
+
+FLUFF_CONSTEXPR void codegen_emit_pops(CodeGen * self, size_t count) {
+    if (count == 1) _codegen_emit(self, IR_OP_POP);
+    else if (count > 1) _codegen_emit_uint(self, IR_OP_POPN, count);
+}
+
+FLUFF_CONSTEXPR void codegen_begin_scope(CodeGen * self) {
+    ++self->scope_depth;
+}
+
+FLUFF_CONSTEXPR void codegen_end_scope(CodeGen * self) {
+    const size_t count = self->local_count;
+    while (self->local_count > self->local_base && self->locals[self->local_count - 1].depth >= self->scope_depth)
+        --self->local_count;
+    codegen_emit_pops(self, count - self->local_count);
+    --self->scope_depth;
+}
+
+/* -=- Functions -=- */
+FLUFF_CONSTEXPR CodeGenFunc * codegen_find_func(CodeGen * self, uint32_t token) {
+    for (size_t i = 0; i < self->func_count; ++i)
+        if (codegen_same_name(self, self->funcs[i].token, token)) return &self->funcs[i];
+    return NULL;
+}
+
+// NOTE: the method is created on first use so calls may come before the definition
+FLUFF_CONSTEXPR CodeGenFunc * codegen_get_func(CodeGen * self, uint32_t token) {
+    CodeGenFunc * func = codegen_find_func(self, token);
+    if (func) return func;
+
+    if (self->func_count >= self->func_capacity) {
+        self->func_capacity = FLUFF_MAX(self->func_capacity * 2, 16);
+        self->funcs         = fluff_alloc(self->funcs, sizeof(CodeGenFunc) * self->func_capacity);
+    }
+
+    const Token * name   = &self->lexer->tokens[token];
+    FluffMethod * method = _new_method(&self->lexer->str[name->start.index], name->length);
+
+    func = &self->funcs[self->func_count++];
+    func->token   = token;
+    func->index    = _ir_binary_add_method(self->binary, method);
+    func->declared = false;
+    func->defined  = false;
+    return func;
+}
+
+FLUFF_CONSTEXPR void codegen_reset_signature(FluffMethod * method) {
+    if (method->properties) fluff_free(method->properties);
+    method->properties     = NULL;
+    method->property_count = 0;
+    method->ret_type       = NULL;
+}
+
+FLUFF_CONSTEXPR void codegen_add_param(CodeGen * self, FluffMethod * method, uint32_t token, int klass) {
+    const Token * param = &self->lexer->tokens[token];
+    char name[FLUFF_MAX_FIELD_NAME_LEN] = { 0 };
+    memcpy(name, &self->lexer->str[param->start.index], FLUFF_MIN(param->length, FLUFF_MAX_FIELD_NAME_LEN - 1));
+    _method_add_property(method, name, codegen_get_klass(self, klass));
+}
+
+// Gives every function its signature before anything is compiled, so calls placed before a definition are checked too.
+// NOTE: malformed signatures are skipped, compiling their definition reports them
+static void codegen_declare_funcs(CodeGen * self) {
+    const size_t index = self->index;
+    for (size_t i = 0; i < self->lexer->token_count; ++i) {
+        self->index = i;
+        if (!_codegen_match(self, TOKEN_FUNC) || !_codegen_check(self, TOKEN_LABEL_LITERAL) || _codegen_peek(self, 1)->type != TOKEN_LPAREN) continue;
+
+        CodeGenFunc * func   = codegen_get_func(self, _codegen_consume(self));
+        FluffMethod * method = self->binary->methods[func->index];
+        codegen_reset_signature(method);
+        _codegen_consume(self);
+
+        bool valid = true;
+        if (!_codegen_match(self, TOKEN_RPAREN)) {
+            do {
+                const uint32_t param = (uint32_t)self->index;
+                const int      klass = codegen_type_klass(_codegen_peek(self, 2)->type);
+                valid = (_codegen_match(self, TOKEN_LABEL_LITERAL) && _codegen_match(self, TOKEN_COLON) && 
+                    (klass >= 0 || _codegen_check(self, TOKEN_LABEL_LITERAL)));
+                if (!valid) break;
+
+                _codegen_consume(self);
+                codegen_add_param(self, method, param, klass);
+            } while (_codegen_match(self, TOKEN_COMMA));
+            valid = (valid && _codegen_match(self, TOKEN_RPAREN));
+        }
+
+        func->declared = valid;
+        if (!valid) codegen_reset_signature(method);
+        else if (_codegen_match(self, TOKEN_ARROW)) method->ret_type = codegen_get_klass(self, codegen_type_klass(_codegen_peek(self, 0)->type));
+    }
+    self->index = index;
+}
+
+/* -=- Loops -=- */
+FLUFF_CONSTEXPR void codegen_push_jump(CodeGen * self, size_t offset, bool is_break) {
+    if (self->jump_count >= self->jump_capacity) {
+        self->jump_capacity = FLUFF_MAX(self->jump_capacity * 2, 16);
+        self->jumps         = fluff_alloc(self->jumps, sizeof(CodeGenJump) * self->jump_capacity);
+    }
+    self->jumps[self->jump_count++] = (CodeGenJump){ .offset = offset, .is_break = is_break };
+}
+
+FLUFF_CONSTEXPR void codegen_patch_loop(CodeGen * self, CodeGenLoop * loop, bool is_break) {
+    for (size_t i = loop->jump_base; i < self->jump_count; ++i)
+        if (self->jumps[i].is_break == is_break) _codegen_patch_jump(self, self->jumps[i].offset);
+}
+
+FLUFF_CONSTEXPR void codegen_begin_loop(CodeGen * self, CodeGenLoop * loop, size_t start) {
+    loop->prev        = self->loop;
+    loop->start       = start;
+    loop->local_count = self->local_count;
+    loop->jump_base   = self->jump_count;
+    self->loop        = loop;
+}
+
+FLUFF_CONSTEXPR void codegen_end_loop(CodeGen * self, CodeGenLoop * loop) {
+    codegen_patch_loop(self, loop, true);
+    self->jump_count = loop->jump_base;
+    self->loop       = loop->prev;
+}
+
+/* -=- Folding -=- */
+typedef FluffResult(* CodeGenBinaryFn)(FluffObject *, FluffObject *, FluffObject *);
+typedef FluffResult(* CodeGenUnaryFn)(FluffObject *, FluffObject *);
+
+// NOTE: mirrors the dispatch of the VM, so folded values are exactly the ones computed at runtime
+FLUFF_CONSTEXPR CodeGenBinaryFn codegen_binary_fn(uint8_t op, bool * is_bool) {
+    * is_bool = (op >= IR_OP_EQ && op <= IR_OP_OR);
+    switch (op) {
+        case IR_OP_ADD:     return fluff_object_add;
+        case IR_OP_SUB:     return fluff_object_sub;
+        case IR_OP_MUL:     return fluff_object_mul;
+        case IR_OP_DIV:     return fluff_object_div;
+        case IR_OP_MOD:     return fluff_object_mod;
+        case IR_OP_POW:     return fluff_object_pow;
+        case IR_OP_BIT_AND: return fluff_object_bit_and;
+        case IR_OP_BIT_OR:  return fluff_object_bit_or;
+        case IR_OP_BIT_XOR: return fluff_object_bit_xor;
+        case IR_OP_BIT_SHL: return fluff_object_bit_shl;
+        case IR_OP_BIT_SHR: return fluff_object_bit_shr;
+        case IR_OP_EQ:      return fluff_object_eq;
+        case IR_OP_NE:      return fluff_object_ne;
+        case IR_OP_GT:      return fluff_object_gt;
+        case IR_OP_GE:      return fluff_object_ge;
+        case IR_OP_LT:      return fluff_object_lt;
+        case IR_OP_LE:      return fluff_object_le;
+        case IR_OP_AND:     return fluff_object_and;
+        case IR_OP_OR:      return fluff_object_or;
+        default:            return NULL;
+    }
+}
+
+FLUFF_CONSTEXPR CodeGenUnaryFn codegen_unary_fn(uint8_t op, bool * is_bool) {
+    * is_bool = (op == IR_OP_NOT);
+    switch (op) {
+        case IR_OP_BIT_NOT: return fluff_object_bit_not;
+        case IR_OP_NEGATE:  return fluff_object_negate;
+        case IR_OP_NOT:     return fluff_object_not;
+        default:            return NULL;
+    }
+}
+
+// NOTE: only succeeds when everything emitted since 'start' is the push of a known value
+FLUFF_CONSTEXPR bool codegen_get_folded(CodeGen * self, size_t start, CodeGenValue * value) {
+    if (self->folded.op == IR_OP_NOP || self->folded_chunk != self->chunk) return false;
+    if (self->folded_start != start || self->folded_end != self->chunk->size) return false;
+    * value = self->folded;
+    return true;
+}
+
+FLUFF_CONSTEXPR void codegen_value_object(CodeGen * self, CodeGenValue value, FluffObject * obj) {
+    const IRConstant * constant = _ir_binary_get_constant(self->binary, value.index);
+    switch (value.op) {
+        case IR_OP_PUSH_TRUE:
+        case IR_OP_PUSH_FALSE: { _new_bool_object(obj, self->instance, (value.op == IR_OP_PUSH_TRUE)); break; }
+        case IR_OP_PUSH_INT:   { _new_int_object(obj, self->instance, constant->data.i); break; }
+        case IR_OP_PUSH_FLOAT: { _new_float_object(obj, self->instance, constant->data.f); break; }
+        default:               { _new_string_object_n(obj, self->instance, constant->data.s.data, constant->data.s.length); break; }
+    }
+}
+
+// NOTE: operations on known values always give a bool, an int, a float or a string back
+FLUFF_CONSTEXPR CodeGenValue codegen_object_value(CodeGen * self, FluffObject * obj) {
+    if (obj->klass == fluff_instance_get_core_class(self->instance, FLUFF_KLASS_BOOL))
+        return (CodeGenValue){ .op = (obj->data._bool ? IR_OP_PUSH_TRUE : IR_OP_PUSH_FALSE), .index = 0 };
+    if (obj->klass == fluff_instance_get_core_class(self->instance, FLUFF_KLASS_INT))
+        return (CodeGenValue){ .op = IR_OP_PUSH_INT, .index = _ir_binary_add_int(self->binary, obj->data._int) };
+    if (obj->klass == fluff_instance_get_core_class(self->instance, FLUFF_KLASS_FLOAT))
+        return (CodeGenValue){ .op = IR_OP_PUSH_FLOAT, .index = _ir_binary_add_float(self->binary, obj->data._float) };
+    return (CodeGenValue){ 
+        .op = IR_OP_PUSH_STRING, .index = _ir_binary_add_string(self->binary, obj->data._string.data, obj->data._string.length) 
+    };
+}
+
+// NOTE: errors raised while folding are turned into warnings pointing at the operator
+FLUFF_CONSTEXPR void codegen_demote_logs(CodeGen * self, size_t first, uint32_t token) {
+    const Token * op  = &self->lexer->tokens[token];
+    FluffLog    * log = fluff_get_log_buffer();
+    for (size_t i = first; i < fluff_get_log_count(); ++i) {
+        log[i].type   = FLUFF_LOG_TYPE_WARN;
+        log[i].file   = codegen_path(self);
+        log[i].line   = op->start.line + 1;
+        log[i].column = op->start.column + 1;
+    }
+}
+
+// Replaces the code emitted since 'start' with the result of 'op', 'rhs' is NULL for unary operators.
+// NOTE: constants added since 'constants' only belonged to the replaced code, so they're dropped as well
+// NOTE: an operation that fails is left for the runtime, which reports the same error once it's reached
+static bool codegen_fold(CodeGen * self, size_t start, size_t constants, uint32_t token, uint8_t op, const CodeGenValue * lhs, const CodeGenValue * rhs) {
+    if (!self->instance) return false;
+
+    bool            is_bool   = false;
+    CodeGenBinaryFn binary_fn = (rhs ? codegen_binary_fn(op, &is_bool) : NULL);
+    CodeGenUnaryFn  unary_fn  = (rhs ? NULL : codegen_unary_fn(op, &is_bool));
+    if (!binary_fn && !unary_fn) return false;
+
+    FluffObject a, b, result;
+    codegen_value_object(self, * lhs, &a);
+    if (rhs) codegen_value_object(self, * rhs, &b);
+    _new_null_object(&result, self->instance, 
+        (is_bool ? fluff_instance_get_core_class(self->instance, FLUFF_KLASS_BOOL) : a.klass)
+    );
+
+    const size_t      log_count = fluff_get_log_count();
+    const FluffResult res       = (rhs ? binary_fn(&a, &b, &result) : unary_fn(&a, &result));
+
+    if (res == FLUFF_OK) {
+        _ir_binary_truncate_constants(self->binary, constants);
+        self->chunk->size = start;
+        _codegen_emit_value(self, codegen_object_value(self, &result));
+    } else codegen_demote_logs(self, log_count, token);
+
+    _free_object(&a);
+    if (rhs) _free_object(&b);
+    _free_object(&result);
+    return (res == FLUFF_OK);
+}
+
+/* -=- Logic -=- */
+// Compiles the right side of '&&' or '||', which only runs when the left side doesn't decide the result.
+// NOTE: a left side known at compile time decides it there, the right side is still compiled for its errors
+static FluffResult codegen_compile_logical(CodeGen * self, size_t start, size_t constants, uint32_t token, TokenType op, int op_level) {
+    const bool        is_and    = (op == TOKEN_AND);
+    const uint8_t     ir_op     = codegen_binary_op(op);
+    const CodeGenType lhs_type  = self->type;
+    CodeGenValue      lhs, rhs;
+    const bool        lhs_known = (codegen_get_folded(self, start, &lhs) && codegen_value_klass(lhs) == FLUFF_KLASS_BOOL);
+
+    const size_t skip      = (lhs_known ? 0 : _codegen_emit_jump(self, (is_and ? IR_OP_JZ : IR_OP_JNZ)));
+    const size_t rhs_start = self->chunk->size;
+    _codegen_try(_codegen_compile_expr(self, op_level + 1));
+
+    const int klass = codegen_binary_type(ir_op, lhs_type.klass, self->type.klass);
+    if (self->strict && klass == CODEGEN_DYNAMIC) {
+        const int rhs_klass = self->type.klass;
+        self->index = token;
+        _codegen_error("cannot apply '%.*s' to values of type '%s' and '%s'", 
+            _codegen_token_text(&self->lexer->tokens[token]), codegen_type_name(lhs_type.klass), codegen_type_name(rhs_klass)
+        );
+    }
+
+    if (lhs_known && (lhs.op == IR_OP_PUSH_TRUE) != is_and) {
+        _ir_binary_truncate_constants(self->binary, constants);
+        self->chunk->size = start;
+        _codegen_emit_value(self, lhs);
+        return FLUFF_OK;
+    }
+    if (lhs_known && codegen_get_folded(self, rhs_start, &rhs) && codegen_fold(self, start, constants, token, ir_op, &lhs, &rhs)) 
+        return FLUFF_OK;
+
+    // NOTE: the right side is the result, so it's checked to be a bool like the operator did with both sides
+    if (self->type.klass != FLUFF_KLASS_BOOL && self->instance)
+        _codegen_emit_const(self, IR_OP_CHECK, _ir_binary_add_klass(self->binary, codegen_get_klass(self, FLUFF_KLASS_BOOL)));
+
+    if (lhs_known) {
+        // NOTE: a left side that decides nothing is dropped from in front of the right side, jumps in it are relative
+        memmove(&self->chunk->data[start], &self->chunk->data[rhs_start], self->chunk->size - rhs_start);
+        self->chunk->size -= rhs_start - start;
+        self->folded.op    = IR_OP_NOP;
+    } else {
+        const size_t end = _codegen_emit_jump(self, IR_OP_JMP);
+        _codegen_patch_jump(self, skip);
+        _codegen_emit(self, (is_and ? IR_OP_PUSH_FALSE : IR_OP_PUSH_TRUE));
+        _codegen_patch_jump(self, end);
+    }
+    self->type = codegen_make_type(FLUFF_KLASS_BOOL);
+    return FLUFF_OK;
+}
+
+/* -============
+     CodeGen
+   ============- */
+
+/* -=- Initializers -=- */
+FLUFF_PRIVATE_API void _new_codegen(CodeGen * self, Lexer * lexer, IRBinary * binary, FluffInstance * instance) {
+    FLUFF_CLEANUP(self);
+    self->lexer    = lexer;
+    self->binary   = binary;
+    self->chunk    = &binary->main_chunk;
+    self->instance = instance;
+
+    self->eof       = _make_token(TOKEN_EOF);
+    self->eof.start = lexer->location;
+
+    // NOTE: types are resolved through the instance, without one strict mode couldn't prove anything
+    self->strict = (instance && fluff_get_config().strict_mode);
+    self->type   = codegen_make_type(CODEGEN_DYNAMIC);
+}
+
+FLUFF_PRIVATE_API void _free_codegen(CodeGen * self) {
+    if (self->locals) fluff_free(self->locals);
+    if (self->funcs)  fluff_free(self->funcs);
+    if (self->jumps)  fluff_free(self->jumps);
+    FLUFF_CLEANUP(self);
+}
+
+/* -=- Compiling -=- */
+FLUFF_PRIVATE_API FluffResult _codegen_compile(CodeGen * self) {
+    codegen_declare_funcs(self);
+    self->chunk->typed = true;
+
+    while (!_codegen_check(self, TOKEN_EOF)) {
+        if (_codegen_match(self, TOKEN_END)) continue;
+        _codegen_try(_codegen_compile_statement(self));
+    }
+
+    for (size_t i = 0; i < self->func_count; ++i) {
+        if (self->funcs[i].defined) continue;
+
+        const Token * token = &self->lexer->tokens[self->funcs[i].token];
+        fluff_push_log(FLUFF_LOG_TYPE_ERROR, codegen_path(self), token->start.line + 1, token->start.column + 1,
+            "function '%.*s' is used but never defined", _codegen_token_text(token)
+        );
+        return FLUFF_FAILURE;
+    }
+
+    // NOTE: the main chunk leaves its top-level locals on the stack, the caller drops them
+    _codegen_emit(self, IR_OP_PUSH_VOID);
+    _codegen_emit(self, IR_OP_RET);
+    return FLUFF_OK;
+}
+
+FLUFF_PRIVATE_API FluffResult _codegen_compile_statement(CodeGen * self) {
+    const Token * token = _codegen_peek(self, 0);
+    switch (token->type) {
+        case TOKEN_LET:
+        case TOKEN_CONST:  return _codegen_compile_decl(self);
+        case TOKEN_FUNC:   return _codegen_compile_func(self);
+        case TOKEN_LBRACE: return _codegen_compile_block(self);
+        case TOKEN_IF:     return _codegen_compile_if(self);
+        case TOKEN_WHILE:  return _codegen_compile_while(self);
+        case TOKEN_FOR:    return _codegen_compile_for(self);
+        case TOKEN_RETURN: {
+            const uint32_t ret = _codegen_consume(self);
+
+            if (_codegen_check(self, TOKEN_END)) {
+                _codegen_emit(self, IR_OP_PUSH_VOID);
+                self->type = codegen_klass_type(self, FLUFF_KLASS_VOID);
+            } else _codegen_try(_codegen_compile_expr(self, 0));
+
+            if (self->method && !codegen_coerce(self, codegen_ret_klass(self, self->method))) {
+                const int klass = self->type.klass;
+                self->index = ret;
+                _codegen_error("'%s' must return a value of type '%s', not '%s'", 
+                    self->method->name, codegen_type_name(codegen_ret_klass(self, self->method)), codegen_type_name(klass)
+                );
+            }
+            _codegen_expect(TOKEN_END, "';' after return");
+
+            // NOTE: returning drops the whole frame, locals don't need to be popped
+            _codegen_emit(self, IR_OP_RET);
+            return FLUFF_OK;
+        }
+        case TOKEN_BREAK:
+        case TOKEN_CONTINUE: return _codegen_compile_jump(self);
+        case TOKEN_PUB:
+        case TOKEN_VIRTUAL:
+        case TOKEN_CLASS:
+        case TOKEN_REQUIRES:
+            _codegen_error("'%.*s' is not supported by the compiler yet", _codegen_token_text(token));
+        default: {
+            _codegen_try(_codegen_compile_expr(self, 0));
+            _codegen_expect(TOKEN_END, "';' after expression");
+            _codegen_emit(self, IR_OP_POP);
+            return FLUFF_OK;
+        }
+    }
+}
+
+FLUFF_PRIVATE_API FluffResult _codegen_compile_block(CodeGen * self) {
+    _codegen_expect(TOKEN_LBRACE, "'{'");
+    _codegen_enter();
+    codegen_begin_scope(self);
+
+    while (!_codegen_match(self, TOKEN_RBRACE)) {
+        if (_codegen_check(self, TOKEN_EOF)) return codegen_unexpected(self, "'}'");
+        if (_codegen_match(self, TOKEN_END)) continue;
+        _codegen_try(_codegen_compile_statement(self));
+    }
+
+    codegen_end_scope(self);
+    _codegen_leave();
+    return FLUFF_OK;
+}
+
+FLUFF_PRIVATE_API FluffResult _codegen_compile_decl(CodeGen * self) {
+    const bool constant = _codegen_check(self, TOKEN_CONST);
+    _codegen_consume(self);
+
+    const uint32_t name = (uint32_t)self->index;
+    _codegen_expect(TOKEN_LABEL_LITERAL, "a variable name");
+
+    for (size_t i = self->local_count; i > self->local_base; --i) {
+        const CodeGenLocal * local = &self->locals[i - 1];
+        if (local->depth < self->scope_depth) break;
+        if (local->token != CODEGEN_NO_TOKEN && codegen_same_name(self, local->token, name)) {
+            self->index = name;
+            _codegen_error("'%.*s' is already declared in this scope", _codegen_token_text(&self->lexer->tokens[name]));
+        }
+    }
+
+    int klass = -1;
+    if (_codegen_match(self, TOKEN_COLON)) {
+        const Token * type = _codegen_peek(self, 0);
+        klass = codegen_type_klass(type->type);
+        if (klass < 0) {
+            if (type->type == TOKEN_LABEL_LITERAL) _codegen_error("unknown type '%.*s'", _codegen_token_text(type));
+            return codegen_unexpected(self, "a type");
+        }
+        if (self->strict && klass == FLUFF_KLASS_OBJECT) _codegen_error("type 'object' can't be checked in strict mode");
+        _codegen_consume(self);
+    }
+
+    // NOTE: the variable is declared after its value, so 'let x = x;' still refers to an outer 'x'
+    const size_t      start = self->chunk->size;
+    const CodeGenType type  = codegen_klass_type(self, klass);
+    if (_codegen_match(self, TOKEN_EQUAL)) {
+        _codegen_try(_codegen_compile_expr(self, _token_type_get_precedence(TOKEN_EQUAL) + 1));
+        if (!codegen_coerce(self, type.klass)) {
+            const int value_klass = self->type.klass;
+            self->index = name;
+            _codegen_error("cannot assign a value of type '%s' to '%.*s' of type '%s'", 
+                codegen_type_name(value_klass), _codegen_token_text(&self->lexer->tokens[name]), codegen_type_name(type.klass)
+            );
+        }
+    } else {
+        if (self->strict && klass < 0) {
+            self->index = name;
+            _codegen_error("'%.*s' needs a type or a value in strict mode", _codegen_token_text(&self->lexer->tokens[name]));
+        }
+        self->type = (type.klass >= 0 ? type : codegen_klass_type(self, FLUFF_KLASS_VOID));
+
+        switch (klass) {
+            case FLUFF_KLASS_BOOL:   { _codegen_emit(self, IR_OP_PUSH_FALSE); break; }
+            case FLUFF_KLASS_INT:    { _codegen_emit_const(self, IR_OP_PUSH_INT, _ir_binary_add_int(self->binary, 0)); break; }
+            case FLUFF_KLASS_FLOAT:  { _codegen_emit_const(self, IR_OP_PUSH_FLOAT, _ir_binary_add_float(self->binary, 0.0)); break; }
+            case FLUFF_KLASS_STRING: { _codegen_emit_const(self, IR_OP_PUSH_STRING, _ir_binary_add_string(self->binary, "", 0)); break; }
+            default:                 { _codegen_emit(self, IR_OP_PUSH_VOID); break; }
+        }
+    }
+    _codegen_expect(TOKEN_END, "';' after declaration");
+
+    // NOTE: variables without a type take the one of their value when they can't change it,
+    // the function a variable refers to is only kept while it can't be assigned another one
+    CodeGenType local_type = (type.klass >= 0 || constant || self->strict ? self->type : type);
+    if (!constant) local_type.method = NULL;
+    codegen_add_local(self, name, constant, local_type);
+
+    CodeGenValue value;
+    if (constant && codegen_get_folded(self, start, &value)) self->locals[self->local_count - 1].value = value;
+    return FLUFF_OK;
+}
+
+FLUFF_PRIVATE_API FluffResult _codegen_compile_func(CodeGen * self) {
+    _codegen_consume(self);
+
+    const uint32_t name = (uint32_t)self->index;
+    _codegen_expect(TOKEN_LABEL_LITERAL, "a function name");
+    _codegen_expect(TOKEN_LPAREN, "'('");
+
+    const size_t  index  = codegen_get_func(self, name)->index;
+    FluffMethod * method = self->binary->methods[index];
+    if (method->chunk) {
+        self->index = name;
+        _codegen_error("function '%.*s' is already defined", _codegen_token_text(&self->lexer->tokens[name]));
+    }
+
+    // NOTE: a definition replaces the signature of an earlier declaration
+    codegen_reset_signature(method);
+    method->index = index;
+
+    // NOTE: slot 0 of every frame holds the callee, parameters follow it
+    IRChunk     * prev_chunk       = self->chunk;
+    CodeGenLoop * prev_loop        = self->loop;
+    FluffMethod * prev_method      = self->method;
+    const size_t  prev_local_base  = self->local_base;
+    const size_t  prev_local_count = self->local_count;
+
+    self->local_base = self->local_count;
+    self->loop       = NULL;
+    codegen_begin_scope(self);
+    codegen_add_local(self, CODEGEN_NO_TOKEN, true, (CodeGenType){ .klass = FLUFF_KLASS_FUNC, .method = method });
+
+    if (!_codegen_match(self, TOKEN_RPAREN)) {
+        do {
+            const uint32_t param = (uint32_t)self->index;
+            _codegen_expect(TOKEN_LABEL_LITERAL, "a parameter name");
+            _codegen_expect(TOKEN_COLON, "':' after parameter name");
+
+            const Token * type  = _codegen_peek(self, 0);
+            const int     klass = codegen_type_klass(type->type);
+            if (type->type != TOKEN_LABEL_LITERAL && klass < 0) return codegen_unexpected(self, "a type");
+            if (self->strict && (klass < 0 || klass == FLUFF_KLASS_OBJECT))
+                _codegen_error("type '%.*s' can't be checked in strict mode", _codegen_token_text(type));
+            _codegen_consume(self);
+
+            if (_codegen_check(self, TOKEN_EQUAL)) _codegen_error("default parameter values are not supported yet");
+
+            codegen_add_param(self, method, param, klass);
+            codegen_add_local(self, param, false, codegen_klass_type(self, klass));
+        } while (_codegen_match(self, TOKEN_COMMA));
+        _codegen_expect(TOKEN_RPAREN, "')' after parameters");
+    }
+
+    if (_codegen_match(self, TOKEN_ARROW)) {
+        const Token * type  = _codegen_peek(self, 0);
+        const int     klass = codegen_type_klass(type->type);
+        if (type->type != TOKEN_LABEL_LITERAL && klass < 0) return codegen_unexpected(self, "a type");
+        if (self->strict && (klass < 0 || klass == FLUFF_KLASS_OBJECT))
+            _codegen_error("type '%.*s' can't be checked in strict mode", _codegen_token_text(type));
+        _codegen_consume(self);
+        method->ret_type = codegen_get_klass(self, klass);
+    }
+
+    // NOTE: functions without a body are only declared
+    codegen_find_func(self, name)->declared = true;
+    if (!_codegen_match(self, TOKEN_END)) {
+        method->chunk = fluff_alloc(NULL, sizeof(IRChunk));
+        _new_ir_chunk(method->chunk);
+        method->chunk->typed = true;
+        self->chunk  = method->chunk;
+        self->method = method;
+
+        _codegen_try(_codegen_compile_block(self));
+
+        // NOTE: falling off the end returns nothing, which only a function returning 'void' may do
+        const int ret_klass = codegen_ret_klass(self, method);
+        _codegen_emit(self, IR_OP_PUSH_VOID);
+        if (ret_klass != CODEGEN_DYNAMIC && ret_klass != FLUFF_KLASS_VOID)
+            _codegen_emit_const(self, IR_OP_CHECK, _ir_binary_add_klass(self->binary, method->ret_type));
+        _codegen_emit(self, IR_OP_RET);
+
+        codegen_find_func(self, name)->defined = true;
+    }
+
+    --self->scope_depth;
+    self->chunk       = prev_chunk;
+    self->loop        = prev_loop;
+    self->method      = prev_method;
+    self->local_base  = prev_local_base;
+    self->local_count = prev_local_count;
+    return FLUFF_OK;
+}
+
+FLUFF_PRIVATE_API FluffResult _codegen_compile_if(CodeGen * self) {
+    _codegen_consume(self);
+    _codegen_try(_codegen_compile_expr(self, 0));
+    _codegen_try(codegen_check_condition(self));
+
+    const size_t else_jump = _codegen_emit_jump(self, IR_OP_JZ);
+    _codegen_try(_codegen_compile_block(self));
+
+    if (!_codegen_match(self, TOKEN_ELSE)) {
+        _codegen_patch_jump(self, else_jump);
+        return FLUFF_OK;
+    }
+
+    const size_t end_jump = _codegen_emit_jump(self, IR_OP_JMP);
+    _codegen_patch_jump(self, else_jump);
+    _codegen_try(_codegen_check(self, TOKEN_IF) ? _codegen_compile_if(self) : _codegen_compile_block(self));
+    _codegen_patch_jump(self, end_jump);
+    return FLUFF_OK;
+}
+
+FLUFF_PRIVATE_API FluffResult _codegen_compile_while(CodeGen * self) {
+    _codegen_consume(self);
+
+    const size_t start = self->chunk->size;
+    _codegen_try(_codegen_compile_expr(self, 0));
+    _codegen_try(codegen_check_condition(self));
+    const size_t exit_jump = _codegen_emit_jump(self, IR_OP_JZ);
+
+    CodeGenLoop loop;
+    codegen_begin_loop(self, &loop, start);
+    _codegen_try(_codegen_compile_block(self));
+    _codegen_emit_loop(self, start);
+
+    _codegen_patch_jump(self, exit_jump);
+    codegen_end_loop(self, &loop);
+    return FLUFF_OK;
+}
+
+// NOTE: there are no iterable objects yet, so 'for i in n' counts from 0 up to n - 1
+FLUFF_PRIVATE_API FluffResult _codegen_compile_for(CodeGen * self) {
+    _codegen_consume(self);
+
+    const uint32_t name = (uint32_t)self->index;
+    _codegen_expect(TOKEN_LABEL_LITERAL, "a loop variable");
+    _codegen_expect(TOKEN_IN, "'in'");
+
+    codegen_begin_scope(self);
+
+    // Hidden limit and counter
+    const size_t limit = self->local_count - self->local_base;
+    _codegen_try(_codegen_compile_expr(self, 0));
+    if (self->strict && self->type.klass != FLUFF_KLASS_INT)
+        _codegen_error("loop limit must be of type 'int', not '%s'", codegen_type_name(self->type.klass));
+    const bool int_limit = (self->type.klass == FLUFF_KLASS_INT);
+    codegen_add_local(self, CODEGEN_NO_TOKEN, true, self->type);
+
+    // NOTE: only ever incremented by the loop itself, so the counter and the loop variable are always ints
+    const size_t counter = limit + 1;
+    _codegen_emit_const(self, IR_OP_PUSH_INT, _ir_binary_add_int(self->binary, 0));
+    codegen_add_local(self, CODEGEN_NO_TOKEN, false, codegen_make_type(FLUFF_KLASS_INT));
+
+    const size_t start = self->chunk->size;
+    _codegen_emit_uint(self, IR_OP_GET_LOCAL, counter);
+    _codegen_emit_uint(self, IR_OP_GET_LOCAL, limit);
+    _codegen_emit(self, (int_limit ? IR_OP_ILT : IR_OP_LT));
+    const size_t exit_jump = _codegen_emit_jump(self, IR_OP_JZ);
+
+    CodeGenLoop loop;
+    codegen_begin_loop(self, &loop, SIZE_MAX);
+
+    codegen_begin_scope(self);
+    _codegen_emit_uint(self, IR_OP_GET_LOCAL, counter);
+    codegen_add_local(self, name, false, codegen_make_type(FLUFF_KLASS_INT));
+    _codegen_try(_codegen_compile_block(self));
+    codegen_end_scope(self);
+
+    codegen_patch_loop(self, &loop, false);
+    _codegen_emit_uint(self, IR_OP_GET_LOCAL, counter);
+    _codegen_emit_const(self, IR_OP_PUSH_INT, _ir_binary_add_int(self->binary, 1));
+    _codegen_emit(self, IR_OP_IADD);
+    _codegen_emit_uint(self, IR_OP_SET_LOCAL, counter);
+    _codegen_emit(self, IR_OP_POP);
+    _codegen_emit_loop(self, start);
+
+    _codegen_patch_jump(self, exit_jump);
+    codegen_end_loop(self, &loop);
+    codegen_end_scope(self);
+    return FLUFF_OK;
+}
+
+FLUFF_PRIVATE_API FluffResult _codegen_compile_jump(CodeGen * self) {
+    const Token * token    = _codegen_peek(self, 0);
+    const bool    is_break = (token->type == TOKEN_BREAK);
+    if (!self->loop) _codegen_error("'%.*s' outside of a loop", _codegen_token_text(token));
+    _codegen_consume(self);
+    _codegen_expect(TOKEN_END, "';'");
+
+    // NOTE: locals declared inside the loop are dropped before leaving it
+    codegen_emit_pops(self, self->local_count - self->loop->local_count);
+    if (!is_break && self->loop->start != SIZE_MAX) _codegen_emit_loop(self, self->loop->start);
+    else codegen_push_jump(self, _codegen_emit_jump(self, IR_OP_JMP), is_break);
+    return FLUFF_OK;
+}
+
+FLUFF_PRIVATE_API FluffResult _codegen_compile_expr(CodeGen * self, int precedence) {
+    _codegen_enter();
+
+    const size_t    start     = self->chunk->size;
+    const size_t    constants = self->binary->constant_count;
+    const TokenType prefix = _codegen_peek(self, 0)->type;
+    if (_token_type_is_prefix_operator(prefix)) {
+        const uint32_t token = _codegen_consume(self);
+        _codegen_try(_codegen_compile_expr(self, TOKEN_UNARY_PRECEDENCE));
+
+        // NOTE: promoting does nothing at runtime, a known value is left as it is
+        const uint8_t op    = codegen_unary_op(prefix);
+        const int     klass = codegen_unary_type(op, self->type.klass);
+        if (self->strict && klass == CODEGEN_DYNAMIC) {
+            const int operand_klass = self->type.klass;
+            self->index = token;
+            _codegen_error("cannot apply '%.*s' to a value of type '%s'", 
+                _codegen_token_text(&self->lexer->tokens[token]), codegen_type_name(operand_klass)
+            );
+        }
+
+        CodeGenValue operand;
+        if (!codegen_get_folded(self, start, &operand))
+            _codegen_emit(self, op);
+        else if (op != IR_OP_PROMOTE && !codegen_fold(self, start, constants, token, op, &operand, NULL))
+            _codegen_emit(self, op);
+        self->type = codegen_make_type(klass);
+    } else {
+        _codegen_try(_codegen_compile_primary(self, precedence));
+    }
+
+    while (true) {
+        const TokenType op       = _codegen_peek(self, 0)->type;
+        const int       op_level = _token_type_get_precedence(op);
+        if (op_level == 0 || op_level < precedence) break;
+
+        const uint32_t token = _codegen_consume(self);
+        if (op == TOKEN_EQUAL) {
+            self->index = token;
+            _codegen_error("invalid assignment target");
+        }
+
+        if (op == TOKEN_AS || op == TOKEN_IS) {
+            const Token * type  = _codegen_peek(self, 0);
+            const int     klass = codegen_type_klass(type->type);
+            if (klass < 0) {
+                if (type->type == TOKEN_LABEL_LITERAL) _codegen_error("unknown type '%.*s'", _codegen_token_text(type));
+                return codegen_unexpected(self, "a type");
+            }
+            if (!self->instance) _codegen_error("'%s' needs an instance to resolve types", (op == TOKEN_AS ? "as" : "is"));
+            if (self->strict && op == TOKEN_AS && klass == FLUFF_KLASS_OBJECT) _codegen_error("type 'object' can't be checked in strict mode");
+            _codegen_consume(self);
+            _codegen_emit_const(self, (op == TOKEN_AS ? IR_OP_AS : IR_OP_IS), _ir_binary_add_klass(self->binary, codegen_get_klass(self, klass)));
+            self->type = codegen_klass_type(self, (op == TOKEN_AS ? klass : FLUFF_KLASS_BOOL));
+            continue;
+        }
+
+        if (op == TOKEN_AND || op == TOKEN_OR) {
+            _codegen_try(codegen_compile_logical(self, start, constants, token, op, op_level));
+            continue;
+        }
+
+        CodeGenValue      lhs, rhs;
+        const CodeGenType lhs_type  = self->type;
+        const bool        lhs_known = codegen_get_folded(self, start, &lhs);
+        const size_t      rhs_start = self->chunk->size;
+        _codegen_try(_codegen_compile_expr(self, (_token_type_is_right_associative(op) ? op_level : op_level + 1)));
+
+        // NOTE: an operation that can't apply is only an error in strict mode, the VM reports it otherwise
+        const uint8_t ir_op = codegen_binary_op(op);
+        const int     klass = codegen_binary_type(ir_op, lhs_type.klass, self->type.klass);
+        if (self->strict && klass == CODEGEN_DYNAMIC) {
+            const int rhs_klass = self->type.klass;
+            self->index = token;
+            _codegen_error("cannot apply '%.*s' to values of type '%s' and '%s'", 
+                _codegen_token_text(&self->lexer->tokens[token]), codegen_type_name(lhs_type.klass), codegen_type_name(rhs_klass)
+            );
+        }
+
+        if (!lhs_known || !codegen_get_folded(self, rhs_start, &rhs) || !codegen_fold(self, start, constants, token, ir_op, &lhs, &rhs))
+            _codegen_emit(self, (klass == CODEGEN_DYNAMIC ? ir_op : codegen_typed_op(ir_op, lhs_type.klass)));
+        self->type = codegen_make_type(klass);
+    }
+
+    _codegen_leave();
+    return FLUFF_OK;
+}
+
+FLUFF_PRIVATE_API FluffResult _codegen_compile_primary(CodeGen * self, int precedence) {
+    const Token * token = _codegen_peek(self, 0);
+    switch (token->type) {
+        case TOKEN_BOOL_LITERAL: {
+            _codegen_emit_value(self, (CodeGenValue){ .op = (token->data.b ? IR_OP_PUSH_TRUE : IR_OP_PUSH_FALSE), .index = 0 });
+            break;
+        }
+        case TOKEN_INTEGER_LITERAL: {
+            _codegen_emit_value(self, (CodeGenValue){ .op = IR_OP_PUSH_INT, .index = _ir_binary_add_int(self->binary, token->data.i) });
+            break;
+        }
+        case TOKEN_DECIMAL_LITERAL: {
+            _codegen_emit_value(self, (CodeGenValue){ .op = IR_OP_PUSH_FLOAT, .index = _ir_binary_add_float(self->binary, token->data.f) });
+            break;
+        }
+        case TOKEN_STRING_LITERAL: {
+            const uint32_t index = _ir_binary_add_string(self->binary, &self->lexer->str[token->start.index], token->length);
+            _codegen_emit_value(self, (CodeGenValue){ .op = IR_OP_PUSH_STRING, .index = index });
+            break;
+        }
+        case TOKEN_NULL: {
+            _codegen_emit(self, IR_OP_PUSH_VOID);
+            self->type = codegen_klass_type(self, FLUFF_KLASS_VOID);
+            break;
+        }
+        case TOKEN_LABEL_LITERAL: {
+            const uint32_t name = (uint32_t)self->index;
+
+            size_t         slot  = 0;
+            CodeGenLocal * local = codegen_find_local(self, name, &slot);
+            if (local && _codegen_peek(self, 1)->type == TOKEN_EQUAL && precedence <= _token_type_get_precedence(TOKEN_EQUAL)) {
+                if (local->constant) _codegen_error("cannot assign to constant '%.*s'", _codegen_token_text(token));
+                _codegen_consume(self);
+                _codegen_consume(self);
+                _codegen_try(_codegen_compile_expr(self, _token_type_get_precedence(TOKEN_EQUAL)));
+                if (!codegen_coerce(self, local->type.klass)) {
+                    const int klass = self->type.klass;
+                    self->index = name;
+                    _codegen_error("cannot assign a value of type '%s' to '%.*s' of type '%s'", 
+                        codegen_type_name(klass), _codegen_token_text(token), codegen_type_name(local->type.klass)
+                    );
+                }
+                _codegen_emit_uint(self, IR_OP_SET_LOCAL, slot);
+                return FLUFF_OK;
+            }
+
+            if (local && local->value.op != IR_OP_NOP) {
+                _codegen_emit_value(self, local->value);
+            } else if (local) {
+                _codegen_emit_uint(self, IR_OP_GET_LOCAL, slot);
+                self->type = local->type;
+            } else if (codegen_find_func(self, name) || _codegen_peek(self, 1)->type == TOKEN_LPAREN) {
+                const CodeGenFunc * func = codegen_get_func(self, name);
+                _codegen_emit_uint(self, IR_OP_PUSH_FUNC, func->index);
+                self->type = (CodeGenType){ .klass = FLUFF_KLASS_FUNC, .method = (func->declared ? self->binary->methods[func->index] : NULL) };
+            } else
+                _codegen_error("unknown name '%.*s'", _codegen_token_text(token));
+            break;
+        }
+        case TOKEN_LPAREN: {
+            _codegen_consume(self);
+            _codegen_try(_codegen_compile_expr(self, 0));
+            _codegen_expect(TOKEN_RPAREN, "')'");
+            goto postfix;
+        }
+        case TOKEN_LBRACKET:
+        case TOKEN_SELF:
+        case TOKEN_SUPER:
+            _codegen_error("'%.*s' is not supported by the compiler yet", _codegen_token_text(token));
+        default:
+            return codegen_unexpected(self, "an expression");
+    }
+    _codegen_consume(self);
+
+postfix:
+    while (true) {
+        if (_codegen_check(self, TOKEN_LPAREN)) {
+            const uint32_t call = _codegen_consume(self);
+
+            // NOTE: calls through unknown functions leave their arguments for the VM to check
+            FluffMethod * method = (self->type.klass == FLUFF_KLASS_FUNC ? self->type.method : NULL);
+            if (!method) {
+                if (self->strict) _codegen_error("only functions known by name can be called in strict mode");
+                self->chunk->typed = false;
+            }
+
+            size_t argc = 0;
+            if (!_codegen_match(self, TOKEN_RPAREN)) {
+                do {
+                    const uint32_t arg = (uint32_t)self->index;
+                    _codegen_try(_codegen_compile_expr(self, _token_type_get_precedence(TOKEN_EQUAL) + 1));
+
+                    const int klass = (method && argc < method->property_count ? codegen_klass_index(self, method->properties[argc].type) : CODEGEN_DYNAMIC);
+                    if (!codegen_coerce(self, klass)) {
+                        const int arg_klass = self->type.klass;
+                        self->index = arg;
+                        _codegen_error("argument %zu of '%s' must be of type '%s', not '%s'", 
+                            argc + 1, method->name, codegen_type_name(klass), codegen_type_name(arg_klass)
+                        );
+                    }
+                    ++argc;
+                } while (_codegen_match(self, TOKEN_COMMA));
+                _codegen_expect(TOKEN_RPAREN, "')' after arguments");
+            }
+            if (method && argc != method->property_count) {
+                self->index = call;
+                _codegen_error("function '%s' expects %zu arguments, got %zu", method->name, method->property_count, argc);
+            }
+
+            _codegen_emit_uint(self, IR_OP_CALL, argc);
+            self->type = codegen_make_type(method ? codegen_ret_klass(self, method) : CODEGEN_DYNAMIC);
+        } else if (_codegen_check(self, TOKEN_DOT) || _codegen_check(self, TOKEN_LBRACKET)) {
+            _codegen_error("'%.*s' is not supported by the compiler yet", _codegen_token_text(_codegen_peek(self, 0)));
+        } else break;
+    }
+    return FLUFF_OK;
+}
+
+/* -=- Emitting -=- */
+FLUFF_PRIVATE_API void _codegen_emit(CodeGen * self, uint8_t op) {
+    _ir_chunk_append_opcode(self->chunk, op);
+}
+
+// NOTE: small locals and argument counts are packed into the opcode itself
+FLUFF_PRIVATE_API void _codegen_emit_uint(CodeGen * self, uint8_t op, uint64_t v) {
+    _ir_chunk_append_instruction(self->chunk, op, v, 0);
+}
+
+FLUFF_PRIVATE_API void _codegen_emit_const(CodeGen * self, uint8_t op, uint32_t index) {
+    _ir_chunk_append_opcode(self->chunk, op);
+    _ir_chunk_append_const(self->chunk, index);
+}
+
+FLUFF_PRIVATE_API void _codegen_emit_value(CodeGen * self, CodeGenValue value) {
+    self->type         = codegen_make_type(codegen_value_klass(value));
+    self->folded       = value;
+    self->folded_chunk = self->chunk;
+    self->folded_start = self->chunk->size;
+
+    if (value.op == IR_OP_PUSH_TRUE || value.op == IR_OP_PUSH_FALSE) _codegen_emit(self, value.op);
+    else _codegen_emit_const(self, value.op, value.index);
+    self->folded_end = self->chunk->size;
+}
+
+// NOTE: forward jumps always take the long form since their target isn't known yet
+FLUFF_PRIVATE_API size_t _codegen_emit_jump(CodeGen * self, uint8_t op) {
+    _ir_chunk_append_opcode(self->chunk, op);
+    const size_t offset = self->chunk->size;
+    _ir_chunk_append_i32(self->chunk, 0);
+    return offset;
+}
+
+// NOTE: jump offsets are relative to the end of the instruction
+FLUFF_PRIVATE_API void _codegen_emit_loop(CodeGen * self, size_t start) {
+    const ptrdiff_t short_offset = (ptrdiff_t)start - (ptrdiff_t)(self->chunk->size + sizeof(IROpcode) + sizeof(int8_t));
+    if (short_offset >= INT8_MIN) {
+        _ir_chunk_append_opcode(self->chunk, IR_OP_JMP_S);
+        _ir_chunk_append_i8(self->chunk, (int8_t)short_offset);
+        return;
+    }
+
+    _ir_chunk_append_opcode(self->chunk, IR_OP_JMP);
+    _ir_chunk_append_i32(self->chunk, (int32_t)((ptrdiff_t)start - (ptrdiff_t)(self->chunk->size + sizeof(int32_t))));
+}
+
+FLUFF_PRIVATE_API void _codegen_patch_jump(CodeGen * self, size_t offset) {
+    _ir_chunk_patch_i32(self->chunk, offset, (int32_t)(self->chunk->size - (offset + sizeof(int32_t))));
+}
+
+/* -=- Tokens -=- */
+FLUFF_PRIVATE_API const Token * _codegen_peek(CodeGen * self, size_t offset) {
+    const size_t index = self->index + offset;
+    if (index >= self->lexer->token_count) return &self->eof;
+    return &self->lexer->tokens[index];
+}
+
+FLUFF_PRIVATE_API bool _codegen_check(CodeGen * self, TokenType type) {
+    return _codegen_peek(self, 0)->type == type;
+}
+
+FLUFF_PRIVATE_API bool _codegen_match(CodeGen * self, TokenType type) {
+    if (!_codegen_check(self, type)) return false;
+    _codegen_consume(self);
+    return true;
+}
+
+FLUFF_PRIVATE_API uint32_t _codegen_consume(CodeGen * self) {
+    return (uint32_t)(self->index < self->lexer->token_count ? self->index++ : self->index);
+}
\ No newline at end of file
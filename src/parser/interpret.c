@@ -4,21 +4,80 @@
 
 #define FLUFF_IMPLEMENTATION
 #include <base.h>
+#include <error.h>
 #include <parser/interpret.h>
 #include <parser/lexer.h>
+#include <parser/analyser.h>
+#include <parser/codegen.h>
+#include <core/module.h>
+#include <core/optimizer.h>
+#include <core/register.h>
+#include <core/vm.h>
+#include <core/trace.h>
+#include <core/pgo.h>
 #include <core/config.h>
 
+/* -==============
+     Internals
+   ==============- */
+
+FLUFF_CONSTEXPR void interpreter_reserve_source(FluffInterpreter * self, size_t len) {
+    if (len + 1 <= self->source_capacity) return;
+    self->source_capacity = FLUFF_MAX(self->source_capacity * 2, len + 1);
+    self->source          = fluff_alloc(self->source, self->source_capacity);
+}
+
+FLUFF_CONSTEXPR FluffResult interpreter_analyse(FluffInterpreter * self) {
+    Analyser analyser;
+    _new_analyser(&analyser, &self->lexer, &self->ast);
+    const FluffResult res = _analyser_read(&analyser);
+    _free_analyser(&analyser);
+    return res;
+}
+
+FLUFF_CONSTEXPR FluffResult interpreter_compile(FluffInterpreter * self) {
+    _ir_binary_clear(self->binary);
+
+    CodeGen codegen;
+    _new_codegen(&codegen, &self->lexer, self->binary, (self->module ? self->module->instance : NULL));
+    const FluffResult res = _codegen_compile(&codegen);
+    _free_codegen(&codegen);
+    if (res == FLUFF_FAILURE) return FLUFF_FAILURE;
+
+    IROptStats stats;
+    FLUFF_CLEANUP(&stats);
+    _ir_optimize_binary(self->binary, &stats);
+    if (fluff_get_config().opt_stats) _ir_opt_stats_dump(&stats);
+    if (fluff_get_config().pgo_in) _pgo_apply(self->binary, fluff_get_config().pgo_in);
+    if (fluff_get_config().register_vm) _ir_translate_binary(self->binary);
+    if (fluff_get_config().dump_ir) _ir_binary_dump(self->binary);
+    return FLUFF_OK;
+}
+
+// NOTE: checking stops at the syntax tree, which also covers what the compiler doesn't support yet
+FLUFF_CONSTEXPR FluffResult interpreter_process(FluffInterpreter * self) {
+    if (fluff_get_config().check) return interpreter_analyse(self);
+    return interpreter_compile(self);
+}
+
 /* -================
      Interpreter
    ================- */
 
 FLUFF_API FluffInterpreter * fluff_new_interpreter(FluffModule * module) {
     FluffInterpreter * self = fluff_alloc(NULL, sizeof(FluffInterpreter));
+    FLUFF_CLEANUP(self);
     self->module = module;
+    _new_ast(&self->ast, &self->lexer);
+    self->binary = _new_ir_binary();
     return self;
 }
 
 FLUFF_API void fluff_free_interpreter(FluffInterpreter * self) {
+    _free_ir_binary(self->binary);
+    _free_ast(&self->ast);
+    _free_lexer(&self->lexer);
+    if (self->source) fluff_free(self->source);
     fluff_free(self);
 }
 
@@ -49,27 +108,47 @@ FLUFF_API FluffResult fluff_interpreter_read_file(FluffInterpreter * self, const
     return fluff_interpreter_read(self, source, size);
 }
 
-FLUFF_PRIVATE_API FluffResult fluff_interpreter_read(FluffInterpreter * self, const char * source, size_t n) {
-    Lexer lexer;
-    _new_lexer(&lexer, self, source, n);
-    if (_lexer_parse(&lexer) == FLUFF_FAILURE) {
-        _free_lexer(&lexer);
+FLUFF_API FluffResult fluff_interpreter_edit(FluffInterpreter * self, size_t offset, size_t removed, const char * text, size_t inserted) {
+    if (offset + removed > self->source_len) {
+        fluff_push_error("edit at %zu (-%zu) is out of bounds of a %zu characters source", 
+            offset, removed, self->source_len
+        );
         return FLUFF_FAILURE;
     }
-    _lexer_dump(&lexer);
-    
-    //Analyser analyser;
-    //_new_analyser(&analyser, &lexer);
-    //if (_analyser_read(&analyser) == FLUFF_FAILURE) {
-    //    _free_lexer(&lexer);
-    //    _free_analyser(&analyser);
-    //    return FLUFF_FAILURE;
-    //}
-    //_ast_dump(&self->ast);
-    //_ast_node_solve(&self->ast.root);
-    //_free_analyser(&analyser);
-
-    _free_lexer(&lexer);
 
-    return FLUFF_OK;
+    const size_t len = self->source_len - removed + inserted;
+    interpreter_reserve_source(self, len);
+
+    char * edit = &self->source[offset];
+    memmove(edit + inserted, edit + removed, self->source_len - offset - removed);
+    memcpy(edit, text, inserted);
+    self->source[len] = '\0';
+    self->source_len  = len;
+
+    if (_lexer_edit(&self->lexer, self->source, len, offset, removed, inserted) == FLUFF_FAILURE)
+        return FLUFF_FAILURE;
+    return interpreter_process(self);
+}
+
+FLUFF_PRIVATE_API FluffResult fluff_interpreter_read(FluffInterpreter * self, const char * source, size_t n) {
+    // NOTE: the source is copied since the lexer keeps pointing to it
+    interpreter_reserve_source(self, n);
+    memcpy(self->source, source, n);
+    self->source[n]  = '\0';
+    self->source_len = n;
+
+    _free_lexer(&self->lexer);
+    _new_lexer(&self->lexer, self, self->source, n);
+    if (_lexer_parse_parallel(&self->lexer, fluff_get_config().lexer_threads) == FLUFF_FAILURE)
+        return FLUFF_FAILURE;
+    _lexer_dump(&self->lexer);
+
+    return interpreter_process(self);
+}
+
+FLUFF_API FluffResult fluff_interpreter_run(FluffInterpreter * self, FluffVM * vm) {
+    const FluffResult res = _vm_execute(vm, self->binary);
+    if (fluff_get_config().trace_stats) _trace_dump_stats(self->binary);
+    if (vm->feedback) _pgo_write(self->binary, fluff_get_config().pgo_out);
+    return res;
 }
\ No newline at end of file
@@ -7,8 +7,11 @@
 #include <error.h>
 #include <parser/lexer.h>
 #include <parser/interpret.h>
+#include <core/module.h>
 #include <core/config.h>
 
+#include <pthread.h>
+
 /* -==============
      Internals
    ==============- */
@@ -280,7 +283,7 @@ FLUFF_CONSTEXPR TokenType label_match(Token * token, const char * str, size_t n)
         case 7: {
             if (str[0] == 'v' && str[1] == 'i' && str[2] == 'r' &&
                 str[3] == 't' && str[4] == 'u' && str[5] == 'a' &&
-                str[5] == 'l')
+                str[6] == 'l')
                 return TOKEN_VIRTUAL;
             break;
         }
@@ -303,6 +306,374 @@ FLUFF_CONSTEXPR int base16toi(char c) {
     return c - '0';
 }
 
+/* -=- Number parsing -=- */
+
+// NOTE: a FluffInt fits at most 19 decimal digits, anything past that only moves the exponent
+#define MAX_MANTISSA_DIGITS 19
+
+#define MIN_FAST_POW10 -64
+#define MAX_FAST_POW10 64
+
+// Powers of five as truncated 128-bit mantissas, normalized so the top bit is set (used by the
+// Eisel-Lemire algorithm). Only a small window of exponents is kept, larger ones take the slow path.
+FLUFF_CONSTEXPR_V const uint64_t pow5_table[][2] = {
+    { 0xa87fea27a539e9a5ull, 0x3f2398d747b36224ull }, // 5^-64
+    { 0xd29fe4b18e88640eull, 0x8eec7f0d19a03aadull }, // 5^-63
+    { 0x83a3eeeef9153e89ull, 0x1953cf68300424acull }, // 5^-62
+    { 0xa48ceaaab75a8e2bull, 0x5fa8c3423c052dd7ull }, // 5^-61
+    { 0xcdb02555653131b6ull, 0x3792f412cb06794dull }, // 5^-60
+    { 0x808e17555f3ebf11ull, 0xe2bbd88bbee40bd0ull }, // 5^-59
+    { 0xa0b19d2ab70e6ed6ull, 0x5b6aceaeae9d0ec4ull }, // 5^-58
+    { 0xc8de047564d20a8bull, 0xf245825a5a445275ull }, // 5^-57
+    { 0xfb158592be068d2eull, 0xeed6e2f0f0d56712ull }, // 5^-56
+    { 0x9ced737bb6c4183dull, 0x55464dd69685606bull }, // 5^-55
+    { 0xc428d05aa4751e4cull, 0xaa97e14c3c26b886ull }, // 5^-54
+    { 0xf53304714d9265dfull, 0xd53dd99f4b3066a8ull }, // 5^-53
+    { 0x993fe2c6d07b7fabull, 0xe546a8038efe4029ull }, // 5^-52
+    { 0xbf8fdb78849a5f96ull, 0xde98520472bdd033ull }, // 5^-51
+    { 0xef73d256a5c0f77cull, 0x963e66858f6d4440ull }, // 5^-50
+    { 0x95a8637627989aadull, 0xdde7001379a44aa8ull }, // 5^-49
+    { 0xbb127c53b17ec159ull, 0x5560c018580d5d52ull }, // 5^-48
+    { 0xe9d71b689dde71afull, 0xaab8f01e6e10b4a6ull }, // 5^-47
+    { 0x9226712162ab070dull, 0xcab3961304ca70e8ull }, // 5^-46
+    { 0xb6b00d69bb55c8d1ull, 0x3d607b97c5fd0d22ull }, // 5^-45
+    { 0xe45c10c42a2b3b05ull, 0x8cb89a7db77c506aull }, // 5^-44
+    { 0x8eb98a7a9a5b04e3ull, 0x77f3608e92adb242ull }, // 5^-43
+    { 0xb267ed1940f1c61cull, 0x55f038b237591ed3ull }, // 5^-42
+    { 0xdf01e85f912e37a3ull, 0x6b6c46dec52f6688ull }, // 5^-41
+    { 0x8b61313bbabce2c6ull, 0x2323ac4b3b3da015ull }, // 5^-40
+    { 0xae397d8aa96c1b77ull, 0xabec975e0a0d081aull }, // 5^-39
+    { 0xd9c7dced53c72255ull, 0x96e7bd358c904a21ull }, // 5^-38
+    { 0x881cea14545c7575ull, 0x7e50d64177da2e54ull }, // 5^-37
+    { 0xaa242499697392d2ull, 0xdde50bd1d5d0b9e9ull }, // 5^-36
+    { 0xd4ad2dbfc3d07787ull, 0x955e4ec64b44e864ull }, // 5^-35
+    { 0x84ec3c97da624ab4ull, 0xbd5af13bef0b113eull }, // 5^-34
+    { 0xa6274bbdd0fadd61ull, 0xecb1ad8aeacdd58eull }, // 5^-33
+    { 0xcfb11ead453994baull, 0x67de18eda5814af2ull }, // 5^-32
+    { 0x81ceb32c4b43fcf4ull, 0x80eacf948770ced7ull }, // 5^-31
+    { 0xa2425ff75e14fc31ull, 0xa1258379a94d028dull }, // 5^-30
+    { 0xcad2f7f5359a3b3eull, 0x096ee45813a04330ull }, // 5^-29
+    { 0xfd87b5f28300ca0dull, 0x8bca9d6e188853fcull }, // 5^-28
+    { 0x9e74d1b791e07e48ull, 0x775ea264cf55347eull }, // 5^-27
+    { 0xc612062576589ddaull, 0x95364afe032a819eull }, // 5^-26
+    { 0xf79687aed3eec551ull, 0x3a83ddbd83f52205ull }, // 5^-25
+    { 0x9abe14cd44753b52ull, 0xc4926a9672793543ull }, // 5^-24
+    { 0xc16d9a0095928a27ull, 0x75b7053c0f178294ull }, // 5^-23
+    { 0xf1c90080baf72cb1ull, 0x5324c68b12dd6339ull }, // 5^-22
+    { 0x971da05074da7beeull, 0xd3f6fc16ebca5e04ull }, // 5^-21
+    { 0xbce5086492111aeaull, 0x88f4bb1ca6bcf585ull }, // 5^-20
+    { 0xec1e4a7db69561a5ull, 0x2b31e9e3d06c32e6ull }, // 5^-19
+    { 0x9392ee8e921d5d07ull, 0x3aff322e62439fd0ull }, // 5^-18
+    { 0xb877aa3236a4b449ull, 0x09befeb9fad487c3ull }, // 5^-17
+    { 0xe69594bec44de15bull, 0x4c2ebe687989a9b4ull }, // 5^-16
+    { 0x901d7cf73ab0acd9ull, 0x0f9d37014bf60a11ull }, // 5^-15
+    { 0xb424dc35095cd80full, 0x538484c19ef38c95ull }, // 5^-14
+    { 0xe12e13424bb40e13ull, 0x2865a5f206b06fbaull }, // 5^-13
+    { 0x8cbccc096f5088cbull, 0xf93f87b7442e45d4ull }, // 5^-12
+    { 0xafebff0bcb24aafeull, 0xf78f69a51539d749ull }, // 5^-11
+    { 0xdbe6fecebdedd5beull, 0xb573440e5a884d1cull }, // 5^-10
+    { 0x89705f4136b4a597ull, 0x31680a88f8953031ull }, // 5^-9
+    { 0xabcc77118461cefcull, 0xfdc20d2b36ba7c3eull }, // 5^-8
+    { 0xd6bf94d5e57a42bcull, 0x3d32907604691b4dull }, // 5^-7
+    { 0x8637bd05af6c69b5ull, 0xa63f9a49c2c1b110ull }, // 5^-6
+    { 0xa7c5ac471b478423ull, 0x0fcf80dc33721d54ull }, // 5^-5
+    { 0xd1b71758e219652bull, 0xd3c36113404ea4a9ull }, // 5^-4
+    { 0x83126e978d4fdf3bull, 0x645a1cac083126eaull }, // 5^-3
+    { 0xa3d70a3d70a3d70aull, 0x3d70a3d70a3d70a4ull }, // 5^-2
+    { 0xccccccccccccccccull, 0xcccccccccccccccdull }, // 5^-1
+    { 0x8000000000000000ull, 0x0000000000000000ull }, // 5^0
+    { 0xa000000000000000ull, 0x0000000000000000ull }, // 5^1
+    { 0xc800000000000000ull, 0x0000000000000000ull }, // 5^2
+    { 0xfa00000000000000ull, 0x0000000000000000ull }, // 5^3
+    { 0x9c40000000000000ull, 0x0000000000000000ull }, // 5^4
+    { 0xc350000000000000ull, 0x0000000000000000ull }, // 5^5
+    { 0xf424000000000000ull, 0x0000000000000000ull }, // 5^6
+    { 0x9896800000000000ull, 0x0000000000000000ull }, // 5^7
+    { 0xbebc200000000000ull, 0x0000000000000000ull }, // 5^8
+    { 0xee6b280000000000ull, 0x0000000000000000ull }, // 5^9
+    { 0x9502f90000000000ull, 0x0000000000000000ull }, // 5^10
+    { 0xba43b74000000000ull, 0x0000000000000000ull }, // 5^11
+    { 0xe8d4a51000000000ull, 0x0000000000000000ull }, // 5^12
+    { 0x9184e72a00000000ull, 0x0000000000000000ull }, // 5^13
+    { 0xb5e620f480000000ull, 0x0000000000000000ull }, // 5^14
+    { 0xe35fa931a0000000ull, 0x0000000000000000ull }, // 5^15
+    { 0x8e1bc9bf04000000ull, 0x0000000000000000ull }, // 5^16
+    { 0xb1a2bc2ec5000000ull, 0x0000000000000000ull }, // 5^17
+    { 0xde0b6b3a76400000ull, 0x0000000000000000ull }, // 5^18
+    { 0x8ac7230489e80000ull, 0x0000000000000000ull }, // 5^19
+    { 0xad78ebc5ac620000ull, 0x0000000000000000ull }, // 5^20
+    { 0xd8d726b7177a8000ull, 0x0000000000000000ull }, // 5^21
+    { 0x878678326eac9000ull, 0x0000000000000000ull }, // 5^22
+    { 0xa968163f0a57b400ull, 0x0000000000000000ull }, // 5^23
+    { 0xd3c21bcecceda100ull, 0x0000000000000000ull }, // 5^24
+    { 0x84595161401484a0ull, 0x0000000000000000ull }, // 5^25
+    { 0xa56fa5b99019a5c8ull, 0x0000000000000000ull }, // 5^26
+    { 0xcecb8f27f4200f3aull, 0x0000000000000000ull }, // 5^27
+    { 0x813f3978f8940984ull, 0x4000000000000000ull }, // 5^28
+    { 0xa18f07d736b90be5ull, 0x5000000000000000ull }, // 5^29
+    { 0xc9f2c9cd04674edeull, 0xa400000000000000ull }, // 5^30
+    { 0xfc6f7c4045812296ull, 0x4d00000000000000ull }, // 5^31
+    { 0x9dc5ada82b70b59dull, 0xf020000000000000ull }, // 5^32
+    { 0xc5371912364ce305ull, 0x6c28000000000000ull }, // 5^33
+    { 0xf684df56c3e01bc6ull, 0xc732000000000000ull }, // 5^34
+    { 0x9a130b963a6c115cull, 0x3c7f400000000000ull }, // 5^35
+    { 0xc097ce7bc90715b3ull, 0x4b9f100000000000ull }, // 5^36
+    { 0xf0bdc21abb48db20ull, 0x1e86d40000000000ull }, // 5^37
+    { 0x96769950b50d88f4ull, 0x1314448000000000ull }, // 5^38
+    { 0xbc143fa4e250eb31ull, 0x17d955a000000000ull }, // 5^39
+    { 0xeb194f8e1ae525fdull, 0x5dcfab0800000000ull }, // 5^40
+    { 0x92efd1b8d0cf37beull, 0x5aa1cae500000000ull }, // 5^41
+    { 0xb7abc627050305adull, 0xf14a3d9e40000000ull }, // 5^42
+    { 0xe596b7b0c643c719ull, 0x6d9ccd05d0000000ull }, // 5^43
+    { 0x8f7e32ce7bea5c6full, 0xe4820023a2000000ull }, // 5^44
+    { 0xb35dbf821ae4f38bull, 0xdda2802c8a800000ull }, // 5^45
+    { 0xe0352f62a19e306eull, 0xd50b2037ad200000ull }, // 5^46
+    { 0x8c213d9da502de45ull, 0x4526f422cc340000ull }, // 5^47
+    { 0xaf298d050e4395d6ull, 0x9670b12b7f410000ull }, // 5^48
+    { 0xdaf3f04651d47b4cull, 0x3c0cdd765f114000ull }, // 5^49
+    { 0x88d8762bf324cd0full, 0xa5880a69fb6ac800ull }, // 5^50
+    { 0xab0e93b6efee0053ull, 0x8eea0d047a457a00ull }, // 5^51
+    { 0xd5d238a4abe98068ull, 0x72a4904598d6d880ull }, // 5^52
+    { 0x85a36366eb71f041ull, 0x47a6da2b7f864750ull }, // 5^53
+    { 0xa70c3c40a64e6c51ull, 0x999090b65f67d924ull }, // 5^54
+    { 0xd0cf4b50cfe20765ull, 0xfff4b4e3f741cf6dull }, // 5^55
+    { 0x82818f1281ed449full, 0xbff8f10e7a8921a4ull }, // 5^56
+    { 0xa321f2d7226895c7ull, 0xaff72d52192b6a0dull }, // 5^57
+    { 0xcbea6f8ceb02bb39ull, 0x9bf4f8a69f764490ull }, // 5^58
+    { 0xfee50b7025c36a08ull, 0x02f236d04753d5b4ull }, // 5^59
+    { 0x9f4f2726179a2245ull, 0x01d762422c946590ull }, // 5^60
+    { 0xc722f0ef9d80aad6ull, 0x424d3ad2b7b97ef5ull }, // 5^61
+    { 0xf8ebad2b84e0d58bull, 0xd2e0898765a7deb2ull }, // 5^62
+    { 0x9b934c3b330c8577ull, 0x63cc55f49f88eb2full }, // 5^63
+    { 0xc2781f49ffcfa6d5ull, 0x3cbf6b71c76b25fbull }, // 5^64
+};
+
+FLUFF_CONSTEXPR_V const FluffFloat exact_pow10_table[] = {
+    1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+};
+
+FLUFF_CONSTEXPR uint64_t full_mul(uint64_t a, uint64_t b, uint64_t * hi) {
+#if defined(__SIZEOF_INT128__)
+    const unsigned __int128 r = (unsigned __int128)a * b;
+    * hi = (uint64_t)(r >> 64);
+    return (uint64_t)r;
+#else
+    const uint64_t a_lo = (uint32_t)a, a_hi = a >> 32;
+    const uint64_t b_lo = (uint32_t)b, b_hi = b >> 32;
+    const uint64_t p0 = a_lo * b_lo, p1 = a_lo * b_hi, p2 = a_hi * b_lo, p3 = a_hi * b_hi;
+    const uint64_t mid = (p0 >> 32) + (uint32_t)p1 + (uint32_t)p2;
+    * hi = p3 + (p1 >> 32) + (p2 >> 32) + (mid >> 32);
+    return (mid << 32) | (uint32_t)p0;
+#endif
+}
+
+FLUFF_CONSTEXPR bool is_eight_digits(uint64_t v) {
+    // NOTE: SWAR check, every byte has to be within '0'..'9'
+    return ((v & 0xf0f0f0f0f0f0f0f0ull) |
+            (((v + 0x0606060606060606ull) & 0xf0f0f0f0f0f0f0f0ull) >> 4)) == 0x3333333333333333ull;
+}
+
+FLUFF_CONSTEXPR uint64_t read_eight_digits(const char * str) {
+    uint64_t v;
+    memcpy(&v, str, sizeof(v));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    v = __builtin_bswap64(v);
+#endif
+    return v;
+}
+
+FLUFF_CONSTEXPR uint64_t parse_eight_digits(uint64_t v) {
+    // NOTE: SWAR conversion, combines the digits in pairs, then quads, then the whole word
+    const uint64_t mask = 0x000000ff000000ffull;
+    const uint64_t mul1 = 0x000f424000000064ull; // 100 + (1000000 << 32)
+    const uint64_t mul2 = 0x0000271000000001ull; // 1 + (10000 << 32)
+    v -= 0x3030303030303030ull;
+    v  = (v * 10) + (v >> 8);
+    v  = (((v & mask) * mul1) + (((v >> 16) & mask) * mul2)) >> 32;
+    return v;
+}
+
+FLUFF_CONSTEXPR bool decimal_clinger(uint64_t mantissa, int64_t exp10, FluffFloat * result) {
+    // NOTE: both the mantissa and the power of ten are exact here, so a single rounding happens
+    if (mantissa > (1ull << 53) || exp10 < -22 || exp10 > 22) return false;
+    if (exp10 < 0) * result = (FluffFloat)mantissa / exact_pow10_table[-exp10];
+    else           * result = (FluffFloat)mantissa * exact_pow10_table[exp10];
+    return true;
+}
+
+FLUFF_CONSTEXPR bool decimal_eisel_lemire(uint64_t mantissa, int64_t exp10, FluffFloat * result) {
+    if (mantissa == 0) {
+        * result = 0.0;
+        return true;
+    }
+    if (exp10 < MIN_FAST_POW10 || exp10 > MAX_FAST_POW10) return false;
+
+    const uint64_t * pow5 = pow5_table[exp10 - MIN_FAST_POW10];
+
+    int lz = __builtin_clzll(mantissa);
+    mantissa <<= lz;
+
+    uint64_t upper;
+    uint64_t lower = full_mul(mantissa, pow5[0], &upper);
+
+    if ((upper & 0x1ff) == 0x1ff && lower + mantissa < lower) {
+        // NOTE: the truncated product may be off, refine it with the lower half of the power
+        uint64_t middle2;
+        uint64_t low = full_mul(mantissa, pow5[1], &middle2);
+        uint64_t middle = lower + middle2;
+        if (middle < lower) ++upper;
+        if (middle + 1 == 0 && (upper & 0x1ff) == 0x1ff && low + mantissa < low) return false;
+        lower = middle;
+    }
+
+    const uint64_t upper_bit = upper >> 63;
+    uint64_t bits = upper >> (upper_bit + 9);
+    lz += (int)(1 ^ upper_bit);
+
+    // NOTE: exactly halfway between two floats, can't tell which way to round
+    if (lower == 0 && (upper & 0x1ff) == 0 && (bits & 3) == 1) return false;
+
+    bits += bits & 1;
+    bits >>= 1;
+    if (bits >= (1ull << 53)) {
+        bits = (1ull << 52);
+        --lz;
+    }
+    bits &= ~(1ull << 52);
+
+    const int64_t real_exponent = (((152170 + 65536) * exp10) >> 16) + 1024 + 63 - lz;
+    if (real_exponent < 1 || real_exponent > 2046) return false;
+
+    bits |= (uint64_t)real_exponent << 52;
+    memcpy(result, &bits, sizeof(bits));
+    return true;
+}
+
+FLUFF_CONSTEXPR FluffFloat decimal_fallback(const char * str, size_t len) {
+    // NOTE: strtod() is always correctly rounded, it just doesn't know about '_'
+    char   stack_buf[64];
+    char * buf = (len < sizeof(stack_buf) ? stack_buf : fluff_alloc(NULL, len + 1));
+
+    size_t n = 0;
+    for (size_t i = 0; i < len; ++i) {
+        if (str[i] != '_') buf[n++] = str[i];
+    }
+    buf[n] = '\0';
+
+    const FluffFloat result = strtod(buf, NULL);
+    if (buf != stack_buf) fluff_free(buf);
+    return result;
+}
+
+/* -=- Incremental parsing -=- */
+// NOTE: how far past the end of a token the lexer may look before ending it
+#define LEXER_LOOKAHEAD 2
+
+// NOTE: string tokens leave their delimiters out
+FLUFF_CONSTEXPR size_t token_source_start(const Token * token) {
+    return token->start.index - (token->type == TOKEN_STRING_LITERAL);
+}
+
+FLUFF_CONSTEXPR size_t token_source_end(const Token * token) {
+    return token->start.index + token->length + (token->type == TOKEN_STRING_LITERAL);
+}
+
+FLUFF_CONSTEXPR void text_sect_shift(TextSect * self, TextSect from, TextSect to) {
+    // NOTE: only the line where both streams meet has its columns moved
+    if (self->line == from.line) self->column = self->column - from.column + to.column;
+    self->index = self->index - from.index + to.index;
+    self->line  = self->line - from.line + to.line;
+}
+
+/* -=- Parallel parsing -=- */
+// NOTE: below this size per thread, spawning costs more than it saves
+#define LEXER_MIN_CHUNK_SIZE 65536
+
+typedef struct LexerChunk {
+    Lexer       lexer;
+    SymbolTable symbols;
+    FluffResult result;
+    pthread_t   thread;
+    bool        threaded;
+
+    // NOTE: filled once every chunk is lexed
+    Token    * dest;
+    uint32_t * remap;
+} LexerChunk;
+
+FLUFF_CONSTEXPR size_t lexer_find_splits(const char * str, size_t len, TextSect * splits, size_t count) {
+    // NOTE: a split is only safe right after a newline or a ';' outside of strings and comments, 
+    //       which always ends a token. The scan below mirrors how the lexer skips those.
+    size_t found  = 0;
+    size_t target = len / (count + 1);
+    size_t line   = 0;
+    size_t column = 0;
+
+    size_t i = 0;
+    while (i < len && found < count) {
+        const char ch       = str[i];
+        const char ch_ahead = (i + 1 < len ? str[i + 1] : '\0');
+
+        size_t n = 1;
+        if (is_comment(ch, ch_ahead)) {
+            if (ch_ahead == '/') {
+                while (i + n < len && str[i + n] != '\n' && str[i + n] != '\0') ++n;
+            } else {
+                size_t j = i;
+                while (j < len && !(j + 2 < len && str[j + 1] == '*' && str[j + 2] == '/')) ++j;
+                if (j >= len) break;
+                n = j + 3 - i;
+            }
+        } else if (is_string_delimiter(ch)) {
+            while (i + n < len && str[i + n] != ch) ++n;
+            if (i + n >= len) break;
+            ++n;
+        }
+
+        for (const size_t end = i + n; i < end; ++i) {
+            if (str[i] == '\n') {
+                ++line;
+                column = 0;
+            } else ++column;
+        }
+
+        if (n == 1 && (ch == '\n' || is_end_delimiter(ch)) && i >= target && i < len) {
+            splits[found++] = (TextSect){ .index = i, .line = line, .column = column };
+            target          = (found + 1) * (len / (count + 1));
+        }
+    }
+    return found;
+}
+
+static void * lexer_chunk_parse(void * data) {
+    LexerChunk * chunk = data;
+    chunk->result = _lexer_parse(&chunk->lexer);
+    return NULL;
+}
+
+static void * lexer_chunk_stitch(void * data) {
+    LexerChunk * chunk = data;
+    for (size_t i = 0; i < chunk->lexer.token_count; ++i) {
+        Token token = chunk->lexer.tokens[i];
+        if (token.type == TOKEN_LABEL_LITERAL && chunk->remap) token.data.sym = chunk->remap[token.data.sym];
+        chunk->dest[i] = token;
+    }
+    return NULL;
+}
+
+FLUFF_CONSTEXPR void lexer_run_chunks(LexerChunk * chunks, size_t count, void * (* fn)(void *)) {
+    // NOTE: the first chunk always runs on the calling thread
+    for (size_t i = 1; i < count; ++i)
+        chunks[i].threaded = !pthread_create(&chunks[i].thread, NULL, fn, &chunks[i]);
+
+    fn(&chunks[0]);
+    for (size_t i = 1; i < count; ++i) {
+        if (chunks[i].threaded) pthread_join(chunks[i].thread, NULL);
+        else fn(&chunks[i]);
+    }
+}
+
 /* -==========
      Lexer
    ==========- */
@@ -313,6 +684,8 @@ FLUFF_PRIVATE_API void _new_lexer(Lexer * self, FluffInterpreter * interpret, co
     self->interpret = interpret;
     self->str       = str;
     self->len       = len;
+    // NOTE: labels are interned into the module so later stages can compare names by id
+    if (interpret && interpret->module) self->symbols = &interpret->module->symbols;
 }
 
 FLUFF_PRIVATE_API void _free_lexer(Lexer * self) {
@@ -330,39 +703,230 @@ FLUFF_PRIVATE_API void _free_lexer(Lexer * self) {
 
 FLUFF_PRIVATE_API FluffResult _lexer_parse(Lexer * self) {
     if (self->len == 0) return FLUFF_OK;
-    
-    FluffResult res = FLUFF_OK;
 
+    self->failed = false;
     while (_lexer_is_within_bounds(self)) {
-        _lexer_digest(self);
+        if (_lexer_parse_next(self) != FLUFF_OK) {
+            self->failed = true;
+            return FLUFF_FAILURE;
+        }
+    }
+    return FLUFF_OK;
+}
 
-        const char ch = _lexer_current_char(self);
+FLUFF_PRIVATE_API FluffResult _lexer_parse_next(Lexer * self) {
+    FluffResult res = FLUFF_OK;
 
-        if (is_space(ch)) {
-            _lexer_consume(self, 1);
-        } else if (is_end_delimiter(ch)) {
-            _lexer_consume(self, 1);
-            _lexer_push(self, _make_token(TOKEN_END));
-        } else if (is_comment(ch, _lexer_peek(self, 1))) {
-            res = _lexer_parse_comment(self);
-        } else if (is_digit(ch) || is_decimal(ch, _lexer_peek(self, 1))) {
-            res = _lexer_parse_number(self);
-        } else if (is_string_delimiter(ch)) {
-            res = _lexer_parse_string(self);
-        } else if (is_operator(ch)) {
-            res = _lexer_parse_operator(self);
-        } else if (is_label(ch) || !is_ascii(ch)) {
-            res = _lexer_parse_label(self);
-        } else
-            _lexer_error("unexpected character '%c'", ch);
-
-        if (res != FLUFF_OK) return res;
-
-        fluff_assert(self->prev_location.index < self->location.index, 
-            "loop detected, aborting (%zu vs %zu)", 
-            self->prev_location.index, self->location.index
-        );
+    _lexer_digest(self);
+
+    const char ch = _lexer_current_char(self);
+
+    if (is_space(ch)) {
+        _lexer_consume(self, 1);
+    } else if (is_end_delimiter(ch)) {
+        _lexer_consume(self, 1);
+        _lexer_push(self, _make_token(TOKEN_END));
+    } else if (is_comment(ch, _lexer_peek(self, 1))) {
+        res = _lexer_parse_comment(self);
+    } else if (is_digit(ch) || is_decimal(ch, _lexer_peek(self, 1))) {
+        res = _lexer_parse_number(self);
+    } else if (is_string_delimiter(ch)) {
+        res = _lexer_parse_string(self);
+    } else if (is_operator(ch)) {
+        res = _lexer_parse_operator(self);
+    } else if (is_label(ch) || !is_ascii(ch)) {
+        res = _lexer_parse_label(self);
+    } else
+        _lexer_error("unexpected character '%c'", ch);
+
+    if (res != FLUFF_OK) return res;
+
+    fluff_assert(self->prev_location.index < self->location.index, 
+        "loop detected, aborting (%zu vs %zu)", 
+        self->prev_location.index, self->location.index
+    );
+    return res;
+}
+
+FLUFF_PRIVATE_API FluffResult _lexer_parse_parallel(Lexer * self, size_t thread_count) {
+    // NOTE: chunks are split from the start of the source
+    if (thread_count <= 1 || self->location.index != 0 || self->len < LEXER_MIN_CHUNK_SIZE * 2)
+        return _lexer_parse(self);
+    thread_count = FLUFF_MIN(thread_count, self->len / LEXER_MIN_CHUNK_SIZE);
+
+    TextSect     splits[thread_count - 1];
+    const size_t split_count = lexer_find_splits(self->str, self->len, splits, thread_count - 1);
+    if (split_count == 0) return _lexer_parse(self);
+
+    // NOTE: the first chunk is lexed straight into 'self' and the rest are appended after it
+    const size_t chunk_count = split_count + 1;
+    const size_t len         = self->len;
+    const size_t base_count  = self->token_count;
+    LexerChunk * chunks      = fluff_alloc(NULL, sizeof(LexerChunk) * chunk_count);
+    FLUFF_CLEANUP_N(chunks, sizeof(LexerChunk) * chunk_count);
+
+    for (size_t i = 1; i < chunk_count; ++i) {
+        LexerChunk * chunk = &chunks[i];
+        const size_t end   = (i < split_count ? splits[i].index : len);
+
+        // NOTE: each chunk sees the whole string up to its end, so locations come out absolute
+        _new_lexer(&chunk->lexer, self->interpret, self->str, end);
+        _new_symbol_table(&chunk->symbols);
+        chunk->lexer.location      = splits[i - 1];
+        chunk->lexer.prev_location = splits[i - 1];
+        chunk->lexer.symbols       = (self->symbols ? &chunk->symbols : NULL);
+    }
+    chunks[0].lexer     = *self;
+    chunks[0].lexer.len = splits[0].index;
+
+    lexer_run_chunks(chunks, chunk_count, lexer_chunk_parse);
+
+    *self     = chunks[0].lexer;
+    self->len = len;
+
+    const bool first_failed = (chunks[0].result != FLUFF_OK);
+
+    bool   failed      = false;
+    size_t token_count = 0;
+    for (size_t i = 0; i < chunk_count; ++i) {
+        failed      |= (chunks[i].result != FLUFF_OK);
+        token_count += chunks[i].lexer.token_count;
+    }
+
+    if (!failed) {
+        if (token_count > self->token_capacity) {
+            self->token_capacity = token_count;
+            self->tokens         = fluff_alloc(self->tokens, sizeof(Token) * self->token_capacity);
+        }
+
+        // NOTE: local ids are given in order of appearance, so interning them chunk by chunk
+        //       gives the same ids as a serial parse
+        Token * dest = &self->tokens[self->token_count];
+        for (size_t i = 1; i < chunk_count; ++i) {
+            LexerChunk * chunk        = &chunks[i];
+            const size_t symbol_count = _symbol_table_size(&chunk->symbols);
+
+            chunk->dest = dest;
+            dest       += chunk->lexer.token_count;
+
+            if (symbol_count == 0) continue;
+            chunk->remap = fluff_alloc(NULL, sizeof(uint32_t) * symbol_count);
+            for (uint32_t j = 0; j < symbol_count; ++j) {
+                chunk->remap[j] = _symbol_table_intern(self->symbols, 
+                    _symbol_table_get(&chunk->symbols, j), _symbol_table_get_len(&chunk->symbols, j)
+                );
+            }
+        }
+
+        lexer_run_chunks(&chunks[1], chunk_count - 1, lexer_chunk_stitch);
+
+        self->token_count   = token_count;
+        self->prev_location = chunks[chunk_count - 1].lexer.prev_location;
+        self->location      = chunks[chunk_count - 1].lexer.location;
+    }
+
+    for (size_t i = 1; i < chunk_count; ++i) {
+        if (chunks[i].remap) fluff_free(chunks[i].remap);
+        _free_symbol_table(&chunks[i].symbols);
+        _free_lexer(&chunks[i].lexer);
+    }
+    fluff_free(chunks);
+
+    // NOTE: the first chunk ran on this thread and already reported its error
+    if (first_failed) return FLUFF_FAILURE;
+    if (failed) {
+        // NOTE: errors of the other chunks were logged on their own threads, a serial parse reports them in order
+        self->token_count = base_count;
+        self->location    = self->prev_location = (TextSect){ 0 };
+        return _lexer_parse(self);
     }
+    return FLUFF_OK;
+}
+
+FLUFF_PRIVATE_API FluffResult _lexer_edit(Lexer * self, const char * str, size_t len, size_t offset, size_t removed, size_t inserted) {
+    fluff_assert(offset + removed <= self->len && self->len - removed + inserted == len, 
+        "invalid edit at %zu (-%zu, +%zu) of a %zu characters source", offset, removed, inserted, self->len
+    );
+
+    // Finds the first token that may have been changed by the edit
+    size_t first = 0;
+    size_t last  = self->token_count;
+    while (first < last) {
+        const size_t mid = first + (last - first) / 2;
+        if (token_source_end(&self->tokens[mid]) + LEXER_LOOKAHEAD > offset) last = mid;
+        else first = mid + 1;
+    }
+
+    TextSect restart = { 0 };
+    if (first > 0) {
+        const Token * token = &self->tokens[first - 1];
+        restart = token->start;
+        _text_sect_advance(&restart, str, len, token_source_end(token) - token->start.index);
+    }
+
+    Lexer lexer;
+    _new_lexer(&lexer, self->interpret, str, len);
+    lexer.symbols       = self->symbols;
+    lexer.location      = restart;
+    lexer.prev_location = restart;
+
+    // Relexes until a token starts where an old one did past the edit, from there on both streams are the same
+    // NOTE: if the last parse failed the old stream stops early, so it can't be resynced with
+    const bool  can_sync = !self->failed;
+    FluffResult res      = FLUFF_OK;
+    size_t      old      = first;
+    bool        synced   = false;
+    while (_lexer_is_within_bounds(&lexer)) {
+        const size_t count = lexer.token_count;
+        if ((res = _lexer_parse_next(&lexer)) != FLUFF_OK) break;
+        if (lexer.token_count == count || !can_sync) continue;
+
+        const size_t start = token_source_start(&lexer.tokens[count]);
+        if (start < offset + inserted) continue;
+
+        const size_t old_start = start - inserted + removed;
+        while (old < self->token_count && token_source_start(&self->tokens[old]) < old_start) ++old;
+        if (old < self->token_count && token_source_start(&self->tokens[old]) == old_start) {
+            synced = true;
+            break;
+        }
+    }
+
+    // NOTE: the token that resynced is dropped, its old copy is kept and shifted with the rest
+    const size_t new_count   = lexer.token_count - synced;
+    const size_t tail_count  = (synced ? self->token_count - old : 0);
+    const size_t token_count = first + new_count + tail_count;
+
+    if (token_count > self->token_capacity) {
+        self->token_capacity = FLUFF_MAX(token_count, self->token_capacity * 2);
+        self->tokens         = fluff_alloc(self->tokens, sizeof(Token) * self->token_capacity);
+    }
+
+    if (synced) {
+        const TextSect from = self->tokens[old].start;
+        const TextSect to   = lexer.tokens[new_count].start;
+
+        // NOTE: edits that keep the token count and position of the rest only touch the edited range
+        Token * tail = &self->tokens[first + new_count];
+        if (first + new_count != old) memmove(tail, &self->tokens[old], sizeof(Token) * tail_count);
+
+        if (from.index != to.index || from.line != to.line || from.column != to.column) {
+            for (size_t i = 0; i < tail_count; ++i) text_sect_shift(&tail[i].start, from, to);
+            text_sect_shift(&self->prev_location, from, to);
+            text_sect_shift(&self->location, from, to);
+        }
+    } else {
+        self->prev_location = lexer.prev_location;
+        self->location      = lexer.location;
+    }
+
+    if (new_count > 0) memcpy(&self->tokens[first], lexer.tokens, sizeof(Token) * new_count);
+    self->token_count = token_count;
+    self->str         = str;
+    self->len         = len;
+    self->failed      = (res != FLUFF_OK);
+
+    _free_lexer(&lexer);
     return res;
 }
 
@@ -412,7 +976,7 @@ FLUFF_PRIVATE_API FluffResult _lexer_parse_number(Lexer * self) {
                 break;
             }
             default: {
-                if (!is_token_separator(ch))
+                if (_lexer_is_within_bounds(self) && !is_token_separator(ch))
                     _lexer_error("invalid literal '%c'", ch);
                 if (_lexer_read_decimal(self, &token) != FLUFF_OK)
                     return FLUFF_FAILURE;
@@ -444,10 +1008,14 @@ FLUFF_PRIVATE_API FluffResult _lexer_parse_label(Lexer * self) {
         _lexer_error("unexpected character '%c' in label", ch);
     }
 
-    token.type = label_match(&token, 
-        &self->str[self->prev_location.index], 
-        self->location.index - self->prev_location.index
-    );
+    const char * label     = &self->str[self->prev_location.index];
+    const size_t label_len = self->location.index - self->prev_location.index;
+
+    token.type = label_match(&token, label, label_len);
+    if (token.type == TOKEN_LABEL_LITERAL) {
+        token.data.sym = SYMBOL_NONE;
+        if (self->symbols) token.data.sym = _symbol_table_intern(self->symbols, label, label_len);
+    }
     _lexer_push(self, token);
     return FLUFF_OK;
 }
@@ -582,148 +1150,220 @@ FLUFF_PRIVATE_API FluffResult _lexer_read_long_operator(Lexer * self, Token * to
     return FLUFF_OK;
 }
 
+// NOTE: numbers are scanned straight from the source and consumed at once, errors still point
+//       at the offending character
+// NOTE: every base shares the range of FluffInt, a digit that would set the sign bit is out of range
+#define _lexer_number_error(...) {\
+            _lexer_consume(self, (size_t)(ptr - start));\
+            _lexer_error(__VA_ARGS__);\
+        }
+
 FLUFF_PRIVATE_API FluffResult _lexer_read_decimal(Lexer * self, Token * token) {
+    const char * start = &self->str[self->location.index];
+    const char * end   = &self->str[self->len];
+    const char * ptr   = start;
+
     bool e_notation = false;
     bool e_signed   = false;
     bool neg_e      = false;
     bool ended      = false;
     bool decimal    = false;
+    bool truncated  = false;
+
+    uint64_t mantissa = 0;
+    int      digits   = 0;
+    int64_t  exp10    = 0;
+    int64_t  exponent = 0;
+
+    while (ptr < end) {
+        const char ch = * ptr;
+        if (is_digit(ch)) {
+            if (e_notation) {
+                if (exponent < 100000) exponent = exponent * 10 + ch - '0';
+                ended = true;
+                ++ptr;
+                continue;
+            }
 
-    FluffFloat top      = 0;
-    FluffFloat bot      = 0;
-    FluffInt   bot_len  = 1;
-    FluffInt   exponent = 0;
-
-    while (_lexer_is_within_bounds(self)) {
-        const char ch = _lexer_current_char(self);
-        if (is_unary(ch) && e_notation) {
-            if (e_signed) break;
+            if (digits + 8 <= MAX_MANTISSA_DIGITS && end - ptr >= 8) {
+                const uint64_t word = read_eight_digits(ptr);
+                if (is_eight_digits(word)) {
+                    const uint64_t chunk = parse_eight_digits(word);
+                    if (mantissa != 0) {
+                        digits += 8;
+                    } else {
+                        // NOTE: leading zeros are not significant
+                        for (uint64_t v = chunk; v != 0; v /= 10) ++digits;
+                    }
+                    mantissa = mantissa * 100000000 + chunk;
+                    if (decimal) exp10 -= 8;
+                    ptr += 8;
+                    continue;
+                }
+            }
 
+            const uint64_t digit = (uint64_t)(ch - '0');
+            if (digits < MAX_MANTISSA_DIGITS) {
+                mantissa = mantissa * 10 + digit;
+                if (mantissa != 0) ++digits;
+                if (decimal) --exp10;
+            } else {
+                truncated |= (digit != 0);
+                if (!decimal) ++exp10;
+            }
+            ++ptr;
+            continue;
+        } else if (ch == '_') {
+            ++ptr;
+            continue;
+        } else if (is_unary(ch) && e_notation && !e_signed && !ended) {
             e_signed = true;
             neg_e    = (ch == '-');
-            _lexer_consume(self, 1);
-            continue;
-        }
-
-        if (is_digit(ch) || ch == '_') {
-            if (ch != '_') {
-                if (e_notation) {
-                    exponent = exponent * 10 + ch - '0';
-                    ended    = true;
-                } else if (decimal) {
-                    bot      = bot * 10 + ch - '0';
-                    bot_len *= 10;
-                } else {
-                    top = top * 10 + ch - '0';
-                }
-            }
-            _lexer_consume(self, 1);
+            ++ptr;
             continue;
         } else if (to_lower(ch) == 'e') {
             if (e_notation)
-                _lexer_error("duplicated e-notation marker in number");
+                _lexer_number_error("duplicated e-notation marker in number");
             e_notation = true;
-            _lexer_consume(self, 1);
+            ++ptr;
             continue;
         } else if (is_token_separator(ch)) {
             if (ch == '.') {
                 if (e_notation)
-                    _lexer_error("decimal number on e-notation exponent");
+                    _lexer_number_error("decimal number on e-notation exponent");
                 if (token->type == TOKEN_DECIMAL_LITERAL)
-                    _lexer_error("duplicated dot in decimal number");
+                    _lexer_number_error("duplicated dot in decimal number");
 
                 decimal     = true;
                 token->type = TOKEN_DECIMAL_LITERAL;
-                _lexer_consume(self, 1);
+                ++ptr;
                 continue;
             }
 
             if (e_notation && !ended)
-                _lexer_error("invalid e-notation exponent");
+                _lexer_number_error("invalid e-notation exponent");
             break;
         }
 
-        _lexer_error("malformed number");
+        _lexer_number_error("malformed number");
     }
 
-    if (decimal && bot != 0) {
-        bot /= bot_len;
-        top += bot;
-    }
+    if (e_notation && !ended)
+        _lexer_number_error("invalid e-notation exponent");
+
+    const int64_t exp_total = exp10 + (neg_e ? -exponent : exponent);
 
-    while (exponent-- != 0) top *= (neg_e ? 0.1 : 10);
+    if (!decimal) {
+        if (truncated || mantissa > INT64_MAX)
+            _lexer_number_error("integer literal out of range");
 
-    if (decimal) token->data.f = top;
-    else         token->data.i = (int)top;
+        FluffInt value = (FluffInt)mantissa;
+        for (int64_t e = exp_total; e > 0 && value != 0; --e) {
+            if (__builtin_mul_overflow(value, 10, &value))
+                _lexer_number_error("integer literal out of range");
+        }
+        for (int64_t e = exp_total; e < 0 && value != 0; ++e) value /= 10;
+
+        token->data.i = value;
+    } else {
+        FluffFloat value = 0;
+        if (truncated) {
+            // NOTE: the dropped digits only matter if they could round the result differently
+            FluffFloat upper = 0;
+            if (!decimal_eisel_lemire(mantissa, exp_total, &value) ||
+                !decimal_eisel_lemire(mantissa + 1, exp_total, &upper) || value != upper)
+                value = decimal_fallback(start, (size_t)(ptr - start));
+        } else if (!decimal_clinger(mantissa, exp_total, &value) &&
+                   !decimal_eisel_lemire(mantissa, exp_total, &value)) {
+            value = decimal_fallback(start, (size_t)(ptr - start));
+        }
+        token->data.f = value;
+    }
 
+    _lexer_consume(self, (size_t)(ptr - start));
     return FLUFF_OK;
 }
 
 FLUFF_PRIVATE_API FluffResult _lexer_read_hexadecimal(Lexer * self, Token * token) {
     _lexer_consume(self, 1);
 
-    while (_lexer_is_within_bounds(self)) {
-        const char ch = _lexer_current_char(self);
-        if (is_hexadecimal_digit(ch) || ch == '_') {
-            if (ch != '_') {
-                token->data.i *= 16;
-                token->data.i += base16toi(ch);
-            }
-            _lexer_consume(self, 1);
-            continue;
-        } else if (is_token_separator(ch)) {
-            break;
+    const char * start = &self->str[self->location.index];
+    const char * end   = &self->str[self->len];
+    const char * ptr   = start;
+
+    uint64_t value = 0;
+    while (ptr < end) {
+        const char ch = * ptr;
+        if (is_hexadecimal_digit(ch)) {
+            if (value >> 59)
+                _lexer_number_error("integer literal out of range");
+            value = (value << 4) | (uint64_t)base16toi(ch);
+        } else if (ch != '_') {
+            if (is_token_separator(ch)) break;
+            _lexer_number_error("hexadecimal number containing non-hexadecimal character '%c'", ch);
         }
-
-        _lexer_error("hexadecimal number containing non-hexadecimal character '%c'", ch);
+        ++ptr;
     }
 
+    token->data.i = (FluffInt)value;
+    _lexer_consume(self, (size_t)(ptr - start));
     return FLUFF_OK;
 }
 
 FLUFF_PRIVATE_API FluffResult _lexer_read_octal(Lexer * self, Token * token) {
     _lexer_consume(self, 1);
 
-    while (_lexer_is_within_bounds(self)) {
-        const char ch = _lexer_current_char(self);
-        if (is_octal(ch) || ch == '_') {
-            if (ch != '_') {
-                token->data.i *= 8;
-                token->data.i += ch - '0';
-            }
-            _lexer_consume(self, 1);
-            continue;
-        } else if (is_token_separator(ch)) {
-            break;
+    const char * start = &self->str[self->location.index];
+    const char * end   = &self->str[self->len];
+    const char * ptr   = start;
+
+    uint64_t value = 0;
+    while (ptr < end) {
+        const char ch = * ptr;
+        if (is_octal(ch)) {
+            if (value >> 60)
+                _lexer_number_error("integer literal out of range");
+            value = (value << 3) | (uint64_t)(ch - '0');
+        } else if (ch != '_') {
+            if (is_token_separator(ch)) break;
+            _lexer_number_error("octal number containing non-octal character '%c'", ch);
         }
-
-        _lexer_error("octal number containing non-octal character '%c'", ch);
+        ++ptr;
     }
 
+    token->data.i = (FluffInt)value;
+    _lexer_consume(self, (size_t)(ptr - start));
     return FLUFF_OK;
 }
 
 FLUFF_PRIVATE_API FluffResult _lexer_read_binary(Lexer * self, Token * token) {
     _lexer_consume(self, 1);
-    while (_lexer_is_within_bounds(self)) {
-        const char ch = _lexer_current_char(self);
-        if (is_binary(ch) || ch == '_') {
-            if (ch != '_') {
-                token->data.i <<= 1;
-                token->data.i |= ch - '0';
-            }
-            _lexer_consume(self, 1);
-            continue;
-        } else if (is_token_separator(ch)) {
-            break;
-        }
 
-        _lexer_error("binary number containing non-binary character '%c'", ch);
+    const char * start = &self->str[self->location.index];
+    const char * end   = &self->str[self->len];
+    const char * ptr   = start;
+
+    uint64_t value = 0;
+    while (ptr < end) {
+        const char ch = * ptr;
+        if (is_binary(ch)) {
+            if (value >> 62)
+                _lexer_number_error("integer literal out of range");
+            value = (value << 1) | (uint64_t)(ch - '0');
+        } else if (ch != '_') {
+            if (is_token_separator(ch)) break;
+            _lexer_number_error("binary number containing non-binary character '%c'", ch);
+        }
+        ++ptr;
     }
 
+    token->data.i = (FluffInt)value;
+    _lexer_consume(self, (size_t)(ptr - start));
     return FLUFF_OK;
 }
 
+#undef _lexer_number_error
+
 /* -=- Token management -=- */
 FLUFF_PRIVATE_API void _lexer_pop(Lexer * self) {
     // TODO: this
@@ -734,8 +1374,11 @@ FLUFF_PRIVATE_API void _lexer_push(Lexer * self, Token token) {
     token.start  = self->prev_location;
     token.length = self->location.index - self->prev_location.index;
     
-    self->tokens = fluff_alloc(self->tokens, sizeof(Token) * (++self->token_count));
-    self->tokens[self->token_count - 1] = token;
+    if (self->token_count >= self->token_capacity) {
+        self->token_capacity = FLUFF_MAX(self->token_capacity * 2, 64);
+        self->tokens         = fluff_alloc(self->tokens, sizeof(Token) * self->token_capacity);
+    }
+    self->tokens[self->token_count++] = token;
 }
 
 /* -=- Character reading -=- */
@@ -792,6 +1435,10 @@ FLUFF_PRIVATE_API void _lexer_dump(Lexer * self) {
                 { printf("%ld", token->data.i); break; }
             case TOKEN_DECIMAL_LITERAL:
                 { printf("%f", token->data.f); break; }
+            case TOKEN_LABEL_LITERAL: {
+                printf("'%.*s' #%u", (int)token->length, &self->str[token->start.index], token->data.sym);
+                break;
+            }
             default: {
                 printf("'%.*s'", (int)token->length, &self->str[token->start.index]);
                 break;
@@ -971,4 +1618,44 @@ FLUFF_PRIVATE_API TokenCategory _token_type_get_category(TokenType type) {
 
         default: return TOKEN_CATEGORY_NONE;
     } 
+}
+
+FLUFF_PRIVATE_API int _token_type_get_precedence(TokenType type) {
+    switch (type) {
+        case TOKEN_EQUAL:          return 1;
+        case TOKEN_OR:             return 2;
+        case TOKEN_AND:            return 3;
+        case TOKEN_BIT_OR:         return 4;
+        case TOKEN_BIT_XOR:        return 5;
+        case TOKEN_BIT_AND:        return 6;
+        case TOKEN_EQUALS:
+        case TOKEN_NOT_EQUALS:     return 7;
+        case TOKEN_LESS:
+        case TOKEN_LESS_EQUALS:
+        case TOKEN_GREATER:
+        case TOKEN_GREATER_EQUALS: return 8;
+        case TOKEN_AS:
+        case TOKEN_IS:             return 9;
+        case TOKEN_BIT_SHL:
+        case TOKEN_BIT_SHR:        return 10;
+        case TOKEN_PLUS:
+        case TOKEN_MINUS:          return 11;
+        case TOKEN_MULTIPLY:
+        case TOKEN_DIVIDE:
+        case TOKEN_MODULO:         return 12;
+        case TOKEN_POWER:          return 13;
+        default:                   return 0;
+    }
+}
+
+FLUFF_PRIVATE_API bool _token_type_is_right_associative(TokenType type) {
+    return type == TOKEN_EQUAL || type == TOKEN_POWER;
+}
+
+FLUFF_PRIVATE_API bool _token_type_is_prefix_operator(TokenType type) {
+    return type == TOKEN_MINUS || type == TOKEN_PLUS || type == TOKEN_NOT || type == TOKEN_BIT_NOT;
+}
+
+FLUFF_PRIVATE_API bool _token_type_is_type_keyword(TokenType type) {
+    return type >= TOKEN_VOID && type <= TOKEN_OBJECT;
 }
\ No newline at end of file
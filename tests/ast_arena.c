@@ -0,0 +1,92 @@
+/* -=============
+     Includes
+   =============- */
+
+#define FLUFF_IMPLEMENTATION
+#include <fluff.h>
+#include <error.h>
+#include <parser/interpret.h>
+#include <parser/ast.h>
+#include <core/config.h>
+
+#include <stdio.h>
+#include <string.h>
+
+/* -==============
+     Internals
+   ==============- */
+
+// NOTE: classes and members on purpose, the compiler doesn't support them yet but checking parses them
+static const char * statements[] = {
+    "class Point : object { pub let x: int = 0; let y: float = 1.5; pub virtual func len() -> int { return self.x * self.x; } }\n",
+    "func fib(n: int) -> int { if n < 2 { return n; } else { return fib(n - 1) + fib(n - 2); } }\n",
+    "let p = Point(); p.x = fib(10) as int; let ok = p is Point && !(p.len() > 3 || false);\n",
+    "let items = [1, 2, 3 + 4, -5]; items[0] = items[1] ** 2 % 3; const s: string = \"text\";\n",
+    "let i = 0; while i < 10 { i = i + 1; if i == 5 { continue; } } for j in 3 { break; }\n",
+};
+
+static size_t failures = 0;
+
+static void expect_arena(FluffInterpreter * interpret, const char * what) {
+    const Ast  * ast         = &interpret->ast;
+    const size_t token_count = interpret->lexer.token_count;
+
+    // NOTE: the arena is sized by the token count before parsing, every node and list item has to fit in it
+    const size_t bound = (sizeof(AstNode) + sizeof(uint32_t)) * (token_count + 1);
+    if (ast->node_count > token_count + 1 || ast->extra_count > token_count + 1 || _ast_memory_usage(&interpret->ast) > bound) {
+        fprintf(stderr, "%s: %zu tokens gave %u nodes and %u extras in %zu bytes, expected at most %zu bytes\n",
+            what, token_count, ast->node_count, ast->extra_count, _ast_memory_usage(&interpret->ast), bound
+        );
+        ++failures;
+    }
+    if (ast->root == AST_NONE || ast->nodes[ast->root].type != AST_NODE_ROOT) {
+        fprintf(stderr, "%s: no root node\n", what);
+        ++failures;
+    }
+}
+
+/* -=========
+     Main
+   =========- */
+
+int main() {
+    char     msg_buf[2048] = { 0 };
+    FluffLog logs[32]      = { 0 };
+    fluff_set_log(logs, 32);
+    fluff_set_log_msg_buffer(msg_buf, 2048);
+
+    FluffConfig cfg = fluff_get_default_config();
+    cfg.check = true;
+    fluff_init(&cfg, FLUFF_CURRENT_VERSION);
+
+    char   source[16384];
+    size_t len = 0;
+    for (size_t i = 0; i < 20; ++i) {
+        const char * statement = statements[i % (sizeof(statements) / sizeof(statements[0]))];
+        memcpy(&source[len], statement, strlen(statement));
+        len += strlen(statement);
+    }
+    source[len] = '\0';
+
+    FluffInterpreter * interpret = fluff_new_interpreter(NULL);
+    if (fluff_interpreter_read_string(interpret, source) != FLUFF_OK) {
+        fprintf(stderr, "checking the source failed\n");
+        fluff_logger_print();
+        return 1;
+    }
+    expect_arena(interpret, "read");
+
+    // NOTE: an edit is checked again, into the same arena
+    const char * edit = "let extra = [p.x, p.y, fib(3)]; ";
+    if (fluff_interpreter_edit(interpret, 0, 0, edit, strlen(edit)) != FLUFF_OK) {
+        fprintf(stderr, "checking the edited source failed\n");
+        fluff_logger_print();
+        return 1;
+    }
+    expect_arena(interpret, "edit");
+
+    fluff_free_interpreter(interpret);
+    fluff_close();
+    if (failures) fprintf(stderr, "%zu failures\n", failures);
+    return (failures != 0);
+}
\ No newline at end of file
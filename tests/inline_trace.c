@@ -0,0 +1,124 @@
+/* -=============
+     Includes
+   =============- */
+
+#define FLUFF_IMPLEMENTATION
+#include <fluff.h>
+#include <error.h>
+#include <parser/interpret.h>
+#include <core/instance.h>
+#include <core/method.h>
+#include <core/config.h>
+#include <core/ir.h>
+#include <core/vm.h>
+
+#include <stdio.h>
+#include <string.h>
+
+/* -==============
+     Internals
+   ==============- */
+
+// NOTE: 'inner' is inlined into 'mid', which is inlined into 'outer' in turn, 'run' and 'top' keep their calls
+static const char * source =
+    "func inner(x: int) -> int {\n"
+    "    if x == 3 { return x / 0; }\n"
+    "    return x;\n"
+    "}\n"
+    "func mid(x: int) -> int {\n"
+    "    return inner(x) + 1;\n"
+    "}\n"
+    "func outer(x: int) -> int {\n"
+    "    return mid(x) * 2;\n"
+    "}\n"
+    "func run(n: int) -> int {\n"
+    "    let s = 0;\n"
+    "    let i = 0;\n"
+    "    while i < n {\n"
+    "        s = s + outer(i);\n"
+    "        i = i + 1;\n"
+    "    }\n"
+    "    return s;\n"
+    "}\n"
+    "func top(n: int) -> int {\n"
+    "    let r = run(n);\n"
+    "    return r + 1;\n"
+    "}\n"
+    "return top(5);\n";
+
+static size_t failures = 0;
+
+// Gives the address of the division in 'chunk', where the error is raised.
+static size_t find_div(const IRChunk * chunk) {
+    for (size_t ip = 0; ip < chunk->size; ip += _ir_decode(chunk->data, ip).size)
+        if (_ir_decode(chunk->data, ip).op == IR_OP_DIV) return ip;
+    return SIZE_MAX;
+}
+
+// Runs the source with 'cfg', the error it raises has to go through every function down to 'top'.
+static void expect_trace(FluffConfig * cfg, const char * what) {
+    fluff_init(cfg, FLUFF_CURRENT_VERSION);
+    fluff_logger_clear();
+
+    FluffInstance    * instance  = fluff_new_instance();
+    FluffModule      * module    = fluff_instance_get_core_module(instance);
+    FluffInterpreter * interpret = fluff_new_interpreter(module);
+    FluffVM          * vm        = fluff_new_vm(instance, module);
+
+    if (fluff_interpreter_read_string(interpret, source) != FLUFF_OK) {
+        fprintf(stderr, "%s: compiling failed\n", what);
+        fluff_logger_print();
+        ++failures;
+    } else if (fluff_interpreter_run(interpret, vm) != FLUFF_FAILURE) {
+        fprintf(stderr, "%s: dividing by zero didn't fail\n", what);
+        ++failures;
+    } else {
+        FluffMethod ** methods = interpret->binary->methods;
+
+        char expected[5][64];
+        snprintf(expected[0], 64, "in 'inner' at %.4zx, inlined", find_div(methods[0]->chunk));
+        snprintf(expected[1], 64, "in 'mid' at %.4zx, inlined", find_div(methods[1]->chunk));
+        snprintf(expected[2], 64, "in 'outer' at %.4zx", find_div(methods[2]->chunk));
+        snprintf(expected[3], 64, "in 'run' at ");
+        snprintf(expected[4], 64, "in 'top' at ");
+
+        const FluffLog * logs = fluff_get_log_buffer();
+        if (fluff_get_log_count() < 6 || !strstr(logs[0].msg, "division by zero")) {
+            fprintf(stderr, "%s: expected the error followed by 5 frames\n", what);
+            fluff_logger_print();
+            ++failures;
+        } else {
+            for (size_t i = 0; i < 5; ++i) {
+                if (logs[i + 1].type == FLUFF_LOG_TYPE_NOTE && !strncmp(logs[i + 1].msg, expected[i], strlen(expected[i])))
+                    continue;
+                fprintf(stderr, "%s: frame %zu is '%.*s', expected '%s'\n", what, i, (int)logs[i + 1].msg_len, logs[i + 1].msg, expected[i]);
+                ++failures;
+            }
+        }
+    }
+
+    fluff_free_vm(vm);
+    fluff_free_interpreter(interpret);
+    fluff_free_instance(instance);
+    fluff_close();
+}
+
+/* -=========
+     Main
+   =========- */
+
+int main() {
+    char     msg_buf[2048] = { 0 };
+    FluffLog logs[32]      = { 0 };
+    fluff_set_log(logs, 32);
+    fluff_set_log_msg_buffer(msg_buf, 2048);
+
+    FluffConfig cfg = fluff_get_default_config();
+    expect_trace(&cfg, "stack VM");
+
+    cfg.register_vm = true;
+    expect_trace(&cfg, "register VM");
+
+    if (failures) fprintf(stderr, "%zu failures\n", failures);
+    return (failures != 0);
+}
\ No newline at end of file
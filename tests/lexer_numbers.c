@@ -0,0 +1,163 @@
+/* -=============
+     Includes
+   =============- */
+
+#define FLUFF_IMPLEMENTATION
+#include <fluff.h>
+#include <error.h>
+#include <parser/lexer.h>
+#include <parser/interpret.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* -==============
+     Internals
+   ==============- */
+
+static size_t failures = 0;
+
+// Lexes a lone literal, the lexer gets its own interpreter so errors have a path to point at.
+static FluffResult lex_number(const char * src, Token * token) {
+    FluffInterpreter interpret = { .path = "[test]" };
+    Lexer            lexer;
+    _new_lexer(&lexer, &interpret, src, strlen(src));
+
+    FluffResult res = _lexer_parse(&lexer);
+    if (res == FLUFF_OK && lexer.token_count != 1) res = FLUFF_FAILURE;
+    if (res == FLUFF_OK) * token = lexer.tokens[0];
+
+    _free_lexer(&lexer);
+    fluff_logger_clear();
+    return res;
+}
+
+static void expect_int(const char * src, FluffInt expected) {
+    Token token;
+    if (lex_number(src, &token) != FLUFF_OK || token.type != TOKEN_INTEGER_LITERAL || token.data.i != expected) {
+        fprintf(stderr, "'%s': expected %lld\n", src, (long long)expected);
+        ++failures;
+    }
+}
+
+static void expect_out_of_range(const char * src) {
+    Token token;
+    if (lex_number(src, &token) == FLUFF_OK) {
+        fprintf(stderr, "'%s': expected an error, got %lld\n", src, (long long)token.data.i);
+        ++failures;
+    }
+}
+
+// NOTE: strtod() is the reference, results have to be the same bits (which also tells 0.0 from -0.0)
+static void expect_strtod(const char * src) {
+    const double expected = strtod(src, NULL);
+
+    Token token;
+    if (lex_number(src, &token) != FLUFF_OK || token.type != TOKEN_DECIMAL_LITERAL ||
+        memcmp(&token.data.f, &expected, sizeof(expected)) != 0) {
+        fprintf(stderr, "'%s': expected %.17g, got %.17g\n", src, expected, token.data.f);
+        ++failures;
+    }
+}
+
+FLUFF_CONSTEXPR uint64_t next_random(uint64_t * state) {
+    // NOTE: xorshift64, a fixed seed keeps every run checking the same literals
+    * state ^= * state << 13;
+    * state ^= * state >> 7;
+    * state ^= * state << 17;
+    return * state;
+}
+
+/* -=========
+     Main
+   =========- */
+
+int main() {
+    char     msg_buf[2048] = { 0 };
+    FluffLog logs[32]      = { 0 };
+    fluff_set_log(logs, 32);
+    fluff_set_log_msg_buffer(msg_buf, 2048);
+    fluff_init(NULL, FLUFF_CURRENT_VERSION);
+
+    /* -=- Integer ranges -=- */
+    expect_int("9223372036854775807", INT64_MAX);
+    expect_int("0x7fffffffffffffff", INT64_MAX);
+    expect_int("0x0000_7fff_ffff_ffff_ffff", INT64_MAX);
+    expect_int("0o777777777777777777777", INT64_MAX);
+    expect_int("0b111111111111111111111111111111111111111111111111111111111111111", INT64_MAX);
+
+    expect_out_of_range("9223372036854775808");
+    expect_out_of_range("0x8000000000000000");
+    expect_out_of_range("0xffffffffffffffff");
+    expect_out_of_range("0x1_0000_0000_0000_0000");
+    expect_out_of_range("0o1000000000000000000000");
+    expect_out_of_range("0o1777777777777777777777");
+    expect_out_of_range("0b1000000000000000000000000000000000000000000000000000000000000000");
+
+    /* -=- Subnormals -=- */
+    expect_strtod("4.9406564584124654e-324");
+    expect_strtod("2.4703282292062327e-324");
+    expect_strtod("2.4703282292062328e-324");
+    expect_strtod("1.0e-320");
+    expect_strtod("2.2250738585072009e-308");
+    expect_strtod("2.2250738585072011e-308");
+    expect_strtod("2.2250738585072014e-308");
+    expect_strtod("1.0e-400");
+
+    /* -=- Halfway values -=- */
+    expect_strtod("9007199254740993.0");
+    expect_strtod("9007199254740995.0");
+    expect_strtod("1.00000000000000011102230246251565404236316680908203125");
+    expect_strtod("1.00000000000000011102230246251565404236316680908203124");
+    expect_strtod("1.00000000000000011102230246251565404236316680908203126");
+    expect_strtod("0.500000000000000166533453693773481063544750213623046875");
+    expect_strtod("7.2057594037927933e16");
+
+    /* -=- Exponents around the power table -=- */
+    expect_strtod("1.0e64");
+    expect_strtod("1.0e-64");
+    expect_strtod("9.999999999999999e64");
+    expect_strtod("1.2345678901234567e-64");
+    expect_strtod("1.0e65");
+    expect_strtod("1.0e-65");
+    expect_strtod("4.5e-66");
+    expect_strtod("1.7976931348623157e308");
+    expect_strtod("1.7976931348623159e308");
+    expect_strtod("1.0e400");
+
+    /* -=- Long mantissas -=- */
+    expect_strtod("1234567890123456789.0");
+    expect_strtod("9999999999999999999.0");
+    expect_strtod("0.1234567890123456789");
+    expect_strtod("12345678901234567890.0");
+    expect_strtod("18446744073709551615.0");
+    expect_strtod("18446744073709551616.0");
+    expect_strtod("0.12345678901234567891");
+    expect_strtod("9007199254740993000.0");
+    expect_strtod("90071992547409930001.0e-1");
+
+    /* -=- Random literals -=- */
+    uint64_t state = 0x9e3779b97f4a7c15ull;
+    for (size_t i = 0; i < 200000; ++i) {
+        char   src[64];
+        size_t len    = 0;
+        size_t digits = 1 + next_random(&state) % 24;
+        size_t dot    = next_random(&state) % digits;
+
+        // NOTE: a literal can't start with a zero, unless it's followed by a base
+        for (size_t d = 0; d < digits; ++d) {
+            src[len++] = (char)((d == 0 ? '1' : '0') + next_random(&state) % (d == 0 ? 9 : 10));
+            if (d == dot) src[len++] = '.';
+        }
+        if (dot == digits - 1) src[len++] = '0';
+
+        const int exponent = (int)(next_random(&state) % 701) - 350;
+        snprintf(&src[len], sizeof(src) - len, "e%d", exponent);
+        expect_strtod(src);
+    }
+
+    fluff_close();
+    if (failures) fprintf(stderr, "%zu failures\n", failures);
+    return (failures != 0);
+}
\ No newline at end of file
@@ -0,0 +1,153 @@
+/* -=============
+     Includes
+   =============- */
+
+#define FLUFF_IMPLEMENTATION
+#include <fluff.h>
+#include <error.h>
+#include <parser/lexer.h>
+#include <parser/interpret.h>
+#include <core/module.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* -==============
+     Internals
+   ==============- */
+
+// NOTE: well past the size each thread needs before the lexer splits the source at all
+#define SOURCE_SIZE (1 << 21)
+
+static size_t failures = 0;
+
+static char * source     = NULL;
+static size_t source_len = 0;
+
+FLUFF_CONSTEXPR void source_append(const char * text) {
+    const size_t len = strlen(text);
+    memcpy(&source[source_len], text, len);
+    source_len += len;
+}
+
+FLUFF_CONSTEXPR void source_fill(char ch, size_t count) {
+    memset(&source[source_len], ch, count);
+    source_len += count;
+}
+
+// Builds a source where most of the bytes, and so most of the places the lexer first aims to split at, are inside
+// block comments, line comments and strings full of newlines and ';'.
+static void build_source() {
+    // NOTE: a block is far below 64 KB, so the last one always fits
+    source = malloc(SOURCE_SIZE + (1 << 16));
+    size_t n = 0;
+    while (source_len < SOURCE_SIZE) {
+        switch (n++ % 4) {
+            case 0: {
+                source_append("let a = 1; /* ;\n");
+                for (size_t i = 0; i < 200; ++i) {
+                    source_append("let b = 2;\n");
+                    source_fill('x', 64);
+                }
+                source_append("*/ let c = a + 3;\n");
+                break;
+            }
+            case 1: {
+                source_append("let s = \"");
+                for (size_t i = 0; i < 200; ++i) {
+                    source_append(";\nlet t = 'u';\n");
+                    source_fill('y', 64);
+                }
+                source_append("\";\n");
+                break;
+            }
+            case 2: {
+                for (size_t i = 0; i < 200; ++i) {
+                    source_append("x = x * 2.5; // ; \" ' /* ;");
+                    source_fill('z', 64);
+                    source_append("\n");
+                }
+                break;
+            }
+            default: {
+                source_append("func f(n: int) -> int { return n << 2; } let q = 'single ;\n quoted\n';\n");
+                break;
+            }
+        }
+    }
+}
+
+static FluffResult lex_source(FluffModule * module, size_t thread_count, Lexer * lexer) {
+    FluffInterpreter interpret = { .path = "[test]", .module = module };
+    _new_lexer(lexer, &interpret, source, source_len);
+
+    // NOTE: the interpreter only lives for the parse, the tokens don't point to it
+    const FluffResult res = _lexer_parse_parallel(lexer, thread_count);
+    lexer->interpret = NULL;
+    return res;
+}
+
+FLUFF_CONSTEXPR bool token_equals(const Token * a, const Token * b) {
+    if (a->type != b->type || a->length != b->length) return false;
+    if (a->start.index != b->start.index || a->start.line != b->start.line || a->start.column != b->start.column) return false;
+    return !memcmp(&a->data, &b->data, sizeof(a->data));
+}
+
+/* -=========
+     Main
+   =========- */
+
+int main() {
+    char     msg_buf[2048] = { 0 };
+    FluffLog logs[32]      = { 0 };
+    fluff_set_log(logs, 32);
+    fluff_set_log_msg_buffer(msg_buf, 2048);
+    fluff_init(NULL, FLUFF_CURRENT_VERSION);
+
+    build_source();
+
+    FluffModule * serial_module = fluff_new_module("serial");
+    Lexer         serial;
+    if (lex_source(serial_module, 1, &serial) != FLUFF_OK) {
+        fprintf(stderr, "serial lexing failed\n");
+        fluff_logger_print();
+        return 1;
+    }
+
+    const size_t thread_counts[] = { 2, 3, 4, 7, 16 };
+    for (size_t t = 0; t < sizeof(thread_counts) / sizeof(thread_counts[0]); ++t) {
+        // NOTE: a module of its own, so labels are only equal if the chunks intern them in the same order
+        FluffModule * module = fluff_new_module("parallel");
+        Lexer         parallel;
+        if (lex_source(module, thread_counts[t], &parallel) != FLUFF_OK) {
+            fprintf(stderr, "%zu threads: lexing failed\n", thread_counts[t]);
+            fluff_logger_print();
+            fluff_logger_clear();
+            ++failures;
+        } else if (parallel.token_count != serial.token_count) {
+            fprintf(stderr, "%zu threads: %zu tokens, serial has %zu\n", thread_counts[t], parallel.token_count, serial.token_count);
+            ++failures;
+        } else {
+            for (size_t i = 0; i < serial.token_count; ++i) {
+                if (token_equals(&parallel.tokens[i], &serial.tokens[i])) continue;
+                fprintf(stderr, "%zu threads: token %zu at %zu differs from the serial one\n",
+                    thread_counts[t], i, (size_t)serial.tokens[i].start.index
+                );
+                ++failures;
+                break;
+            }
+        }
+
+        _free_lexer(&parallel);
+        fluff_free_module(module);
+    }
+
+    _free_lexer(&serial);
+    fluff_free_module(serial_module);
+    free(source);
+
+    fluff_close();
+    if (failures) fprintf(stderr, "%zu failures\n", failures);
+    return (failures != 0);
+}
\ No newline at end of file
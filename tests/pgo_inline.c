@@ -0,0 +1,129 @@
+/* -=============
+     Includes
+   =============- */
+
+#define FLUFF_IMPLEMENTATION
+#include <fluff.h>
+#include <error.h>
+#include <parser/interpret.h>
+#include <core/instance.h>
+#include <core/method.h>
+#include <core/config.h>
+#include <core/ir.h>
+#include <core/vm.h>
+
+#include <stdio.h>
+#include <string.h>
+
+/* -==============
+     Internals
+   ==============- */
+
+// NOTE: 'clamp' is past the size of the inliner without a profile, it's only inlined once a profile found it hot
+static const char * source =
+    "func clamp(x: int, lo: int, hi: int) -> int {\n"
+    "    let y = x * 3 + 1;\n"
+    "    let z = y - x * 2;\n"
+    "    if z < lo { return lo; }\n"
+    "    if z > hi { return hi; }\n"
+    "    if z == 7 { return 70; }\n"
+    "    if z == 8 { return 80; }\n"
+    "    return z + (x - x) + (lo - lo) + (hi - hi);\n"
+    "}\n"
+    "func run(n: int) -> int {\n"
+    "    let s = 0;\n"
+    "    let i = 0;\n"
+    "    while i < n {\n"
+    "        s = s + clamp(i - i / 50 * 50, 3, 40);\n"
+    "        i = i + 1;\n"
+    "    }\n"
+    "    return s;\n"
+    "}\n"
+    "return run(5000);\n";
+
+static size_t failures = 0;
+
+static size_t count_calls(const IRChunk * chunk) {
+    size_t count = 0;
+    for (size_t ip = 0; ip < chunk->size; ip += _ir_decode(chunk->data, ip).size) {
+        const uint8_t op = _ir_decode(chunk->data, ip).op;
+        if (op == IR_OP_CALL || op == IR_OP_TAIL_CALL) ++count;
+    }
+    return count;
+}
+
+// Compiles and runs the source with 'cfg', gives how many calls are left in 'run' and what it returned.
+// NOTE: the config only takes the fields that are set, so every step keeps the profiles of the ones before it
+static bool run_source(FluffConfig * cfg, size_t * calls, FluffInt * result) {
+    fluff_init(cfg, FLUFF_CURRENT_VERSION);
+
+    FluffInstance    * instance  = fluff_new_instance();
+    FluffModule      * module    = fluff_instance_get_core_module(instance);
+    FluffInterpreter * interpret = fluff_new_interpreter(module);
+    FluffVM          * vm        = fluff_new_vm(instance, module);
+
+    bool ok = (fluff_interpreter_read_string(interpret, source) == FLUFF_OK);
+    if (ok) * calls = count_calls(interpret->binary->methods[1]->chunk);
+    ok = ok && (fluff_interpreter_run(interpret, vm) == FLUFF_OK);
+    if (ok) * result = fluff_vm_at(vm, -1)->data._int;
+    if (!ok) fluff_logger_print();
+
+    fluff_free_vm(vm);
+    fluff_free_interpreter(interpret);
+    fluff_free_instance(instance);
+    fluff_close();
+    return ok;
+}
+
+static void expect_run(FluffConfig * cfg, const char * what, size_t expected_calls, FluffInt expected) {
+    size_t   calls  = 0;
+    FluffInt result = 0;
+    if (!run_source(cfg, &calls, &result)) {
+        fprintf(stderr, "%s: running failed\n", what);
+        ++failures;
+        return;
+    }
+    if (calls != expected_calls) {
+        fprintf(stderr, "%s: %zu calls left in 'run', expected %zu\n", what, calls, expected_calls);
+        ++failures;
+    }
+    if (result != expected) {
+        fprintf(stderr, "%s: got %lld, expected %lld\n", what, (long long)result, (long long)expected);
+        ++failures;
+    }
+}
+
+/* -=========
+     Main
+   =========- */
+
+int main() {
+    char     msg_buf[2048] = { 0 };
+    FluffLog logs[32]      = { 0 };
+    fluff_set_log(logs, 32);
+    fluff_set_log_msg_buffer(msg_buf, 2048);
+
+    FluffConfig cfg      = fluff_get_default_config();
+    size_t      calls    = 0;
+    FluffInt    expected = 0;
+    if (!run_source(&cfg, &calls, &expected) || calls != 1) {
+        fprintf(stderr, "without a profile: expected 'clamp' to stay a call\n");
+        return 1;
+    }
+
+    cfg.pgo_out = "pgo_inline_first.prof";
+    expect_run(&cfg, "recording", 1, expected);
+
+    // NOTE: the inlined code is recorded in turn, the calls it no longer makes still count
+    cfg.pgo_in  = "pgo_inline_first.prof";
+    cfg.pgo_out = "pgo_inline_second.prof";
+    expect_run(&cfg, "first profile", 0, expected);
+
+    cfg.pgo_in = "pgo_inline_second.prof";
+    expect_run(&cfg, "second profile", 0, expected);
+
+    remove("pgo_inline_first.prof");
+    remove("pgo_inline_second.prof");
+    if (failures) fprintf(stderr, "%zu failures\n", failures);
+    return (failures != 0);
+}
\ No newline at end of file
@@ -0,0 +1,86 @@
+/* -=============
+     Includes
+   =============- */
+
+#define FLUFF_IMPLEMENTATION
+#include <fluff.h>
+#include <error.h>
+#include <parser/interpret.h>
+#include <core/instance.h>
+#include <core/method.h>
+#include <core/vm.h>
+
+#include <stdio.h>
+#include <string.h>
+
+/* -==============
+     Internals
+   ==============- */
+
+static size_t failures = 0;
+
+// Calls 'method' from the host with the given arguments, like an embedder would.
+static FluffResult invoke(FluffVM * vm, FluffMethod * method, const FluffInt * args, size_t argc) {
+    FluffObject callee;
+    _new_function_object(&callee, vm->instance, method);
+    ++method->ref_count;
+    for (size_t i = 0; i < argc; ++i) fluff_vm_push_int(vm, args[i]);
+
+    const FluffResult res = fluff_vm_invoke(vm, &callee, argc);
+    _free_object(&callee);
+    return res;
+}
+
+/* -=========
+     Main
+   =========- */
+
+int main() {
+    char     msg_buf[2048] = { 0 };
+    FluffLog logs[32]      = { 0 };
+    fluff_set_log(logs, 32);
+    fluff_set_log_msg_buffer(msg_buf, 2048);
+    fluff_init(NULL, FLUFF_CURRENT_VERSION);
+
+    FluffInstance    * instance  = fluff_new_instance();
+    FluffModule      * module    = fluff_instance_get_core_module(instance);
+    FluffInterpreter * interpret = fluff_new_interpreter(module);
+    FluffVM          * vm        = fluff_new_vm(instance, module);
+
+    if (fluff_interpreter_read_string(interpret, "func add(a: int, b: int) -> int { return a + b; }") != FLUFF_OK ||
+        fluff_interpreter_run(interpret, vm) != FLUFF_OK) {
+        fprintf(stderr, "compiling 'add' failed\n");
+        fluff_logger_print();
+        return 1;
+    }
+    FluffMethod * add = interpret->binary->methods[0];
+
+    const FluffInt args[] = { 40, 2, 7 };
+    if (invoke(vm, add, args, 2) != FLUFF_OK || fluff_vm_at(vm, -1)->data._int != 42) {
+        fprintf(stderr, "add(40, 2) didn't give 42\n");
+        fluff_logger_print();
+        ++failures;
+    }
+
+    // NOTE: a chunk reads its parameters from fixed slots, so too few or too many arguments have to be refused
+    for (size_t argc = 0; argc <= 3; argc += 3) {
+        fluff_logger_clear();
+        const size_t size = fluff_vm_size(vm);
+        if (invoke(vm, add, args, argc) != FLUFF_FAILURE) {
+            fprintf(stderr, "add() with %zu arguments didn't fail\n", argc);
+            ++failures;
+        } else if (fluff_get_log_count() == 0 || !strstr(fluff_get_log_buffer()[0].msg, "expects 2 arguments")) {
+            fprintf(stderr, "add() with %zu arguments failed without reporting its arity\n", argc);
+            fluff_logger_print();
+            ++failures;
+        }
+        fluff_vm_popn(vm, fluff_vm_size(vm) - size);
+    }
+
+    fluff_free_vm(vm);
+    fluff_free_interpreter(interpret);
+    fluff_free_instance(instance);
+    fluff_close();
+    if (failures) fprintf(stderr, "%zu failures\n", failures);
+    return (failures != 0);
+}
\ No newline at end of file
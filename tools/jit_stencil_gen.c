@@ -0,0 +1,255 @@
+/* -=============
+     Includes
+   =============- */
+
+#include <elf.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* -==============
+     Internals
+   ==============- */
+
+/*
+    Reads the object file jit_stencils.c was compiled into and writes the stencil table the JIT copies from.
+    Each '_jit_stencil_*' function becomes the bytes of its code and the holes left by its relocations.
+
+    Usage: jit_stencil_gen <stencils.o> <output.h>
+*/
+
+#define STENCIL_PREFIX "_jit_stencil_"
+#define HOLE_PREFIX    "_JIT_"
+
+typedef struct Hole {
+    uint64_t     offset;
+    const char * name;
+    int64_t      addend;
+    bool         jump;
+} Hole;
+
+typedef struct Stencil {
+    const char    * name;
+    const uint8_t * code;
+    uint64_t        size;
+    Hole          * holes;
+    size_t          hole_count;
+} Stencil;
+
+typedef struct Object {
+    uint8_t    * data;
+    size_t       size;
+    Elf64_Shdr * sections;
+    size_t       section_count;
+    const char * section_names;
+    Elf64_Sym  * symbols;
+    size_t       symbol_count;
+    const char * symbol_names;
+} Object;
+
+static const char * object_path;
+
+static void fail(const char * what, const char * name) {
+    fprintf(stderr, "jit_stencil_gen: %s: %s (%s)\n", object_path, what, name);
+    exit(EXIT_FAILURE);
+}
+
+static int compare_holes(const void * a, const void * b) {
+    const uint64_t x = ((const Hole *)a)->offset, y = ((const Hole *)b)->offset;
+    return (x > y) - (x < y);
+}
+
+/* -=- Reading -=- */
+static void read_object(Object * self, const char * path) {
+    FILE * file = fopen(path, "rb");
+    if (!file) fail("couldn't open the file", path);
+
+    fseek(file, 0, SEEK_END);
+    self->size = (size_t)ftell(file);
+    fseek(file, 0, SEEK_SET);
+    self->data = malloc(self->size);
+    if (!self->data || fread(self->data, 1, self->size, file) != self->size) fail("couldn't read the file", path);
+    fclose(file);
+
+    const Elf64_Ehdr * header = (const Elf64_Ehdr *)self->data;
+    if (self->size < sizeof(Elf64_Ehdr) || memcmp(header->e_ident, ELFMAG, SELFMAG) != 0 ||
+        header->e_ident[EI_CLASS] != ELFCLASS64 || header->e_machine != EM_X86_64 || header->e_type != ET_REL)
+        fail("not a relocatable x86-64 ELF object", path);
+
+    self->sections      = (Elf64_Shdr *)(self->data + header->e_shoff);
+    self->section_count = header->e_shnum;
+    self->section_names = (const char *)(self->data + self->sections[header->e_shstrndx].sh_offset);
+
+    for (size_t i = 0; i < self->section_count; ++i) {
+        const Elf64_Shdr * section = &self->sections[i];
+        const char       * name    = self->section_names + section->sh_name;
+
+        // NOTE: stencils are copied on their own, so they can't refer to anything but their holes
+        if (section->sh_size > 0 && (section->sh_flags & SHF_ALLOC) && !(section->sh_flags & SHF_EXECINSTR))
+            fail("stencils can't use data sections", name);
+
+        if (section->sh_type != SHT_SYMTAB) continue;
+        self->symbols      = (Elf64_Sym *)(self->data + section->sh_offset);
+        self->symbol_count = section->sh_size / sizeof(Elf64_Sym);
+        self->symbol_names = (const char *)(self->data + self->sections[section->sh_link].sh_offset);
+    }
+    if (!self->symbols) fail("no symbol table", path);
+}
+
+// NOTE: holes feeding an indirect jump are marked, so the JIT can turn them into direct ones
+static bool is_jump(const Stencil * stencil, uint64_t offset, uint64_t * end) {
+    if (offset < 2 || offset + 10 > stencil->size) return false;
+
+    const uint8_t * code = stencil->code;
+    const uint8_t   rex  = code[offset - 2], mov = code[offset - 1];
+    if ((rex != 0x48 && rex != 0x49) || (mov & 0xf8) != 0xb8) return false;
+
+    uint64_t at = offset + 8;
+    if (rex == 0x49) {
+        if (code[at] != 0x41) return false;
+        ++at;
+    }
+    if (at + 2 > stencil->size || code[at] != 0xff || code[at + 1] != (0xe0 | (mov & 0x7))) return false;
+
+    * end = at + 2;
+    return true;
+}
+
+static void read_holes(const Object * self, Stencil * stencil, size_t section, uint64_t start) {
+    for (size_t i = 0; i < self->section_count; ++i) {
+        const Elf64_Shdr * rela = &self->sections[i];
+        if (rela->sh_info != section) continue;
+        if (rela->sh_type == SHT_REL) fail("unsupported relocation section", stencil->name);
+        if (rela->sh_type != SHT_RELA) continue;
+
+        const Elf64_Rela * entries = (const Elf64_Rela *)(self->data + rela->sh_offset);
+        const size_t       count   = rela->sh_size / sizeof(Elf64_Rela);
+        stencil->holes = realloc(stencil->holes, sizeof(Hole) * (stencil->hole_count + count));
+
+        for (size_t k = 0; k < count; ++k) {
+            const Elf64_Rela * entry  = &entries[k];
+            const Elf64_Sym  * symbol = &self->symbols[ELF64_R_SYM(entry->r_info)];
+            const char       * name   = self->symbol_names + symbol->st_name;
+
+            if (entry->r_offset < start || entry->r_offset >= start + stencil->size) continue;
+            if (ELF64_R_TYPE(entry->r_info) != R_X86_64_64) fail("unsupported relocation", stencil->name);
+            if (symbol->st_shndx != SHN_UNDEF || strncmp(name, HOLE_PREFIX, strlen(HOLE_PREFIX)) != 0)
+                fail("relocation to something other than a hole", name);
+
+            Hole * hole = &stencil->holes[stencil->hole_count++];
+            uint64_t end;
+            hole->offset = entry->r_offset - start;
+            hole->name   = name + strlen(HOLE_PREFIX);
+            hole->addend = entry->r_addend;
+            hole->jump   = is_jump(stencil, hole->offset, &end);
+        }
+    }
+    qsort(stencil->holes, stencil->hole_count, sizeof(Hole), compare_holes);
+
+    // NOTE: stencils are laid out in the order they run, a jump to the next one at the very end is dropped
+    if (stencil->hole_count == 0) return;
+    const Hole * last = &stencil->holes[stencil->hole_count - 1];
+    uint64_t     end;
+    if (strcmp(last->name, "CONTINUE") == 0 && is_jump(stencil, last->offset, &end) && end == stencil->size) {
+        stencil->size = last->offset - 2;
+        --stencil->hole_count;
+    }
+}
+
+static Stencil * read_stencils(const Object * self, size_t * count) {
+    Stencil * stencils = NULL;
+    * count = 0;
+
+    for (size_t i = 0; i < self->symbol_count; ++i) {
+        const Elf64_Sym * symbol = &self->symbols[i];
+        const char      * name   = self->symbol_names + symbol->st_name;
+        if (ELF64_ST_TYPE(symbol->st_info) != STT_FUNC || strncmp(name, STENCIL_PREFIX, strlen(STENCIL_PREFIX)) != 0)
+            continue;
+
+        const Elf64_Shdr * section = &self->sections[symbol->st_shndx];
+        stencils = realloc(stencils, sizeof(Stencil) * (* count + 1));
+
+        Stencil * stencil = &stencils[(* count)++];
+        memset(stencil, 0, sizeof(Stencil));
+        stencil->name = name + strlen(STENCIL_PREFIX);
+        stencil->code = self->data + section->sh_offset + symbol->st_value;
+        stencil->size = symbol->st_size;
+        read_holes(self, stencil, symbol->st_shndx, symbol->st_value);
+    }
+    if (* count == 0) fail("no stencils found", object_path);
+    return stencils;
+}
+
+/* -=- Writing -=- */
+static void write_table(FILE * out, const Stencil * stencils, size_t count) {
+    fprintf(out, "// NOTE: generated by jit_stencil_gen from the stencils in tools/jit_stencils.c, don't edit it\n\n");
+
+    fprintf(out, "typedef enum JitStencilType {\n");
+    for (size_t i = 0; i < count; ++i) fprintf(out, "    JIT_STENCIL_%s,\n", stencils[i].name);
+    fprintf(out, "    JIT_STENCIL_COUNT,\n} JitStencilType;\n");
+
+    for (size_t i = 0; i < count; ++i) {
+        const Stencil * stencil = &stencils[i];
+
+        fprintf(out, "\nstatic const uint8_t jit_code_%s[] = {", stencil->name);
+        for (uint64_t k = 0; k < stencil->size; ++k)
+            fprintf(out, "%s0x%02x,", (k % 16 == 0 ? "\n    " : " "), stencil->code[k]);
+        fprintf(out, "\n};\n");
+
+        if (stencil->hole_count == 0) continue;
+        fprintf(out, "\nstatic const JitHole jit_holes_%s[] = {\n", stencil->name);
+        for (size_t k = 0; k < stencil->hole_count; ++k) {
+            const Hole * hole = &stencil->holes[k];
+            fprintf(out, "    { .offset = 0x%03llx, .kind = JIT_HOLE_%s, .addend = %lld, .jump = %s },\n",
+                (unsigned long long)hole->offset, hole->name, (long long)hole->addend, (hole->jump ? "true" : "false")
+            );
+        }
+        fprintf(out, "};\n");
+    }
+
+    fprintf(out, "\nstatic const JitStencil jit_stencils[JIT_STENCIL_COUNT] = {\n");
+    for (size_t i = 0; i < count; ++i) {
+        const Stencil * stencil = &stencils[i];
+        if (stencil->hole_count == 0) {
+            fprintf(out, "    [JIT_STENCIL_%s] = { jit_code_%s, sizeof(jit_code_%s), NULL, 0 },\n",
+                stencil->name, stencil->name, stencil->name
+            );
+        } else {
+            fprintf(out, "    [JIT_STENCIL_%s] = { jit_code_%s, sizeof(jit_code_%s), jit_holes_%s, %zu },\n",
+                stencil->name, stencil->name, stencil->name, stencil->name, stencil->hole_count
+            );
+        }
+    }
+    fprintf(out, "};\n");
+}
+
+/* -=========
+     Main
+   =========- */
+
+int main(int argc, const char ** argv) {
+    if (argc != 3) {
+        fprintf(stderr, "usage: jit_stencil_gen <stencils.o> <output.h>\n");
+        return EXIT_FAILURE;
+    }
+    object_path = argv[1];
+
+    Object object;
+    memset(&object, 0, sizeof(Object));
+    read_object(&object, argv[1]);
+
+    size_t    count;
+    Stencil * stencils = read_stencils(&object, &count);
+
+    FILE * out = fopen(argv[2], "w");
+    if (!out) fail("couldn't write the table", argv[2]);
+    write_table(out, stencils, count);
+    fclose(out);
+
+    for (size_t i = 0; i < count; ++i) free(stencils[i].holes);
+    free(stencils);
+    free(object.data);
+    return EXIT_SUCCESS;
+}
\ No newline at end of file
@@ -0,0 +1,347 @@
+/* -=============
+     Includes
+   =============- */
+
+#define FLUFF_IMPLEMENTATION
+#include <base.h>
+#include <core/object.h>
+
+/* -==============
+     Internals
+   ==============- */
+
+/*
+    Stencils are the native code of each opcode, compiled at build time and copied into chunks by the JIT.
+    Every stencil is a function taking the VM and the frame base, it ends by tail calling the next one.
+
+    The holes are undefined symbols, the large code model loads each of them with a 64-bit immediate that
+    the JIT patches with the address or value it stands for:
+        _JIT_CONTINUE / _JIT_TARGET   = the next instruction / the jump target, or the side exit of a trace
+        _JIT_INSTANCE / _JIT_*_CLASS  = the instance and core classes the chunk is compiled for
+        _JIT_SLOT_A / _JIT_SLOT_B     = byte offsets of stack entries from the frame base
+        _JIT_HELPER / _JIT_DEPTH      = the helper called on the slow path and the stack size given to it
+        _JIT_ARG / _JIT_ARG2          = operands of the instruction
+*/
+
+typedef struct FluffVM FluffVM;
+
+typedef FluffObject *(* JitHelperFn)(FluffVM *, size_t, uint64_t, uint64_t);
+
+extern FluffResult _JIT_CONTINUE(FluffVM *, FluffObject *);
+extern FluffResult _JIT_TARGET(FluffVM *, FluffObject *);
+
+extern char _JIT_INSTANCE[], _JIT_INT_CLASS[], _JIT_FLOAT_CLASS[], _JIT_BOOL_CLASS[];
+extern char _JIT_SLOT_A[], _JIT_SLOT_B[];
+extern char _JIT_HELPER[], _JIT_DEPTH[], _JIT_ARG[], _JIT_ARG2[];
+
+#define JIT_HOLE(name) jit_hole(_JIT_##name)
+
+#define JIT_INSTANCE    ((FluffInstance *)(void *)_JIT_INSTANCE)
+#define JIT_INT_CLASS   ((FluffKlass *)(void *)_JIT_INT_CLASS)
+#define JIT_FLOAT_CLASS ((FluffKlass *)(void *)_JIT_FLOAT_CLASS)
+#define JIT_BOOL_CLASS  ((FluffKlass *)(void *)_JIT_BOOL_CLASS)
+
+#define JIT_SLOT(base, name) ((FluffObject *)((char *)(base) + JIT_HOLE(SLOT_##name)))
+
+// NOTE: helpers give back the frame base, since they might grow the stack, or NULL on failure
+#define JIT_CALL_HELPER(vm, base)\
+    ((JitHelperFn)(void *)_JIT_HELPER)((vm), (size_t)JIT_HOLE(DEPTH), JIT_HOLE(ARG), JIT_HOLE(ARG2))
+
+#define JIT_SLOW_PATH(vm, base)\
+    do {\
+        (base) = JIT_CALL_HELPER(vm, base);\
+        if (!(base)) return FLUFF_FAILURE;\
+        return _JIT_CONTINUE((vm), (base));\
+    } while (0)
+
+#define JIT_STENCIL(name) FluffResult _jit_stencil_##name(FluffVM * vm, FluffObject * base)
+
+// NOTE: the compiler takes holes for addresses and assumes they're never null, so their value is hidden from it
+FLUFF_CONSTEXPR uint64_t jit_hole(const char * symbol) {
+    uint64_t v = (uint64_t)(uintptr_t)symbol;
+    __asm__("" : "+r"(v));
+    return v;
+}
+
+FLUFF_CONSTEXPR bool jit_is_primitive(const FluffObject * obj) {
+    return obj->klass == JIT_INT_CLASS || obj->klass == JIT_FLOAT_CLASS || obj->klass == JIT_BOOL_CLASS;
+}
+
+// NOTE: ints, floats and bools own nothing, only their instance, class and value are copied
+FLUFF_CONSTEXPR void jit_copy_primitive(FluffObject * dst, const FluffObject * src) {
+    dst->instance   = src->instance;
+    dst->klass      = src->klass;
+    dst->data._int  = src->data._int;
+}
+
+/* -=- Arithmetic -=- */
+
+// NOTE: ints wrap around instead of overflowing, which is what the interpreters end up doing
+#define JIT_INT_ADD(a, b) ((FluffInt)((uint64_t)(a) + (uint64_t)(b)))
+#define JIT_INT_SUB(a, b) ((FluffInt)((uint64_t)(a) - (uint64_t)(b)))
+#define JIT_INT_MUL(a, b) ((FluffInt)((uint64_t)(a) * (uint64_t)(b)))
+
+#define JIT_FLOAT_ADD(a, b) ((a) + (b))
+#define JIT_FLOAT_SUB(a, b) ((a) - (b))
+#define JIT_FLOAT_MUL(a, b) ((a) * (b))
+
+#define JIT_ARITH_STENCILS(name, op)\
+    JIT_STENCIL(name) {\
+        FluffObject * lhs = JIT_SLOT(base, A), * rhs = JIT_SLOT(base, B);\
+        if (lhs->klass == JIT_INT_CLASS && rhs->klass == JIT_INT_CLASS) {\
+            lhs->data._int = JIT_INT_##op(lhs->data._int, rhs->data._int);\
+            return _JIT_CONTINUE(vm, base);\
+        }\
+        if (lhs->klass == JIT_FLOAT_CLASS && rhs->klass == JIT_FLOAT_CLASS) {\
+            lhs->data._float = JIT_FLOAT_##op(lhs->data._float, rhs->data._float);\
+            return _JIT_CONTINUE(vm, base);\
+        }\
+        JIT_SLOW_PATH(vm, base);\
+    }\
+    JIT_STENCIL(I##name) {\
+        FluffObject * lhs = JIT_SLOT(base, A), * rhs = JIT_SLOT(base, B);\
+        lhs->data._int = JIT_INT_##op(lhs->data._int, rhs->data._int);\
+        return _JIT_CONTINUE(vm, base);\
+    }\
+    JIT_STENCIL(F##name) {\
+        FluffObject * lhs = JIT_SLOT(base, A), * rhs = JIT_SLOT(base, B);\
+        lhs->data._float = JIT_FLOAT_##op(lhs->data._float, rhs->data._float);\
+        return _JIT_CONTINUE(vm, base);\
+    }
+
+#define JIT_COMPARE_STENCILS(name, op)\
+    JIT_STENCIL(name) {\
+        FluffObject * lhs = JIT_SLOT(base, A), * rhs = JIT_SLOT(base, B);\
+        if (lhs->klass == JIT_INT_CLASS && rhs->klass == JIT_INT_CLASS) {\
+            lhs->data._bool = (lhs->data._int op rhs->data._int);\
+            lhs->klass      = JIT_BOOL_CLASS;\
+            return _JIT_CONTINUE(vm, base);\
+        }\
+        if (lhs->klass == JIT_FLOAT_CLASS && rhs->klass == JIT_FLOAT_CLASS) {\
+            lhs->data._bool = (lhs->data._float op rhs->data._float);\
+            lhs->klass      = JIT_BOOL_CLASS;\
+            return _JIT_CONTINUE(vm, base);\
+        }\
+        JIT_SLOW_PATH(vm, base);\
+    }\
+    JIT_STENCIL(I##name) {\
+        FluffObject * lhs = JIT_SLOT(base, A), * rhs = JIT_SLOT(base, B);\
+        lhs->data._bool = (lhs->data._int op rhs->data._int);\
+        lhs->klass      = JIT_BOOL_CLASS;\
+        return _JIT_CONTINUE(vm, base);\
+    }\
+    JIT_STENCIL(F##name) {\
+        FluffObject * lhs = JIT_SLOT(base, A), * rhs = JIT_SLOT(base, B);\
+        lhs->data._bool = (lhs->data._float op rhs->data._float);\
+        lhs->klass      = JIT_BOOL_CLASS;\
+        return _JIT_CONTINUE(vm, base);\
+    }
+
+/* -==============
+     Stencils
+   ==============- */
+
+/* -=- Arithmetic -=- */
+JIT_ARITH_STENCILS(ADD, ADD)
+JIT_ARITH_STENCILS(SUB, SUB)
+JIT_ARITH_STENCILS(MUL, MUL)
+
+JIT_COMPARE_STENCILS(EQ, ==)
+JIT_COMPARE_STENCILS(NE, !=)
+JIT_COMPARE_STENCILS(GT, >)
+JIT_COMPARE_STENCILS(GE, >=)
+JIT_COMPARE_STENCILS(LT, <)
+JIT_COMPARE_STENCILS(LE, <=)
+
+JIT_STENCIL(ADD_INT) {
+    FluffObject * top = JIT_SLOT(base, A);
+    if (top->klass != JIT_INT_CLASS) JIT_SLOW_PATH(vm, base);
+    top->data._int = JIT_INT_ADD(top->data._int, JIT_HOLE(ARG));
+    return _JIT_CONTINUE(vm, base);
+}
+
+JIT_STENCIL(SUB_INT) {
+    FluffObject * top = JIT_SLOT(base, A);
+    if (top->klass != JIT_INT_CLASS) JIT_SLOW_PATH(vm, base);
+    top->data._int = JIT_INT_SUB(top->data._int, JIT_HOLE(ARG));
+    return _JIT_CONTINUE(vm, base);
+}
+
+/* -=- Control flow -=- */
+JIT_STENCIL(JMP) {
+    return _JIT_TARGET(vm, base);
+}
+
+// NOTE: the helper reports the condition not being a bool
+JIT_STENCIL(JZ) {
+    const FluffObject * top = JIT_SLOT(base, A);
+    if (top->klass != JIT_BOOL_CLASS) {
+        JIT_CALL_HELPER(vm, base);
+        return FLUFF_FAILURE;
+    }
+    if (!top->data._bool) return _JIT_TARGET(vm, base);
+    return _JIT_CONTINUE(vm, base);
+}
+
+JIT_STENCIL(JNZ) {
+    const FluffObject * top = JIT_SLOT(base, A);
+    if (top->klass != JIT_BOOL_CLASS) {
+        JIT_CALL_HELPER(vm, base);
+        return FLUFF_FAILURE;
+    }
+    if (top->data._bool) return _JIT_TARGET(vm, base);
+    return _JIT_CONTINUE(vm, base);
+}
+
+// NOTE: the helper leaves the result where the left operand was
+JIT_STENCIL(LT_JZ) {
+    const FluffObject * lhs = JIT_SLOT(base, A), * rhs = JIT_SLOT(base, B);
+    if (lhs->klass == JIT_INT_CLASS && rhs->klass == JIT_INT_CLASS) {
+        if (lhs->data._int >= rhs->data._int) return _JIT_TARGET(vm, base);
+        return _JIT_CONTINUE(vm, base);
+    }
+
+    base = JIT_CALL_HELPER(vm, base);
+    if (!base) return FLUFF_FAILURE;
+    if (!JIT_SLOT(base, A)->data._bool) return _JIT_TARGET(vm, base);
+    return _JIT_CONTINUE(vm, base);
+}
+
+JIT_STENCIL(ILT_JZ) {
+    const FluffObject * lhs = JIT_SLOT(base, A), * rhs = JIT_SLOT(base, B);
+    if (lhs->data._int >= rhs->data._int) return _JIT_TARGET(vm, base);
+    return _JIT_CONTINUE(vm, base);
+}
+
+JIT_STENCIL(ILT_JNZ) {
+    const FluffObject * lhs = JIT_SLOT(base, A), * rhs = JIT_SLOT(base, B);
+    if (lhs->data._int < rhs->data._int) return _JIT_TARGET(vm, base);
+    return _JIT_CONTINUE(vm, base);
+}
+
+// NOTE: the helper pops the frame, so there's nothing left to continue to
+JIT_STENCIL(RET) {
+    if (!JIT_CALL_HELPER(vm, base)) return FLUFF_FAILURE;
+    return FLUFF_OK;
+}
+
+/* -=- Constants -=- */
+JIT_STENCIL(PUSH_INT) {
+    FluffObject * top = JIT_SLOT(base, A);
+    top->instance  = JIT_INSTANCE;
+    top->klass     = JIT_INT_CLASS;
+    top->data._int = (FluffInt)JIT_HOLE(ARG);
+    return _JIT_CONTINUE(vm, base);
+}
+
+// NOTE: 'ARG' holds the bits of the float
+JIT_STENCIL(PUSH_FLOAT) {
+    FluffObject * top = JIT_SLOT(base, A);
+    top->instance  = JIT_INSTANCE;
+    top->klass     = JIT_FLOAT_CLASS;
+    top->data._int = (FluffInt)JIT_HOLE(ARG);
+    return _JIT_CONTINUE(vm, base);
+}
+
+JIT_STENCIL(PUSH_BOOL) {
+    FluffObject * top = JIT_SLOT(base, A);
+    top->instance   = JIT_INSTANCE;
+    top->klass      = JIT_BOOL_CLASS;
+    top->data._bool = (FluffBool)JIT_HOLE(ARG);
+    return _JIT_CONTINUE(vm, base);
+}
+
+/* -=- Locals -=- */
+
+// NOTE: 'A' is the local, 'B' is the entry right past the top
+JIT_STENCIL(GET_LOCAL) {
+    const FluffObject * local = JIT_SLOT(base, A);
+    if (!jit_is_primitive(local)) JIT_SLOW_PATH(vm, base);
+    jit_copy_primitive(JIT_SLOT(base, B), local);
+    return _JIT_CONTINUE(vm, base);
+}
+
+// NOTE: 'A' is the local, 'B' is the top
+JIT_STENCIL(SET_LOCAL) {
+    FluffObject * local = JIT_SLOT(base, A), * top = JIT_SLOT(base, B);
+    if (!jit_is_primitive(local) || !jit_is_primitive(top)) JIT_SLOW_PATH(vm, base);
+    jit_copy_primitive(local, top);
+    return _JIT_CONTINUE(vm, base);
+}
+
+// NOTE: the top entry is moved into the local, whatever it is
+JIT_STENCIL(STORE_LOCAL) {
+    FluffObject * local = JIT_SLOT(base, A);
+    if (!jit_is_primitive(local)) JIT_SLOW_PATH(vm, base);
+    * local = * JIT_SLOT(base, B);
+    return _JIT_CONTINUE(vm, base);
+}
+
+// NOTE: 'ARG2' is the value being added, like the helper takes it
+JIT_STENCIL(INC_LOCAL) {
+    FluffObject * local = JIT_SLOT(base, A);
+    if (local->klass != JIT_INT_CLASS) JIT_SLOW_PATH(vm, base);
+    local->data._int = JIT_INT_ADD(local->data._int, JIT_HOLE(ARG2));
+    return _JIT_CONTINUE(vm, base);
+}
+
+// NOTE: the sum is pushed, right past the top
+JIT_STENCIL(ADD_LOCALS) {
+    const FluffObject * lhs = JIT_SLOT(base, A), * rhs = JIT_SLOT(base, B);
+    if (lhs->klass != JIT_INT_CLASS || rhs->klass != JIT_INT_CLASS) JIT_SLOW_PATH(vm, base);
+
+    FluffObject * top = &base[JIT_HOLE(DEPTH)];
+    top->instance  = JIT_INSTANCE;
+    top->klass     = JIT_INT_CLASS;
+    top->data._int = JIT_INT_ADD(lhs->data._int, rhs->data._int);
+    return _JIT_CONTINUE(vm, base);
+}
+
+/* -=- Checks -=- */
+
+// NOTE: the helper reports the mismatch
+JIT_STENCIL(CHECK) {
+    if (JIT_SLOT(base, A)->klass != (FluffKlass *)(void *)_JIT_ARG) {
+        JIT_CALL_HELPER(vm, base);
+        return FLUFF_FAILURE;
+    }
+    return _JIT_CONTINUE(vm, base);
+}
+
+/* -=- Traces -=- */
+
+// NOTE: 'TARGET' is the side exit taken when the entry isn't of the class the trace was recorded with
+JIT_STENCIL(GUARD) {
+    if (JIT_SLOT(base, A)->klass != (FluffKlass *)(void *)_JIT_ARG) return _JIT_TARGET(vm, base);
+    return _JIT_CONTINUE(vm, base);
+}
+
+// NOTE: 'A' is copied into 'B', the trace already guarded it's a primitive
+JIT_STENCIL(COPY) {
+    jit_copy_primitive(JIT_SLOT(base, B), JIT_SLOT(base, A));
+    return _JIT_CONTINUE(vm, base);
+}
+
+// NOTE: the entries written below already have the right class, only their value is written
+JIT_STENCIL(COPY_DATA) {
+    JIT_SLOT(base, B)->data._int = JIT_SLOT(base, A)->data._int;
+    return _JIT_CONTINUE(vm, base);
+}
+
+JIT_STENCIL(SET_DATA) {
+    JIT_SLOT(base, A)->data._int = (FluffInt)JIT_HOLE(ARG);
+    return _JIT_CONTINUE(vm, base);
+}
+
+JIT_STENCIL(ADD_DATA) {
+    FluffObject * obj = JIT_SLOT(base, A);
+    obj->data._int = JIT_INT_ADD(obj->data._int, JIT_HOLE(ARG));
+    return _JIT_CONTINUE(vm, base);
+}
+
+/* -=- Helpers -=- */
+
+// NOTE: anything without a stencil of its own runs through its helper
+JIT_STENCIL(HELPER) {
+    JIT_SLOW_PATH(vm, base);
+}
\ No newline at end of file